@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoBeadRenderer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Renders DemoCamera's fluorescent bead images
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DemoBeadRenderer.h"
+#include "DemoWorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const unsigned TileSize = 64;
+
+// Spots are drawn out to 4 sigma, where exp(-u) has u = 8 along the axes
+// and u = 16 in the corners of the box
+const float ExpRange = 16.0f;
+const unsigned ExpStepsPerUnit = 256;
+const unsigned ExpSteps = static_cast<unsigned>(ExpRange) * ExpStepsPerUnit;
+
+// A full tile row at a time, so that the trip count is constant and the
+// compiler vectorizes the loop
+inline void AddScaledRow(float* __restrict row, const float* __restrict profile,
+   float weight)
+{
+   for (unsigned i = 0; i < TileSize; ++i)
+      row[i] += weight * profile[i];
+}
+
+} // namespace
+
+DemoBeadRenderer::DemoBeadRenderer()
+{
+   // One extra entry for interpolating at the end of the range
+   expTable_.resize(ExpSteps + 2);
+   for (unsigned i = 0; i < expTable_.size(); ++i)
+      expTable_[i] = static_cast<float>(std::exp(-static_cast<double>(i) / ExpStepsPerUnit));
+}
+
+float DemoBeadRenderer::Profile(float u) const
+{
+   if (u >= ExpRange)
+      return 0.0f;
+   const float f = u * ExpStepsPerUnit;
+   const unsigned i = static_cast<unsigned>(f);
+   const float t = f - static_cast<float>(i);
+   return expTable_[i] + t * (expTable_[i + 1] - expTable_[i]);
+}
+
+void DemoBeadRenderer::BinSpots(const std::vector<Spot>& spots)
+{
+   for (auto& bin : bins_)
+      bin.clear();
+   boxes_.clear();
+
+   for (const Spot& spot : spots)
+   {
+      const double sigma = std::max(spot.sigma, 0.5);
+      const int radius = static_cast<int>(4.0 * sigma) + 1;
+      Box box;
+      box.x0 = std::max(0, static_cast<int>(std::floor(spot.x)) - radius);
+      box.x1 = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::floor(spot.x)) + radius);
+      box.y0 = std::max(0, static_cast<int>(std::floor(spot.y)) - radius);
+      box.y1 = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::floor(spot.y)) + radius);
+      if (box.x0 > box.x1 || box.y0 > box.y1 || spot.amplitude <= 0.0)
+         continue;
+      box.x = static_cast<float>(spot.x);
+      box.y = static_cast<float>(spot.y);
+      box.inverseTwoSigmaSq = static_cast<float>(1.0 / (2.0 * sigma * sigma));
+      box.amplitude = static_cast<float>(spot.amplitude);
+
+      const std::uint32_t index = static_cast<std::uint32_t>(boxes_.size());
+      boxes_.push_back(box);
+      for (unsigned ty = box.y0 / TileSize; ty <= box.y1 / TileSize; ++ty)
+         for (unsigned tx = box.x0 / TileSize; tx <= box.x1 / TileSize; ++tx)
+            bins_[ty * tilesX_ + tx].push_back(index);
+   }
+}
+
+template <typename T, unsigned Components>
+void DemoBeadRenderer::RenderTile(unsigned tile, T* pixels, float maxValue) const
+{
+   const int tx0 = static_cast<int>((tile % tilesX_) * TileSize);
+   const int ty0 = static_cast<int>((tile / tilesX_) * TileSize);
+   const int tw = std::min(static_cast<int>(TileSize), static_cast<int>(width_) - tx0);
+   const int th = std::min(static_cast<int>(TileSize), static_cast<int>(height_) - ty0);
+
+   if (bins_[tile].empty())
+   {
+      for (int y = 0; y < th; ++y)
+         std::memset(pixels + (static_cast<std::size_t>(ty0 + y) * width_ + tx0) * Components,
+            0, static_cast<std::size_t>(tw) * Components * sizeof(T));
+      return;
+   }
+
+   float acc[TileSize * TileSize];
+   std::fill(acc, acc + TileSize * th, 0.0f);
+
+   float gx[TileSize];
+   for (std::uint32_t index : bins_[tile])
+   {
+      const Box& box = boxes_[index];
+      const int xa = std::max(box.x0, tx0);
+      const int xb = std::min(box.x1, tx0 + tw - 1);
+      const int ya = std::max(box.y0, ty0);
+      const int yb = std::min(box.y1, ty0 + th - 1);
+
+      // Zero outside the spot's box, which may end within the tile
+      for (int i = 0; i < static_cast<int>(TileSize); ++i)
+      {
+         const int x = tx0 + i;
+         const float dx = static_cast<float>(x) - box.x;
+         gx[i] = (x >= xa && x <= xb) ?
+            Profile(dx * dx * box.inverseTwoSigmaSq) : 0.0f;
+      }
+      for (int y = ya; y <= yb; ++y)
+      {
+         const float dy = static_cast<float>(y) - box.y;
+         const float wy = box.amplitude * Profile(dy * dy * box.inverseTwoSigmaSq);
+         if (wy != 0.0f)
+            AddScaledRow(acc + (y - ty0) * TileSize, gx, wy);
+      }
+   }
+
+   // RGB images (BGRA byte order) are drawn in the green channel
+   const unsigned channel = (Components == 4) ? 1 : 0;
+   for (int y = 0; y < th; ++y)
+   {
+      const float* row = acc + y * TileSize;
+      T* out = pixels + (static_cast<std::size_t>(ty0 + y) * width_ + tx0) * Components;
+      for (int x = 0; x < tw; ++x)
+      {
+         if (Components > 1)
+            std::memset(out + x * Components, 0, Components * sizeof(T));
+         out[x * Components + channel] = static_cast<T>(std::min(row[x], maxValue));
+      }
+   }
+}
+
+template <typename T, unsigned Components>
+void DemoBeadRenderer::RenderTiles(T* pixels, float maxValue, DemoWorkerPool& pool)
+{
+   pool.ParallelFor(bins_.size(), 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t tile = begin; tile < end; ++tile)
+         RenderTile<T, Components>(static_cast<unsigned>(tile), pixels, maxValue);
+   });
+}
+
+void DemoBeadRenderer::Render(unsigned char* pixels, unsigned width,
+   unsigned height, unsigned bytesPerPixel, unsigned components,
+   const std::vector<Spot>& spots, DemoWorkerPool& pool)
+{
+   if (width == 0 || height == 0)
+      return;
+
+   width_ = width;
+   height_ = height;
+   tilesX_ = (width + TileSize - 1) / TileSize;
+   tilesY_ = (height + TileSize - 1) / TileSize;
+   bins_.resize(static_cast<std::size_t>(tilesX_) * tilesY_);
+   BinSpots(spots);
+
+   if (bytesPerPixel == 1)
+      RenderTiles<unsigned char, 1>(pixels, 255.0f, pool);
+   else if (bytesPerPixel == 2)
+      RenderTiles<unsigned short, 1>(reinterpret_cast<unsigned short*>(pixels), 65535.0f, pool);
+   else if (bytesPerPixel == 4 && components == 1)
+      RenderTiles<float, 1>(reinterpret_cast<float*>(pixels), 1.0f, pool);
+   else if (bytesPerPixel == 4 && components == 4)
+      RenderTiles<unsigned char, 4>(pixels, 255.0f, pool);
+   else
+      std::memset(pixels, 0, static_cast<std::size_t>(width) * height * bytesPerPixel);
+}
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoBeadRenderer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Renders DemoCamera's fluorescent bead images
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class DemoWorkerPool;
+
+/**
+ * Draws Gaussian spots on a black image.
+ *
+ * The image is divided into square tiles, and each spot is binned into the
+ * tiles its 4-sigma box overlaps. Tiles are rendered in parallel, each into
+ * a small floating point accumulator that is converted to the pixel type
+ * once, so that overlapping spots add up without intermediate rounding.
+ *
+ * A Gaussian is separable: exp(-(dx^2 + dy^2) / 2s^2) is the product of an
+ * x profile and a y profile. Per spot and tile, the two profiles are read
+ * from a lookup table of exp(-u), and the spot is added as their outer
+ * product, so no exp() is evaluated per pixel.
+ */
+class DemoBeadRenderer
+{
+public:
+   struct Spot {
+      double x; // Center, in pixels
+      double y;
+      double sigma; // In pixels
+      double amplitude; // Peak value
+   };
+
+   DemoBeadRenderer();
+
+   // Supported formats are 8 and 16 bit and 32 bit float grayscale, and
+   // 32 bit RGB (spots are drawn in green). Other formats are left black.
+   // Pixel values are clipped to the range of the type (to 1.0 for float).
+   void Render(unsigned char* pixels, unsigned width, unsigned height,
+      unsigned bytesPerPixel, unsigned components,
+      const std::vector<Spot>& spots, DemoWorkerPool& pool);
+
+private:
+   struct Box {
+      float x, y;
+      float inverseTwoSigmaSq;
+      float amplitude;
+      int x0, y0, x1, y1; // Inclusive, within the image
+   };
+
+   template <typename T, unsigned Components>
+   void RenderTiles(T* pixels, float maxValue, DemoWorkerPool& pool);
+   template <typename T, unsigned Components>
+   void RenderTile(unsigned tile, T* pixels, float maxValue) const;
+
+   void BinSpots(const std::vector<Spot>& spots);
+   float Profile(float u) const;
+
+   std::vector<float> expTable_;
+
+   unsigned width_ = 0;
+   unsigned height_ = 0;
+   unsigned tilesX_ = 0;
+   unsigned tilesY_ = 0;
+   std::vector<Box> boxes_;
+   std::vector<std::vector<std::uint32_t>> bins_; // Box indices per tile
+};
@@ -35,6 +35,8 @@
 #include <algorithm>
 #include <iostream>
 #include <future>
+#include <chrono>
+#include <thread>
 
 #ifdef _WIN32
    #include <timeapi.h>
@@ -75,6 +77,10 @@ const char* g_Norm_Noise = "Noise";
 const char* g_Color_Test = "Color Test Pattern";
 const char* g_Beads = "Fluorescent Beads";
 
+// constants for naming noise generation methods
+const char* g_Noise_PerPixel = "Per Pixel";
+const char* g_Noise_TileCache = "Tile Cache";
+
 const char* g_PropImposedPressure = "Imposed Pressure";
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -381,6 +387,24 @@ int CDemoCamera::Initialize()
    CreateFloatProperty(propName.c_str(), photonFlux_, false, pAct);
    SetPropertyLimits(propName.c_str(), 2.0, 5000.0);
 
+   // How the Noise mode generates pixels: a random value for every pixel,
+   // or rows taken from a precomputed noise tile (faster, for load testing)
+   pAct = new CPropertyAction(this, &CDemoCamera::OnNoiseGeneration);
+   propName = "NoiseGeneration";
+   CreateStringProperty(propName.c_str(), g_Noise_PerPixel, false, pAct);
+   AddAllowedValue(propName.c_str(), g_Noise_PerPixel);
+   AddAllowedValue(propName.c_str(), g_Noise_TileCache);
+
+   // Threads used to generate Noise mode images
+   pAct = new CPropertyAction(this, &CDemoCamera::OnGenerationThreads);
+   propName = "GenerationThreads";
+   CreateIntegerProperty(propName.c_str(), generationThreads_, false, pAct);
+   SetPropertyLimits(propName.c_str(), 1, 64);
+
+   // Frame timing jitter of the current or last sequence acquisition
+   pAct = new CPropertyAction(this, &CDemoCamera::OnFrameTimingJitter);
+   CreateFloatProperty(MM::g_Keyword_FrameTimingJitter_ms, 0.0, true, pAct);
+
    // Bead mode properties
    pAct = new CPropertyAction(this, &CDemoCamera::OnBeadDensity);
    nRet = CreateIntegerProperty("BeadDensity", beadDensity_, false, pAct);
@@ -451,6 +475,10 @@ int CDemoCamera::Initialize()
 int CDemoCamera::Shutdown()
 {
    initialized_ = false;
+   {
+      MMThreadGuard g(imgPixelsLock_);
+      workerPool_.reset();
+   }
    return DEVICE_OK;
 }
 
@@ -463,6 +491,7 @@ int CDemoCamera::Shutdown()
 int CDemoCamera::SnapImage()
 {
    MM::MMTime startTime = GetCurrentMMTime();
+   const MMFramePacer::Clock::time_point snapStart = MMFramePacer::Clock::now();
    double exp = GetExposure();
    if (sequenceRunning_ && IsCapturing()) 
    {
@@ -477,10 +506,9 @@ int CDemoCamera::SnapImage()
    MM::MMTime s0(0,0);
    if( s0 < startTime )
    {
-      while (exp > (GetCurrentMMTime() - startTime).getMsec())
-      {
-         CDeviceUtils::SleepMs(1);
-      }
+      std::this_thread::sleep_until(snapStart +
+         std::chrono::duration_cast<MMFramePacer::Clock::duration>(
+            std::chrono::duration<double, std::milli>(exp)));
    }
    else
    {
@@ -956,9 +984,9 @@ int CDemoCamera::StartSequenceAcquisition(long numImages, double interval_ms, bo
 }
 
 /*
- * Inserts Image and MetaData into MMCore circular Buffer
+ * Builds the metadata that is sent to MMCore along with each sequence image
  */
-int CDemoCamera::InsertImage()
+MM::CameraImageMetadata CDemoCamera::BuildSequenceImageMetadata()
 {
    MM::MMTime timeStamp = this->GetCurrentMMTime();
    char label[MM::MaxStrLength];
@@ -977,6 +1005,15 @@ int CDemoCamera::InsertImage()
    char buf[MM::MaxStrLength];
    GetProperty(MM::g_Keyword_Binning, buf);
    md.AddTag(MM::g_Keyword_Binning, buf);
+   return md;
+}
+
+/*
+ * Inserts Image and MetaData into MMCore circular Buffer
+ */
+int CDemoCamera::InsertImage()
+{
+   MM::CameraImageMetadata md = BuildSequenceImageMetadata();
 
    MMThreadGuard g(imgPixelsLock_);
 
@@ -990,14 +1027,56 @@ int CDemoCamera::InsertImage()
    return GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_, md.Serialize());
 }
 
+/*
+ * Generates the next sequence image directly into a slot of the MMCore
+ * circular buffer, avoiding the copy made by InsertImage(). Falls back to
+ * generating into img_ and inserting it if the Core does not provide a slot.
+ */
+int CDemoCamera::GenerateAndInsertImage(double exposure)
+{
+   unsigned int w = GetImageWidth();
+   unsigned int h = GetImageHeight();
+   unsigned int b = GetImageBytesPerPixel();
+
+   unsigned char* pixels = nullptr;
+   int ret = GetCoreCallback()->AcquireImageWriteSlot(this, w, h, b,
+         nComponents_, &pixels);
+   if (ret == DEVICE_NOT_SUPPORTED)
+   {
+      GenerateSyntheticImage(img_, exposure);
+      return InsertImage();
+   }
+   if (ret != DEVICE_OK)
+      return ret;
+
+   // Gives the slot back if generating the image throws; until then, other
+   // images cannot be inserted
+   struct SlotGuard
+   {
+      CDemoCamera* camera;
+      unsigned char* pixels;
+      ~SlotGuard()
+      {
+         if (pixels)
+            camera->GetCoreCallback()->AbortImageWriteSlot(camera, pixels);
+      }
+   } slotGuard{this, pixels};
+
+   ImgBuffer slotImg(pixels, w, h, b);
+   GenerateSyntheticImage(slotImg, exposure);
+
+   MM::CameraImageMetadata md = BuildSequenceImageMetadata();
+   const char* serialized = md.Serialize();
+   slotGuard.pixels = nullptr; // Committing takes the slot, even on failure
+   return GetCoreCallback()->CommitImageWriteSlot(this, pixels, serialized);
+}
+
 /*
  * Do actual capturing
  * Called from inside the thread  
  */
 int CDemoCamera::RunSequenceOnThread()
 {
-   MM::MMTime startTime = GetCurrentMMTime();
-   
    // Trigger
    if (triggerDevice_.length() > 0) {
       MM::Device* triggerDev = GetDevice(triggerDevice_.c_str());
@@ -1009,20 +1088,22 @@ int CDemoCamera::RunSequenceOnThread()
 
    double exposure = GetSequenceExposure();
 
+   // Simulate exposure duration. Exposures follow each other on a fixed
+   // schedule, as on a camera that reads out one frame while exposing the
+   // next, so generating and inserting images does not lower the frame rate
+   // as long as it takes less than the exposure time.
    if (!fastImage_)
    {
-      GenerateSyntheticImage(img_, exposure);
+      if (!thd_->pacer_.WaitForNextFrame(exposure))
+         return DEVICE_OK;
 
-      // Simulate exposure duration
-      while ((GetCurrentMMTime() - startTime).getMsec() < exposure)
-      {
-         CDeviceUtils::SleepMs(1);
-      }
+      // The image is generated after the exposure, so that the Core's write
+      // slot is only held while the image is rendered.
+      return GenerateAndInsertImage(exposure);
    }
    else {
-      unsigned long wait = (unsigned long) exposure;
-      wait = wait < 1 ? 1ul : wait;
-      CDeviceUtils::SleepMs(wait);
+      if (!thd_->pacer_.WaitForNextFrame(std::max(exposure, 1.0)))
+         return DEVICE_OK;
    }
 
    return InsertImage();
@@ -1056,6 +1137,7 @@ MySequenceThread::~MySequenceThread() {}
 void MySequenceThread::Stop() {
    MMThreadGuard g(this->stopLock_);
    stop_=true;
+   pacer_.Stop();
 }
 
 void MySequenceThread::Start(long numImages, double intervalMs)
@@ -1067,6 +1149,7 @@ void MySequenceThread::Start(long numImages, double intervalMs)
    imageCounter_=0;
    stop_ = false;
    suspend_=false;
+   pacer_.Start();
    activate();
    actualDuration_ = MM::MMTime{};
    startTime_= camera_->GetCurrentMMTime();
@@ -1828,6 +1911,51 @@ int CDemoCamera::OnReadNoise(MM::PropertyBase* pProp, MM::ActionType eAct)
    return DEVICE_OK;
 }
 
+int CDemoCamera::OnNoiseGeneration(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(noiseMethod_ == DemoNoiseGenerator::Method::TileCache ?
+            g_Noise_TileCache : g_Noise_PerPixel);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string val;
+      pProp->Get(val);
+      MMThreadGuard g(imgPixelsLock_);
+      noiseMethod_ = (val == g_Noise_TileCache) ?
+            DemoNoiseGenerator::Method::TileCache :
+            DemoNoiseGenerator::Method::PerPixel;
+   }
+   return DEVICE_OK;
+}
+
+int CDemoCamera::OnGenerationThreads(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(generationThreads_);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      long threads = 1;
+      pProp->Get(threads);
+      MMThreadGuard g(imgPixelsLock_);
+      generationThreads_ = threads;
+   }
+   return DEVICE_OK;
+}
+
+int CDemoCamera::OnFrameTimingJitter(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(thd_->GetFramePacer().GetJitterMs());
+   }
+   // no AfterSet as this is a readonly property
+   return DEVICE_OK;
+}
+
 
 int CDemoCamera::OnCrash(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
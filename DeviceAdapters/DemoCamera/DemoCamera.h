@@ -32,8 +32,13 @@
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
+#include "FramePacer.h"
+#include "DemoBeadRenderer.h"
+#include "DemoNoiseGenerator.h"
+#include "DemoWorkerPool.h"
 #include <string>
 #include <map>
+#include <memory>
 #include <algorithm>
 #include <cstring>
 #include <stdint.h>
@@ -204,6 +209,7 @@ public:
    int StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow);
    int StopSequenceAcquisition();
    int InsertImage();
+   int GenerateAndInsertImage(double exposure);
    int RunSequenceOnThread();
    bool IsCapturing();
    void OnThreadExiting() throw(); 
@@ -251,6 +257,9 @@ public:
    int OnPCF(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnPhotonFlux(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnReadNoise(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnNoiseGeneration(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnGenerationThreads(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnFrameTimingJitter(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnCrash(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnBeadDensity(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnBeadSize(MM::PropertyBase* pProp, MM::ActionType eAct);
@@ -258,11 +267,6 @@ public:
    int OnBeadBlurRate(MM::PropertyBase* pProp, MM::ActionType eAct);
 
    // Special public DemoCamera methods
-   void AddBackgroundAndNoise(ImgBuffer& img, double mean, double stdDev);
-   void AddSignal(ImgBuffer& img, double photonFlux, double exp, double cf);
-   // this function replace normal_distribution in C++11
-   double GaussDistributedValue(double mean, double std);
-
    int RegisterImgManipulatorCallBack(ImgManipulator* imgManpl);
    long GetCCDXSize() { return cameraCCDXSize_; }
    long GetCCDYSize() { return cameraCCDYSize_; }
@@ -270,15 +274,17 @@ public:
 
 private:
    int SetAllowedBinning();
+   MM::CameraImageMetadata BuildSequenceImageMetadata();
    void TestResourceLocking(const bool);
    void GenerateEmptyImage(ImgBuffer& img);
    void GenerateSyntheticImage(ImgBuffer& img, double exp);
    bool GenerateColorTestPattern(ImgBuffer& img);
+   void FillNoise(ImgBuffer& img, double mean, double stdDev, bool accumulate);
+   DemoWorkerPool& GetWorkerPool();
    int ResizeImageBuffer();
-   void GenerateBeadPositions();
+   void GenerateBeadPositions(double stageX, double stageY, double viewWidth, double viewHeight, double margin);
    void GenerateBeadsForTile(int tileX, int tileY, std::vector<Bead>& beads);
    unsigned int HashTileCoords(int tileX, int tileY);
-   void RenderBeadToImage(ImgBuffer& img, const Bead& bead, double blurRadius, double stageX, double stageY);
    void GenerateBeadsImage(ImgBuffer& img, double exposure);
    double GetCurrentZPosition();
    void GetCurrentXYPosition(double& x, double& y);
@@ -338,6 +344,12 @@ private:
    double pcf_ = 1.0;
    double photonFlux_ = 50.0;
    double readNoise_ = 2.5;
+
+   // Noise mode image generation (guarded by imgPixelsLock_)
+   DemoNoiseGenerator noiseGenerator_;
+   DemoNoiseGenerator::Method noiseMethod_ = DemoNoiseGenerator::Method::PerPixel;
+   std::unique_ptr<DemoWorkerPool> workerPool_;
+   long generationThreads_ = DemoWorkerPool::DefaultThreadCount();
    
    // Bead mode members
    std::vector<Bead> beads_;
@@ -346,6 +358,8 @@ private:
    double beadSize_ = 2.0;
    double beadBrightness_ = 1.0;
    double beadBlurRate_ = 0.5;
+   DemoBeadRenderer beadRenderer_;
+   std::vector<DemoBeadRenderer::Spot> beadSpots_;
 };
 
 class MySequenceThread : public MMDeviceThreadBase
@@ -366,6 +380,7 @@ class MySequenceThread : public MMDeviceThreadBase
       long GetImageCounter(){return imageCounter_;}                             
       MM::MMTime GetStartTime(){return startTime_;}                             
       MM::MMTime GetActualDuration(){return actualDuration_;}
+      const MMFramePacer& GetFramePacer() const {return pacer_;}
    private:
       int svc(void) throw();
       double intervalMs_ = 100;
@@ -377,6 +392,7 @@ class MySequenceThread : public MMDeviceThreadBase
       MM::MMTime startTime_;
       MM::MMTime actualDuration_;
       MM::MMTime lastFrameTime_;
+      MMFramePacer pacer_;
       MMThreadLock stopLock_;
       MMThreadLock suspendLock_;
 };
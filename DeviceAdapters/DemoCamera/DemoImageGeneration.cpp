@@ -62,8 +62,13 @@ void CDemoCamera::GenerateSyntheticImage(ImgBuffer& img, double exp)
          offset = 100;
       }
 	   double readNoiseDN = readNoise_ / pcf_;
-      AddBackgroundAndNoise(img, offset, readNoiseDN);
-      AddSignal (img, photonFlux_, exp, pcf_);
+      // Read noise and shot noise are independent and Gaussian, so both are
+      // generated in a single pass with the summed variance
+      double photons = photonFlux_ * exp;
+      double signalDN = photons / pcf_;
+      double shotNoiseDN = sqrt(photons) / pcf_;
+      FillNoise(img, offset + signalDN,
+            sqrt(readNoiseDN * readNoiseDN + shotNoiseDN * shotNoiseDN), false);
       if (imgManpl_ != 0)
       {
          imgManpl_->ChangePixels(img);
@@ -523,132 +528,44 @@ bool CDemoCamera::GenerateColorTestPattern(ImgBuffer& img)
 
 
 /**
-* Generate an image with offset plus noise
+* Sets (or, if accumulate is true, adds to) each pixel a Gaussian distributed
+* value, clipped to the camera's bit depth. Only 8 and 16 bit grayscale
+* images (1 and 2 bytes per pixel) are supported.
+* Rows are generated in parallel on the worker pool.
 */
-void CDemoCamera::AddBackgroundAndNoise(ImgBuffer& img, double mean, double stdDev)
+void CDemoCamera::FillNoise(ImgBuffer& img, double mean, double stdDev, bool accumulate)
 {
-	char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-	std::string pixelType(buf);
-
-   int maxValue = 1 << GetBitDepth();
-   long nrPixels = img.Width() * img.Height();
-   if (pixelType.compare(g_PixelType_8bit) == 0)
+   if (img.Depth() != 1 && img.Depth() != 2)
+      return;
+   unsigned bits = std::min(GetBitDepth(), 8 * img.Depth());
+   unsigned maxValue = (1u << bits) - 1;
+   unsigned char* pixels = img.GetPixelsRW();
+   if (img.Depth() == 1)
    {
-      unsigned char* pBuf = (unsigned char*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++)
-      {
-         double value = GaussDistributedValue(mean, stdDev);
-         if (value < 0)
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned char) value;
-      }
+      noiseGenerator_.Fill(pixels, img.Width(), img.Height(), mean, stdDev,
+            maxValue, accumulate, noiseMethod_, GetWorkerPool());
    }
-   else if (pixelType.compare(g_PixelType_16bit) == 0)
+   else
    {
-      unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++)
-      {
-         double value = GaussDistributedValue(mean, stdDev);
-         if (value < 0)
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned short) value;
-      }
+      noiseGenerator_.Fill(reinterpret_cast<unsigned short*>(pixels),
+            img.Width(), img.Height(), mean, stdDev, maxValue, accumulate,
+            noiseMethod_, GetWorkerPool());
    }
 }
 
 
-/**
-* Adds signal to an image
-* Assume a homogenuous illumination
-* Calculates the signal for each pixel individually as:
-* photon flux * exposure time / conversion factor
-* Assumes QE of 100%
-*/
-void CDemoCamera::AddSignal(ImgBuffer& img, double photonFlux, double exp, double cf)
+DemoWorkerPool& CDemoCamera::GetWorkerPool()
 {
-	char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-	std::string pixelType(buf);
-
-   int maxValue = (1 << GetBitDepth()) -1;
-   long nrPixels = img.Width() * img.Height();
-   double photons = photonFlux * exp;
-   double shotNoise = sqrt(photons);
-   double digitalValue = photons / cf;
-   double shotNoiseDigital = shotNoise / cf;
-   if (pixelType.compare(g_PixelType_8bit) == 0)
-   {
-      unsigned char* pBuf = (unsigned char*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++)
-      {
-         double value = *(pBuf + i) + GaussDistributedValue(digitalValue, shotNoiseDigital);
-         if (value < 0)
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) =  (unsigned char) value;
-      }
-   }
-   else if (pixelType.compare(g_PixelType_16bit) == 0)
+   unsigned threads = static_cast<unsigned>(std::max(generationThreads_, 1L));
+   if (!workerPool_ || workerPool_->GetThreadCount() != threads)
    {
-      unsigned short* pBuf = (unsigned short*) const_cast<unsigned char*>(img.GetPixels());
-      for (long i = 0; i < nrPixels; i++)
-      {
-         double value = *(pBuf + i) + GaussDistributedValue(digitalValue, shotNoiseDigital);
-         if (value < 0)
-         {
-            value = 0;
-         }
-         else if (value > maxValue)
-         {
-            value = maxValue;
-         }
-         *(pBuf + i) = (unsigned short) value;
-      }
+      workerPool_.reset();
+      workerPool_.reset(new DemoWorkerPool(threads));
    }
+   return *workerPool_;
 }
 
 
-/**
- * Uses Marsaglia polar method to generate Gaussian distributed value.
- * Then distributes this around mean with the desired std
- */
-double CDemoCamera::GaussDistributedValue(double mean, double std)
-{
-   double s = 2;
-   double u = 1; // inconsequential, but avoid potential use of uninitialized value
-   double v;
-   double halfRandMax = (double) RAND_MAX / 2.0;
-   while (s >= 1 || s <= 0)
-   {
-      // get random values between -1 and 1
-      u = (double) rand() / halfRandMax - 1.0;
-      v = (double) rand() / halfRandMax - 1.0;
-      s = u * u + v * v;
-   }
-   double tmp = sqrt( -2 * log(s) / s);
-   double x = u * tmp;
-
-   return mean + std * x;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // Bead mode implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -669,9 +586,11 @@ void CDemoCamera::GenerateBeadsForTile(int tileX, int tileY, std::vector<Bead>&
 {
    const double tileSize = 512.0; // microns, matches typical image size
    
-   // Use tile hash as seed for deterministic random generation
-   unsigned int seed = HashTileCoords(tileX, tileY);
-   std::srand(seed);
+   // Use tile hash as seed for deterministic random generation. A local
+   // generator, rather than srand(), so that other users of rand() are not
+   // disturbed.
+   std::mt19937 rng(HashTileCoords(tileX, tileY));
+   auto uniform = [&rng]() { return rng() / 4294967296.0; };
    
    // Calculate tile boundaries in world coordinates
    double tileWorldX = tileX * tileSize;
@@ -685,37 +604,28 @@ void CDemoCamera::GenerateBeadsForTile(int tileX, int tileY, std::vector<Bead>&
    {
       Bead bead;
       // Generate position within this tile
-      bead.worldX = tileWorldX + (double)std::rand() / RAND_MAX * tileSize;
-      bead.worldY = tileWorldY + (double)std::rand() / RAND_MAX * tileSize;
-      bead.intensityFactor = 0.8 + 0.4 * (double)std::rand() / RAND_MAX;  // 80-120%
-      bead.sizeFactor = 0.8 + 0.4 * (double)std::rand() / RAND_MAX;       // 80-120%
+      bead.worldX = tileWorldX + uniform() * tileSize;
+      bead.worldY = tileWorldY + uniform() * tileSize;
+      bead.intensityFactor = 0.8 + 0.4 * uniform();  // 80-120%
+      bead.sizeFactor = 0.8 + 0.4 * uniform();       // 80-120%
       beads.push_back(bead);
    }
 }
 
-void CDemoCamera::GenerateBeadPositions()
+// Generates the beads that can be seen in a view of the given size (in
+// microns) centered on the stage position, plus a margin for blur
+void CDemoCamera::GenerateBeadPositions(double stageX, double stageY,
+      double viewWidth, double viewHeight, double margin)
 {
    beads_.clear();
    
    const double tileSize = 512.0; // microns
    
-   // Get current stage position
-   double stageX, stageY;
-   GetCurrentXYPosition(stageX, stageY);
-   
-   // Calculate which tiles are visible
-   // Image size in world coords (1px = 1um, typical 512x512)
-   double imageWidth = 512.0;
-   double imageHeight = 512.0;
-   
-   // Add margin to ensure beads near edges with blur are included
-   double margin = 100.0; // microns
-   
    // Calculate view bounds
-   double viewLeft = stageX - imageWidth / 2.0 - margin;
-   double viewRight = stageX + imageWidth / 2.0 + margin;
-   double viewBottom = stageY - imageHeight / 2.0 - margin;
-   double viewTop = stageY + imageHeight / 2.0 + margin;
+   double viewLeft = stageX - viewWidth / 2.0 - margin;
+   double viewRight = stageX + viewWidth / 2.0 + margin;
+   double viewBottom = stageY - viewHeight / 2.0 - margin;
+   double viewTop = stageY + viewHeight / 2.0 + margin;
    
    // Calculate tile range
    int tileXMin = (int)floor(viewLeft / tileSize);
@@ -776,115 +686,60 @@ void CDemoCamera::GetCurrentXYPosition(double& x, double& y)
    pStage->GetPositionUm(x, y);
 }
 
-void CDemoCamera::RenderBeadToImage(ImgBuffer& img, const Bead& bead, double blurRadius, double stageX, double stageY)
-{
-   unsigned width = img.Width();
-   unsigned height = img.Height();
-   unsigned depth = img.Depth();
-   
-   // Convert world coordinates to screen coordinates
-   // 1px = 1um
-   double pixelSizeUm = 1.0;
-   double screenX = (bead.worldX - stageX) / pixelSizeUm + width / 2.0;
-   double screenY = (bead.worldY - stageY) / pixelSizeUm + height / 2.0;
-   
-   // Total sigma is the sum of base size and defocus blur (root sum of squares for convolutions)
-   double effectiveBaseSize = beadSize_ * bead.sizeFactor;
-   double totalSigma = sqrt(effectiveBaseSize * effectiveBaseSize + blurRadius * blurRadius);
-   if (totalSigma < 0.5) totalSigma = 0.5;
-   
-   double twoSigmaSq = 2.0 * totalSigma * totalSigma;
-   
-   // Render within 4-sigma radius
-   int renderRadius = (int)(4.0 * totalSigma) + 1;
-   
-   int xMin = std::max(0, (int)(screenX - renderRadius));
-   int xMax = std::min((int)width - 1, (int)(screenX + renderRadius));
-   int yMin = std::max(0, (int)(screenY - renderRadius));
-   int yMax = std::min((int)height - 1, (int)(screenY + renderRadius));
-   
-   // Use fixed maxValue of 255 regardless of bit depth. Users can scale brightness with beadBrightness param.
-   double maxValue = 255.0;
-   
-   double amplitude = maxValue * bead.intensityFactor * beadBrightness_ * g_IntensityFactor_;
-   
-   for (int y = yMin; y <= yMax; ++y)
-   {
-      for (int x = xMin; x <= xMax; ++x)
-      {
-         double dx = x - screenX;
-         double dy = y - screenY;
-         double distSq = dx * dx + dy * dy;
-         
-         double value = amplitude * exp(-distSq / twoSigmaSq);
-         
-         unsigned char* pBuf = const_cast<unsigned char*>(img.GetPixels());
-         unsigned long pixelIndex = (y * width + x);
-         
-         if (depth == 1)  // 8-bit
-         {
-            unsigned long idx = pixelIndex * depth;
-            pBuf[idx] = (unsigned char)std::min(255.0, (double)pBuf[idx] + value);
-         }
-         else if (depth == 2)  // 16-bit
-         {
-            unsigned short* pShort = (unsigned short*)pBuf;
-            pShort[pixelIndex] = (unsigned short)std::min(65535.0, (double)pShort[pixelIndex] + value);
-         }
-         else if (depth == 4 && nComponents_ == 1)  // 32-bit float
-         {
-            float* pFloat = (float*)pBuf;
-            pFloat[pixelIndex] = std::min(1.0f, pFloat[pixelIndex] + (float)value);
-         }
-         else if (depth == 4 && nComponents_ == 4)  // 32-bit RGB - render to green channel
-         {
-            unsigned long idx = pixelIndex * 4;
-            pBuf[idx + 1] = (unsigned char)std::min(255.0, (double)pBuf[idx + 1] + value);
-         }
-      }
-   }
-}
-
 void CDemoCamera::GenerateBeadsImage(ImgBuffer& img, double /* exposure */)
 {
    if (img.Height() == 0 || img.Width() == 0 || img.Depth() == 0)
       return;
    
-   // Clear image to dark background
-   unsigned char* pBuf = const_cast<unsigned char*>(img.GetPixels());
-   memset(pBuf, 0, img.Height() * img.Width() * img.Depth() * ((nComponents_ > 1) ? nComponents_ : 1));
-   
    // Get current XY and Z positions
    double stageX, stageY;
    GetCurrentXYPosition(stageX, stageY);
    double zPos = GetCurrentZPosition();
    
-   // Regenerate beads for current view (always regenerate since stage may have moved)
-   GenerateBeadPositions();
-   
    // Calculate blur (no cap)
    double blurRadius = beadBlurRate_ * std::abs(zPos);
    
    // 1px = 1um
    double pixelSizeUm = 1.0;
+   double width = img.Width();
+   double height = img.Height();
+   
+   // Beads up to 4 sigma outside the view contribute to it. Beyond one
+   // bead tile, very blurred beads are left out to bound the cost.
+   double maxBaseSize = beadSize_ * 1.2;
+   double maxSigma = sqrt(maxBaseSize * maxBaseSize + blurRadius * blurRadius);
+   double margin = std::min(4.0 * maxSigma + 1.0, 512.0);
    
-   // Render each bead
+   // Regenerate beads for current view (always regenerate since stage may have moved)
+   GenerateBeadPositions(stageX, stageY, width * pixelSizeUm,
+         height * pixelSizeUm, margin);
+   
+   // Use fixed maxValue of 255 regardless of bit depth. Users can scale brightness with beadBrightness param.
+   double amplitude = 255.0 * beadBrightness_ * g_IntensityFactor_;
+   
+   beadSpots_.clear();
    for (const auto& bead : beads_)
    {
-      // Convert world coordinates to screen coordinates for visibility check
-      double screenX = (bead.worldX - stageX) / pixelSizeUm + img.Width() / 2.0;
-      double screenY = (bead.worldY - stageY) / pixelSizeUm + img.Height() / 2.0;
+      // Convert world coordinates to screen coordinates
+      DemoBeadRenderer::Spot spot;
+      spot.x = (bead.worldX - stageX) / pixelSizeUm + width / 2.0;
+      spot.y = (bead.worldY - stageY) / pixelSizeUm + height / 2.0;
       
-      // Total sigma is sum of base size and blur
+      // Total sigma combines base size and defocus blur (root sum of squares for convolutions)
       double effectiveBaseSize = beadSize_ * bead.sizeFactor;
-      double totalSigma = sqrt(effectiveBaseSize * effectiveBaseSize + blurRadius * blurRadius);
+      spot.sigma = sqrt(effectiveBaseSize * effectiveBaseSize + blurRadius * blurRadius);
+      spot.amplitude = amplitude * bead.intensityFactor;
       
       // Only render beads that might be visible (with some margin for blur)
-      double margin = totalSigma * 4.0;
-      if (screenX >= -margin && screenX < img.Width() + margin &&
-         screenY >= -margin && screenY < img.Height() + margin)
+      double spotMargin = spot.sigma * 4.0;
+      if (spot.x >= -spotMargin && spot.x < width + spotMargin &&
+         spot.y >= -spotMargin && spot.y < height + spotMargin)
       {
-         RenderBeadToImage(img, bead, blurRadius, stageX, stageY);
+         beadSpots_.push_back(spot);
       }
    }
+   
+   // Draws on a black background, in parallel over image tiles
+   beadRenderer_.Render(img.GetPixelsRW(), img.Width(), img.Height(),
+         img.Depth(), nComponents_, beadSpots_, GetWorkerPool());
 }
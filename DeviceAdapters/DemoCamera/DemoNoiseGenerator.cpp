@@ -0,0 +1,232 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoNoiseGenerator.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast Gaussian noise images for DemoCamera
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DemoNoiseGenerator.h"
+#include "DemoWorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+const unsigned TableBits = 12;
+const unsigned TableSize = 1u << TableBits;
+
+// Standard normal deviates in the noise tile; a 2048-pixel row then starts
+// at one of about 500,000 offsets
+const std::size_t TileLength = std::size_t(1) << 19;
+
+// Pixels generated at a time, so that the deviates stay in L1 cache
+const unsigned BlockSize = 256;
+
+// Rows handed to a thread at a time
+const std::size_t RowGrain = 8;
+
+// Integer hash with good avalanche behavior (Chris Wellons' "lowbias32")
+inline std::uint32_t Mix32(std::uint32_t x)
+{
+   x ^= x >> 16;
+   x *= 0x7feb352dU;
+   x ^= x >> 15;
+   x *= 0x846ca68bU;
+   x ^= x >> 16;
+   return x;
+}
+
+const std::uint32_t Golden32 = 0x9e3779b9U;
+
+double NormalCdf(double x)
+{
+   return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+double InverseNormalCdf(double p)
+{
+   double lo = -10.0;
+   double hi = 10.0;
+   for (int i = 0; i < 64; ++i)
+   {
+      const double mid = 0.5 * (lo + hi);
+      if (NormalCdf(mid) < p)
+         lo = mid;
+      else
+         hi = mid;
+   }
+   return 0.5 * (lo + hi);
+}
+
+} // namespace
+
+DemoNoiseGenerator::DemoNoiseGenerator() :
+   seed_(std::random_device()())
+{
+   // Knots at the quantiles (j + 0.5) / (TableSize + 1); a hash value
+   // selects an interval between two knots (top bits) and a position within
+   // it (next 16 bits), so that the deviates are piecewise uniform between
+   // the quantiles.
+   std::vector<double> knots(TableSize + 1);
+   for (unsigned j = 0; j <= TableSize; ++j)
+      knots[j] = InverseNormalCdf((j + 0.5) / (TableSize + 1));
+
+   // The tails beyond the outer knots are cut off, which lowers the
+   // variance slightly; scale to exactly unit variance.
+   double variance = 0.0;
+   for (unsigned i = 0; i < TableSize; ++i)
+   {
+      const double a = knots[i];
+      const double b = knots[i + 1];
+      variance += (a * a + a * b + b * b) / 3.0;
+   }
+   variance /= TableSize;
+   const double scale = 1.0 / std::sqrt(variance);
+
+   icdf_.resize(TableSize);
+   icdfSlope_.resize(TableSize);
+   for (unsigned i = 0; i < TableSize; ++i)
+   {
+      icdf_[i] = static_cast<float>(knots[i] * scale);
+      icdfSlope_[i] = static_cast<float>((knots[i + 1] - knots[i]) * scale / 65536.0);
+   }
+}
+
+void DemoNoiseGenerator::EnsureTile(unsigned width)
+{
+   if (tile_.size() >= TileLength + width)
+      return;
+   const std::size_t length = TileLength + std::max(width, 4096u);
+   tile_.resize(length);
+   const std::uint32_t key = Mix32(seed_ ^ 0x7ffffff1U);
+   for (std::size_t i = 0; i < length; ++i)
+   {
+      const std::uint32_t u = Mix32(key + static_cast<std::uint32_t>(i) * Golden32);
+      const unsigned idx = u >> (32 - TableBits);
+      const float frac = static_cast<float>((u >> (16 - TableBits)) & 0xffff);
+      tile_[i] = icdf_[idx] + frac * icdfSlope_[idx];
+   }
+}
+
+const float* DemoNoiseGenerator::TileWindow(std::uint32_t rowKey) const
+{
+   return tile_.data() + (Mix32(rowKey ^ Golden32) % TileLength);
+}
+
+namespace {
+
+// Sets (or adds to) n pixels from n standard normal deviates. With the
+// pointers declared unaliased and n a constant after inlining, compilers
+// vectorize this at their default optimization level.
+template <bool Accumulate, typename T>
+inline void CombineBlock(T* __restrict out, const float* __restrict z,
+   unsigned n, float mean, float stdDev, float maxValue)
+{
+   for (unsigned i = 0; i < n; ++i)
+   {
+      float v = mean + stdDev * z[i];
+      if (Accumulate)
+         v += static_cast<float>(out[i]);
+      v = std::min(std::max(v, 0.0f), maxValue);
+      out[i] = static_cast<T>(v);
+   }
+}
+
+template <bool Accumulate, typename T>
+inline void Combine(T* out, const float* z, unsigned n, float mean,
+   float stdDev, float maxValue)
+{
+   if (n == BlockSize)
+      CombineBlock<Accumulate>(out, z, BlockSize, mean, stdDev, maxValue);
+   else
+      CombineBlock<Accumulate>(out, z, n, mean, stdDev, maxValue);
+}
+
+} // namespace
+
+template <typename T>
+void DemoNoiseGenerator::FillRow(T* row, unsigned width, std::uint32_t rowKey,
+   float mean, float stdDev, float maxValue, bool accumulate,
+   Method method) const
+{
+   const float* tileRow = nullptr;
+   if (method == Method::TileCache)
+      tileRow = TileWindow(rowKey);
+
+   const float* icdf = icdf_.data();
+   const float* slope = icdfSlope_.data();
+   std::uint32_t u[BlockSize];
+   float z[BlockSize];
+   for (unsigned x0 = 0; x0 < width; x0 += BlockSize)
+   {
+      const unsigned n = std::min(BlockSize, width - x0);
+      const float* deviates = z;
+      if (tileRow)
+      {
+         deviates = tileRow + x0;
+      }
+      else
+      {
+         // Hashing vectorizes; the table lookups (gathers) mostly do not
+         for (unsigned i = 0; i < BlockSize; ++i)
+            u[i] = Mix32(rowKey + (x0 + i) * Golden32);
+         for (unsigned i = 0; i < n; ++i)
+         {
+            const unsigned idx = u[i] >> (32 - TableBits);
+            const float frac = static_cast<float>((u[i] >> (16 - TableBits)) & 0xffff);
+            z[i] = icdf[idx] + frac * slope[idx];
+         }
+      }
+
+      if (accumulate)
+         Combine<true>(row + x0, deviates, n, mean, stdDev, maxValue);
+      else
+         Combine<false>(row + x0, deviates, n, mean, stdDev, maxValue);
+   }
+}
+
+template <typename T>
+void DemoNoiseGenerator::Fill(T* pixels, unsigned width, unsigned height,
+   double mean, double stdDev, unsigned maxValue, bool accumulate,
+   Method method, DemoWorkerPool& pool)
+{
+   if (width == 0 || height == 0)
+      return;
+   if (method == Method::TileCache)
+      EnsureTile(width);
+
+   const std::uint32_t frameKey = Mix32(seed_ ^ Mix32(++frame_ * Golden32));
+   const float fMean = static_cast<float>(mean);
+   const float fStdDev = static_cast<float>(stdDev);
+   const float fMax = static_cast<float>(maxValue);
+   pool.ParallelFor(height, RowGrain, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t y = begin; y < end; ++y)
+      {
+         const std::uint32_t rowKey =
+            Mix32(frameKey + static_cast<std::uint32_t>(y) * 0x85ebca6bU);
+         FillRow(pixels + y * width, width, rowKey, fMean, fStdDev, fMax,
+            accumulate, method);
+      }
+   });
+}
+
+template void DemoNoiseGenerator::Fill<unsigned char>(unsigned char*,
+   unsigned, unsigned, double, double, unsigned, bool, Method,
+   DemoWorkerPool&);
+template void DemoNoiseGenerator::Fill<unsigned short>(unsigned short*,
+   unsigned, unsigned, double, double, unsigned, bool, Method,
+   DemoWorkerPool&);
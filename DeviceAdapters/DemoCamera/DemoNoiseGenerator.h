@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoNoiseGenerator.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Fast Gaussian noise images for DemoCamera
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DemoWorkerPool;
+
+/**
+ * Fills images with Gaussian distributed pixel values.
+ *
+ * Random numbers come from a counter-based generator: each pixel's value is
+ * a hash of (seed, frame, row, column), so rows can be generated on any
+ * thread, in any order, with no shared generator state. Hash values are
+ * turned into standard normal deviates through a tabulated inverse normal
+ * CDF, which needs no rejection loop or transcendental functions, so the
+ * inner loops are branch-free.
+ *
+ * In TileCache mode, a block of standard normal deviates is computed once
+ * and each row of each frame reads a window of it starting at a random
+ * offset. Pixel values are then as cheap as a multiply-add, at the cost of
+ * noise that repeats (shifted) between rows.
+ */
+class DemoNoiseGenerator
+{
+public:
+   enum class Method { PerPixel, TileCache };
+
+   DemoNoiseGenerator();
+
+   // Sets pixel = mean + stdDev * N(0, 1) (or adds that to the existing
+   // value if accumulate is true), truncated to [0, maxValue]. Each call
+   // uses a new noise realization. T is unsigned char or unsigned short.
+   template <typename T>
+   void Fill(T* pixels, unsigned width, unsigned height, double mean,
+      double stdDev, unsigned maxValue, bool accumulate, Method method,
+      DemoWorkerPool& pool);
+
+private:
+   template <typename T>
+   void FillRow(T* row, unsigned width, std::uint32_t rowKey, float mean,
+      float stdDev, float maxValue, bool accumulate, Method method) const;
+
+   const float* TileWindow(std::uint32_t rowKey) const;
+   void EnsureTile(unsigned width);
+
+   std::uint32_t seed_;
+   std::uint32_t frame_ = 0;
+
+   // Deviate at the start of each interval of the inverse normal CDF, and
+   // its increase per step of the 16-bit position within the interval
+   std::vector<float> icdf_;
+   std::vector<float> icdfSlope_;
+
+   std::vector<float> tile_;
+};
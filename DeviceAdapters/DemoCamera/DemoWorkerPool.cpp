@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoWorkerPool.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Small fork-join thread pool for DemoCamera image generation
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DemoWorkerPool.h"
+
+#include <algorithm>
+
+DemoWorkerPool::DemoWorkerPool(unsigned threadCount)
+{
+   for (unsigned i = 1; i < threadCount; ++i)
+      workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+DemoWorkerPool::~DemoWorkerPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+   }
+   workAvailable_.notify_all();
+   for (auto& t : workers_)
+      t.join();
+}
+
+unsigned DemoWorkerPool::DefaultThreadCount()
+{
+   // Leave a core for the sequence thread and the application
+   const unsigned hw = std::thread::hardware_concurrency();
+   return hw > 2 ? std::min(hw - 1, 16u) : 1;
+}
+
+void DemoWorkerPool::ParallelFor(std::size_t count, std::size_t grain,
+   const RangeFunction& fn)
+{
+   if (count == 0)
+      return;
+   grain = std::max<std::size_t>(grain, 1);
+   if (workers_.empty() || count <= grain)
+   {
+      fn(0, count);
+      return;
+   }
+
+   std::lock_guard<std::mutex> run(runMutex_);
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fn_ = &fn;
+      count_ = count;
+      grain_ = grain;
+      next_.store(0, std::memory_order_relaxed);
+      busyWorkers_ = static_cast<unsigned>(workers_.size());
+      ++generation_;
+   }
+   workAvailable_.notify_all();
+
+   RunBlocks();
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   workDone_.wait(lock, [this] { return busyWorkers_ == 0; });
+   fn_ = nullptr;
+}
+
+void DemoWorkerPool::WorkerLoop()
+{
+   unsigned long long seen = 0;
+   for (;;)
+   {
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         workAvailable_.wait(lock, [&] { return stop_ || generation_ != seen; });
+         if (stop_)
+            return;
+         seen = generation_;
+      }
+
+      RunBlocks();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busyWorkers_ == 0)
+         workDone_.notify_one();
+   }
+}
+
+void DemoWorkerPool::RunBlocks()
+{
+   // fn_, count_ and grain_ do not change until every worker has finished
+   for (;;)
+   {
+      const std::size_t begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+      if (begin >= count_)
+         return;
+      (*fn_)(begin, std::min(begin + grain_, count_));
+   }
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DemoWorkerPool.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Small fork-join thread pool for DemoCamera image generation
+//
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs a loop over [0, count) on a fixed set of threads.
+ *
+ * The calling thread takes part in the work, so a pool of N threads starts
+ * N - 1 workers (none for N = 1). Ranges are handed out dynamically in
+ * blocks of `grain` items, which balances uneven work (such as rows with
+ * and without beads). ParallelFor() calls are serialized.
+ */
+class DemoWorkerPool
+{
+public:
+   using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+   explicit DemoWorkerPool(unsigned threadCount);
+   ~DemoWorkerPool();
+
+   DemoWorkerPool(const DemoWorkerPool&) = delete;
+   DemoWorkerPool& operator=(const DemoWorkerPool&) = delete;
+
+   unsigned GetThreadCount() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+   // Returns when fn has been called on every block. fn must not throw.
+   void ParallelFor(std::size_t count, std::size_t grain, const RangeFunction& fn);
+
+   // A reasonable default thread count for this machine
+   static unsigned DefaultThreadCount();
+
+private:
+   void WorkerLoop();
+   void RunBlocks();
+
+   std::vector<std::thread> workers_;
+
+   std::mutex runMutex_; // Serializes ParallelFor()
+
+   std::mutex mutex_;
+   std::condition_variable workAvailable_;
+   std::condition_variable workDone_;
+   unsigned long long generation_ = 0;
+   unsigned busyWorkers_ = 0;
+   bool stop_ = false;
+
+   // Current job; written under mutex_ before generation_ is bumped
+   const RangeFunction* fn_ = nullptr;
+   std::size_t count_ = 0;
+   std::size_t grain_ = 1;
+   std::atomic<std::size_t> next_{0};
+};
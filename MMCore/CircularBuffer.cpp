@@ -3,10 +3,12 @@
 // PROJECT:       Micro-Manager
 // SUBSYSTEM:     MMCore
 //-----------------------------------------------------------------------------
-// DESCRIPTION:   Generic implementation of the circular buffer. The buffer
-//                allows only one thread to enter at a time by using a mutex lock.
-//                This makes the buffer susceptible to race conditions if the
-//                calling threads are mutually dependent.
+// DESCRIPTION:   Generic implementation of the circular buffer. With the
+//                default (Mutex) engine, the buffer allows only one thread to
+//                enter at a time by using a mutex lock. This makes the buffer
+//                susceptible to race conditions if the calling threads are
+//                mutually dependent. The LockFree engine instead coordinates
+//                producers and readers through atomic sequence counters.
 //              
 // COPYRIGHT:     University of California, San Francisco, 2007,
 //
@@ -25,6 +27,7 @@
 // 
 #include "CircularBuffer.h"
 #include "CoreUtils.h"
+#include "MemoryCopy.h"
 
 #include "TaskSet_CopyMemory.h"
 #include "ThreadPool.h"
@@ -32,10 +35,14 @@
 #include "DeviceUtils.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <new>
+#include <thread>
+#include <utility>
 
 namespace mmcore {
 namespace internal {
@@ -48,14 +55,25 @@ constexpr std::size_t adjustThreshold = std::numeric_limits<std::size_t>::max()
 // division by zero can be added.
 constexpr std::size_t maxCBSize = 10000000;
 
-CircularBuffer::CircularBuffer(std::size_t memorySizeMB) :
+CircularBuffer::CircularBuffer(std::size_t memorySizeMB,
+      std::shared_ptr<ThreadPool> threadPool) :
+   engine_(Engine::Mutex),
    frameSize_(0),
+   storageOptionsChanged_(false),
    insertIndex_(0),
    saveIndex_(0),
+   reserveSeq_(0),
+   insertSeq_(0),
+   saveSeq_(0),
+   discardedEnd_(0),
+   openWriteSlots_(0),
    overflow_(false),
    overwriteData_(false),
+   spillInsertIndex_(0),
+   spillSaveIndex_(0),
+   waiters_(0),
    memorySizeMB_(memorySizeMB),
-   threadPool_(std::make_shared<ThreadPool>()),
+   threadPool_(std::move(threadPool)),
    tasksMemCopy_(std::make_shared<TaskSet_CopyMemory>(threadPool_))
 {
 }
@@ -68,13 +86,41 @@ int CircularBuffer::SetOverwriteData(bool overwrite) {
    return DEVICE_OK;
 }
 
+void CircularBuffer::SetThreadPool(std::shared_ptr<ThreadPool> threadPool)
+{
+   auto tasks = std::make_shared<TaskSet_CopyMemory>(threadPool);
+   std::lock_guard<std::mutex> copyGuard(copyLock_);
+   threadPool_ = std::move(threadPool);
+   tasksMemCopy_ = std::move(tasks);
+}
+
+void CircularBuffer::SetEngine(Engine engine)
+{
+   std::lock_guard<std::mutex> insertGuard(insertLock_);
+   std::lock_guard<std::mutex> copyGuard(copyLock_);
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   engine_ = engine;
+   ClearLocked();
+}
+
 bool CircularBuffer::Initialize(std::size_t frameSize)
 {
    std::lock_guard<std::mutex> guard(bufferLock_);
 
+   // A camera may still be writing into a slot (and, with the Mutex engine,
+   // holds insertLock_ until it commits)
+   if (openWriteSlots_.load() > 0)
+      return false;
+
    overflow_ = false;
    insertIndex_ = 0;
    saveIndex_ = 0;
+   spillInsertIndex_ = 0;
+   spillSaveIndex_ = 0;
+   reserveSeq_ = 0;
+   insertSeq_ = 0;
+   saveSeq_ = 0;
+   discardedEnd_ = 0;
 
    try
    {
@@ -84,32 +130,129 @@ bool CircularBuffer::Initialize(std::size_t frameSize)
          return false;
       }
 
+      const std::size_t slotSize =
+         storageOptions_.storage == Storage::Arena ?
+         FrameArena::SlotStride(frameSize) : frameSize;
       const std::size_t cbSize = std::min(maxCBSize,
-         (memorySizeMB_ * bytesInMB) / frameSize);
+         (memorySizeMB_ * bytesInMB) / slotSize);
 
       if (cbSize == 0)
       {
          frameSize_ = frameSize;
-         frameArray_.resize(0);
+         ReleaseFrames();
          return false; // memory footprint too small
       }
 
-      if (frameSize == frameSize_ && frameArray_.size() == cbSize)
+      if (frameSize == frameSize_ && frameArray_.size() == cbSize &&
+            !storageOptionsChanged_)
          return true;
 
       frameSize_ = frameSize;
-      frameArray_.resize(cbSize);
-      for (auto& frameBuf : frameArray_)
-         frameBuf.Resize(frameSize_);
+      storageOptionsChanged_ = false;
+      // Deallocate before allocating, since these buffers can be large.
+      // Frames that are leased stay alive until their leases are released.
+      ReleaseFrames();
+      AllocateFrames(cbSize);
       return true;
    }
-   catch (std::bad_alloc&)
+   catch (const std::bad_alloc&)
    {
-      frameArray_.resize(0);
+      ReleaseFrames();
+      allocationStats_ = AllocationStats();
+      allocationStats_.error = "Out of memory";
+      return false;
+   }
+   catch (const CMMError& e)
+   {
+      ReleaseFrames();
+      allocationStats_ = AllocationStats();
+      allocationStats_.error = e.getMsg();
       return false;
    }
 }
 
+void CircularBuffer::AllocateFrames(std::size_t count)
+{
+   using Clock = std::chrono::steady_clock;
+   const auto start = Clock::now();
+   const std::int64_t startFaults = GetPageFaultCount();
+
+   AllocationStats stats;
+   std::shared_ptr<FrameArena> arena;
+   if (storageOptions_.storage == Storage::Arena)
+   {
+      arena = FrameArena::Create(frameSize_, count, storageOptions_.arena);
+      stats.hugePages = arena->UsesHugePages();
+      stats.numaBound = arena->IsNumaBound();
+   }
+
+   std::vector<std::atomic<FrameBuffer*>> ring(count);
+   frameStore_.reserve(count);
+   for (std::size_t i = 0; i < count; ++i)
+   {
+      if (arena)
+         frameStore_.push_back(std::make_shared<FrameBuffer>(
+            arena->GetSlot(i), frameSize_, arena));
+      else
+         frameStore_.push_back(std::make_shared<FrameBuffer>(frameSize_));
+      ring[i].store(frameStore_.back().get());
+   }
+   frameArray_ = std::move(ring);
+
+   const std::size_t spillCount = storageOptions_.spillDirectory.empty() ? 0 :
+      std::min(maxCBSize, storageOptions_.spillSizeMB * bytesInMB /
+         FrameArena::FileBackedSlotStride(frameSize_));
+   if (spillCount > 0)
+   {
+      auto spill = FrameArena::CreateFileBacked(
+         storageOptions_.spillDirectory, frameSize_, spillCount);
+      std::vector<std::atomic<FrameBuffer*>> spillRing(spillCount);
+      frameStore_.reserve(count + spillCount);
+      for (std::size_t i = 0; i < spillCount; ++i)
+      {
+         frameStore_.push_back(std::make_shared<FrameBuffer>(
+            spill->GetSlot(i), frameSize_, spill));
+         spillRing[i].store(frameStore_.back().get());
+      }
+      spillArray_ = std::move(spillRing);
+      stats.spillFrames = spillCount;
+   }
+
+   const std::int64_t endFaults = GetPageFaultCount();
+   stats.pageFaults = (startFaults < 0 || endFaults < 0) ? -1 :
+      endFaults - startFaults;
+   stats.milliseconds = std::chrono::duration<double, std::milli>(
+      Clock::now() - start).count();
+   allocationStats_ = stats;
+}
+
+void CircularBuffer::SetStorageOptions(const StorageOptions& options)
+{
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   storageOptions_ = options;
+   storageOptionsChanged_ = true;
+}
+
+CircularBuffer::StorageOptions CircularBuffer::GetStorageOptions() const
+{
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   return storageOptions_;
+}
+
+CircularBuffer::AllocationStats CircularBuffer::GetAllocationStats() const
+{
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   return allocationStats_;
+}
+
+void CircularBuffer::ReleaseFrames()
+{
+   frameArray_.clear();
+   spillArray_.clear();
+   retiredFrames_.clear();
+   frameStore_.clear();
+}
+
 void CircularBuffer::Clear()
 {
    std::lock_guard<std::mutex> guard(bufferLock_);
@@ -120,25 +263,82 @@ void CircularBuffer::ClearLocked()
 {
    insertIndex_=0;
    saveIndex_=0;
+   spillInsertIndex_ = 0;
+   spillSaveIndex_ = 0;
+   DiscardPublishedLockFree();
    overflow_ = false;
 }
 
+// Drop all frames that have been published but not yet retrieved, by
+// advancing saveSeq_ to insertSeq_. Frames still being written (between
+// insertSeq_ and reserveSeq_) are unaffected. Returns false if there
+// was nothing to discard.
+bool CircularBuffer::DiscardPublishedLockFree()
+{
+   std::uint64_t saved = saveSeq_.load(std::memory_order_acquire);
+   for (;;)
+   {
+      // Loading insertSeq_ after saveSeq_ guarantees published >= saved.
+      const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+      if (published == saved)
+         return false;
+      // seq_cst: see LeaseNthFromTopImageBufferLockFree()
+      if (saveSeq_.compare_exchange_weak(saved, published))
+         return true;
+   }
+}
+
+std::size_t CircularBuffer::SpillCapacityLocked() const
+{
+   return engine_ == Engine::Mutex ? spillArray_.size() : 0;
+}
+
 std::size_t CircularBuffer::GetSize() const
 {
    std::lock_guard<std::mutex> guard(bufferLock_);
-   return frameArray_.size();
+   return frameArray_.size() + SpillCapacityLocked();
 }
 
 std::size_t CircularBuffer::GetFreeSize() const
 {
+   if (engine_ == Engine::LockFree)
+   {
+      const std::uint64_t saved = saveSeq_.load(std::memory_order_acquire);
+      const std::uint64_t reserved = reserveSeq_.load(std::memory_order_acquire);
+      // reserved - saved can transiently exceed the size if a reader
+      // advanced saveSeq_ in between the two loads.
+      const std::size_t used = static_cast<std::size_t>(std::min<std::uint64_t>(
+         reserved - saved, frameArray_.size()));
+      return frameArray_.size() - used;
+   }
    std::lock_guard<std::mutex> guard(bufferLock_);
-   return frameArray_.size() - (insertIndex_ - saveIndex_);
+   const std::size_t spilled = spillInsertIndex_ - spillSaveIndex_;
+   // Memory is not used again until all spilled frames are retrieved
+   if (spilled > 0)
+      return spillArray_.size() - spilled;
+   return frameArray_.size() - (insertIndex_ - saveIndex_) +
+      SpillCapacityLocked();
 }
 
 std::size_t CircularBuffer::GetRemainingImageCount() const
 {
+   if (engine_ == Engine::LockFree)
+   {
+      const std::uint64_t saved = saveSeq_.load(std::memory_order_acquire);
+      const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+      if (discardedEnd_.load(std::memory_order_acquire) <= saved)
+         return static_cast<std::size_t>(published - saved);
+      std::size_t count = 0;
+      for (std::uint64_t seq = saved; seq < published; ++seq)
+      {
+         if (!frameArray_[static_cast<std::size_t>(seq % frameArray_.size())]
+               .load()->IsDiscarded())
+            ++count;
+      }
+      return count;
+   }
    std::lock_guard<std::mutex> guard(bufferLock_);
-   return insertIndex_ - saveIndex_;
+   return (insertIndex_ - saveIndex_) + (spillInsertIndex_ - spillSaveIndex_);
 }
 
 /**
@@ -146,58 +346,257 @@ std::size_t CircularBuffer::GetRemainingImageCount() const
 */
 bool CircularBuffer::InsertImage(const unsigned char* pixArray,
    std::size_t frameSize,
-   std::string_view serializedMetadata) MMCORE_LEGACY_THROW(CMMError)
+   const ImageTagBlock& metadata) MMCORE_LEGACY_THROW(CMMError)
 {
-    std::lock_guard<std::mutex> insertGuard(insertLock_);
+   WriteSlot slot;
+   if (!AcquireWriteSlot(frameSize, slot))
+      return false;
 
-    FrameBuffer* pImg;
+   {
+      // The parallel copy task set can serve one insert at a time (which is
+      // always the case with the Mutex engine); rather than wait for another
+      // producer, copy on the calling thread.
+      std::unique_lock<std::mutex> copyGuard(copyLock_, std::try_to_lock);
+      if (copyGuard.owns_lock())
+         tasksMemCopy_->MemCopy(slot.buffer->GetPixelsRW(), pixArray, frameSize);
+      else
+         CopyFrameMemory(slot.buffer->GetPixelsRW(), pixArray, frameSize,
+            frameSize);
+   }
 
-    {
-       std::lock_guard<std::mutex> guard(bufferLock_);
+   CommitWriteSlot(slot, metadata);
+   return true;
+}
 
-       if (overflow_)
-          return false;
+bool CircularBuffer::AcquireWriteSlot(std::size_t frameSize,
+   WriteSlot& slot) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (engine_ == Engine::LockFree)
+      return AcquireWriteSlotLockFree(frameSize, slot);
 
-       if (frameSize != frameSize_)
-          throw CMMError("Incompatible image size in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+   // Held until the slot is committed or aborted.
+   std::unique_lock<std::mutex> insertGuard(insertLock_);
 
-       bool overflowed = (insertIndex_ - saveIndex_) >= frameArray_.size();
-       if (overflowed) {
+   {
+      std::lock_guard<std::mutex> guard(bufferLock_);
+
+      if (overflow_)
+         return false;
+
+      if (frameSize != frameSize_)
+         throw CMMError("Incompatible image size in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+
+      const std::size_t spilled = spillInsertIndex_ - spillSaveIndex_;
+      slot.spill = spilled > 0 ||
+         (insertIndex_ - saveIndex_) >= frameArray_.size();
+      bool overflowed = slot.spill && spilled >= spillArray_.size();
+      if (overflowed) {
          if (overwriteData_) {
             ClearLocked();
+            slot.spill = false;
          } else {
             overflow_ = true;
             return false;
          }
-       }
+      }
 
-       pImg = &frameArray_[insertIndex_ % frameArray_.size()];
-    }
+      auto& ring = slot.spill ? spillArray_ : frameArray_;
+      const std::size_t index =
+         (slot.spill ? spillInsertIndex_ : insertIndex_) % ring.size();
+      slot.buffer = ring[index].load();
+      if (slot.buffer->IsLeased())
+      {
+         slot.buffer = ReplaceLeasedFrame(ring, index);
+         if (!slot.buffer)
+         {
+            overflow_ = true;
+            return false;
+         }
+      }
+      slot.seq = 0;
+      openWriteSlots_.fetch_add(1);
+   }
 
-   pImg->SetSerializedMetadata(serializedMetadata);
+   insertGuard.release();
+   return true;
+}
 
-   // TODO: In MMCore the FrameBuffer::GetPixels() returns const pointer.
-   //       It would be better to have something like FrameBuffer::GetPixelsRW() in MMDevice.
-   //       Or even better - pass tasksMemCopy_ to FrameBuffer constructor
-   //       and utilize parallel copy also in single snap acquisitions.
-   tasksMemCopy_->MemCopy((void*)pImg->GetPixels(), pixArray, frameSize);
+void CircularBuffer::CommitWriteSlot(const WriteSlot& slot,
+   const ImageTagBlock& metadata)
+{
+   slot.buffer->SetMetadata(metadata);
+   slot.buffer->SetDiscarded(false);
+
+   if (engine_ == Engine::LockFree)
+   {
+      PublishWriteSlotLockFree(slot);
+      openWriteSlots_.fetch_sub(1);
+      NotifyImageAvailable();
+      return;
+   }
 
    {
+      // Adopt the lock taken by AcquireWriteSlot()
+      std::unique_lock<std::mutex> insertGuard(insertLock_, std::adopt_lock);
       std::lock_guard<std::mutex> guard(bufferLock_);
 
-      insertIndex_++;
-      // Periodically rebase indices to keep them from growing without bound.
-      if (insertIndex_ > frameArray_.size() + adjustThreshold &&
-          saveIndex_  > frameArray_.size() + adjustThreshold)
+      if (slot.spill)
       {
-         insertIndex_ -= adjustThreshold;
-         saveIndex_   -= adjustThreshold;
+         spillInsertIndex_++;
+         if (spillInsertIndex_ > spillArray_.size() + adjustThreshold &&
+             spillSaveIndex_  > spillArray_.size() + adjustThreshold)
+         {
+            spillInsertIndex_ -= adjustThreshold;
+            spillSaveIndex_   -= adjustThreshold;
+         }
+      }
+      else
+      {
+         insertIndex_++;
+         // Periodically rebase indices to keep them from growing without
+         // bound.
+         if (insertIndex_ > frameArray_.size() + adjustThreshold &&
+             saveIndex_  > frameArray_.size() + adjustThreshold)
+         {
+            insertIndex_ -= adjustThreshold;
+            saveIndex_   -= adjustThreshold;
+         }
       }
    }
+   openWriteSlots_.fetch_sub(1);
+   NotifyImageAvailable();
+}
 
-   return true;
+void CircularBuffer::NotifyImageAvailable()
+{
+   // Pairs with the fence in WaitForImage(): either the waiter sees the
+   // frame just published, or we see the waiter.
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (waiters_.load(std::memory_order_relaxed) == 0)
+      return;
+   // Once we hold waitLock_, the waiter is either blocked in wait_for() or
+   // has not yet checked for images.
+   {
+      std::lock_guard<std::mutex> guard(waitLock_);
+   }
+   imageAvailable_.notify_all();
+}
+
+bool CircularBuffer::WaitForImage(std::chrono::milliseconds timeout) const
+{
+   if (GetRemainingImageCount() > 0)
+      return true;
+
+   std::unique_lock<std::mutex> lock(waitLock_);
+   waiters_.fetch_add(1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   const bool available = imageAvailable_.wait_for(lock, timeout,
+      [this] { return GetRemainingImageCount() > 0; });
+   waiters_.fetch_sub(1, std::memory_order_relaxed);
+   return available;
+}
+
+void CircularBuffer::AbortWriteSlot(const WriteSlot& slot)
+{
+   if (engine_ == Engine::LockFree)
+      AbortWriteSlotLockFree(slot);
+   else
+   {
+      // Nothing was modified; just release the lock taken by
+      // AcquireWriteSlot()
+      insertLock_.unlock();
+   }
+   openWriteSlots_.fetch_sub(1);
+}
+
+void CircularBuffer::AbortWriteSlotLockFree(const WriteSlot& slot)
+{
+   // If no other producer has reserved a slot since, simply give ours back.
+   // Otherwise we cannot leave a hole in the sequence, so publish the slot
+   // marked as discarded; readers skip such frames.
+   std::uint64_t expected = slot.seq + 1;
+   if (reserveSeq_.compare_exchange_strong(expected, slot.seq,
+         std::memory_order_acq_rel, std::memory_order_acquire))
+      return;
+   slot.buffer->SetDiscarded(true);
+   std::uint64_t end = discardedEnd_.load();
+   while (end <= slot.seq &&
+         !discardedEnd_.compare_exchange_weak(end, slot.seq + 1))
+   {
+   }
+   PublishWriteSlotLockFree(slot);
+}
+
+bool CircularBuffer::AcquireWriteSlotLockFree(std::size_t frameSize,
+   WriteSlot& slot)
+{
+   if (overflow_.load(std::memory_order_acquire))
+      return false;
+
+   if (frameSize != frameSize_)
+      throw CMMError("Incompatible image size in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+
+   const std::size_t capacity = frameArray_.size();
+   if (capacity == 0)
+   {
+      overflow_ = true;
+      return false;
+   }
+
+   // Reserve a slot. Readers only ever advance saveSeq_, so a stale value can
+   // only make us see the buffer as fuller than it is.
+   for (;;)
+   {
+      // seq_cst: see LeaseNthFromTopImageBufferLockFree()
+      const std::uint64_t saved = saveSeq_.load();
+      std::uint64_t reserved = reserveSeq_.load(std::memory_order_acquire);
+      if (reserved - saved >= capacity)
+      {
+         if (!overwriteData_.load(std::memory_order_acquire))
+         {
+            overflow_ = true;
+            return false;
+         }
+         // Same semantics as the Mutex engine: discard everything that has
+         // been published. If every slot is still being written by other
+         // producers, wait for one of them to publish.
+         if (!DiscardPublishedLockFree())
+            std::this_thread::yield();
+         continue;
+      }
+      if (reserveSeq_.compare_exchange_weak(reserved, reserved + 1,
+            std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+         const std::size_t index = static_cast<std::size_t>(reserved % capacity);
+         slot.seq = reserved;
+         slot.buffer = frameArray_[index].load();
+         if (slot.buffer->IsLeased())
+         {
+            slot.buffer = ReplaceLeasedFrame(frameArray_, index);
+            if (!slot.buffer)
+            {
+               // Give up the reservation (the slot is never written)
+               slot.buffer = frameArray_[index].load();
+               AbortWriteSlotLockFree(slot);
+               overflow_ = true;
+               return false;
+            }
+         }
+         openWriteSlots_.fetch_add(1);
+         return true;
+      }
+   }
+}
+
+void CircularBuffer::PublishWriteSlotLockFree(const WriteSlot& slot)
+{
+   // Publish in reservation order, so that [saveSeq_, insertSeq_) is always
+   // a contiguous run of completely written frames. With a single producer
+   // this never waits.
+   while (insertSeq_.load(std::memory_order_acquire) != slot.seq)
+      std::this_thread::yield();
+   insertSeq_.store(slot.seq + 1, std::memory_order_release);
 }
- 
 
 const unsigned char* CircularBuffer::GetTopImage() const
 {
@@ -214,14 +613,37 @@ const FrameBuffer* CircularBuffer::GetTopImageBuffer() const
 
 const FrameBuffer* CircularBuffer::GetNthFromTopImageBuffer(std::size_t n) const
 {
+   if (engine_ == Engine::LockFree)
+      return GetNthFromTopImageBufferLockFree(n);
+
    std::lock_guard<std::mutex> guard(bufferLock_);
+   return NthFromTopImageBufferLocked(n);
+}
+
+FrameBuffer* CircularBuffer::NthFromTopImageBufferLocked(std::size_t n) const
+{
+   // The newest frames are in the spill file, if any are
+   const std::size_t spilled = spillInsertIndex_ - spillSaveIndex_;
+   if (n < spilled)
+      return spillArray_[(spillInsertIndex_ - n - 1) % spillArray_.size()].load();
+   n -= spilled;
 
    const std::size_t availableImages = insertIndex_ - saveIndex_;
    if (n >= availableImages)
       return nullptr;
 
    const std::size_t targetIndex = (insertIndex_ - n - 1) % frameArray_.size();
-   return &frameArray_[targetIndex];
+   return frameArray_[targetIndex].load();
+}
+
+FrameBuffer* CircularBuffer::TakeNextImageBufferLocked()
+{
+   // The oldest frames are in memory, if any are
+   if (insertIndex_ != saveIndex_)
+      return frameArray_[saveIndex_++ % frameArray_.size()].load();
+   if (spillInsertIndex_ != spillSaveIndex_)
+      return spillArray_[spillSaveIndex_++ % spillArray_.size()].load();
+   return nullptr;
 }
 
 const unsigned char* CircularBuffer::GetNextImage()
@@ -234,14 +656,239 @@ const unsigned char* CircularBuffer::GetNextImage()
 
 const FrameBuffer* CircularBuffer::GetNextImageBuffer()
 {
+   if (engine_ == Engine::LockFree)
+      return GetNextImageBufferLockFree();
+
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   return TakeNextImageBufferLocked();
+}
+
+// Finds the sequence number of the nth newest frame in [saved, published)
+// that was not discarded by its producer. Only the rare windows that
+// contain a discarded frame are scanned.
+bool CircularBuffer::FindNthFromTopLockFree(std::size_t n, std::uint64_t saved,
+   std::uint64_t published, std::uint64_t& target) const
+{
+   if (discardedEnd_.load(std::memory_order_acquire) <= saved)
+   {
+      if (n >= published - saved)
+         return false;
+      target = published - n - 1;
+      return true;
+   }
+   for (std::uint64_t seq = published; seq > saved; --seq)
+   {
+      const FrameBuffer* frame = frameArray_[
+         static_cast<std::size_t>((seq - 1) % frameArray_.size())].load();
+      if (frame->IsDiscarded())
+         continue;
+      if (n == 0)
+      {
+         target = seq - 1;
+         return true;
+      }
+      --n;
+   }
+   return false;
+}
+
+const FrameBuffer* CircularBuffer::GetNthFromTopImageBufferLockFree(std::size_t n) const
+{
+   const std::uint64_t saved = saveSeq_.load(std::memory_order_acquire);
+   const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+   std::uint64_t target;
+   if (!FindNthFromTopLockFree(n, saved, published, target))
+      return nullptr;
+   return frameArray_[static_cast<std::size_t>(target % frameArray_.size())].load();
+}
+
+const FrameBuffer* CircularBuffer::GetNextImageBufferLockFree()
+{
+   std::uint64_t saved = saveSeq_.load(std::memory_order_acquire);
+   for (;;)
+   {
+      const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+      if (saved == published)
+         return nullptr;
+      // seq_cst: see LeaseNthFromTopImageBufferLockFree()
+      if (saveSeq_.compare_exchange_weak(saved, saved + 1))
+      {
+         const FrameBuffer* frame =
+            frameArray_[static_cast<std::size_t>(saved % frameArray_.size())].load();
+         if (!frame->IsDiscarded())
+            return frame;
+         ++saved; // Skip a slot aborted by its producer
+      }
+   }
+}
+
+std::shared_ptr<FrameLease> CircularBuffer::LeaseNthFromTopImageBuffer(
+   std::size_t n) const
+{
+   if (engine_ == Engine::LockFree)
+      return LeaseNthFromTopImageBufferLockFree(n);
+
    std::lock_guard<std::mutex> guard(bufferLock_);
 
-   if (insertIndex_ == saveIndex_)
+   FrameBuffer* frame = NthFromTopImageBufferLocked(n);
+   if (!frame)
       return nullptr;
+   return std::make_shared<FrameLease>(frame->shared_from_this());
+}
+
+std::shared_ptr<FrameLease> CircularBuffer::LeaseNextImageBuffer()
+{
+   if (engine_ == Engine::LockFree)
+      return LeaseNextImageBufferLockFree();
+
+   std::lock_guard<std::mutex> guard(bufferLock_);
+
+   FrameBuffer* frame = TakeNextImageBufferLocked();
+   if (!frame)
+      return nullptr;
+   return std::make_shared<FrameLease>(frame->shared_from_this());
+}
+
+std::size_t CircularBuffer::LeaseNextImageBuffers(std::size_t maxCount,
+   std::vector<std::shared_ptr<FrameLease>>& leases)
+{
+   const std::size_t initialSize = leases.size();
+   if (engine_ == Engine::LockFree)
+   {
+      // As in LeaseNextImageBufferLockFree(), but leasing the whole batch
+      // before claiming it with a single update of saveSeq_.
+      std::uint64_t saved = saveSeq_.load();
+      for (;;)
+      {
+         const std::uint64_t published =
+            insertSeq_.load(std::memory_order_acquire);
+         const std::uint64_t count =
+            std::min<std::uint64_t>(published - saved, maxCount);
+         if (count == 0)
+            return 0;
+         std::vector<FrameBuffer*> frames;
+         frames.reserve(static_cast<std::size_t>(count));
+         for (std::uint64_t seq = saved; seq < saved + count; ++seq)
+         {
+            FrameBuffer* frame = frameArray_[
+               static_cast<std::size_t>(seq % frameArray_.size())].load();
+            frames.push_back(frame);
+            leases.push_back(
+               std::make_shared<FrameLease>(frame->shared_from_this()));
+         }
+         if (saveSeq_.compare_exchange_weak(saved, saved + count))
+         {
+            // Drop slots aborted by their producers
+            auto first = leases.begin() + initialSize;
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < frames.size(); ++i)
+            {
+               if (!frames[i]->IsDiscarded())
+                  std::swap(first[kept++], first[i]);
+            }
+            leases.resize(initialSize + kept);
+            if (kept > 0)
+               return kept;
+            saved += count;
+            continue;
+         }
+         leases.resize(initialSize);
+      }
+   }
+
+   std::lock_guard<std::mutex> guard(bufferLock_);
+   while (leases.size() - initialSize < maxCount)
+   {
+      FrameBuffer* frame = TakeNextImageBufferLocked();
+      if (!frame)
+         break;
+      leases.push_back(std::make_shared<FrameLease>(frame->shared_from_this()));
+   }
+   return leases.size() - initialSize;
+}
+
+// A lock-free lease is taken before checking (or, for the next image,
+// claiming) that the frame is still in the readable window, and producers
+// check for leases only after reserving a slot, which requires the slot's
+// previous frame to have left the window. With sequentially consistent
+// operations on the lease count and saveSeq_, either the reader sees that
+// the frame left the window (and gives up its lease), or the producer sees
+// the lease (and replaces the frame).
+std::shared_ptr<FrameLease> CircularBuffer::LeaseNthFromTopImageBufferLockFree(
+   std::size_t n) const
+{
+   for (;;)
+   {
+      const std::uint64_t saved = saveSeq_.load();
+      const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+      std::uint64_t target;
+      if (!FindNthFromTopLockFree(n, saved, published, target))
+         return nullptr;
+
+      FrameBuffer* frame = frameArray_[
+         static_cast<std::size_t>(target % frameArray_.size())].load();
+      auto lease = std::make_shared<FrameLease>(frame->shared_from_this());
+      // The discarded flags seen by FindNthFromTopLockFree() are those of
+      // the frames in the window only if target is still in it.
+      if (saveSeq_.load() <= target)
+         return lease;
+      // The frame was retrieved and its slot may have been reused; retry.
+   }
+}
+
+std::shared_ptr<FrameLease> CircularBuffer::LeaseNextImageBufferLockFree()
+{
+   std::uint64_t saved = saveSeq_.load();
+   for (;;)
+   {
+      const std::uint64_t published = insertSeq_.load(std::memory_order_acquire);
+      if (saved == published)
+         return nullptr;
+      FrameBuffer* frame = frameArray_[
+         static_cast<std::size_t>(saved % frameArray_.size())].load();
+      auto lease = std::make_shared<FrameLease>(frame->shared_from_this());
+      if (saveSeq_.compare_exchange_weak(saved, saved + 1))
+      {
+         if (!frame->IsDiscarded())
+            return lease;
+         ++saved; // Skip a slot aborted by its producer
+      }
+   }
+}
+
+// Called by a producer that owns slot 'index' of 'ring' (but has not yet
+// written to it) and found its frame leased. Substitutes a frame that is not leased,
+// reusing a previously retired frame if possible. Returns null if memory for
+// a new frame cannot be allocated.
+FrameBuffer* CircularBuffer::ReplaceLeasedFrame(
+   std::vector<std::atomic<FrameBuffer*>>& ring, std::size_t index)
+{
+   std::lock_guard<std::mutex> guard(retiredLock_);
+
+   FrameBuffer* replacement = nullptr;
+   auto it = std::find_if(retiredFrames_.begin(), retiredFrames_.end(),
+      [](const FrameBuffer* frame) { return !frame->IsLeased(); });
+   if (it != retiredFrames_.end())
+   {
+      replacement = *it;
+      retiredFrames_.erase(it);
+   }
+   else
+   {
+      try
+      {
+         frameStore_.push_back(std::make_shared<FrameBuffer>(frameSize_));
+      }
+      catch (const std::bad_alloc&)
+      {
+         return nullptr;
+      }
+      replacement = frameStore_.back().get();
+   }
 
-   const std::size_t targetIndex = saveIndex_ % frameArray_.size();
-   ++saveIndex_;
-   return &frameArray_[targetIndex];
+   retiredFrames_.push_back(ring[index].load());
+   ring[index].store(replacement);
+   return replacement;
 }
 
 } // namespace internal
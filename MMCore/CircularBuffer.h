@@ -26,14 +26,19 @@
 
 #include "Error.h"
 #include "ErrorCodes.h"
+#include "FrameArena.h"
 #include "FrameBuffer.h"
 
 #include "MMDevice.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <string_view>
+#include <string>
 #include <vector>
 
 namespace mmcore {
@@ -46,53 +51,242 @@ class TaskSet_CopyMemory;
 class CircularBuffer
 {
 public:
-   CircularBuffer(std::size_t memorySizeMB);
+   // Synchronization strategy used for inserting and retrieving frames.
+   // Mutex: all index updates are made under bufferLock_ and inserts are
+   // serialized by insertLock_.
+   // LockFree: producers reserve and publish slots through atomic sequence
+   // counters; readers never take a lock and never block the producer.
+   enum class Engine {
+      Mutex,
+      LockFree,
+   };
+
+   // How frame memory is allocated.
+   // Heap: each frame is a separate heap allocation.
+   // Arena: all frames are carved out of a single FrameArena mapping.
+   enum class Storage {
+      Heap,
+      Arena,
+   };
+
+   struct StorageOptions {
+      Storage storage = Storage::Heap;
+      FrameArena::Options arena; // Arena storage only
+
+      // If spillDirectory is not empty and spillSizeMB is not zero, frames
+      // that do not fit in memory are written to a scratch file of that
+      // size in spillDirectory, and read back from it in order (Mutex
+      // engine only).
+      std::string spillDirectory;
+      std::size_t spillSizeMB = 0;
+   };
+
+   // Measured the last time Initialize() (re)allocated frames.
+   struct AllocationStats {
+      double milliseconds = 0.0;
+      std::int64_t pageFaults = 0; // -1 if not available
+      bool hugePages = false; // Arena storage only
+      bool numaBound = false; // Arena storage only
+      std::size_t spillFrames = 0;
+      std::string error; // Reason allocation failed, if it did
+   };
+
+   // The thread pool is used for copying large frames and may be shared
+   // with other users.
+   CircularBuffer(std::size_t memorySizeMB,
+      std::shared_ptr<ThreadPool> threadPool);
    ~CircularBuffer();
 
    int SetOverwriteData(bool overwrite);
 
+   // Must not be called while images are being inserted. Discards all
+   // images currently in the buffer.
+   void SetEngine(Engine engine);
+   Engine GetEngine() const { return engine_.load(std::memory_order_relaxed); }
+
    std::size_t GetMemorySizeMB() const { return memorySizeMB_; }
 
+   // Waits for any copy in progress to finish.
+   void SetThreadPool(std::shared_ptr<ThreadPool> threadPool);
+
+   // Takes effect the next time Initialize() is called, which will then
+   // reallocate all frames. Must not be called concurrently with
+   // Initialize().
+   void SetStorageOptions(const StorageOptions& options);
+   StorageOptions GetStorageOptions() const;
+   AllocationStats GetAllocationStats() const;
+
+   // Returns false if frames cannot be allocated (see
+   // GetAllocationStats() for the reason).
    bool Initialize(std::size_t frameSize);
    std::size_t GetSize() const;
    std::size_t GetFreeSize() const;
    std::size_t GetRemainingImageCount() const;
 
    bool InsertImage(const unsigned char* pixArray, std::size_t frameSize,
-      std::string_view serializedMetadata) MMCORE_LEGACY_THROW(CMMError);
+      const ImageTagBlock& metadata) MMCORE_LEGACY_THROW(CMMError);
+
+   // Two-phase insertion, allowing the caller to write pixels directly into
+   // the buffer. A successfully acquired slot must be passed to exactly one
+   // of CommitWriteSlot() or AbortWriteSlot(), on the same thread. With the
+   // Mutex engine, other inserts are blocked until then. The buffer must not
+   // be destroyed, and is not reinitialized, while a slot is open.
+   struct WriteSlot {
+      FrameBuffer* buffer = nullptr;
+      std::uint64_t seq = 0; // LockFree engine only
+      bool spill = false; // Mutex engine only
+   };
+   // Returns false (overflow) if no slot is available; throws if frameSize
+   // does not match the buffer.
+   bool AcquireWriteSlot(std::size_t frameSize, WriteSlot& slot)
+      MMCORE_LEGACY_THROW(CMMError);
+   void CommitWriteSlot(const WriteSlot& slot,
+      const ImageTagBlock& metadata);
+   void AbortWriteSlot(const WriteSlot& slot);
+   bool HasOpenWriteSlots() const { return openWriteSlots_.load() > 0; }
    const unsigned char* GetTopImage() const;
    const unsigned char* GetNextImage();
    const FrameBuffer* GetTopImageBuffer() const;
    const FrameBuffer* GetNthFromTopImageBuffer(std::size_t n) const;
    const FrameBuffer* GetNextImageBuffer();
+
+   // Like GetNthFromTopImageBuffer() and GetNextImageBuffer(), but the
+   // returned frame is leased: it will not be overwritten while the lease
+   // exists. Instead, a new frame buffer is substituted when the producer
+   // reaches its slot. Return null if no such image is available.
+   std::shared_ptr<FrameLease> LeaseNthFromTopImageBuffer(std::size_t n) const;
+   std::shared_ptr<FrameLease> LeaseNextImageBuffer();
+
+   // Removes up to maxCount of the next images, appending leases on them to
+   // leases in order. Takes bufferLock_ (or claims frames, with the LockFree
+   // engine) once for the whole batch. Returns the number of images
+   // removed.
+   std::size_t LeaseNextImageBuffers(std::size_t maxCount,
+      std::vector<std::shared_ptr<FrameLease>>& leases);
+
+   // Blocks until an image is available for retrieval or the timeout
+   // elapses; returns false in the latter case. Producers only notify when
+   // a consumer is waiting, so inserting does not get slower.
+   bool WaitForImage(std::chrono::milliseconds timeout) const;
+
    void Clear();
 
-   bool Overflow() const {std::lock_guard<std::mutex> guard(bufferLock_); return overflow_;}
+   bool Overflow() const { return overflow_.load(std::memory_order_acquire); }
 
 private:
    void ClearLocked();
+   void AllocateFrames(std::size_t count);
+   void ReleaseFrames();
+   std::size_t SpillCapacityLocked() const;
+   FrameBuffer* NthFromTopImageBufferLocked(std::size_t n) const;
+   FrameBuffer* TakeNextImageBufferLocked();
+
+   bool DiscardPublishedLockFree();
+   bool AcquireWriteSlotLockFree(std::size_t frameSize, WriteSlot& slot);
+   void AbortWriteSlotLockFree(const WriteSlot& slot);
+   void PublishWriteSlotLockFree(const WriteSlot& slot);
+   bool FindNthFromTopLockFree(std::size_t n, std::uint64_t saved,
+      std::uint64_t published, std::uint64_t& target) const;
+   const FrameBuffer* GetNthFromTopImageBufferLockFree(std::size_t n) const;
+   const FrameBuffer* GetNextImageBufferLockFree();
+   std::shared_ptr<FrameLease> LeaseNthFromTopImageBufferLockFree(
+      std::size_t n) const;
+   std::shared_ptr<FrameLease> LeaseNextImageBufferLockFree();
+   FrameBuffer* ReplaceLeasedFrame(std::vector<std::atomic<FrameBuffer*>>& ring,
+      std::size_t index);
+   void NotifyImageAvailable();
 
-   // Serializes InsertImage calls so that the pixel copy can occur
-   // without holding bufferLock_.
+   std::atomic<Engine> engine_;
+
+   // Serializes InsertImage calls (and write slots, from acquisition to
+   // commit) so that the pixel copy can occur without holding bufferLock_.
+   // Not used by the LockFree engine.
    mutable std::mutex insertLock_;
 
+   // Guards threadPool_ and tasksMemCopy_, which can only perform one copy
+   // at a time. Only ever try-locked on the insert path.
+   std::mutex copyLock_;
+
    // Guards all mutable state below except where noted.
    mutable std::mutex bufferLock_;
 
    std::size_t frameSize_;
 
+   StorageOptions storageOptions_;
+   bool storageOptionsChanged_;
+   AllocationStats allocationStats_;
+
    // Invariants:
    // 0 <= saveIndex_ <= insertIndex_
    // insertIndex_ - saveIndex_ <= frameArray_.size()
    std::size_t insertIndex_;
    std::size_t saveIndex_;
 
-   bool overflow_;
-   bool overwriteData_;
-   std::vector<FrameBuffer> frameArray_;
+   // Lock-free engine state (frameArray_ and frameSize_ are only modified
+   // by Initialize(), which must not race with inserts in any mode).
+   // Invariants:
+   // saveSeq_ <= insertSeq_ <= reserveSeq_
+   // reserveSeq_ - saveSeq_ <= frameArray_.size()
+   // Frames in [saveSeq_, insertSeq_) are available to readers; frames in
+   // [insertSeq_, reserveSeq_) are being written by producers. The counters
+   // are 64-bit so that they never need to be rebased.
+   std::atomic<std::uint64_t> reserveSeq_;
+   std::atomic<std::uint64_t> insertSeq_;
+   std::atomic<std::uint64_t> saveSeq_;
+   // One past the newest frame published as discarded (0 if none), so that
+   // readers only look for discarded frames when the window may hold one.
+   std::atomic<std::uint64_t> discardedEnd_;
+
+   // Write slots acquired and not yet committed or aborted (either engine).
+   // Incremented under bufferLock_ (Mutex engine), so that Initialize() sees
+   // every slot acquired before it took the lock.
+   std::atomic<unsigned> openWriteSlots_;
+
+   // Written under bufferLock_ in Mutex mode; atomic so that Overflow() and
+   // the lock-free engine can access them without the lock.
+   std::atomic<bool> overflow_;
+   std::atomic<bool> overwriteData_;
+
+   // The ring of frames. Entries are atomic because a producer may replace
+   // a leased frame in its reserved slot while a lock-free reader is
+   // looking up an older frame. The vector itself is only modified by
+   // Initialize().
+   std::vector<std::atomic<FrameBuffer*>> frameArray_;
+
+   // Frames in the spill file (Mutex engine only). While any frame is
+   // spilled, new frames are also spilled even if frameArray_ has room, so
+   // that every frame in memory is older than every spilled frame; readers
+   // retrieve frames from memory first.
+   // Invariants:
+   // 0 <= spillSaveIndex_ <= spillInsertIndex_
+   // spillInsertIndex_ - spillSaveIndex_ <= spillArray_.size()
+   std::vector<std::atomic<FrameBuffer*>> spillArray_;
+   std::size_t spillInsertIndex_;
+   std::size_t spillSaveIndex_;
+
+   // Owns every frame buffer in, or retired from, frameArray_ and
+   // spillArray_. With Arena storage (and for the spill file), the frames
+   // initially in the rings keep the arena alive; replacements for leased
+   // frames are allocated on the heap.
+   std::vector<std::shared_ptr<FrameBuffer>> frameStore_;
+
+   // Leased frames that were replaced in frameArray_; once no longer leased
+   // they are used as replacements in turn.
+   std::vector<FrameBuffer*> retiredFrames_;
+
+   // Guards frameStore_ and retiredFrames_ (except in Initialize(), which
+   // must not race with inserts).
+   mutable std::mutex retiredLock_;
+
+   // Consumers blocked in WaitForImage(). waitLock_ is never acquired while
+   // holding bufferLock_.
+   mutable std::mutex waitLock_;
+   mutable std::condition_variable imageAvailable_;
+   mutable std::atomic<unsigned> waiters_;
 
    // Effectively const after construction.
    std::size_t memorySizeMB_;
+
    std::shared_ptr<ThreadPool> threadPool_;
    std::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
 };
@@ -24,9 +24,26 @@
 
 #include "Configuration.h"
 #include "Error.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+// Device label and property name
+typedef std::pair<std::string, std::string> PropertyKey;
+
+// Generations are unique across all groups, so that a group recreated under
+// the name of a deleted one never appears unchanged
+inline std::uint64_t NextConfigGroupGeneration()
+{
+   static std::atomic<std::uint64_t> generation(0);
+   return ++generation;
+}
+
 /**
  * Encapsulates a collection (map) of user-defined presets.
  */
@@ -41,6 +58,7 @@ public:
    void Define(const char* configName)
    {
       configs_[configName];
+      generation_ = NextConfigGroupGeneration();
    }
 
 	/**
@@ -49,7 +67,7 @@ public:
    void Define(const char* configName, const char* deviceLabel, const char* propName, const char* value)
    {
       PropertySetting setting(deviceLabel, propName, value);
-      configs_[configName].addSetting(setting);
+      AddSetting(configs_[configName], setting);
 	}
 
    /**
@@ -64,6 +82,15 @@ public:
          return &(it->second);
    }
 
+   const T* Find(const char* configName) const
+   {
+      typename std::map<std::string,T>::const_iterator it = configs_.find(configName);
+      if (it == configs_.end())
+         return 0;
+      else
+         return &(it->second);
+   }
+
     /**
     * Renames a preset (addressed by old name).
     */
@@ -76,9 +103,17 @@ public:
       typename std::map<std::string, T>::const_iterator it = configs_.find(oldConfigName);
       if (it == configs_.end())
          return false;
-	  
+
+      if (it->first == newConfigName)
+         return true;
+
+      // A preset already named newConfigName is replaced
+      typename std::map<std::string, T>::iterator existing = configs_.find(newConfigName);
+      if (existing != configs_.end())
+         ReleaseSettings(existing->second);
 	  configs_[newConfigName] = it->second;
       configs_.erase(it->first);
+      generation_ = NextConfigGroupGeneration();
       return true;
    }
 
@@ -94,7 +129,9 @@ public:
       typename std::map<std::string, T>::const_iterator it = configs_.find(configName);
       if (it == configs_.end())
          return false;
+      ReleaseSettings(it->second);
       configs_.erase(configName);
+      generation_ = NextConfigGroupGeneration();
       return true;
    }
 
@@ -113,7 +150,13 @@ public:
 		  return false;
 	  
 	  // Delete the specified property
-      configs_[configName].deleteSetting(deviceLabel,propName);
+      T& config = configs_[configName];
+      if (config.isPropertyIncluded(deviceLabel, propName))
+      {
+         config.deleteSetting(deviceLabel,propName);
+         ReleaseProperty(PropertyKey(deviceLabel, propName));
+         generation_ = NextConfigGroupGeneration();
+      }
 	  return true;
    }
 
@@ -130,16 +173,82 @@ public:
       return configList;
    }
 
-   bool IsEmpty()
+   bool IsEmpty() const
    {
       return configs_.size() == 0;
    }
 
+   /**
+    * Checks if any preset includes the property, without looking at each
+    * preset.
+    */
+   bool IsPropertyIncluded(const char* deviceLabel, const char* propName) const
+   {
+      return presetCounts_.find(PropertyKey(deviceLabel, propName)) !=
+         presetCounts_.end();
+   }
+
+   /**
+    * Returns the properties included in any preset.
+    */
+   std::vector<PropertyKey> GetIncludedProperties() const
+   {
+      std::vector<PropertyKey> props;
+      props.reserve(presetCounts_.size());
+      for (const auto& entry : presetCounts_)
+         props.push_back(entry.first);
+      return props;
+   }
+
+   /**
+    * Returns a number that changes whenever presets are added, removed, or
+    * modified (other than through pointers returned by Find()).
+    */
+   std::uint64_t GetGeneration() const
+   {
+      return generation_;
+   }
+
 protected:
-   ConfigGroupBase() {}
+   ConfigGroupBase() : generation_(NextConfigGroupGeneration()) {}
    virtual ~ConfigGroupBase() {}
 
+   void AddSetting(T& config, const PropertySetting& setting)
+   {
+      const bool included = config.isPropertyIncluded(
+         setting.getDeviceLabel().c_str(), setting.getPropertyName().c_str());
+      config.addSetting(setting);
+      if (!included)
+         ++presetCounts_[PropertyKey(setting.getDeviceLabel(),
+            setting.getPropertyName())];
+      generation_ = NextConfigGroupGeneration();
+   }
+
    std::map<std::string, T> configs_;
+
+private:
+   void ReleaseProperty(const PropertyKey& key)
+   {
+      typename std::map<PropertyKey, unsigned>::iterator it = presetCounts_.find(key);
+      if (it != presetCounts_.end() && --it->second == 0)
+         presetCounts_.erase(it);
+   }
+
+   void ReleaseSettings(const T& config)
+   {
+      for (size_t i = 0; i < config.size(); ++i)
+      {
+         const PropertySetting setting = config.getSetting(i);
+         ReleaseProperty(PropertyKey(setting.getDeviceLabel(),
+            setting.getPropertyName()));
+      }
+   }
+
+   // Number of presets that include each property, kept up to date by all
+   // functions that modify presets
+   std::map<PropertyKey, unsigned> presetCounts_;
+
+   std::uint64_t generation_;
 };
 
 
@@ -175,6 +284,7 @@ public:
    void Define(const char* groupName, const char* configName, const char* deviceLabel, const char* propName, const char* value)
    {
       groups_[groupName].Define(configName, deviceLabel, propName, value);
+      groupsByProperty_[PropertyKey(deviceLabel, propName)].insert(groupName);
    }
 
    /**
@@ -204,6 +314,17 @@ public:
          return it->second.Find(configName);
    }
 
+   /**
+    * Finds a group by name.
+    */
+   const ConfigGroup* FindGroup(const char* groupName) const
+   {
+      std::map<std::string, ConfigGroup>::const_iterator it = groups_.find(groupName);
+      if (it == groups_.end())
+         return 0;
+      return &it->second;
+   }
+
    /**
     * Checks if group exists.
     */
@@ -226,7 +347,11 @@ public:
          std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
          if (it == groups_.end())
             return false; // group not found
-         return it->second.Rename(oldConfigName, newConfigName);
+         // May replace a preset, and thus remove properties from the group
+         const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+         const bool ret = it->second.Rename(oldConfigName, newConfigName);
+         Unindex(it->first, props);
+         return ret;
       } else {
          return true;
       }
@@ -244,7 +369,9 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it == groups_.end())
          return false; // group not found
-      return it->second.Delete(configName, deviceLabel, propName);
+      const bool ret = it->second.Delete(configName, deviceLabel, propName);
+      Unindex(it->first, std::vector<PropertyKey>(1, PropertyKey(deviceLabel, propName)));
+      return ret;
    }
 
 
@@ -260,7 +387,10 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it == groups_.end())
          return false; // group not found
-      return it->second.Delete(configName);
+      const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+      const bool ret = it->second.Delete(configName);
+      Unindex(it->first, props);
+      return ret;
    }
 
    /**
@@ -275,7 +405,9 @@ public:
       std::map<std::string, ConfigGroup>::iterator it = groups_.find(groupName);
       if (it != groups_.end())
       {
-         groups_.erase(it->first);
+         const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
+         groups_.erase(it);
+         Unindex(groupName, props);
          return true;
       }
       return false; //not found
@@ -295,8 +427,18 @@ public:
          std::map<std::string, ConfigGroup>::iterator it = groups_.find(oldGroupName);
          if (it != groups_.end())
          {
+            // A group already named newGroupName is replaced
+            std::map<std::string, ConfigGroup>::iterator existing = groups_.find(newGroupName);
+            std::vector<PropertyKey> replacedProps;
+            if (existing != groups_.end())
+               replacedProps = existing->second.GetIncludedProperties();
+            const std::vector<PropertyKey> props = it->second.GetIncludedProperties();
             groups_[newGroupName] = it->second;
             groups_.erase(it->first);
+            Unindex(oldGroupName, props);
+            Unindex(newGroupName, replacedProps);
+            for (const PropertyKey& key : props)
+               groupsByProperty_[key].insert(newGroupName);
             return true;
          }
          return false; //not found
@@ -336,14 +478,52 @@ public:
       return confList;
    }
 
+   /**
+    * Returns the names of the groups in which any preset includes the
+    * property.
+    */
+   std::vector<std::string> GetGroupsIncludingProperty(const char* deviceLabel, const char* propName) const
+   {
+      std::map<PropertyKey, std::set<std::string>>::const_iterator it =
+         groupsByProperty_.find(PropertyKey(deviceLabel, propName));
+      if (it == groupsByProperty_.end())
+         return std::vector<std::string>();
+      return std::vector<std::string>(it->second.begin(), it->second.end());
+   }
+
    void Clear()
    {
       groups_.clear();
+      groupsByProperty_.clear();
    }
 
 
 private:
+   // Removes groupName from the index entries of those of props that its
+   // presets no longer include.
+   void Unindex(const std::string& groupName, const std::vector<PropertyKey>& props)
+   {
+      std::map<std::string, ConfigGroup>::const_iterator group = groups_.find(groupName);
+      for (const PropertyKey& key : props)
+      {
+         if (group != groups_.end() &&
+               group->second.IsPropertyIncluded(key.first.c_str(), key.second.c_str()))
+            continue;
+         std::map<PropertyKey, std::set<std::string>>::iterator it = groupsByProperty_.find(key);
+         if (it == groupsByProperty_.end())
+            continue;
+         it->second.erase(groupName);
+         if (it->second.empty())
+            groupsByProperty_.erase(it);
+      }
+   }
+
    std::map<std::string, ConfigGroup> groups_;
+
+   // Reverse index from properties to the groups whose presets include
+   // them, so that a property change can be matched to groups without
+   // looking at every preset
+   std::map<PropertyKey, std::set<std::string>> groupsByProperty_;
 };
 
 } // namespace internal
@@ -412,7 +592,7 @@ public:
    bool DefinePixelSize(const char* resolutionID, const char* deviceLabel, const char* propName, const char* value, double pixSizeUm)
    {
       PropertySetting setting(deviceLabel, propName, value);
-      configs_[resolutionID].addSetting(setting);
+      AddSetting(configs_[resolutionID], setting);
       if (configs_[resolutionID].getPixelSizeUm() == 0.0)
       {
          // this is the first setting, so it is OK to set pixel size
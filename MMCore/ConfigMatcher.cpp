@@ -0,0 +1,311 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ConfigMatcher.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Incremental matching of property values against presets
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ConfigMatcher.h"
+
+#include <algorithm>
+
+namespace mmcore {
+namespace internal {
+
+bool ConfigMatcher::IsCompiled(const std::string& group,
+   std::uint64_t generation) const
+{
+   const Group* g = FindGroup(group);
+   return g && g->generation == generation;
+}
+
+void ConfigMatcher::Compile(const std::string& group,
+   std::uint64_t generation,
+   const std::vector<std::pair<std::string, const Configuration*>>& presets,
+   const std::string& liveDevice, const ValueLookup& lookup)
+{
+   Remove(group);
+   auto g = std::make_unique<Group>();
+   g->generation = generation;
+
+   // Intern properties and values, and collect the slots in order of first
+   // appearance
+   std::map<int, std::size_t> slotOfProperty;
+   std::vector<std::vector<std::pair<std::size_t, int>>> settings;
+   for (const auto& preset : presets)
+   {
+      g->presetNames.push_back(preset.first);
+      settings.emplace_back();
+      const Configuration& config = *preset.second;
+      for (std::size_t i = 0; i < config.size(); ++i)
+      {
+         const PropertySetting setting = config.getSetting(i);
+         PropertyKey key(setting.getDeviceLabel(), setting.getPropertyName());
+         auto id = propertyIds_.find(key);
+         if (id == propertyIds_.end())
+         {
+            id = propertyIds_.emplace(key, static_cast<int>(properties_.size())).first;
+            properties_.emplace_back();
+            properties_.back().key = std::move(key);
+         }
+         Property& prop = properties_[id->second];
+         const int value = prop.valueIds.emplace(setting.getPropertyValue(),
+            static_cast<int>(prop.valueIds.size())).first->second;
+
+         auto slot = slotOfProperty.find(id->second);
+         if (slot == slotOfProperty.end())
+         {
+            slot = slotOfProperty.emplace(id->second, g->slots.size()).first;
+            g->slots.push_back(Slot{id->second,
+               prop.key.first == liveDevice, {}});
+         }
+         settings.back().emplace_back(slot->second, value);
+      }
+   }
+
+   const std::size_t slotCount = g->slots.size();
+   g->required.assign(presets.size() * slotCount, unknownValue);
+   for (std::size_t p = 0; p < settings.size(); ++p)
+   {
+      for (const auto& setting : settings[p])
+      {
+         g->required[p * slotCount + setting.first] = setting.second;
+         auto& byValue = g->slots[setting.first].presetsByValue;
+         if (byValue.size() <= static_cast<std::size_t>(setting.second))
+            byValue.resize(setting.second + 1);
+         byValue[setting.second].push_back(static_cast<int>(p));
+      }
+   }
+
+   // Values that were not known to any preset before may now be
+   for (std::size_t s = 0; s < slotCount; ++s)
+   {
+      if (g->slots[s].live)
+      {
+         g->liveSlots.push_back(s);
+         continue;
+      }
+      Property& prop = properties_[g->slots[s].property];
+      UpdateValue(prop, ValueId(prop, lookup(prop.key)));
+   }
+
+   g->mismatches.assign(presets.size(), 0);
+   for (std::size_t s = 0; s < slotCount; ++s)
+   {
+      Property& prop = properties_[g->slots[s].property];
+      prop.users.emplace_back(g.get(), s);
+      if (g->slots[s].live)
+         continue;
+      if (prop.current == unknownValue)
+         ++g->unknownSlots;
+      for (std::size_t p = 0; p < presets.size(); ++p)
+      {
+         const int required = g->required[p * slotCount + s];
+         if (required != unknownValue && required != prop.current)
+            ++g->mismatches[p];
+      }
+   }
+   for (std::size_t p = 0; p < presets.size(); ++p)
+   {
+      if (g->mismatches[p] == 0)
+         g->matching.insert(static_cast<int>(p));
+   }
+
+   groups_[group] = std::move(g);
+}
+
+void ConfigMatcher::Remove(const std::string& group)
+{
+   auto it = groups_.find(group);
+   if (it == groups_.end())
+      return;
+   Unregister(*it->second);
+   groups_.erase(it);
+}
+
+void ConfigMatcher::Clear()
+{
+   groups_.clear();
+   properties_.clear();
+   propertyIds_.clear();
+}
+
+void ConfigMatcher::SetValue(const PropertyKey& prop, const std::string& value)
+{
+   auto it = propertyIds_.find(prop);
+   if (it == propertyIds_.end())
+      return;
+   Property& p = properties_[it->second];
+   UpdateValue(p, ValueId(p, value));
+}
+
+void ConfigMatcher::ResetValues(const ValueLookup& lookup)
+{
+   for (Property& prop : properties_)
+      UpdateValue(prop, ValueId(prop, lookup(prop.key)));
+}
+
+std::optional<std::string> ConfigMatcher::MatchCurrent(
+   const std::string& group, const std::vector<std::string>& liveValues,
+   bool requireAll) const
+{
+   const Group* g = FindGroup(group);
+   if (!g)
+      return std::string();
+   if (requireAll && g->unknownSlots > 0)
+      return std::nullopt;
+   if (g->liveSlots.empty())
+   {
+      if (g->matching.empty())
+         return std::string();
+      return g->presetNames[*g->matching.begin()];
+   }
+
+   std::vector<int> liveIds;
+   for (std::size_t i = 0; i < g->liveSlots.size(); ++i)
+   {
+      const Property& prop = properties_[g->slots[g->liveSlots[i]].property];
+      liveIds.push_back(i < liveValues.size() ?
+         ValueId(prop, liveValues[i]) : unknownValue);
+   }
+   const std::size_t slotCount = g->slots.size();
+   for (int p : g->matching)
+   {
+      bool match = true;
+      for (std::size_t i = 0; match && i < g->liveSlots.size(); ++i)
+      {
+         const int required = g->required[p * slotCount + g->liveSlots[i]];
+         match = required == unknownValue || required == liveIds[i];
+      }
+      if (match)
+         return g->presetNames[p];
+   }
+   return std::string();
+}
+
+std::vector<PropertyKey> ConfigMatcher::GetLiveProperties(
+   const std::string& group) const
+{
+   std::vector<PropertyKey> props;
+   const Group* g = FindGroup(group);
+   if (g)
+   {
+      for (std::size_t s : g->liveSlots)
+         props.push_back(properties_[g->slots[s].property].key);
+   }
+   return props;
+}
+
+std::vector<PropertyKey> ConfigMatcher::GetProperties(
+   const std::string& group) const
+{
+   std::vector<PropertyKey> props;
+   const Group* g = FindGroup(group);
+   if (g)
+   {
+      for (const Slot& slot : g->slots)
+         props.push_back(properties_[slot.property].key);
+   }
+   return props;
+}
+
+std::string ConfigMatcher::Match(const std::string& group,
+   const std::vector<std::optional<std::string>>& values) const
+{
+   const Group* g = FindGroup(group);
+   if (!g)
+      return std::string();
+   const std::size_t slotCount = g->slots.size();
+   std::vector<int> ids(slotCount, unknownValue);
+   for (std::size_t s = 0; s < slotCount && s < values.size(); ++s)
+      ids[s] = ValueId(properties_[g->slots[s].property], values[s]);
+
+   for (std::size_t p = 0; p < g->presetNames.size(); ++p)
+   {
+      const int* required = &g->required[p * slotCount];
+      bool match = true;
+      for (std::size_t s = 0; match && s < slotCount; ++s)
+         match = required[s] == unknownValue || required[s] == ids[s];
+      if (match)
+         return g->presetNames[p];
+   }
+   return std::string();
+}
+
+int ConfigMatcher::ValueId(const Property& prop,
+   const std::optional<std::string>& value) const
+{
+   if (!value)
+      return unknownValue;
+   auto it = prop.valueIds.find(*value);
+   return it == prop.valueIds.end() ? otherValue : it->second;
+}
+
+void ConfigMatcher::UpdateValue(Property& prop, int value)
+{
+   const int old = prop.current;
+   if (old == value)
+      return;
+   prop.current = value;
+   for (const auto& user : prop.users)
+   {
+      Group& g = *user.first;
+      const Slot& slot = g.slots[user.second];
+      if (slot.live)
+         continue;
+      if (old == unknownValue)
+         --g.unknownSlots;
+      if (value == unknownValue)
+         ++g.unknownSlots;
+      // Only presets requiring the old or the new value are affected
+      if (old >= 0 && static_cast<std::size_t>(old) < slot.presetsByValue.size())
+      {
+         for (int p : slot.presetsByValue[old])
+         {
+            if (g.mismatches[p]++ == 0)
+               g.matching.erase(p);
+         }
+      }
+      if (value >= 0 && static_cast<std::size_t>(value) < slot.presetsByValue.size())
+      {
+         for (int p : slot.presetsByValue[value])
+         {
+            if (--g.mismatches[p] == 0)
+               g.matching.insert(p);
+         }
+      }
+   }
+}
+
+void ConfigMatcher::Unregister(Group& group)
+{
+   for (const Slot& slot : group.slots)
+   {
+      auto& users = properties_[slot.property].users;
+      users.erase(std::remove_if(users.begin(), users.end(),
+         [&](const std::pair<Group*, std::size_t>& user) {
+            return user.first == &group;
+         }), users.end());
+   }
+}
+
+const ConfigMatcher::Group* ConfigMatcher::FindGroup(
+   const std::string& group) const
+{
+   auto it = groups_.find(group);
+   return it == groups_.end() ? nullptr : it->second.get();
+}
+
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ConfigMatcher.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Incremental matching of property values against presets
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "ConfigGroup.h"
+#include "Configuration.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mmcore {
+namespace internal {
+
+// Keeps track of which preset of each of a number of groups matches the
+// current property values, updating the match as values change.
+//
+// Each group is compiled from its presets: properties are interned to
+// integer ids, values to per-property integer ids, and each preset becomes
+// a row of required value ids over the union of the group's properties.
+// For each preset, the matcher counts the properties whose current value
+// differs from the required one; a value change only touches the presets
+// that require the old or the new value. The first matching preset (in
+// name order, as for Configuration::isConfigurationIncluded() applied to
+// each preset in turn) is then available in constant time.
+//
+// Properties of a "live" device (the Core) are not tracked; their values
+// are supplied with each query.
+//
+// Not thread safe; see SynchronizedConfiguration.
+class ConfigMatcher {
+public:
+   using ValueLookup =
+      std::function<std::optional<std::string>(const PropertyKey&)>;
+
+   bool IsCompiled(const std::string& group, std::uint64_t generation) const;
+
+   // Compiles (or recompiles) the named presets of a group, in name order.
+   // Current values of the group's properties are obtained from lookup.
+   void Compile(const std::string& group,
+      std::uint64_t generation,
+      const std::vector<std::pair<std::string, const Configuration*>>& presets,
+      const std::string& liveDevice, const ValueLookup& lookup);
+
+   void Remove(const std::string& group);
+   void Clear();
+
+   // Update the value of a tracked property; no-op for other properties.
+   void SetValue(const PropertyKey& prop, const std::string& value);
+
+   // Refresh the values of all tracked properties.
+   void ResetValues(const ValueLookup& lookup);
+
+   // The first preset matching the current values and, for the live
+   // properties (in the order of GetLiveProperties()), liveValues. Returns
+   // "" if no preset matches, and nullopt if requireAll and any tracked
+   // property has no known value.
+   std::optional<std::string> MatchCurrent(const std::string& group,
+      const std::vector<std::string>& liveValues, bool requireAll) const;
+
+   // The properties of liveDevice included in any preset.
+   std::vector<PropertyKey> GetLiveProperties(const std::string& group) const;
+
+   // The union of the properties included in the presets, in order of first
+   // appearance.
+   std::vector<PropertyKey> GetProperties(const std::string& group) const;
+
+   // The first preset matching the given values (in the order of
+   // GetProperties(); nullopt for unknown values), or "".
+   std::string Match(const std::string& group,
+      const std::vector<std::optional<std::string>>& values) const;
+
+private:
+   static constexpr int unknownValue = -1; // Also "not required" in presets
+   static constexpr int otherValue = -2; // Not a value of any preset
+
+   struct Group;
+
+   struct Property {
+      PropertyKey key;
+      std::unordered_map<std::string, int> valueIds;
+      int current = unknownValue;
+      std::vector<std::pair<Group*, std::size_t>> users; // Group and slot
+   };
+
+   struct Slot {
+      int property;
+      bool live;
+      std::vector<std::vector<int>> presetsByValue;
+   };
+
+   struct Group {
+      std::uint64_t generation = 0;
+      std::vector<std::string> presetNames;
+      std::vector<Slot> slots;
+      std::vector<int> required; // Preset-major, presets x slots
+      std::vector<int> mismatches; // Per preset, over tracked slots
+      std::set<int> matching; // Presets with no mismatches
+      std::size_t unknownSlots = 0;
+      std::vector<std::size_t> liveSlots;
+   };
+
+   struct PropertyKeyHash {
+      std::size_t operator()(const PropertyKey& key) const
+      {
+         const std::hash<std::string> h;
+         return h(key.first) * 31 + h(key.second);
+      }
+   };
+
+   int ValueId(const Property& prop, const std::optional<std::string>& value) const;
+   void UpdateValue(Property& prop, int value);
+   void Unregister(Group& group);
+   const Group* FindGroup(const std::string& group) const;
+
+   std::vector<Property> properties_;
+   std::unordered_map<PropertyKey, int, PropertyKeyHash> propertyIds_;
+   std::map<std::string, std::unique_ptr<Group>> groups_;
+};
+
+} // namespace internal
+} // namespace mmcore
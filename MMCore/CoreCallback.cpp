@@ -26,8 +26,10 @@
 //                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
 
 #include "CircularBuffer.h"
+#include "ConfigGroup.h"
 #include "CoreCallback.h"
 #include "DeviceManager.h"
+#include "ImageTagBlock.h"
 #include "Notification.h"
 #include "SerializedMetadata.h"
 #include "SynchronizedConfiguration.h"
@@ -36,8 +38,7 @@
 
 #include <cassert>
 #include <chrono>
-#include <cstdio>
-#include <ctime>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -64,34 +65,6 @@ void CoreCallback::ResetImageInsertionState()
 }
 
 
-static std::string FormatLocalTime(std::chrono::time_point<std::chrono::system_clock> tp) {
-   using namespace std::chrono;
-   auto us = duration_cast<microseconds>(tp.time_since_epoch());
-   auto secs = duration_cast<seconds>(us);
-   auto whole = duration_cast<microseconds>(secs);
-   auto frac = static_cast<int>((us - whole).count());
-
-   // As of C++14/17, it is simpler (and probably faster) to use C functions for
-   // date-time formatting
-
-   std::time_t t(secs.count()); // time_t is seconds on platforms we support
-   std::tm *ptm;
-#ifdef _WIN32 // Windows localtime() is documented thread-safe
-   ptm = std::localtime(&t);
-#else // POSIX has localtime_r()
-   std::tm tmstruct;
-   ptm = localtime_r(&t, &tmstruct);
-#endif
-
-   // Format as "yyyy-mm-dd hh:mm:ss.uuuuuu" (26 chars)
-   const char *timeFmt = "%Y-%m-%d %H:%M:%S";
-   char buf[32];
-   std::size_t len = std::strftime(buf, sizeof(buf), timeFmt, ptm);
-   std::snprintf(buf + len, sizeof(buf) - len, ".%06d", frac);
-   return buf;
-}
-
-
 CoreCallback::~CoreCallback() = default;
 
 
@@ -230,7 +203,7 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller,
             core_->deviceManager_->GetDevice(caller));
 
    std::string label = camera->GetLabel();
-   md.AddTag(MM::g_Keyword_Metadata_CameraLabel, label);
+   md.AddTag(MM::g_Keyword_Metadata_CameraLabel, label.c_str());
 
    std::string serializedMD;
    try
@@ -252,17 +225,33 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
    return InsertImage(caller, buf, width, height, bytesPerPixel, 1, serializedMetadata);
 }
 
-SerializedMetadata
+/**
+ * Fill md with the metadata for a sequence image: the tags supplied by the
+ * camera and the tags added by the Core.
+ */
+void
 CoreCallback::BuildSequenceImageMetadata(const MM::Device* caller,
    unsigned width, unsigned height,
    unsigned byteDepth, unsigned nComponents,
-   const char* origSerializedMd)
-{
-   SerializedMetadata md(origSerializedMd);
-   AddCameraMetadata(caller, md);
-
-   md.AddTag(MM::g_Keyword_Metadata_Width, width);
-   md.AddTag(MM::g_Keyword_Metadata_Height, height);
+   const char* origSerializedMd, ImageTagBlock& md)
+{
+   static const TagKey widthKey = TagKey::Intern(MM::g_Keyword_Metadata_Width);
+   static const TagKey heightKey = TagKey::Intern(MM::g_Keyword_Metadata_Height);
+   static const TagKey pixelTypeKey = TagKey::Intern(MM::g_Keyword_PixelType);
+   static const TagKey timeInCoreKey =
+      TagKey::Intern(MM::g_Keyword_Metadata_TimeInCore);
+   static const TagKey elapsedTimeKey =
+      TagKey::Intern(MM::g_Keyword_Elapsed_Time_ms);
+   static const TagKey imageNumberKey =
+      TagKey::Intern(MM::g_Keyword_Metadata_ImageNumber);
+
+   md.Clear();
+   SerializedMetadata& deviceTags = md.DeviceTags();
+   deviceTags.AppendSerialized(origSerializedMd);
+   AddCameraMetadata(caller, deviceTags);
+
+   md.AddTag(widthKey, static_cast<std::int64_t>(width));
+   md.AddTag(heightKey, static_cast<std::int64_t>(height));
 
    const char* pixelType = MM::g_Keyword_PixelType_Unknown;
    if (byteDepth == 1)
@@ -274,33 +263,34 @@ CoreCallback::BuildSequenceImageMetadata(const MM::Device* caller,
                                      : MM::g_Keyword_PixelType_RGB32;
    else if (byteDepth == 8)
       pixelType = MM::g_Keyword_PixelType_RGB64;
-   md.AddTag(MM::g_Keyword_PixelType, pixelType);
+   md.AddTag(pixelTypeKey, std::string_view(pixelType));
 
    // Note: It is not ideal to use local time. I think this tag is rarely
    // used. Consider replacing with UTC (micro)seconds-since-epoch (with
    // different tag key) after addressing current usage.
-   md.AddTag(MM::g_Keyword_Metadata_TimeInCore,
-         FormatLocalTime(std::chrono::system_clock::now()));
+   // (Formatting is deferred until the metadata is retrieved.)
+   {
+      using namespace std::chrono;
+      md.AddTimestampTag(timeInCoreKey, duration_cast<microseconds>(
+         system_clock::now().time_since_epoch()).count());
+   }
 
    {
       std::lock_guard<std::mutex> guard(imageInsertionStateMutex_);
-      if (!md.HasTag(MM::g_Keyword_Elapsed_Time_ms))
+      if (!deviceTags.HasTag(MM::g_Keyword_Elapsed_Time_ms))
       {
          using namespace std::chrono;
          auto elapsed = steady_clock::now() - startTime_;
-         md.AddTag(MM::g_Keyword_Elapsed_Time_ms,
-            std::to_string(duration_cast<milliseconds>(elapsed).count()));
+         md.AddTag(elapsedTimeKey, static_cast<std::int64_t>(
+            duration_cast<milliseconds>(elapsed).count()));
       }
 
-      auto cameraLabel = md.GetTag(MM::g_Keyword_Metadata_CameraLabel);
+      auto cameraLabel = deviceTags.GetTag(MM::g_Keyword_Metadata_CameraLabel);
       assert(cameraLabel.has_value());
       long& counter = imageNumbers_[std::string(*cameraLabel)];
-      md.AddTag(MM::g_Keyword_Metadata_ImageNumber,
-         CDeviceUtils::ConvertToString(counter));
+      md.AddTag(imageNumberKey, static_cast<std::int64_t>(counter));
       ++counter;
    }
-
-   return md;
 }
 
 int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf,
@@ -309,8 +299,10 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
 {
    try
    {
-      SerializedMetadata md = BuildSequenceImageMetadata(
-         caller, width, height, bytesPerPixel, nComponents, serializedMetadata);
+      // Reused, so that building the metadata does not allocate in steady state
+      thread_local ImageTagBlock md;
+      BuildSequenceImageMetadata(caller, width, height, bytesPerPixel,
+         nComponents, serializedMetadata, md);
 
       MM::ImageProcessor* ip = GetImageProcessor(caller);
       if (ip != nullptr)
@@ -319,7 +311,7 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
       }
       if (core_->cbuf_->InsertImage(buf,
             static_cast<std::size_t>(width) * height * bytesPerPixel,
-            md.View()))
+            md))
          return DEVICE_OK;
       else
          return DEVICE_BUFFER_OVERFLOW;
@@ -330,6 +322,102 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
    }
 }
 
+int CoreCallback::AcquireImageWriteSlot(const MM::Device* /*caller*/,
+   unsigned width, unsigned height, unsigned bytesPerPixel,
+   unsigned nComponents, unsigned char** pixels)
+{
+   if (!pixels)
+      return DEVICE_INVALID_INPUT_PARAM;
+   *pixels = nullptr;
+
+   PendingWriteSlot pending{{}, width, height, bytesPerPixel, nComponents};
+   try
+   {
+      if (!core_->cbuf_->AcquireWriteSlot(
+            static_cast<std::size_t>(width) * height * bytesPerPixel,
+            pending.slot))
+         return DEVICE_BUFFER_OVERFLOW;
+   }
+   catch (CMMError& /*e*/)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+
+   unsigned char* slotPixels = pending.slot.buffer->GetPixelsRW();
+   try
+   {
+      std::lock_guard<std::mutex> lock(writeSlotsMutex_);
+      writeSlots_[slotPixels] = pending;
+   }
+   catch (...)
+   {
+      core_->cbuf_->AbortWriteSlot(pending.slot);
+      return DEVICE_OUT_OF_MEMORY;
+   }
+   *pixels = slotPixels;
+   return DEVICE_OK;
+}
+
+bool CoreCallback::TakePendingWriteSlot(const unsigned char* pixels,
+   PendingWriteSlot& pending)
+{
+   std::lock_guard<std::mutex> lock(writeSlotsMutex_);
+   auto it = writeSlots_.find(pixels);
+   if (it == writeSlots_.end())
+      return false;
+   pending = it->second;
+   writeSlots_.erase(it);
+   return true;
+}
+
+int CoreCallback::CommitImageWriteSlot(const MM::Device* caller,
+   unsigned char* pixels, const char* serializedMetadata)
+{
+   PendingWriteSlot pending;
+   if (!TakePendingWriteSlot(pixels, pending))
+      return DEVICE_INVALID_INPUT_PARAM;
+
+   try
+   {
+      thread_local ImageTagBlock md;
+      BuildSequenceImageMetadata(caller, pending.width, pending.height,
+         pending.bytesPerPixel, pending.nComponents, serializedMetadata, md);
+
+      // The slot is ours until committed, so process in place
+      MM::ImageProcessor* ip = GetImageProcessor(caller);
+      if (ip != nullptr)
+      {
+         ip->Process(pixels, pending.width, pending.height,
+            pending.bytesPerPixel);
+      }
+      core_->cbuf_->CommitWriteSlot(pending.slot, md);
+      return DEVICE_OK;
+   }
+   catch (CMMError& /*e*/)
+   {
+      core_->cbuf_->AbortWriteSlot(pending.slot);
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+   catch (...)
+   {
+      // E.g. bad_alloc, or an exception from the image processor. The slot
+      // must not stay open: with the Mutex engine, it blocks all inserts.
+      core_->cbuf_->AbortWriteSlot(pending.slot);
+      return DEVICE_ERR;
+   }
+}
+
+int CoreCallback::AbortImageWriteSlot(const MM::Device* /*caller*/,
+   unsigned char* pixels)
+{
+   PendingWriteSlot pending;
+   if (!TakePendingWriteSlot(pixels, pending))
+      return DEVICE_INVALID_INPUT_PARAM;
+
+   core_->cbuf_->AbortWriteSlot(pending.slot);
+   return DEVICE_OK;
+}
+
 bool CoreCallback::InitializeImageBuffer(unsigned channels, unsigned slices,
       unsigned int w, unsigned int h, unsigned int pixDepth)
 {
@@ -470,45 +558,32 @@ int CoreCallback::OnPropertyChanged(const MM::Device* device, const char* propNa
    core_->postNotification(
       notif::PropertyChanged{label, propName, value});
 
-   // Find all configs that contain this property and notify that the
-   // config group changed.
-   // TODO: Assess whether performance is better by maintaining a map tying
-   // property to configurations
-   for (const auto& group : core_->getAvailableConfigGroups()) {
-      for (const auto& config : core_->getAvailableConfigs(group.c_str())) {
-         Configuration configData =
-            core_->getConfigData(group.c_str(), config.c_str());
-         if (configData.isPropertyIncluded(label, propName)) {
-            std::string currentConfig =
-               core_->getCurrentConfigFromCache(group.c_str());
-            core_->postNotification(
-               notif::ConfigGroupChanged{group, currentConfig});
-            break;
-         }
-      }
+   // Notify that the config groups containing this property changed. The
+   // groups are looked up in an index maintained as presets are defined.
+   for (const auto& group :
+         core_->configGroups_->GetGroupsIncludingProperty(label, propName)) {
+      std::string currentConfig =
+         core_->getCurrentConfigFromCache(group.c_str());
+      core_->postNotification(
+         notif::ConfigGroupChanged{group, currentConfig});
    }
 
    // Check if pixel size was potentially affected. If so, update from cache.
-   for (const auto& psConfig : core_->getAvailablePixelSizeConfigs()) {
-      Configuration pixelSizeConfig =
-         core_->getPixelSizeConfigData(psConfig.c_str());
-      if (pixelSizeConfig.isPropertyIncluded(label, propName)) {
-         double pixSizeUm;
-         try {
-            pixSizeUm = core_->getPixelSizeUm(true);
-            std::vector<double> affine = core_->getPixelSizeAffine(true);
-            if (affine.size() == 6) {
-               core_->postNotification(notif::PixelSizeAffineChanged{
-                  affine[0], affine[1], affine[2],
-                  affine[3], affine[4], affine[5]});
-            }
-         }
-         catch (const CMMError&) {
-            pixSizeUm = 0.0;
+   if (core_->pixelSizeGroup_->IsPropertyIncluded(label, propName)) {
+      double pixSizeUm;
+      try {
+         pixSizeUm = core_->getPixelSizeUm(true);
+         std::vector<double> affine = core_->getPixelSizeAffine(true);
+         if (affine.size() == 6) {
+            core_->postNotification(notif::PixelSizeAffineChanged{
+               affine[0], affine[1], affine[2],
+               affine[3], affine[4], affine[5]});
          }
-         core_->postNotification(notif::PixelSizeChanged{pixSizeUm});
-         break;
       }
+      catch (const CMMError&) {
+         pixSizeUm = 0.0;
+      }
+      core_->postNotification(notif::PixelSizeChanged{pixSizeUm});
    }
 
    return DEVICE_OK;
@@ -596,6 +671,23 @@ int CoreCallback::OnShutterOpenChanged(const MM::Device* device, bool state)
    return DEVICE_OK;
 }
 
+/**
+ * Handler for busy state reports (see CDeviceBase::OnBusyChanged()).
+ */
+int CoreCallback::OnBusyChanged(const MM::Device* device, bool busy)
+{
+   try
+   {
+      core_->onDeviceBusyReported(core_->deviceManager_->GetDevice(device),
+            busy);
+   }
+   catch (const CMMError&)
+   {
+      // Device not (or no longer) registered
+   }
+   return DEVICE_OK;
+}
+
 
 int CoreCallback::SetSerialProperties(const char* portName,
                                       const char* answerTimeout,
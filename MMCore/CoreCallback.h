@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Devices/DeviceInstances.h"
+#include "CircularBuffer.h"
 #include "CoreUtils.h"
 #include "MMCore.h"
 
@@ -39,6 +40,7 @@ namespace mmcore {
 namespace internal {
 
 class DeviceManager;
+class ImageTagBlock;
 class SerializedMetadata;
 
 
@@ -95,6 +97,12 @@ public:
    int InsertImage(const MM::Device* caller, const unsigned char* buf,
       unsigned width, unsigned height, unsigned bytesPerPixel, unsigned nComponents,
       const char* serializedMetadata);
+   int AcquireImageWriteSlot(const MM::Device* caller,
+      unsigned width, unsigned height, unsigned bytesPerPixel,
+      unsigned nComponents, unsigned char** pixels);
+   int CommitImageWriteSlot(const MM::Device* caller, unsigned char* pixels,
+      const char* serializedMetadata);
+   int AbortImageWriteSlot(const MM::Device* caller, unsigned char* pixels);
    bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth);
 
    int AcqFinished(const MM::Device* caller, int statusCode);
@@ -112,6 +120,7 @@ public:
    int OnSLMExposureChanged(const MM::Device* device, double newExposure);
    int OnMagnifierChanged(const MM::Device* device);
    int OnShutterOpenChanged(const MM::Device* device, bool open);
+   int OnBusyChanged(const MM::Device* device, bool busy);
 
    // Deprecated
    MM::SignalIO* GetSignalIODevice(const MM::Device* caller,
@@ -137,11 +146,25 @@ private:
    std::map<std::string, long> imageNumbers_;
    std::chrono::time_point<std::chrono::steady_clock> startTime_;
 
+   // Write slots handed out by AcquireImageWriteSlot() and not yet committed
+   // or aborted, keyed by pixel buffer address.
+   struct PendingWriteSlot {
+      CircularBuffer::WriteSlot slot;
+      unsigned width;
+      unsigned height;
+      unsigned bytesPerPixel;
+      unsigned nComponents;
+   };
+   std::mutex writeSlotsMutex_;
+   std::map<const unsigned char*, PendingWriteSlot> writeSlots_;
+   bool TakePendingWriteSlot(const unsigned char* pixels,
+         PendingWriteSlot& pending);
+
    void AddCameraMetadata(const MM::Device* caller, SerializedMetadata& md);
-   SerializedMetadata BuildSequenceImageMetadata(const MM::Device* caller,
+   void BuildSequenceImageMetadata(const MM::Device* caller,
          unsigned width, unsigned height,
          unsigned byteDepth, unsigned nComponents,
-         const char* origSerializedMd);
+         const char* origSerializedMd, ImageTagBlock& md);
    MM::ImageProcessor* GetImageProcessor(const MM::Device* caller);
 };
 
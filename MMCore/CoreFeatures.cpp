@@ -119,6 +119,14 @@ const auto& featureMap() {
             [](bool e) { g_flags.ParallelDeviceInitialization = e; }
          }
       },
+      {
+         "ParallelConfigurationLoading", {
+            [] { return g_flags.ParallelConfigurationLoading; },
+            [](bool e) { g_flags.ParallelConfigurationLoading = e; }
+            // Device adapters that are not safe to configure concurrently
+            // with other adapters are what keeps this from being the default.
+         }
+      },
       // How to add a new Core feature: see the comment at the top of this file.
       // Features (the string names) must never be removed once added!
    };
@@ -28,6 +28,7 @@ namespace features {
 struct Flags {
    bool strictInitializationChecks = false;
    bool ParallelDeviceInitialization = true;
+   bool ParallelConfigurationLoading = false;
    // How to add a new Core feature: see the comment in the .cpp file.
 };
 
@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceAdapterCatalog.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   On-disk cache of the devices provided by device adapters
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DeviceAdapterCatalog.h"
+
+#include "CoreUtils.h"
+#include "Error.h"
+#include "LoadableModules/LoadedDeviceAdapter.h"
+
+#include "MMDevice.h"
+#include "ModuleInterface.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+namespace mmcore {
+namespace internal {
+
+namespace {
+
+const char* const catalogFormat = "MMDeviceAdapterCatalog";
+const int catalogFormatVersion = 1;
+
+// Fields are tab-separated, one record per line
+std::string Escape(const std::string& s)
+{
+   std::string ret;
+   ret.reserve(s.size());
+   for (char ch : s)
+   {
+      switch (ch)
+      {
+         case '\\': ret += "\\\\"; break;
+         case '\t': ret += "\\t"; break;
+         case '\n': ret += "\\n"; break;
+         case '\r': ret += "\\r"; break;
+         default: ret += ch;
+      }
+   }
+   return ret;
+}
+
+std::vector<std::string> SplitFields(const std::string& line)
+{
+   std::vector<std::string> fields(1);
+   for (std::size_t i = 0; i < line.size(); ++i)
+   {
+      const char ch = line[i];
+      if (ch == '\t')
+      {
+         fields.emplace_back();
+      }
+      else if (ch == '\\' && i + 1 < line.size())
+      {
+         const char next = line[++i];
+         fields.back() += next == 't' ? '\t' : next == 'n' ? '\n' :
+            next == 'r' ? '\r' : next;
+      }
+      else
+      {
+         fields.back() += ch;
+      }
+   }
+   return fields;
+}
+
+} // anonymous namespace
+
+std::optional<DeviceAdapterCatalog::FileStamp>
+DeviceAdapterCatalog::GetFileStamp(const std::string& path)
+{
+   std::error_code ec;
+   const auto size = std::filesystem::file_size(path, ec);
+   if (ec)
+      return std::nullopt;
+   const auto mtime = std::filesystem::last_write_time(path, ec);
+   if (ec)
+      return std::nullopt;
+   FileStamp stamp;
+   stamp.mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count());
+   stamp.size = static_cast<std::uint64_t>(size);
+   return stamp;
+}
+
+std::vector<DeviceAdapterCatalog::Device>
+DeviceAdapterCatalog::DescribeDevices(const LoadedDeviceAdapter& module)
+{
+   std::vector<Device> devices;
+   for (const auto& name : module.GetAvailableDeviceNames())
+   {
+      Device device;
+      device.name = name;
+      device.description = module.GetDeviceDescription(name);
+      device.type = module.GetAdvertisedDeviceType(name);
+      devices.push_back(std::move(device));
+   }
+   return devices;
+}
+
+bool
+DeviceAdapterCatalog::Load(const std::string& filename)
+{
+   entries_.clear();
+   std::ifstream in(filename);
+   if (!in)
+      return false;
+
+   std::string line;
+   if (!std::getline(in, line))
+      return false;
+   std::vector<std::string> header = SplitFields(line);
+   if (header.size() != 2 || header[0] != catalogFormat ||
+         header[1] != std::to_string(catalogFormatVersion))
+      return false;
+
+   std::map<std::string, Entry> entries;
+   try
+   {
+      while (std::getline(in, line))
+      {
+         std::vector<std::string> fields = SplitFields(line);
+         if (fields.size() != 7 || fields[0] != "L")
+            return false;
+         Entry entry;
+         entry.stamp.mtime = std::stoll(fields[2]);
+         entry.stamp.size = std::stoull(fields[3]);
+         entry.moduleInterfaceVersion = std::stol(fields[4]);
+         entry.deviceInterfaceVersion = std::stol(fields[5]);
+         const unsigned long count = std::stoul(fields[6]);
+         for (unsigned long i = 0; i < count; ++i)
+         {
+            if (!std::getline(in, line))
+               return false;
+            std::vector<std::string> deviceFields = SplitFields(line);
+            if (deviceFields.size() != 4 || deviceFields[0] != "D")
+               return false;
+            Device device;
+            device.name = deviceFields[1];
+            device.type = static_cast<MM::DeviceType>(std::stoi(deviceFields[2]));
+            device.description = deviceFields[3];
+            entry.devices.push_back(std::move(device));
+         }
+         entries[fields[1]] = std::move(entry);
+      }
+   }
+   catch (const std::exception&) // Malformed number
+   {
+      return false;
+   }
+   entries_ = std::move(entries);
+   return true;
+}
+
+void
+DeviceAdapterCatalog::Save(const std::string& filename) const
+{
+   std::ostringstream out;
+   out << catalogFormat << '\t' << catalogFormatVersion << '\n';
+   for (const auto& entry : entries_)
+   {
+      const Entry& e = entry.second;
+      out << "L\t" << Escape(entry.first) << '\t' << e.stamp.mtime << '\t' <<
+         e.stamp.size << '\t' << e.moduleInterfaceVersion << '\t' <<
+         e.deviceInterfaceVersion << '\t' << e.devices.size() << '\n';
+      for (const auto& device : e.devices)
+      {
+         out << "D\t" << Escape(device.name) << '\t' <<
+            static_cast<int>(device.type) << '\t' <<
+            Escape(device.description) << '\n';
+      }
+   }
+
+   // Write to a temporary file and rename, so that readers (possibly in
+   // another process) never see a partial catalog
+   const std::string tmpName = filename + ".tmp";
+   {
+      std::ofstream file(tmpName, std::ios::binary | std::ios::trunc);
+      file << out.str();
+      file.close();
+      if (!file)
+         throw CMMError("Cannot write device adapter catalog " +
+               ToQuotedString(tmpName));
+   }
+   std::error_code ec;
+   std::filesystem::rename(tmpName, filename, ec);
+   if (ec)
+   {
+      std::filesystem::remove(tmpName, ec);
+      throw CMMError("Cannot write device adapter catalog " +
+            ToQuotedString(filename));
+   }
+}
+
+std::optional<std::vector<DeviceAdapterCatalog::Device>>
+DeviceAdapterCatalog::Find(const std::string& path) const
+{
+   auto it = entries_.find(path);
+   if (it == entries_.end())
+      return std::nullopt;
+   const Entry& entry = it->second;
+   if (entry.moduleInterfaceVersion != MODULE_INTERFACE_VERSION ||
+         entry.deviceInterfaceVersion != DEVICE_INTERFACE_VERSION)
+      return std::nullopt;
+   const std::optional<FileStamp> stamp = GetFileStamp(path);
+   if (!stamp || stamp->mtime != entry.stamp.mtime ||
+         stamp->size != entry.stamp.size)
+      return std::nullopt;
+   return entry.devices;
+}
+
+void
+DeviceAdapterCatalog::Put(const std::string& path, FileStamp stamp,
+   std::vector<Device> devices)
+{
+   // Only modules that loaded successfully, and thus match our interface
+   // versions, are entered
+   Entry& entry = entries_[path];
+   entry.stamp = stamp;
+   entry.moduleInterfaceVersion = MODULE_INTERFACE_VERSION;
+   entry.deviceInterfaceVersion = DEVICE_INTERFACE_VERSION;
+   entry.devices = std::move(devices);
+}
+
+} // namespace internal
+} // namespace mmcore
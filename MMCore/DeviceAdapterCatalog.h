@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          DeviceAdapterCatalog.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   On-disk cache of the devices provided by device adapters
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "MMDeviceConstants.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace mmcore {
+namespace internal {
+
+class LoadedDeviceAdapter;
+
+// The devices advertised by device adapter libraries, keyed by library path.
+// An entry is valid only while the library file has the modification time
+// and size it had when the entry was made, and only for the module and
+// device interface versions of this build of MMCore. This allows the
+// devices to be listed without loading the libraries.
+class DeviceAdapterCatalog {
+public:
+   struct Device {
+      std::string name;
+      std::string description;
+      MM::DeviceType type = MM::UnknownType;
+   };
+
+   struct FileStamp {
+      std::int64_t mtime = 0;
+      std::uint64_t size = 0;
+   };
+
+   // Stamp of the file at path, or nullopt if it cannot be accessed.
+   static std::optional<FileStamp> GetFileStamp(const std::string& path);
+
+   // The devices of a loaded module.
+   static std::vector<Device> DescribeDevices(const LoadedDeviceAdapter& module);
+
+   // Reads a catalog file, replacing the current entries. A missing or
+   // unreadable file (including one written by an incompatible version)
+   // leaves the catalog empty; returns false in that case.
+   bool Load(const std::string& filename);
+
+   // Writes the catalog, replacing the file atomically. Throws CMMError.
+   void Save(const std::string& filename) const;
+
+   // The devices of the library at path, if the entry is still valid.
+   std::optional<std::vector<Device>> Find(const std::string& path) const;
+
+   void Put(const std::string& path, FileStamp stamp,
+      std::vector<Device> devices);
+
+   void Clear() { entries_.clear(); }
+   std::size_t Size() const { return entries_.size(); }
+
+private:
+   struct Entry {
+      FileStamp stamp;
+      long moduleInterfaceVersion = 0;
+      long deviceInterfaceVersion = 0;
+      std::vector<Device> devices;
+   };
+
+   std::map<std::string, Entry> entries_;
+};
+
+} // namespace internal
+} // namespace mmcore
@@ -24,6 +24,7 @@
 
 #include "MMDeviceConstants.h"
 
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <memory>
@@ -83,6 +84,9 @@ private:
    bool initializeCalled_ = false;
    bool initialized_ = false;
    std::optional<long> timeoutMsOverride_{};
+   // Busy state reported through MM::Core::OnBusyChanged():
+   // -1 if the device never reported it, else 0 or 1
+   std::atomic<int> reportedBusy_{-1};
 
 public:
    DeviceInstance(const DeviceInstance&) = delete;
@@ -108,6 +112,15 @@ public:
    void SetTimeoutMsOverride(long ms) /* final */ { timeoutMsOverride_ = ms; }
    void ClearTimeoutMsOverride() /* final */ { timeoutMsOverride_.reset(); }
 
+   std::optional<bool> GetReportedBusy() const /* final */
+   {
+      const int busy = reportedBusy_;
+      if (busy < 0)
+         return std::nullopt;
+      return busy != 0;
+   }
+   void SetReportedBusy(bool busy) /* final */ { reportedBusy_ = busy ? 1 : 0; }
+
 protected:
    // The DeviceInstance object owns the raw device pointer (pDevice) as soon
    // as the constructor is called, even if the constructor throws.
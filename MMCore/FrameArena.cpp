@@ -0,0 +1,321 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameArena.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Single-mapping backing store for circular buffer frames
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameArena.h"
+
+#include "CoreUtils.h"
+#include "Error.h"
+#include "ErrorCodes.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace mmcore {
+namespace internal {
+
+namespace {
+
+#ifdef MAP_HUGETLB
+constexpr std::size_t hugePageSize = 2 << 20;
+#endif
+
+std::size_t RoundUp(std::size_t n, std::size_t multiple)
+{
+   return (n + multiple - 1) / multiple * multiple;
+}
+
+std::size_t SystemPageSize()
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwPageSize;
+#else
+   const long size = sysconf(_SC_PAGESIZE);
+   return size > 0 ? static_cast<std::size_t>(size) : 4096;
+#endif
+}
+
+// Write to every page so that it is backed by physical memory now rather
+// than on first use.
+void TouchPages(unsigned char* base, std::size_t size, std::size_t pageSize)
+{
+   volatile unsigned char* p = base;
+   for (std::size_t offset = 0; offset < size; offset += pageSize)
+      p[offset] = 0;
+}
+
+#ifdef __linux__
+bool BindToNumaNode(void* addr, std::size_t size, int node)
+{
+   // Avoid a dependency on libnuma for this single call.
+   constexpr int mpolBind = 2; // MPOL_BIND
+   constexpr std::size_t bitsPerWord = 8 * sizeof(unsigned long);
+   std::vector<unsigned long> mask(node / bitsPerWord + 1);
+   mask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+   // The kernel expects the number of bits plus one.
+   const unsigned long maxNode = mask.size() * bitsPerWord + 1;
+   return syscall(SYS_mbind, addr, size, mpolBind, mask.data(), maxNode,
+      0) == 0;
+}
+#endif
+
+} // anonymous namespace
+
+std::size_t FrameArena::SlotStride(std::size_t frameSize)
+{
+   return RoundUp(frameSize, slotAlignment);
+}
+
+std::size_t FrameArena::FileBackedSlotStride(std::size_t frameSize)
+{
+   return RoundUp(frameSize, SystemPageSize());
+}
+
+std::shared_ptr<FrameArena> FrameArena::Create(std::size_t frameSize,
+   std::size_t slotCount, const Options& options)
+{
+   const std::size_t stride = SlotStride(frameSize);
+   if (frameSize == 0 || slotCount == 0 ||
+         stride > std::numeric_limits<std::size_t>::max() / 2 / slotCount)
+      throw std::bad_alloc();
+   const std::size_t pageSize = SystemPageSize();
+
+   std::shared_ptr<FrameArena> arena(new FrameArena());
+   arena->stride_ = stride;
+   arena->slotCount_ = slotCount;
+   std::size_t touchStride = pageSize;
+   bool resident = false;
+
+#ifdef _WIN32
+   const DWORD node = options.numaNode >= 0 ?
+      static_cast<DWORD>(options.numaNode) : NUMA_NO_PREFERRED_NODE;
+   void* addr = nullptr;
+   if (options.hugePages)
+   {
+      // Requires the "Lock pages in memory" privilege; large pages are
+      // always resident, so no prefaulting is needed.
+      const SIZE_T largePageSize = GetLargePageMinimum();
+      if (largePageSize > 0)
+      {
+         arena->mappedSize_ = RoundUp(stride * slotCount, largePageSize);
+         addr = VirtualAllocExNuma(GetCurrentProcess(), nullptr,
+            arena->mappedSize_, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+            PAGE_READWRITE, node);
+         arena->hugePages_ = resident = addr != nullptr;
+      }
+   }
+   if (!addr)
+   {
+      arena->mappedSize_ = RoundUp(stride * slotCount, pageSize);
+      addr = VirtualAllocExNuma(GetCurrentProcess(), nullptr,
+         arena->mappedSize_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+   }
+   if (!addr)
+      throw std::bad_alloc();
+   arena->base_ = static_cast<unsigned char*>(addr);
+   arena->numaBound_ = options.numaNode >= 0;
+#else
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+   void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+   if (options.hugePages)
+   {
+      // Only succeeds if huge pages have been reserved by the administrator
+      // (vm.nr_hugepages); otherwise fall back to transparent huge pages.
+      arena->mappedSize_ = RoundUp(stride * slotCount, hugePageSize);
+      addr = mmap(nullptr, arena->mappedSize_, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (addr != MAP_FAILED)
+      {
+         arena->hugePages_ = true;
+         touchStride = hugePageSize;
+      }
+   }
+#endif
+   if (addr == MAP_FAILED)
+   {
+      arena->mappedSize_ = RoundUp(stride * slotCount, pageSize);
+      addr = mmap(nullptr, arena->mappedSize_, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (addr == MAP_FAILED)
+         throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+      if (options.hugePages)
+         arena->hugePages_ = madvise(addr, arena->mappedSize_,
+            MADV_HUGEPAGE) == 0;
+#endif
+   }
+   arena->base_ = static_cast<unsigned char*>(addr);
+
+#ifdef __linux__
+   // Must precede the first touch of any page.
+   if (options.numaNode >= 0)
+      arena->numaBound_ = BindToNumaNode(addr, arena->mappedSize_,
+         options.numaNode);
+#endif
+#endif // _WIN32
+
+   if (options.prefault && !resident)
+   {
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+      if (madvise(arena->base_, arena->mappedSize_, MADV_POPULATE_WRITE) != 0)
+         TouchPages(arena->base_, arena->mappedSize_, touchStride);
+#else
+      TouchPages(arena->base_, arena->mappedSize_, touchStride);
+#endif
+   }
+   return arena;
+}
+
+std::shared_ptr<FrameArena> FrameArena::CreateFileBacked(
+   const std::string& directory, std::size_t frameSize, std::size_t slotCount)
+{
+   const std::size_t stride = FileBackedSlotStride(frameSize);
+   if (frameSize == 0 || slotCount == 0 ||
+         stride > std::numeric_limits<std::size_t>::max() / 2 / slotCount)
+      throw CMMError("Invalid spill file size", MMERR_OutOfMemory);
+
+   std::shared_ptr<FrameArena> arena(new FrameArena());
+   arena->stride_ = stride;
+   arena->slotCount_ = slotCount;
+   arena->mappedSize_ = stride * slotCount;
+   arena->fileBacked_ = true;
+   const std::string failure = "Cannot create spill file in " +
+      ToQuotedString(directory);
+
+#ifdef _WIN32
+   char path[MAX_PATH];
+   if (!GetTempFileNameA(directory.c_str(), "mms", 0, path))
+      throw CMMError(failure, MMERR_FileOpenFailed);
+   HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+      CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+      nullptr);
+   if (file == INVALID_HANDLE_VALUE)
+   {
+      DeleteFileA(path);
+      throw CMMError(failure, MMERR_FileOpenFailed);
+   }
+   arena->fileHandle_ = file;
+   const auto size = static_cast<unsigned long long>(arena->mappedSize_);
+   // Extends the file to its full size
+   HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+   if (!mapping)
+      throw CMMError(failure + " (insufficient space?)", MMERR_FileOpenFailed);
+   void* addr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+      arena->mappedSize_);
+   CloseHandle(mapping); // The view keeps the mapping alive
+   if (!addr)
+      throw CMMError(failure + " (cannot map file)", MMERR_FileOpenFailed);
+   arena->base_ = static_cast<unsigned char*>(addr);
+#else
+   std::string templ = directory + "/mmcore-spill-XXXXXX";
+   const int fd = mkstemp(&templ[0]);
+   if (fd < 0)
+      throw CMMError(failure + ": " + std::strerror(errno),
+         MMERR_FileOpenFailed);
+   unlink(templ.c_str());
+
+   // Reserve disk space now: writing to a page of a sparse file when the
+   // disk is full would crash the process (SIGBUS).
+#ifdef __linux__
+   const int err = posix_fallocate(fd, 0,
+      static_cast<off_t>(arena->mappedSize_));
+#else
+   const int err = ftruncate(fd, static_cast<off_t>(arena->mappedSize_)) ?
+      errno : 0;
+#endif
+   if (err)
+   {
+      close(fd);
+      throw CMMError(failure + ": " + std::strerror(err),
+         MMERR_FileOpenFailed);
+   }
+
+   void* addr = mmap(nullptr, arena->mappedSize_, PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+   const int mapErr = errno;
+   close(fd); // The mapping keeps the file open
+   if (addr == MAP_FAILED)
+      throw CMMError(failure + ": " + std::strerror(mapErr),
+         MMERR_FileOpenFailed);
+   arena->base_ = static_cast<unsigned char*>(addr);
+#endif
+   return arena;
+}
+
+FrameArena::~FrameArena()
+{
+#ifdef _WIN32
+   if (base_)
+   {
+      if (fileBacked_)
+         UnmapViewOfFile(base_);
+      else
+         VirtualFree(base_, 0, MEM_RELEASE);
+   }
+   if (fileHandle_)
+      CloseHandle(fileHandle_);
+#else
+   if (base_)
+      munmap(base_, mappedSize_);
+#endif
+}
+
+std::int64_t GetPageFaultCount()
+{
+#ifdef _WIN32
+   PROCESS_MEMORY_COUNTERS counters;
+   if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+         sizeof(counters)))
+      return -1;
+   return counters.PageFaultCount;
+#else
+#ifdef RUSAGE_THREAD
+   const int who = RUSAGE_THREAD;
+#else
+   const int who = RUSAGE_SELF;
+#endif
+   struct rusage usage;
+   if (getrusage(who, &usage) != 0)
+      return -1;
+   return static_cast<std::int64_t>(usage.ru_minflt) + usage.ru_majflt;
+#endif
+}
+
+} // namespace internal
+} // namespace mmcore
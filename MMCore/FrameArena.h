@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameArena.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Single-mapping backing store for circular buffer frames
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace mmcore {
+namespace internal {
+
+// One memory mapping, carved into equally sized frame slots.
+//
+// Compared to allocating each frame separately on the heap, this replaces
+// many allocations by one system call, allows the mapping to use huge pages
+// (fewer TLB misses when streaming through a multi-GB buffer) and to be bound
+// to a NUMA node, and allows all pages to be faulted in up front rather than
+// on first touch in the middle of an acquisition.
+//
+// Huge pages and NUMA binding are requests: if the system cannot honor them,
+// the arena falls back to regular pages or default placement (see
+// UsesHugePages() and IsNumaBound()). Only failure to map memory at all is an
+// error (std::bad_alloc).
+class FrameArena
+{
+public:
+   struct Options {
+      bool hugePages = false;
+      bool prefault = true;
+      int numaNode = -1; // -1 for default placement
+   };
+
+   // Slots are aligned to slotAlignment bytes.
+   static constexpr std::size_t slotAlignment = 64;
+
+   static std::size_t SlotStride(std::size_t frameSize);
+
+   // Slot stride of a file-backed arena (frame size rounded up to a page).
+   static std::size_t FileBackedSlotStride(std::size_t frameSize);
+
+   // Anonymous memory. Throws std::bad_alloc.
+   static std::shared_ptr<FrameArena> Create(std::size_t frameSize,
+      std::size_t slotCount, const Options& options);
+
+   // Shared mapping of a new scratch file in directory, preallocated to its
+   // full size. The file is deleted when the arena is destroyed (on POSIX
+   // systems, it is unlinked right away). Slots are page-aligned, which is
+   // also the alignment required for unbuffered (O_DIRECT) file I/O. Throws
+   // CMMError if the file cannot be created or mapped.
+   static std::shared_ptr<FrameArena> CreateFileBacked(
+      const std::string& directory, std::size_t frameSize,
+      std::size_t slotCount);
+
+   ~FrameArena();
+
+   FrameArena(const FrameArena&) = delete;
+   FrameArena& operator=(const FrameArena&) = delete;
+
+   std::size_t GetSlotCount() const { return slotCount_; }
+   std::size_t GetMappedSize() const { return mappedSize_; }
+   unsigned char* GetSlot(std::size_t index) const
+   { return base_ + index * stride_; }
+
+   bool UsesHugePages() const { return hugePages_; }
+   bool IsNumaBound() const { return numaBound_; }
+   bool IsFileBacked() const { return fileBacked_; }
+
+private:
+   FrameArena() = default;
+
+   unsigned char* base_ = nullptr;
+   std::size_t mappedSize_ = 0;
+   std::size_t stride_ = 0;
+   std::size_t slotCount_ = 0;
+   bool hugePages_ = false;
+   bool numaBound_ = false;
+   bool fileBacked_ = false;
+#ifdef _WIN32
+   void* fileHandle_ = nullptr; // Closing it deletes the file
+#endif
+};
+
+// Page faults (minor plus major) incurred so far by the calling thread, or by
+// the process where per-thread counts are not available. Returns -1 if the
+// count cannot be obtained.
+std::int64_t GetPageFaultCount();
+
+} // namespace internal
+} // namespace mmcore
@@ -20,24 +20,39 @@
 
 #include <cmath>
 #include <cstring>
+#include <utility>
 
 namespace mmcore {
 namespace internal {
 
 FrameBuffer::FrameBuffer(std::size_t size) :
    size_(size),
-   pixels_(new unsigned char[size]())
+   ownedPixels_(new unsigned char[size]())
+{
+   pixels_ = ownedPixels_.get();
+}
+
+FrameBuffer::FrameBuffer(unsigned char* pixels, std::size_t size,
+      std::shared_ptr<const void> storage) :
+   size_(size),
+   pixels_(pixels),
+   storage_(std::move(storage))
 {
 }
 
 const unsigned char* FrameBuffer::GetPixels() const
 {
-   return pixels_.get();
+   return pixels_;
+}
+
+unsigned char* FrameBuffer::GetPixelsRW()
+{
+   return pixels_;
 }
 
 void FrameBuffer::SetPixels(const void* pix)
 {
-   memcpy(pixels_.get(), pix, size_);
+   memcpy(pixels_, pix, size_);
 }
 
 void FrameBuffer::Resize(std::size_t size)
@@ -45,16 +60,14 @@ void FrameBuffer::Resize(std::size_t size)
    if (size != size_)
    {
       // Deallocate before allocating, since these buffers can be large
-      pixels_.reset();
-      pixels_.reset(new unsigned char[size]());
+      pixels_ = nullptr;
+      ownedPixels_.reset();
+      storage_.reset();
+      ownedPixels_.reset(new unsigned char[size]());
+      pixels_ = ownedPixels_.get();
       size_ = size;
    }
 }
 
-void FrameBuffer::SetSerializedMetadata(std::string_view serialized)
-{
-   serializedMetadata_.assign(serialized);
-}
-
 } // namespace internal
 } // namespace mmcore
@@ -18,38 +18,81 @@
 
 #pragma once
 
+#include "ImageTagBlock.h"
+
+#include <atomic>
 #include <cstddef>
 #include <memory>
-#include <string>
-#include <string_view>
+#include <utility>
 
 namespace mmcore {
 namespace internal {
 
-class FrameBuffer
+// Always owned by a shared_ptr, so that leased frames can outlive the
+// circular buffer that produced them.
+class FrameBuffer : public std::enable_shared_from_this<FrameBuffer>
 {
    std::size_t size_ = 0;
-   std::unique_ptr<unsigned char[]> pixels_;
-   std::string serializedMetadata_;
+   unsigned char* pixels_ = nullptr;
+   std::unique_ptr<unsigned char[]> ownedPixels_;
+   std::shared_ptr<const void> storage_; // Keeps external pixels alive
+   ImageTagBlock metadata_;
+   std::atomic<bool> discarded_{false}; // Read by lock-free peeks
+   std::atomic<unsigned> leaseCount_{0};
 
 public:
    FrameBuffer() = default;
    FrameBuffer(std::size_t size);
+   // Use size bytes at pixels, which must remain valid for as long as
+   // storage is alive.
+   FrameBuffer(unsigned char* pixels, std::size_t size,
+      std::shared_ptr<const void> storage);
 
-   FrameBuffer(FrameBuffer&&) = default;
-   FrameBuffer& operator=(FrameBuffer&&) = default;
    FrameBuffer(const FrameBuffer&) = delete;
    FrameBuffer& operator=(const FrameBuffer&) = delete;
 
    void SetPixels(const void* pixArray);
    const unsigned char* GetPixels() const;
+   unsigned char* GetPixelsRW();
 
    void Resize(std::size_t size);
+   std::size_t GetSize() const { return size_; }
+
+   void SetMetadata(const ImageTagBlock& metadata) { metadata_ = metadata; }
+   const ImageTagBlock& GetMetadata() const { return metadata_; }
+
+   // Set on a slot whose writer gave up after it could no longer be
+   // withdrawn from the buffer; such frames are skipped by readers.
+   void SetDiscarded(bool discarded) { discarded_ = discarded; }
+   bool IsDiscarded() const { return discarded_; }
+
+   // A leased frame must not be written to or resized. Only FrameLease
+   // modifies the count. The circular buffer relies on the sequential
+   // consistency of these operations (see CircularBuffer.cpp).
+   bool IsLeased() const { return leaseCount_.load() > 0; }
+
+private:
+   friend class FrameLease;
+   void AddLease() { leaseCount_.fetch_add(1); }
+   void ReleaseLease() { leaseCount_.fetch_sub(1); }
+};
+
+// Keeps a frame from being overwritten by the circular buffer, and keeps it
+// alive, for as long as the lease exists.
+class FrameLease
+{
+   std::shared_ptr<FrameBuffer> frame_;
+
+public:
+   explicit FrameLease(std::shared_ptr<FrameBuffer> frame) :
+      frame_(std::move(frame))
+   { frame_->AddLease(); }
+   ~FrameLease() { frame_->ReleaseLease(); }
+
+   FrameLease(const FrameLease&) = delete;
+   FrameLease& operator=(const FrameLease&) = delete;
 
-   void SetSerializedMetadata(std::string_view serialized);
-   const std::string& GetSerializedMetadata() const {
-      return serializedMetadata_;
-   }
+   FrameBuffer& Frame() const { return *frame_; }
 };
 
 } // namespace internal
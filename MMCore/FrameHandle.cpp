@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameHandle.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Reference-counted handle to an image in the circular buffer
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameHandle.h"
+
+#include "FrameBuffer.h"
+#include "ImageMetadata.h"
+
+#include <utility>
+
+FrameHandle::FrameHandle() = default;
+
+FrameHandle::FrameHandle(std::shared_ptr<mmcore::internal::FrameLease> lease) :
+   lease_(std::move(lease))
+{
+}
+
+/**
+ * Returns the pixels of the image, or null if the handle is empty.
+ */
+void* FrameHandle::getPixels() const
+{
+   if (!lease_)
+      return nullptr;
+   return lease_->Frame().GetPixelsRW();
+}
+
+/**
+ * Returns the size of the image in bytes, or 0 if the handle is empty.
+ */
+std::size_t FrameHandle::getSizeBytes() const
+{
+   if (!lease_)
+      return 0;
+   return lease_->Frame().GetSize();
+}
+
+/**
+ * Provides the metadata of the image. md is cleared if the handle is empty.
+ */
+void FrameHandle::getMetadata(Metadata& md) const
+{
+   if (!lease_)
+   {
+      md.Clear();
+      return;
+   }
+   lease_->Frame().GetMetadata().ToMetadata(md);
+}
+
+/**
+ * Releases this handle's share of the lease, leaving the handle empty.
+ */
+void FrameHandle::release()
+{
+   lease_.reset();
+}
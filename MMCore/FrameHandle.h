@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameHandle.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Reference-counted handle to an image in the circular buffer
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+class CMMCore;
+class Metadata;
+
+namespace mmcore {
+namespace internal {
+   class FrameLease;
+}
+}
+
+/**
+ * A shared lease on an image in the circular buffer.
+ *
+ * Unlike the pointers returned by popNextImage() and related functions, the
+ * pixels of an image referred to by a FrameHandle are never overwritten by
+ * subsequently inserted images: while any copy of the handle exists, the
+ * circular buffer writes new images into a different buffer instead. The
+ * pixels may therefore be read, or modified in place, without copying them
+ * first. The pixels also remain valid if the circular buffer is cleared,
+ * reinitialized, or resized.
+ *
+ * Copies of a handle share the same lease, which is released when the last
+ * copy is destroyed or release() is called on it. Each image that is still
+ * leased when the circular buffer reuses its slot costs one extra frame of
+ * memory, so handles should not be kept longer than needed.
+ *
+ * A default-constructed (or released) handle is empty: getPixels() returns
+ * null and getSizeBytes() returns 0.
+ */
+class FrameHandle
+{
+public:
+   FrameHandle();
+
+   bool isValid() const { return lease_ != nullptr; }
+   void* getPixels() const;
+   std::size_t getSizeBytes() const;
+   void getMetadata(Metadata& md) const;
+   void release();
+
+private:
+   friend class CMMCore;
+   explicit FrameHandle(std::shared_ptr<mmcore::internal::FrameLease> lease);
+
+   std::shared_ptr<mmcore::internal::FrameLease> lease_;
+};
@@ -0,0 +1,484 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameStreamWriter.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Writes circular buffer frames to a raw stack file
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "FrameStreamWriter.h"
+
+#include "CircularBuffer.h"
+#include "CoreUtils.h"
+#include "Error.h"
+#include "ErrorCodes.h"
+#include "FrameBuffer.h"
+#include "ImageMetadata.h"
+#include "MemoryCopy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mmcore {
+namespace internal {
+
+namespace {
+
+// Unbuffered I/O requires the buffer address, file offset and size to be
+// multiples of the sector size; 4 KiB covers the common sector sizes.
+constexpr std::size_t ioAlignment = 4096;
+
+// Frames taken from the circular buffer at a time
+constexpr std::size_t drainBatchSize = 64;
+
+constexpr std::chrono::milliseconds drainWaitTimeout(50);
+
+std::size_t RoundUp(std::size_t n, std::size_t multiple)
+{
+   return (n + multiple - 1) / multiple * multiple;
+}
+
+template <typename T>
+void AppendLE(std::string& buf, T value)
+{
+   for (std::size_t i = 0; i < sizeof(T); ++i)
+      buf.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+std::int64_t NowTicks()
+{
+   return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+} // namespace
+
+FrameStreamWriter::FrameStreamWriter(CircularBuffer& cbuf,
+   const std::string& path) :
+   FrameStreamWriter(cbuf, path, Options())
+{}
+
+FrameStreamWriter::FrameStreamWriter(CircularBuffer& cbuf,
+   const std::string& path, const Options& options) :
+   cbuf_(cbuf),
+   path_(path),
+   alignment_(ioAlignment),
+   chunkSize_(RoundUp(std::max<std::size_t>(options.chunkSize, 1),
+      ioAlignment)),
+   unbuffered_(options.unbuffered)
+{
+   const std::size_t chunkCount = std::max<std::size_t>(options.chunkCount, 2);
+   for (std::size_t i = 0; i < chunkCount; ++i)
+   {
+      const auto align = static_cast<std::align_val_t>(alignment_);
+      chunkStorage_.emplace_back(
+         static_cast<unsigned char*>(::operator new(chunkSize_, align)),
+         [align](unsigned char* p) { ::operator delete(p, align); });
+   }
+   chunks_.resize(chunkCount);
+   for (std::size_t i = 0; i < chunkCount; ++i)
+   {
+      chunks_[i].data = chunkStorage_[i].get();
+      freeChunks_.push_back(&chunks_[i]);
+   }
+
+   OpenFile();
+
+   const std::string indexPath = path_ + StreamIndexSuffix;
+   indexFile_.open(indexPath, std::ios_base::out | std::ios_base::binary |
+      std::ios_base::trunc);
+   std::string header(StreamIndexMagic, sizeof(StreamIndexMagic));
+   AppendLE(header, StreamIndexFormatVersion);
+   AppendLE(header, std::uint32_t(0));
+   if (!indexFile_.write(header.data(), header.size()))
+   {
+      CloseFile(0);
+      throw CMMError("Cannot create stream index file " +
+         ToQuotedString(indexPath), MMERR_FileOpenFailed);
+   }
+
+   ioThread_ = std::thread([this] { IoLoop(); });
+   drainThread_ = std::thread([this] { DrainLoop(); });
+}
+
+FrameStreamWriter::~FrameStreamWriter()
+{
+   try
+   {
+      Stop();
+   }
+   catch (const CMMError&)
+   {
+   }
+}
+
+void FrameStreamWriter::Stop()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopped_)
+         return;
+      stopRequested_ = true;
+   }
+   chunkAvailable_.notify_all();
+
+   drainThread_.join();
+   ioThread_.join();
+
+   CloseFile(bytesWritten_.load());
+   indexFile_.close();
+
+   std::string error;
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+      if (failed_)
+         error = error_;
+   }
+   if (!error.empty())
+      throw CMMError("Streaming to " + ToQuotedString(path_) + " failed: " +
+         error);
+}
+
+bool FrameStreamWriter::IsActive() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return !stopped_ && !failed_;
+}
+
+bool FrameStreamWriter::IsStopped() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return stopped_;
+}
+
+double FrameStreamWriter::GetThroughputMBps() const
+{
+   const std::int64_t first = firstFrameTicks_.load();
+   if (first == 0)
+      return 0.0;
+   std::int64_t last = stopTicks_.load();
+   if (last == 0)
+      last = NowTicks();
+   const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::duration(last - first)).count();
+   if (seconds <= 0.0)
+      return 0.0;
+   return static_cast<double>(bytesWritten_.load()) /
+      (1024.0 * 1024.0) / seconds;
+}
+
+void FrameStreamWriter::OpenFile()
+{
+   const std::string failure = "Cannot create stream file " +
+      ToQuotedString(path_);
+#ifdef _WIN32
+   const DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+   HANDLE file = INVALID_HANDLE_VALUE;
+   if (unbuffered_)
+      file = CreateFileA(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+         nullptr, CREATE_ALWAYS, flags | FILE_FLAG_NO_BUFFERING, nullptr);
+   if (file == INVALID_HANDLE_VALUE)
+   {
+      unbuffered_ = false;
+      file = CreateFileA(path_.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+         nullptr, CREATE_ALWAYS, flags, nullptr);
+   }
+   if (file == INVALID_HANDLE_VALUE)
+      throw CMMError(failure, MMERR_FileOpenFailed);
+   fileHandle_ = file;
+#else
+   const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+   if (unbuffered_)
+   {
+      fd_ = open(path_.c_str(), flags | O_DIRECT, 0666);
+      // Some file systems (e.g. tmpfs) do not support O_DIRECT
+      if (fd_ < 0)
+         unbuffered_ = false;
+   }
+#endif
+   if (fd_ < 0)
+      fd_ = open(path_.c_str(), flags, 0666);
+   if (fd_ < 0)
+      throw CMMError(failure + ": " + std::strerror(errno),
+         MMERR_FileOpenFailed);
+#if !defined(O_DIRECT) && defined(F_NOCACHE) // macOS
+   if (unbuffered_ && fcntl(fd_, F_NOCACHE, 1) == -1)
+      unbuffered_ = false;
+#elif !defined(O_DIRECT)
+   unbuffered_ = false;
+#endif
+#endif
+}
+
+void FrameStreamWriter::CloseFile(std::uint64_t finalSize)
+{
+   // Unbuffered writes of the last chunk are padded; remove the padding.
+   std::string error;
+#ifdef _WIN32
+   if (!fileHandle_)
+      return;
+   FILE_END_OF_FILE_INFO info;
+   info.EndOfFile.QuadPart = static_cast<LONGLONG>(finalSize);
+   if (!SetFileInformationByHandle(fileHandle_, FileEndOfFileInfo, &info,
+         sizeof(info)))
+      error = "cannot set the size of the stream file";
+   CloseHandle(fileHandle_);
+   fileHandle_ = nullptr;
+#else
+   if (fd_ < 0)
+      return;
+   if (ftruncate(fd_, static_cast<off_t>(finalSize)) != 0)
+      error = std::string("cannot set the size of the stream file: ") +
+         std::strerror(errno);
+   close(fd_);
+   fd_ = -1;
+#endif
+   if (!error.empty())
+      Fail(error);
+}
+
+bool FrameStreamWriter::WriteToFile(const unsigned char* data,
+   std::size_t size, std::string& error)
+{
+   while (size > 0)
+   {
+#ifdef _WIN32
+      DWORD written = 0;
+      if (!WriteFile(fileHandle_, data, static_cast<DWORD>(size), &written,
+            nullptr))
+      {
+         error = "write failed (error " + std::to_string(GetLastError()) +
+            ")";
+         return false;
+      }
+#else
+      const ssize_t written = write(fd_, data, size);
+      if (written < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         error = std::string("write failed: ") + std::strerror(errno);
+         return false;
+      }
+#endif
+      if (written == 0)
+      {
+         error = "write failed (disk full?)";
+         return false;
+      }
+      data += written;
+      size -= static_cast<std::size_t>(written);
+   }
+   return true;
+}
+
+void FrameStreamWriter::DrainLoop()
+{
+   std::vector<std::shared_ptr<FrameLease>> leases;
+   for (;;)
+   {
+      bool stopping;
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         if (failed_)
+            break;
+         stopping = stopRequested_;
+      }
+
+      leases.clear();
+      cbuf_.LeaseNextImageBuffers(drainBatchSize, leases);
+      if (leases.empty())
+      {
+         // Once asked to stop, finish when the buffer is empty
+         if (stopping)
+            break;
+         cbuf_.WaitForImage(drainWaitTimeout);
+         continue;
+      }
+
+      if (firstFrameTicks_.load(std::memory_order_relaxed) == 0)
+         firstFrameTicks_ = NowTicks();
+
+      bool ok = true;
+      for (const auto& lease : leases)
+      {
+         const FrameBuffer& frame = lease->Frame();
+         Metadata md;
+         frame.GetMetadata().ToMetadata(md);
+         ok = AppendFrame(frame.GetPixels(), frame.GetSize(), md.Serialize());
+         if (!ok)
+            break;
+      }
+      if (!ok)
+         break;
+   }
+
+   if (current_ && current_->used > 0)
+      QueueChunk(current_);
+   current_ = nullptr;
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      drainDone_ = true;
+   }
+   chunkQueued_.notify_one();
+}
+
+bool FrameStreamWriter::AppendFrame(const unsigned char* pixels,
+   std::size_t size, const std::string& metadata)
+{
+   if (!current_ && !(current_ = TakeFreeChunk()))
+      return false;
+
+   std::size_t remaining = size;
+   for (;;)
+   {
+      const std::size_t n = std::min(remaining, chunkSize_ - current_->used);
+      CopyFrameMemory(current_->data + current_->used, pixels, n, size);
+      current_->used += n;
+      pixels += n;
+      remaining -= n;
+
+      if (remaining == 0)
+      {
+         // The record goes with the chunk that completes the frame, so that
+         // it is written only after all of the frame's pixels.
+         std::string& index = current_->index;
+         AppendLE(index, streamOffset_);
+         AppendLE(index, static_cast<std::uint64_t>(size));
+         AppendLE(index, static_cast<std::uint32_t>(metadata.size()));
+         index += metadata;
+         ++current_->framesCompleted;
+      }
+
+      if (current_->used == chunkSize_)
+      {
+         QueueChunk(current_);
+         current_ = nullptr;
+      }
+      if (remaining == 0)
+         break;
+      if (!(current_ = TakeFreeChunk()))
+         return false;
+   }
+   streamOffset_ += size;
+   return true;
+}
+
+FrameStreamWriter::Chunk* FrameStreamWriter::TakeFreeChunk()
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   chunkAvailable_.wait(lock,
+      [this] { return !freeChunks_.empty() || failed_; });
+   if (failed_)
+      return nullptr;
+   Chunk* chunk = freeChunks_.back();
+   freeChunks_.pop_back();
+   return chunk;
+}
+
+void FrameStreamWriter::QueueChunk(Chunk* chunk)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fullChunks_.push_back(chunk);
+   }
+   chunkQueued_.notify_one();
+}
+
+void FrameStreamWriter::IoLoop()
+{
+   for (;;)
+   {
+      Chunk* chunk;
+      bool failed;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         chunkQueued_.wait(lock,
+            [this] { return !fullChunks_.empty() || drainDone_; });
+         if (fullChunks_.empty())
+            break;
+         chunk = fullChunks_.front();
+         fullChunks_.pop_front();
+         failed = failed_;
+      }
+
+      if (!failed)
+      {
+         // Only the last chunk can be partially filled
+         std::size_t writeSize = chunk->used;
+         if (unbuffered_)
+         {
+            writeSize = RoundUp(chunk->used, alignment_);
+            std::memset(chunk->data + chunk->used, 0,
+               writeSize - chunk->used);
+         }
+         std::string error;
+         if (!WriteToFile(chunk->data, writeSize, error))
+         {
+            Fail(error);
+         }
+         else if (!indexFile_.write(chunk->index.data(),
+               static_cast<std::streamsize>(chunk->index.size())))
+         {
+            Fail("cannot write index file");
+         }
+         else
+         {
+            bytesWritten_ += chunk->used;
+            framesWritten_ += chunk->framesCompleted;
+         }
+      }
+
+      chunk->used = 0;
+      chunk->framesCompleted = 0;
+      chunk->index.clear();
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         freeChunks_.push_back(chunk);
+      }
+      chunkAvailable_.notify_one();
+   }
+
+   if (!indexFile_.flush())
+      Fail("cannot write index file");
+   stopTicks_ = NowTicks();
+}
+
+void FrameStreamWriter::Fail(const std::string& error)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (failed_)
+         return;
+      failed_ = true;
+      error_ = error;
+   }
+   chunkAvailable_.notify_all();
+   chunkQueued_.notify_all();
+}
+
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FrameStreamWriter.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Writes circular buffer frames to a raw stack file
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mmcore {
+namespace internal {
+
+class CircularBuffer;
+
+// Stream file layout
+//
+// The stack file holds the pixels of each frame, in order, with no header or
+// padding, so that it can be opened as a raw image sequence.
+//
+// The index file (stack file name + StreamIndexSuffix) describes the frames.
+// All integers are little-endian.
+//
+// Header (16 bytes):
+//     char[8] magic "MMSTKIDX"
+//     u32 format version (StreamIndexFormatVersion)
+//     u32 reserved (0)
+//
+// One record per frame:
+//     u64 offset of the frame in the stack file
+//     u64 frame size in bytes
+//     u32 metadata length, followed by the metadata (Metadata::Serialize())
+//
+// The metadata includes the frame's width, height and pixel type.
+
+const char StreamIndexMagic[8] = {'M', 'M', 'S', 'T', 'K', 'I', 'D', 'X'};
+const std::uint32_t StreamIndexFormatVersion = 1;
+const char* const StreamIndexSuffix = ".idx";
+
+/**
+ * Drains a circular buffer into a stack file on dedicated threads
+ *
+ * A drain thread removes frames from the circular buffer as they arrive
+ * (it is then the buffer's only consumer) and copies them into large
+ * aligned chunks; an I/O thread writes the filled chunks. Where supported,
+ * the file is written unbuffered (O_DIRECT, F_NOCACHE or
+ * FILE_FLAG_NO_BUFFERING), so that the stream does not evict everything else
+ * from the OS page cache.
+ */
+class FrameStreamWriter
+{
+public:
+   struct Options {
+      std::size_t chunkSize = 16 * 1024 * 1024; // Rounded up to alignment
+      std::size_t chunkCount = 4; // Chunks being filled or written
+      bool unbuffered = true;
+   };
+
+   // Opens the files and starts the threads. Throws CMMError if the files
+   // cannot be created.
+   FrameStreamWriter(CircularBuffer& cbuf, const std::string& path,
+      const Options& options);
+   FrameStreamWriter(CircularBuffer& cbuf, const std::string& path);
+
+   // Calls Stop(), ignoring errors
+   ~FrameStreamWriter();
+
+   FrameStreamWriter(const FrameStreamWriter&) = delete;
+   FrameStreamWriter& operator=(const FrameStreamWriter&) = delete;
+
+   // Writes the frames remaining in the circular buffer, then closes the
+   // files. Throws CMMError if writing failed at any point (the files then
+   // contain the frames written up to the failure).
+   void Stop();
+
+   const std::string& GetPath() const { return path_; }
+
+   // False after Stop() or a write error
+   bool IsActive() const;
+   // True once Stop() has been called; until then, the threads may still be
+   // accessing the circular buffer
+   bool IsStopped() const;
+
+   bool IsUnbuffered() const { return unbuffered_; }
+
+   // Frames (and bytes) whose pixels have been written to the file
+   std::uint64_t GetFramesWritten() const
+   { return framesWritten_.load(std::memory_order_relaxed); }
+   std::uint64_t GetBytesWritten() const
+   { return bytesWritten_.load(std::memory_order_relaxed); }
+
+   // Average rate at which frames have been written since the first one
+   // arrived, in MB/s (up to the last write, once the stream has stopped)
+   double GetThroughputMBps() const;
+
+private:
+   struct Chunk {
+      unsigned char* data = nullptr;
+      std::size_t used = 0;
+      std::uint64_t framesCompleted = 0; // Frames that end in this chunk
+      std::string index; // Index records of those frames
+   };
+
+   void OpenFile();
+   void CloseFile(std::uint64_t finalSize);
+   bool WriteToFile(const unsigned char* data, std::size_t size,
+      std::string& error);
+
+   void DrainLoop();
+   void IoLoop();
+   bool AppendFrame(const unsigned char* pixels, std::size_t size,
+      const std::string& metadata);
+   Chunk* TakeFreeChunk();
+   void QueueChunk(Chunk* chunk);
+   void Fail(const std::string& error);
+
+   CircularBuffer& cbuf_;
+   const std::string path_;
+   const std::size_t alignment_;
+   const std::size_t chunkSize_;
+   bool unbuffered_;
+
+#ifdef _WIN32
+   void* fileHandle_ = nullptr;
+#else
+   int fd_ = -1;
+#endif
+   std::ofstream indexFile_;
+
+   std::vector<std::shared_ptr<unsigned char>> chunkStorage_;
+   std::vector<Chunk> chunks_;
+
+   // Guards the chunk queues and the flags below
+   mutable std::mutex mutex_;
+   std::condition_variable chunkAvailable_; // Signals freeChunks_
+   std::condition_variable chunkQueued_; // Signals fullChunks_ and drainDone_
+   std::vector<Chunk*> freeChunks_;
+   std::deque<Chunk*> fullChunks_;
+   bool stopRequested_ = false;
+   bool drainDone_ = false;
+   bool failed_ = false;
+   std::string error_;
+
+   // Drain thread only
+   Chunk* current_ = nullptr;
+   std::uint64_t streamOffset_ = 0;
+
+   std::atomic<std::uint64_t> framesWritten_{0};
+   std::atomic<std::uint64_t> bytesWritten_{0};
+   // steady_clock ticks when the first frame was taken from the buffer and
+   // when the last write completed; 0 if not yet
+   std::atomic<std::int64_t> firstFrameTicks_{0};
+   std::atomic<std::int64_t> stopTicks_{0};
+
+   std::thread drainThread_;
+   std::thread ioThread_;
+   bool stopped_ = false;
+};
+
+} // namespace internal
+} // namespace mmcore
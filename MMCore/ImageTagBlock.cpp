@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageTagBlock.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compact per-frame image metadata storage
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ImageTagBlock.h"
+
+#include "ImageMetadata.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace mmcore {
+namespace internal {
+
+namespace {
+
+struct TagKeyRegistry {
+   std::mutex mutex;
+   std::deque<std::string> names; // Never shrinks; elements never move
+   std::unordered_map<std::string_view, std::uint32_t> ids; // Views of names
+};
+
+TagKeyRegistry& GetTagKeyRegistry()
+{
+   static TagKeyRegistry registry;
+   return registry;
+}
+
+} // anonymous namespace
+
+TagKey TagKey::Intern(std::string_view name)
+{
+   TagKeyRegistry& registry = GetTagKeyRegistry();
+   std::lock_guard<std::mutex> lock(registry.mutex);
+   auto it = registry.ids.find(name);
+   if (it != registry.ids.end())
+      return TagKey(it->second);
+   const auto id = static_cast<std::uint32_t>(registry.names.size());
+   registry.names.emplace_back(name);
+   registry.ids.emplace(registry.names.back(), id);
+   return TagKey(id);
+}
+
+const std::string& TagKey::Name() const
+{
+   TagKeyRegistry& registry = GetTagKeyRegistry();
+   std::lock_guard<std::mutex> lock(registry.mutex);
+   return registry.names[id_];
+}
+
+std::string FormatLocalTime(std::int64_t usSinceEpoch)
+{
+   auto secs = usSinceEpoch / 1000000;
+   auto frac = static_cast<int>(usSinceEpoch % 1000000);
+   if (frac < 0)
+   {
+      --secs;
+      frac += 1000000;
+   }
+
+   // As of C++14/17, it is simpler (and probably faster) to use C functions for
+   // date-time formatting
+
+   std::time_t t(secs); // time_t is seconds on platforms we support
+   std::tm *ptm;
+#ifdef _WIN32 // Windows localtime() is documented thread-safe
+   ptm = std::localtime(&t);
+#else // POSIX has localtime_r()
+   std::tm tmstruct;
+   ptm = localtime_r(&t, &tmstruct);
+#endif
+
+   // Format as "yyyy-mm-dd hh:mm:ss.uuuuuu" (26 chars)
+   const char *timeFmt = "%Y-%m-%d %H:%M:%S";
+   char buf[32];
+   std::size_t len = std::strftime(buf, sizeof(buf), timeFmt, ptm);
+   std::snprintf(buf + len, sizeof(buf) - len, ".%06d", frac);
+   return buf;
+}
+
+void ImageTagBlock::AppendHeader(TagKey key, ValueType type)
+{
+   const std::uint32_t id = key.Id();
+   AppendBytes(&id, sizeof(id));
+   records_.push_back(static_cast<unsigned char>(type));
+}
+
+void ImageTagBlock::AppendBytes(const void* bytes, std::size_t size)
+{
+   const auto* p = static_cast<const unsigned char*>(bytes);
+   records_.insert(records_.end(), p, p + size);
+}
+
+void ImageTagBlock::AddTag(TagKey key, std::int64_t value)
+{
+   AppendHeader(key, ValueType::Int64);
+   AppendBytes(&value, sizeof(value));
+}
+
+void ImageTagBlock::AddTag(TagKey key, double value)
+{
+   AppendHeader(key, ValueType::Double);
+   AppendBytes(&value, sizeof(value));
+}
+
+void ImageTagBlock::AddTag(TagKey key, std::string_view value)
+{
+   AppendHeader(key, ValueType::String);
+   const auto size = static_cast<std::uint32_t>(value.size());
+   AppendBytes(&size, sizeof(size));
+   AppendBytes(value.data(), value.size());
+}
+
+void ImageTagBlock::AddTimestampTag(TagKey key, std::int64_t usSinceEpoch)
+{
+   AppendHeader(key, ValueType::Timestamp);
+   AppendBytes(&usSinceEpoch, sizeof(usSinceEpoch));
+}
+
+void ImageTagBlock::ToMetadata(Metadata& md) const
+{
+   // View() is backed by a std::string, so is null-terminated
+   md.Restore(deviceTags_.View().data());
+
+   const unsigned char* p = records_.data();
+   const unsigned char* const end = p + records_.size();
+   while (p < end)
+   {
+      std::uint32_t id;
+      std::memcpy(&id, p, sizeof(id));
+      p += sizeof(id);
+      const auto type = static_cast<ValueType>(*p++);
+
+      std::string value;
+      switch (type)
+      {
+         case ValueType::Int64:
+         {
+            std::int64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            value = std::to_string(v);
+            break;
+         }
+         case ValueType::Double:
+         {
+            double v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            // Same as the default formatting of std::ostream
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%g", v);
+            value = buf;
+            break;
+         }
+         case ValueType::String:
+         {
+            std::uint32_t size;
+            std::memcpy(&size, p, sizeof(size));
+            p += sizeof(size);
+            value.assign(reinterpret_cast<const char*>(p), size);
+            p += size;
+            break;
+         }
+         case ValueType::Timestamp:
+         {
+            std::int64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            p += sizeof(v);
+            value = FormatLocalTime(v);
+            break;
+         }
+      }
+      assert(p <= end);
+
+      MetadataSingleTag tag(TagKey(id).Name().c_str(), "_", true);
+      tag.SetValue(value.c_str());
+      md.SetTag(tag);
+   }
+}
+
+} // namespace internal
+} // namespace mmcore
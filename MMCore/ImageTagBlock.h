@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageTagBlock.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Compact per-frame image metadata storage
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "SerializedMetadata.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Metadata;
+
+namespace mmcore {
+namespace internal {
+
+// An interned metadata tag key. Interning takes a global lock, so hot paths
+// should intern their keys once (for example, into function-local statics).
+class TagKey {
+public:
+   static TagKey Intern(std::string_view name);
+
+   // The returned reference remains valid for the lifetime of the program.
+   const std::string& Name() const;
+
+   std::uint32_t Id() const { return id_; }
+
+private:
+   friend class ImageTagBlock;
+   explicit TagKey(std::uint32_t id) : id_(id) {}
+   std::uint32_t id_;
+};
+
+// Format microseconds since the Unix epoch as local time
+// "yyyy-mm-dd hh:mm:ss.uuuuuu".
+std::string FormatLocalTime(std::int64_t usSinceEpoch);
+
+// Image metadata as stored with each frame in the circular buffer.
+//
+// Tags supplied by the camera (and the Core's camera label tag, which must
+// be ordered among them) are kept in their wire-serialized form, which is
+// how they cross the device interface; parsing them would cost as much as
+// the Metadata::Restore() this class exists to defer. Tags added by the
+// Core are appended as binary records: an interned key, a type byte, and
+// an int64, double, timestamp (int64 microseconds since the epoch), or
+// length-prefixed string value.
+//
+// Nothing is converted to text or to a Metadata object until ToMetadata()
+// is called by the public retrieval API. Core tags take precedence over
+// camera tags with the same key, as in the text format ("last wins").
+//
+// Clear() and copy assignment reuse existing capacity, so that a block that
+// is rebuilt and copied into the same frame buffers does not allocate in
+// steady state.
+class ImageTagBlock {
+public:
+   void Clear() {
+      deviceTags_.Clear();
+      records_.clear();
+   }
+
+   SerializedMetadata& DeviceTags() { return deviceTags_; }
+   const SerializedMetadata& DeviceTags() const { return deviceTags_; }
+
+   void AddTag(TagKey key, std::int64_t value);
+   void AddTag(TagKey key, double value);
+   void AddTag(TagKey key, std::string_view value);
+   void AddTimestampTag(TagKey key, std::int64_t usSinceEpoch);
+
+   void ToMetadata(Metadata& md) const;
+
+private:
+   enum class ValueType : std::uint8_t {
+      Int64,
+      Double,
+      String,
+      Timestamp,
+   };
+
+   void AppendHeader(TagKey key, ValueType type);
+   void AppendBytes(const void* bytes, std::size_t size);
+
+   SerializedMetadata deviceTags_;
+   std::vector<unsigned char> records_;
+};
+
+} // namespace internal
+} // namespace mmcore
@@ -2,7 +2,11 @@
 
 #include "CoreUtils.h"
 #include "Error.h"
+#include "Logging/BinaryLogFormat.h"
+#include "Logging/FileRotation.h"
 
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <mutex>
 #include <utility>
@@ -40,6 +44,7 @@ LogManager::LogManager() :
    usingStdErr_(false),
    primaryMaxFileSize_(0),
    primaryMaxBackupFiles_(0),
+   primaryBinary_(false),
    nextSecondaryHandle_(0)
 {}
 
@@ -104,8 +109,7 @@ LogManager::SetPrimaryLogFilename(const std::string& filename, bool truncate)
    std::shared_ptr<logging::LogSink> newSink;
    try
    {
-      newSink = std::make_shared<logging::FileLogSink>(primaryFilename_,
-            !truncate, primaryMaxFileSize_, primaryMaxBackupFiles_);
+      newSink = MakePrimaryFileSink(!truncate);
    }
    catch (const logging::CannotOpenFileException&)
    {
@@ -182,8 +186,7 @@ LogManager::SetPrimaryLogRotation(std::size_t maxFileSize, int maxBackupFiles)
    std::shared_ptr<logging::LogSink> newSink;
    try
    {
-      newSink = std::make_shared<logging::FileLogSink>(primaryFilename_,
-            true, primaryMaxFileSize_, primaryMaxBackupFiles_);
+      newSink = MakePrimaryFileSink(true);
    }
    catch (const logging::CannotOpenFileException&)
    {
@@ -206,6 +209,58 @@ LogManager::SetPrimaryLogRotation(std::size_t maxFileSize, int maxBackupFiles)
 }
 
 
+void
+LogManager::SetPrimaryLogBinary(bool flag)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+
+   if (flag == primaryBinary_)
+      return;
+
+   primaryBinary_ = flag;
+
+   if (!primaryFileSink_)
+      return;
+
+   // The two formats cannot share a file, so close the current file (after
+   // draining the queue) and let MakePrimaryFileSink() move it aside. Unlike
+   // switching files, this is not atomic: entries logged by other threads
+   // while the file is closed are not written.
+   LOG_INFO(internalLogger_) << "Switching primary log file to " <<
+      (flag ? "binary" : "text") << " format";
+   loggingCore_->RemoveSink(primaryFileSink_, PrimarySinkMode);
+   primaryFileSink_.reset();
+
+   std::shared_ptr<logging::LogSink> newSink;
+   try
+   {
+      newSink = MakePrimaryFileSink(true);
+   }
+   catch (const logging::CannotOpenFileException&)
+   {
+      LOG_ERROR(internalLogger_) << "Failed to reopen file " <<
+         primaryFilename_ << " while switching log format";
+      std::string filename = primaryFilename_;
+      primaryFilename_.clear();
+      throw CMMError("Cannot open file " + ToQuotedString(filename));
+   }
+
+   newSink->SetFilter(std::make_shared<logging::LevelFilter>(primaryLogLevel_));
+   loggingCore_->AddSink(newSink, PrimarySinkMode);
+   primaryFileSink_ = newSink;
+   LOG_INFO(internalLogger_) << "Switched primary log file to " <<
+      (flag ? "binary" : "text") << " format";
+}
+
+
+bool
+LogManager::IsPrimaryLogBinary() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return primaryBinary_;
+}
+
+
 void
 LogManager::SetLogLevels(LogLevel level, bool setPrimary, bool setStderr)
 {
@@ -345,5 +400,39 @@ LogManager::NewLogger(const std::string& label)
    return loggingCore_->NewLogger(label);
 }
 
+
+std::shared_ptr<logging::LogSink>
+LogManager::MakePrimaryFileSink(bool append)
+{
+   if (append)
+   {
+      // Do not append entries in one format to a file in the other; move the
+      // existing file aside as if it had been rotated.
+      std::ifstream existing(primaryFilename_,
+            std::ios_base::binary | std::ios_base::ate);
+      if (existing && existing.tellg() > 0)
+      {
+         existing.close();
+         if (logging::IsBinaryLogFile(primaryFilename_) != primaryBinary_)
+         {
+            std::string movedName =
+               logging::MakeRotatedFilename(primaryFilename_);
+            if (std::rename(primaryFilename_.c_str(), movedName.c_str()) != 0)
+               throw logging::CannotOpenFileException();
+            logging::DeleteExcessRotatedFiles(primaryFilename_,
+                  primaryMaxBackupFiles_);
+         }
+      }
+   }
+
+   if (primaryBinary_)
+   {
+      return std::make_shared<logging::BinaryFileLogSink>(primaryFilename_,
+            append, primaryMaxFileSize_, primaryMaxBackupFiles_);
+   }
+   return std::make_shared<logging::FileLogSink>(primaryFilename_,
+         append, primaryMaxFileSize_, primaryMaxBackupFiles_);
+}
+
 } // namespace internal
 } // namespace mmcore
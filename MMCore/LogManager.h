@@ -33,6 +33,7 @@ private:
    std::shared_ptr<logging::LogSink> primaryFileSink_;
    std::size_t primaryMaxFileSize_;
    int primaryMaxBackupFiles_;
+   bool primaryBinary_;
 
    LogFileHandle nextSecondaryHandle_;
    struct LogFileInfo
@@ -65,6 +66,11 @@ public:
 
    void SetPrimaryLogRotation(std::size_t maxFileSize, int maxBackupFiles);
 
+   // Write the primary log file in the binary format (see
+   // Logging/BinaryLogFormat.h) instead of text
+   void SetPrimaryLogBinary(bool flag);
+   bool IsPrimaryLogBinary() const;
+
    void SetLogLevels(LogLevel level, bool setPrimary, bool setStderr);
    LogLevel GetPrimaryLogLevel() const;
    LogLevel GetStderrLogLevel() const;
@@ -77,6 +83,10 @@ public:
    // nice for log rotation, but we don't need it now.
 
    logging::Logger NewLogger(const std::string& label);
+
+private:
+   // Throws logging::CannotOpenFileException
+   std::shared_ptr<logging::LogSink> MakePrimaryFileSink(bool append);
 };
 
 } // namespace internal
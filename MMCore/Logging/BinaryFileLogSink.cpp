@@ -0,0 +1,236 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "BinaryFileLogSink.h"
+
+#include "BinaryLogFormat.h"
+#include "FileRotation.h"
+#include "GenericStreamSink.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+
+namespace {
+
+template <typename T>
+void AppendLE(std::string& buf, T value)
+{
+   typename std::make_unsigned<T>::type v =
+      static_cast<typename std::make_unsigned<T>::type>(value);
+   for (std::size_t i = 0; i < sizeof(T); ++i)
+      buf.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+// pthread_t is an integer on Linux but a pointer on macOS
+template <typename T>
+typename std::enable_if<std::is_pointer<T>::value, std::uint64_t>::type
+ThreadIdToInteger(T tid)
+{ return reinterpret_cast<std::uintptr_t>(tid); }
+
+template <typename T>
+typename std::enable_if<!std::is_pointer<T>::value, std::uint64_t>::type
+ThreadIdToInteger(T tid)
+{ return static_cast<std::uint64_t>(tid); }
+
+} // anonymous namespace
+
+
+BinaryFileLogSink::BinaryFileLogSink(const std::string& filename,
+      bool append, std::size_t maxFileSize, int maxBackupFiles) :
+   filename_(filename),
+   hadError_(false),
+   maxFileSize_(maxFileSize),
+   maxBackupFiles_(maxBackupFiles),
+   fileSize_(0)
+{
+   std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary;
+   mode |= (append ? std::ios_base::app : std::ios_base::trunc);
+
+   if (append)
+   {
+      std::ifstream existing(filename_, std::ios_base::binary |
+            std::ios_base::ate);
+      if (existing && existing.tellg() > 0)
+      {
+         if (!IsBinaryLogFile(filename_))
+            throw CannotOpenFileException();
+         fileSize_ = static_cast<std::size_t>(existing.tellg());
+      }
+   }
+
+   fileStream_.open(filename_.c_str(), mode);
+   if (!fileStream_)
+      throw CannotOpenFileException();
+
+   if (fileSize_ == 0)
+      WriteHeader();
+}
+
+
+void
+BinaryFileLogSink::Consume(const PacketArrayType& packets)
+{
+   buffer_.clear();
+
+   auto filter = GetFilter();
+   const Metadata* entryMetadata = nullptr;
+   for (auto it = packets.Begin(), end = packets.End(); it != end; ++it)
+   {
+      switch (it->GetPacketState())
+      {
+         case internal::PacketStateEntryFirstLine:
+            if (entryMetadata)
+               AppendEntryRecord(*entryMetadata);
+            entryMetadata = nullptr;
+            if (filter && !filter->Filter(it->GetMetadataConstRef()))
+               break;
+            entryMetadata = &it->GetMetadataConstRef();
+            entryText_ = it->GetText();
+            break;
+         case internal::PacketStateNewLine:
+            if (entryMetadata)
+            {
+               entryText_ += '\n';
+               entryText_ += it->GetText();
+            }
+            break;
+         case internal::PacketStateLineContinuation:
+            if (entryMetadata)
+               entryText_ += it->GetText();
+            break;
+      }
+   }
+   if (entryMetadata)
+      AppendEntryRecord(*entryMetadata);
+
+   if (buffer_.empty())
+      return;
+
+   fileStream_.clear();
+   fileStream_.write(buffer_.data(), buffer_.size());
+   fileStream_.flush();
+   if (fileStream_.fail())
+   {
+      fileStream_.clear();
+      if (!hadError_)
+      {
+         hadError_ = true;
+         std::cerr << "Logging: cannot write to file " << filename_ << '\n';
+      }
+   }
+   else
+   {
+      hadError_ = false;
+      fileSize_ += buffer_.size();
+   }
+
+   if (maxFileSize_ > 0 && fileSize_ > maxFileSize_)
+      RotateFile();
+}
+
+
+void
+BinaryFileLogSink::AppendEntryRecord(const Metadata& metadata)
+{
+   const char* label = metadata.GetLoggerData().GetComponentLabel();
+   auto found = loggerIds_.find(label);
+   std::uint32_t loggerId;
+   if (found != loggerIds_.end())
+   {
+      loggerId = found->second;
+   }
+   else
+   {
+      loggerId = static_cast<std::uint32_t>(loggerIds_.size());
+      loggerIds_.emplace(label, loggerId);
+
+      std::size_t length = std::strlen(label);
+      if (length > 0xffff)
+         length = 0xffff;
+      buffer_.push_back(static_cast<char>(BinaryLogRecordLogger));
+      AppendLE(buffer_, loggerId);
+      AppendLE(buffer_, static_cast<std::uint16_t>(length));
+      buffer_.append(label, length);
+   }
+
+   using namespace std::chrono;
+   const auto& stamp = metadata.GetStampData();
+   buffer_.push_back(static_cast<char>(BinaryLogRecordEntry));
+   AppendLE(buffer_, static_cast<std::int64_t>(duration_cast<microseconds>(
+               stamp.GetTimestamp().time_since_epoch()).count()));
+   AppendLE(buffer_, ThreadIdToInteger(stamp.GetThreadId()));
+   AppendLE(buffer_, loggerId);
+   AppendLE(buffer_,
+         static_cast<std::uint8_t>(metadata.GetEntryData().GetLevel()));
+   AppendLE(buffer_, static_cast<std::uint32_t>(entryText_.size()));
+   buffer_ += entryText_;
+}
+
+
+void
+BinaryFileLogSink::WriteHeader()
+{
+   std::string header(BinaryLogMagic, sizeof(BinaryLogMagic));
+   AppendLE(header, BinaryLogFormatVersion);
+   AppendLE(header, std::uint32_t(0));
+   fileStream_.write(header.data(), header.size());
+   fileStream_.flush();
+   fileSize_ = header.size();
+   loggerIds_.clear();
+}
+
+
+void
+BinaryFileLogSink::RotateFile()
+{
+   fileStream_.close();
+
+   std::string rotatedName = MakeRotatedFilename(filename_);
+   if (std::rename(filename_.c_str(), rotatedName.c_str()) != 0)
+   {
+      if (!hadError_)
+      {
+         hadError_ = true;
+         std::cerr << "Logging: cannot rotate file " << filename_ << '\n';
+      }
+      fileStream_.open(filename_.c_str(), std::ios_base::out |
+            std::ios_base::binary | std::ios_base::app);
+      return;
+   }
+
+   DeleteExcessRotatedFiles(filename_, maxBackupFiles_);
+
+   fileStream_.open(filename_.c_str(), std::ios_base::out |
+         std::ios_base::binary | std::ios_base::trunc);
+   if (fileStream_)
+   {
+      WriteHeader();
+      hadError_ = false;
+   }
+   else
+   {
+      std::cerr << "Logging: cannot reopen file " << filename_
+            << " after rotation\n";
+   }
+}
+
+
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,73 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "GenericSink.h"
+#include "Metadata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+
+
+/**
+ * Log sink writing the binary log format (see BinaryLogFormat.h)
+ *
+ * Entries are not formatted; each batch of entries is encoded into a buffer
+ * and written with a single call. Component labels are written once per file
+ * and referred to by id. Rotation works as for FileLogSink.
+ *
+ * In append mode, the file must be empty or already a binary log; otherwise
+ * CannotOpenFileException is thrown.
+ */
+class BinaryFileLogSink : public internal::GenericSink<Metadata>
+{
+   std::string filename_;
+   std::ofstream fileStream_;
+   bool hadError_;
+   std::size_t maxFileSize_;
+   int maxBackupFiles_;
+   std::size_t fileSize_;
+
+   // Interned component label pointers (see LoggerData) to ids written to the
+   // current file
+   std::map<const char*, std::uint32_t> loggerIds_;
+
+   std::string buffer_; // Reused for each batch
+   std::string entryText_;
+
+public:
+   BinaryFileLogSink(const BinaryFileLogSink&) = delete;
+   BinaryFileLogSink& operator=(const BinaryFileLogSink&) = delete;
+
+   BinaryFileLogSink(const std::string& filename, bool append = false,
+         std::size_t maxFileSize = 0, int maxBackupFiles = 0);
+
+   void Consume(const PacketArrayType& packets) override;
+
+private:
+   void AppendEntryRecord(const Metadata& metadata);
+   void WriteHeader();
+   void RotateFile();
+};
+
+
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,174 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "BinaryLogFormat.h"
+
+#include "Metadata.h"
+#include "MetadataFormatter.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+
+namespace {
+
+template <typename T>
+bool ReadLE(std::istream& stream, T& value)
+{
+   unsigned char bytes[sizeof(T)];
+   if (!stream.read(reinterpret_cast<char*>(bytes), sizeof(T)))
+      return false;
+   typename std::make_unsigned<T>::type v = 0;
+   for (std::size_t i = 0; i < sizeof(T); ++i)
+      v |= static_cast<decltype(v)>(bytes[i]) << (8 * i);
+   value = static_cast<T>(v);
+   return true;
+}
+
+bool ReadString(std::istream& stream, std::size_t length, std::string& s)
+{
+   s.resize(length);
+   return length == 0 || stream.read(&s[0], length);
+}
+
+} // anonymous namespace
+
+
+bool
+IsBinaryLogFile(const std::string& filename)
+{
+   std::ifstream file(filename, std::ios_base::binary);
+   if (!file)
+      return false;
+   BinaryLogReader reader(file);
+   return reader.ReadHeader();
+}
+
+
+BinaryLogReader::BinaryLogReader(std::istream& stream) :
+   stream_(stream),
+   truncated_(false)
+{}
+
+
+bool
+BinaryLogReader::ReadHeader()
+{
+   char magic[sizeof(BinaryLogMagic)];
+   std::uint32_t version, reserved;
+   if (!stream_.read(magic, sizeof(magic)) ||
+         std::memcmp(magic, BinaryLogMagic, sizeof(magic)) != 0)
+      return false;
+   if (!ReadLE(stream_, version) || !ReadLE(stream_, reserved))
+      return false;
+   return version == BinaryLogFormatVersion;
+}
+
+
+bool
+BinaryLogReader::ReadEntry(BinaryLogEntry& entry)
+{
+   for (;;)
+   {
+      std::uint8_t type;
+      if (!ReadLE(stream_, type))
+         return false; // Clean end of file
+
+      switch (type)
+      {
+         case BinaryLogRecordLogger:
+         {
+            std::uint32_t id;
+            std::uint16_t length;
+            std::string label;
+            if (!ReadLE(stream_, id) || !ReadLE(stream_, length) ||
+                  !ReadString(stream_, length, label))
+            {
+               truncated_ = true;
+               return false;
+            }
+            labels_[id] = label;
+            break;
+         }
+         case BinaryLogRecordEntry:
+         {
+            std::uint32_t loggerId, length;
+            std::uint8_t level;
+            if (!ReadLE(stream_, entry.timestampUs) ||
+                  !ReadLE(stream_, entry.threadId) ||
+                  !ReadLE(stream_, loggerId) ||
+                  !ReadLE(stream_, level) ||
+                  !ReadLE(stream_, length) ||
+                  !ReadString(stream_, length, entry.text))
+            {
+               truncated_ = true;
+               return false;
+            }
+            entry.level = static_cast<LogLevel>(level);
+            auto it = labels_.find(loggerId);
+            entry.label = (it != labels_.end()) ? it->second : "???";
+            return true;
+         }
+         default:
+            truncated_ = true;
+            return false;
+      }
+   }
+}
+
+
+BinaryLogDecodeResult
+DecodeBinaryLog(std::istream& in, std::ostream& out)
+{
+   BinaryLogReader reader(in);
+   if (!reader.ReadHeader())
+      return BinaryLogDecodeNotBinaryLog;
+
+   // Same layout as WritePacketsToStream(), which the text sinks use
+   internal::MetadataFormatter formatter;
+   BinaryLogEntry entry;
+   while (reader.ReadEntry(entry))
+   {
+      std::chrono::time_point<std::chrono::system_clock> timestamp(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+               std::chrono::microseconds(entry.timestampUs)));
+
+      std::size_t lineStart = 0;
+      for (bool firstLine = true; ; firstLine = false)
+      {
+         std::size_t lineEnd = entry.text.find('\n', lineStart);
+         if (firstLine)
+            formatter.FormatLinePrefix(out, timestamp, entry.threadId,
+                  entry.level, entry.label.c_str());
+         else
+            formatter.FormatContinuationPrefix(out);
+         out << ' ';
+         out.write(entry.text.data() + lineStart,
+               (lineEnd == std::string::npos ? entry.text.size() : lineEnd) -
+               lineStart);
+         out << '\n';
+         if (lineEnd == std::string::npos)
+            break;
+         lineStart = lineEnd + 1;
+      }
+   }
+   return reader.IsTruncated() ? BinaryLogDecodeTruncated : BinaryLogDecodeOK;
+}
+
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,114 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "../LogLevel.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+
+// Binary log file format
+//
+// A binary log holds the same entries as a text log, without formatting them.
+// The file starts with a header, followed by records. All integers are
+// little-endian.
+//
+// Header (16 bytes):
+//     char[8] magic "MMCORLOG"
+//     u32 format version (BinaryLogFormatVersion)
+//     u32 reserved (0)
+//
+// Logger record: binds a logger id to a component label, for the records that
+// follow (a later logger record may rebind the id):
+//     u8 BinaryLogRecordLogger
+//     u32 logger id
+//     u16 label length, followed by the label bytes
+//
+// Entry record:
+//     u8 BinaryLogRecordEntry
+//     i64 timestamp, microseconds since the Unix epoch (system clock)
+//     u64 thread id
+//     u32 logger id
+//     u8 log level (LogLevel)
+//     u32 text length, followed by the text bytes; lines are separated by
+//         '\n' (with no trailing newline)
+//
+// Use DecodeBinaryLog() (or the mmlogdecode tool) to render the text format.
+
+const char BinaryLogMagic[8] = {'M', 'M', 'C', 'O', 'R', 'L', 'O', 'G'};
+const std::uint32_t BinaryLogFormatVersion = 1;
+const std::size_t BinaryLogHeaderSize = 16;
+
+enum BinaryLogRecordType : unsigned char
+{
+   BinaryLogRecordLogger = 1,
+   BinaryLogRecordEntry = 2,
+};
+
+// Whether the file exists and starts with a binary log header
+bool IsBinaryLogFile(const std::string& filename);
+
+struct BinaryLogEntry
+{
+   std::int64_t timestampUs;
+   std::uint64_t threadId;
+   LogLevel level;
+   std::string label;
+   std::string text;
+};
+
+/**
+ * Reads the entries of a binary log in order
+ */
+class BinaryLogReader
+{
+   std::istream& stream_;
+   std::map<std::uint32_t, std::string> labels_;
+   bool truncated_;
+
+public:
+   explicit BinaryLogReader(std::istream& stream);
+
+   // Read and check the header; return false if not a binary log
+   bool ReadHeader();
+
+   // Read the next entry; return false at end of file or if the rest of the
+   // file cannot be read (see IsTruncated())
+   bool ReadEntry(BinaryLogEntry& entry);
+
+   // Whether the file ended inside a record or contained an unknown record.
+   // A log that was being written when the process died ends this way.
+   bool IsTruncated() const { return truncated_; }
+};
+
+enum BinaryLogDecodeResult
+{
+   BinaryLogDecodeOK,
+   BinaryLogDecodeNotBinaryLog,
+   BinaryLogDecodeTruncated,
+};
+
+// Write the entries of a binary log to out in the text log format
+BinaryLogDecodeResult DecodeBinaryLog(std::istream& in, std::ostream& out);
+
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,207 @@
+// COPYRIGHT:     University of California, San Francisco, 2014,
+//                All Rights reserved
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+namespace internal {
+
+
+/**
+ * Fixed-size buffer of log entry arguments, formatted later
+ *
+ * The logging thread copies each argument into the buffer in a compact tagged
+ * encoding (strings are copied, so the caller's storage need not outlive the
+ * call). The sink thread then writes the arguments, in order, to a
+ * std::ostream, producing the same text as streaming them into a LogStream.
+ *
+ * Supported argument types are strings (const char*, std::string), char, bool,
+ * arithmetic types and pointers. Appending fails, leaving the buffer in an
+ * unspecified state, if the arguments do not fit; the caller should then
+ * format the entry immediately.
+ */
+class DeferredArgs
+{
+public:
+   static const std::size_t Capacity = 224;
+
+private:
+   enum ArgType : unsigned char
+   {
+      ArgString,
+      ArgChar,
+      ArgBool,
+      ArgSigned,
+      ArgUnsigned,
+      ArgDouble,
+      ArgLongDouble,
+      ArgPointer,
+   };
+
+   std::uint16_t size_;
+   unsigned char buf_[Capacity];
+
+public:
+   DeferredArgs() : size_(0) {}
+
+   DeferredArgs(const DeferredArgs& other) : size_(other.size_)
+   { std::memcpy(buf_, other.buf_, size_); }
+
+   DeferredArgs& operator=(const DeferredArgs& other)
+   {
+      size_ = other.size_;
+      std::memcpy(buf_, other.buf_, size_);
+      return *this;
+   }
+
+   bool IsEmpty() const { return size_ == 0; }
+   void Clear() { size_ = 0; }
+
+   // Returns false if the arguments did not fit
+   template <typename... TArgs>
+   bool Append(const TArgs&... args)
+   { return (Add(args) && ...); }
+
+   // Write all arguments to the stream
+   void FormatTo(std::ostream& strm) const
+   {
+      const unsigned char* p = buf_;
+      const unsigned char* end = buf_ + size_;
+      while (p < end)
+      {
+         ArgType type = static_cast<ArgType>(*p++);
+         switch (type)
+         {
+            case ArgString:
+            {
+               std::uint16_t len;
+               std::memcpy(&len, p, sizeof(len));
+               p += sizeof(len);
+               strm.write(reinterpret_cast<const char*>(p), len);
+               p += len;
+               break;
+            }
+            case ArgChar:
+               strm << static_cast<char>(*p++);
+               break;
+            case ArgBool:
+               strm << (*p++ != 0);
+               break;
+            case ArgSigned:
+               strm << Read<long long>(p);
+               break;
+            case ArgUnsigned:
+               strm << Read<unsigned long long>(p);
+               break;
+            case ArgDouble:
+               strm << Read<double>(p);
+               break;
+            case ArgLongDouble:
+               strm << Read<long double>(p);
+               break;
+            case ArgPointer:
+               strm << Read<const void*>(p);
+               break;
+         }
+      }
+   }
+
+private:
+   bool Add(const char* s)
+   {
+      if (!s)
+         return Add(static_cast<const void*>(s));
+      return AddString(s, std::strlen(s));
+   }
+
+   bool Add(const std::string& s) { return AddString(s.data(), s.size()); }
+
+   bool Add(char c) { return AddByte(ArgChar, static_cast<unsigned char>(c)); }
+   bool Add(signed char c) { return Add(static_cast<char>(c)); }
+   bool Add(unsigned char c) { return Add(static_cast<char>(c)); }
+   bool Add(bool b) { return AddByte(ArgBool, b ? 1 : 0); }
+
+   template <typename T>
+   typename std::enable_if<std::is_integral<T>::value, bool>::type
+   Add(T value)
+   {
+      if (std::is_signed<T>::value)
+         return AddValue(ArgSigned, static_cast<long long>(value));
+      return AddValue(ArgUnsigned, static_cast<unsigned long long>(value));
+   }
+
+   bool Add(float value) { return AddValue(ArgDouble, static_cast<double>(value)); }
+   bool Add(double value) { return AddValue(ArgDouble, value); }
+   bool Add(long double value) { return AddValue(ArgLongDouble, value); }
+
+   bool Add(const void* ptr) { return AddValue(ArgPointer, ptr); }
+
+   bool AddString(const char* s, std::size_t len)
+   {
+      std::uint16_t len16 = static_cast<std::uint16_t>(len);
+      if (1 + sizeof(len16) + len > Capacity - size_)
+         return false;
+      buf_[size_++] = ArgString;
+      std::memcpy(buf_ + size_, &len16, sizeof(len16));
+      size_ += sizeof(len16);
+      std::memcpy(buf_ + size_, s, len);
+      size_ += static_cast<std::uint16_t>(len);
+      return true;
+   }
+
+   bool AddByte(ArgType type, unsigned char value)
+   {
+      if (2 > Capacity - size_)
+         return false;
+      buf_[size_++] = type;
+      buf_[size_++] = value;
+      return true;
+   }
+
+   template <typename T>
+   bool AddValue(ArgType type, T value)
+   {
+      if (1 + sizeof(T) > Capacity - size_)
+         return false;
+      buf_[size_++] = type;
+      std::memcpy(buf_ + size_, &value, sizeof(T));
+      size_ += sizeof(T);
+      return true;
+   }
+
+   template <typename T>
+   static T Read(const unsigned char*& p)
+   {
+      T value;
+      std::memcpy(&value, p, sizeof(T));
+      p += sizeof(T);
+      return value;
+   }
+};
+
+
+} // namespace internal
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
@@ -0,0 +1,229 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "DeferredArgs.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+namespace internal {
+
+
+/**
+ * A log entry as handed from a logging thread to the asynchronous backend
+ *
+ * The entry is kept unformatted: either the entry text, or the deferred
+ * arguments to be formatted by the backend. Text that does not fit in the
+ * argument buffer is moved to the heap.
+ */
+template <class TMetadata>
+class GenericEntryRecord
+{
+   // Records are reused without destroying the metadata
+   static_assert(std::is_trivially_destructible<TMetadata>::value,
+         "Log entry metadata must be trivially destructible");
+
+   std::uint64_t sequence_;
+   alignas(TMetadata) unsigned char metadata_[sizeof(TMetadata)];
+   DeferredArgs args_;
+   std::unique_ptr<std::string> longText_;
+
+public:
+   GenericEntryRecord() : sequence_(0) {}
+   GenericEntryRecord(const GenericEntryRecord&) = delete;
+   GenericEntryRecord& operator=(const GenericEntryRecord&) = delete;
+
+   void SetText(std::uint64_t sequence, const TMetadata& metadata,
+         const char* text)
+   {
+      SetMetadata(sequence, metadata);
+      args_.Clear();
+      if (!args_.Append(text))
+         longText_.reset(new std::string(text));
+   }
+
+   void SetArgs(std::uint64_t sequence, const TMetadata& metadata,
+         const DeferredArgs& args)
+   {
+      SetMetadata(sequence, metadata);
+      args_ = args;
+   }
+
+   // Release what was set; called by the consumer after use
+   void Reset() { longText_.reset(); }
+
+   std::uint64_t GetSequence() const { return sequence_; }
+   const TMetadata& GetMetadata() const
+   { return *std::launder(reinterpret_cast<const TMetadata*>(metadata_)); }
+
+   // Text too long for the argument buffer, or null
+   const std::string* GetLongText() const { return longText_.get(); }
+   const DeferredArgs& GetArgs() const { return args_; }
+
+private:
+   void SetMetadata(std::uint64_t sequence, const TMetadata& metadata)
+   {
+      sequence_ = sequence;
+      new (metadata_) TMetadata(metadata);
+   }
+};
+
+
+/**
+ * Single-producer, single-consumer queue of entry records
+ *
+ * Each logging thread owns one ring per logging core, so that sending an entry
+ * takes no lock and allocates no memory (except for overlong text). The
+ * records are preallocated and reused.
+ *
+ * When the consumer falls behind and the ring is full, records go to a
+ * mutex-protected overflow list instead, so that the producer never waits.
+ * The producer keeps using the overflow list until the consumer takes it. The
+ * consumer must order the two sources by sequence number.
+ */
+template <class TMetadata>
+class GenericEntryRing
+{
+public:
+   typedef GenericEntryRecord<TMetadata> RecordType;
+
+   static const std::size_t DefaultCapacity = 256;
+
+private:
+   std::vector<RecordType> records_;
+   const std::size_t mask_;
+
+   // Producer writes tail_, consumer writes head_; both increase monotonically
+   alignas(64) std::atomic<std::size_t> head_;
+   alignas(64) std::atomic<std::size_t> tail_;
+
+   alignas(64) std::atomic<bool> producerExited_;
+
+   std::atomic<bool> overflowing_; // Written with overflowMutex_ held
+   std::mutex overflowMutex_;
+   std::vector< std::unique_ptr<RecordType> > overflow_;
+
+public:
+   // capacity must be a power of 2
+   explicit GenericEntryRing(std::size_t capacity = DefaultCapacity) :
+      records_(capacity),
+      mask_(capacity - 1),
+      head_(0),
+      tail_(0),
+      producerExited_(false),
+      overflowing_(false)
+   {}
+
+   ~GenericEntryRing()
+   {
+      RecordType* record;
+      while ((record = Front()) != nullptr)
+         PopFront();
+   }
+
+   GenericEntryRing(const GenericEntryRing&) = delete;
+   GenericEntryRing& operator=(const GenericEntryRing&) = delete;
+
+   // Producer side: the slot to fill, or null if the ring is full (or
+   // overflowed and not yet emptied by the consumer)
+   RecordType* BeginPush()
+   {
+      if (overflowing_.load(std::memory_order_acquire))
+         return nullptr;
+      std::size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail - head_.load(std::memory_order_acquire) > mask_)
+         return nullptr;
+      return &records_[tail & mask_];
+   }
+
+   // Producer side: publish the slot returned by BeginPush()
+   void CommitPush()
+   { tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+         std::memory_order_release); }
+
+   // Producer side: add a record when BeginPush() returned null
+   void PushOverflow(std::unique_ptr<RecordType> record)
+   {
+      std::lock_guard<std::mutex> lock(overflowMutex_);
+      overflow_.push_back(std::move(record));
+      overflowing_.store(true, std::memory_order_release);
+   }
+
+   // Consumer side: move the overflow records (oldest first) to the end of
+   // dest, letting the producer return to the ring
+   template <typename TContainer>
+   void TakeOverflow(TContainer& dest)
+   {
+      if (!overflowing_.load(std::memory_order_acquire))
+         return;
+      std::lock_guard<std::mutex> lock(overflowMutex_);
+      for (auto& record : overflow_)
+         dest.push_back(std::move(record));
+      overflow_.clear();
+      overflowing_.store(false, std::memory_order_release);
+   }
+
+   // Consumer side: the oldest record, or null if empty
+   RecordType* Front()
+   {
+      std::size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire))
+         return nullptr;
+      return &records_[head & mask_];
+   }
+
+   // Consumer side: release the record returned by Front()
+   void PopFront()
+   {
+      std::size_t head = head_.load(std::memory_order_relaxed);
+      records_[head & mask_].Reset();
+      head_.store(head + 1, std::memory_order_release);
+   }
+
+   // Producer side: the number of records not yet released by the consumer
+   std::size_t Size() const
+   {
+      return tail_.load(std::memory_order_relaxed) -
+         head_.load(std::memory_order_acquire);
+   }
+
+   // Whether there are no records in the ring or the overflow list
+   bool IsEmpty() const
+   {
+      return !overflowing_.load(std::memory_order_acquire) &&
+         head_.load(std::memory_order_acquire) ==
+         tail_.load(std::memory_order_acquire);
+   }
+
+   void MarkProducerExited()
+   { producerExited_.store(true, std::memory_order_release); }
+   bool HasProducerExited() const
+   { return producerExited_.load(std::memory_order_acquire); }
+};
+
+
+} // namespace internal
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
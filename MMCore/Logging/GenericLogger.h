@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "DeferredArgs.h"
+
 #include <functional>
 #include <sstream>
 #include <string>
@@ -31,6 +33,7 @@ template <typename TEntryData>
 class GenericLogger
 {
    std::function<void (TEntryData, const char*)> impl_;
+   std::function<void (TEntryData, const DeferredArgs&)> deferredImpl_;
 
 public:
    typedef TEntryData EntryDataType;
@@ -39,11 +42,41 @@ public:
       impl_(f)
    {}
 
+   GenericLogger(std::function<void (TEntryData, const char*)> f,
+         std::function<void (TEntryData, const DeferredArgs&)> deferred) :
+      impl_(f),
+      deferredImpl_(deferred)
+   {}
+
    void operator()(TEntryData entryData, const char* message) const
    { impl_(entryData, message); }
 
    void operator()(TEntryData entryData, const std::string& message) const
    { impl_(entryData, message.c_str()); }
+
+   /**
+    * Log an entry consisting of the arguments, formatted as by operator<<.
+    *
+    * The arguments are copied and formatted later, off the calling thread,
+    * when possible. Arguments must be strings, arithmetic types, or pointers.
+    * See the LOG_DEFERRED_* macros.
+    */
+   template <typename... TArgs>
+   void Deferred(TEntryData entryData, const TArgs&... args) const
+   {
+      if (deferredImpl_)
+      {
+         DeferredArgs deferred;
+         if (deferred.Append(args...))
+         {
+            deferredImpl_(entryData, deferred);
+            return;
+         }
+      }
+      std::ostringstream strm;
+      (strm << ... << args);
+      impl_(entryData, strm.str().c_str());
+   }
 };
 
 
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "DeferredArgs.h"
 #include "GenericLinePacket.h"
 #include "GenericLogger.h"
 #include "GenericMetadata.h"
@@ -23,9 +24,11 @@
 #include "GenericSink.h"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -64,6 +67,9 @@ private:
 
    std::mutex syncSinksMutex_; // Protect all access to synchronousSinks_
    std::vector< std::shared_ptr<SinkType> > synchronousSinks_;
+   // Lets senders skip syncSinksMutex_ when there are no synchronous sinks.
+   // Written with syncSinksMutex_ held.
+   std::atomic<bool> haveSyncSinks_;
 
    std::mutex asyncQueueMutex_; // Protect start/stop and sinks change
    internal::GenericPacketQueue<TMetadata> asyncQueue_;
@@ -72,7 +78,7 @@ private:
    std::vector< std::shared_ptr<SinkType> > asynchronousSinks_;
 
 public:
-   GenericLoggingCore() { StartAsyncReceiveLoop(); }
+   GenericLoggingCore() : haveSyncSinks_(false) { StartAsyncReceiveLoop(); }
    ~GenericLoggingCore() { StopAsyncReceiveLoop(); }
 
    /**
@@ -86,6 +92,8 @@ public:
       // guaranteed to be safe to call at any time.
       return internal::GenericLogger<EntryDataType>(
             std::bind(&GenericLoggingCore::SendEntryToShared,
+               this->shared_from_this(), metadata, std::placeholders::_1, std::placeholders::_2),
+            std::bind(&GenericLoggingCore::SendDeferredToShared,
                this->shared_from_this(), metadata, std::placeholders::_1, std::placeholders::_2));
    }
 
@@ -100,6 +108,7 @@ public:
          {
             std::lock_guard<std::mutex> lock(syncSinksMutex_);
             synchronousSinks_.push_back(sink);
+            haveSyncSinks_ = true;
             break;
          }
          case SinkModeAsynchronous:
@@ -131,6 +140,7 @@ public:
                      sink);
             if (it != synchronousSinks_.end())
                synchronousSinks_.erase(it);
+            haveSyncSinks_ = !synchronousSinks_.empty();
             break;
          }
          case SinkModeAsynchronous:
@@ -205,6 +215,7 @@ public:
          }
       }
 
+      haveSyncSinks_ = !synchronousSinks_.empty();
       StartAsyncReceiveLoop();
    }
 
@@ -253,33 +264,66 @@ public:
    }
 
 private:
-   // Static wrapper allowing the use of a shared_ptr for the target instance
+   // Static wrappers allowing the use of a shared_ptr for the target instance
    static void
    SendEntryToShared(std::shared_ptr<GenericLoggingCore> self,
          LoggerDataType loggerData, EntryDataType entryData,
          const char* entryText)
    { self->SendEntry(loggerData, entryData, entryText); }
 
+   static void
+   SendDeferredToShared(std::shared_ptr<GenericLoggingCore> self,
+         LoggerDataType loggerData, EntryDataType entryData,
+         const DeferredArgs& args)
+   { self->SendDeferred(loggerData, entryData, args); }
+
    void SendEntry(LoggerDataType loggerData, EntryDataType entryData,
          const char* entryText)
    {
       StampDataType stampData;
       stampData.Stamp();
 
+      RunSynchronousSinks(loggerData, entryData, stampData, entryText);
+      asyncQueue_.SendEntry(TMetadata(loggerData, entryData, stampData),
+            entryText);
+   }
+
+   void SendDeferred(LoggerDataType loggerData, EntryDataType entryData,
+         const DeferredArgs& args)
+   {
+      StampDataType stampData;
+      stampData.Stamp();
+
+      if (haveSyncSinks_)
+      {
+         // Synchronous sinks need the text now.
+         std::ostringstream strm;
+         args.FormatTo(strm);
+         RunSynchronousSinks(loggerData, entryData, stampData,
+               strm.str().c_str());
+      }
+      asyncQueue_.SendDeferred(TMetadata(loggerData, entryData, stampData),
+            args);
+   }
+
+   void RunSynchronousSinks(LoggerDataType loggerData,
+         EntryDataType entryData, StampDataType stampData,
+         const char* entryText)
+   {
+      if (!haveSyncSinks_)
+         return;
+
       PacketArrayType packets;
       packets.AppendEntry(loggerData, entryData, stampData, entryText);
 
-      {
-         std::lock_guard<std::mutex> lock(syncSinksMutex_);
+      std::lock_guard<std::mutex> lock(syncSinksMutex_);
 
-         for (typename std::vector< std::shared_ptr<SinkType> >::iterator
-               it = synchronousSinks_.begin(), end = synchronousSinks_.end();
-               it != end; ++it)
-         {
-            (*it)->Consume(packets);
-         }
+      for (typename std::vector< std::shared_ptr<SinkType> >::iterator
+            it = synchronousSinks_.begin(), end = synchronousSinks_.end();
+            it != end; ++it)
+      {
+         (*it)->Consume(packets);
       }
-      asyncQueue_.SendPackets(packets.Begin(), packets.End());
    }
 
    // Called on the receive thread of GenericPacketQueue
@@ -16,11 +16,24 @@
 
 #pragma once
 
+#include "DeferredArgs.h"
+#include "GenericEntryRing.h"
+#include "GenericPacketArray.h"
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 
 namespace mmcore {
@@ -28,21 +41,64 @@ namespace internal {
 namespace logging {
 namespace internal {
 
+/**
+ * The "queue" for asynchronous sinks
+ *
+ * Each sending thread writes unformatted entries into its own preallocated
+ * ring (GenericEntryRing), so that sending takes no lock in the common case.
+ * Sending never waits for the receive thread: when a ring is full, entries
+ * overflow to the heap. The receive thread collects the entries from all rings in the order they
+ * were sent, formats them into packets, and hands the packets to the sinks.
+ */
 template <typename TMetadata>
 class GenericPacketQueue
 {
    typedef GenericPacketArray<TMetadata> PacketArrayType;
+   typedef GenericEntryRing<TMetadata> RingType;
+   typedef GenericEntryRecord<TMetadata> RecordType;
+
+   // Upper bound on entries formatted before handing packets to the sinks
+   static const std::size_t MaxEntriesPerBatch = 1024;
 
 private:
-   // The "queue" for asynchronous sinks.
+   const std::uint64_t queueId_;
+   std::atomic<std::uint64_t> nextSequence_;
+
+   std::mutex ringsMutex_; // Protects rings_; taken once per sending thread
+                           // and before the receive loop sleeps
+   std::vector< std::shared_ptr<RingType> > rings_;
+
    std::mutex mutex_;
    std::condition_variable condVar_;
-   PacketArrayType queue_;
+   bool shutdownRequested_; // Protected by mutex_
+   bool drainRequested_; // Protected by mutex_
+   // Set while the receive loop waits without timeout; senders must wake it
+   std::atomic<bool> receiverSleeping_;
 
-   // Swapped with queue_ and accessed from receiving thread.
-   PacketArrayType received_;
+   // Accessed from receiving thread.
+   struct ReceivingRing
+   {
+      std::shared_ptr<RingType> ring;
+      // Taken from the ring's overflow list; oldest first, starting at
+      // overflowPos
+      std::vector< std::unique_ptr<RecordType> > overflow;
+      std::size_t overflowPos;
 
-   bool shutdownRequested_; // Protected by mutex_
+      const RecordType* OverflowFront() const
+      { return overflowPos < overflow.size() ? overflow[overflowPos].get() : nullptr; }
+
+      void OverflowPopFront()
+      {
+         if (++overflowPos == overflow.size())
+         {
+            overflow.clear();
+            overflowPos = 0;
+         }
+      }
+   };
+   std::vector<ReceivingRing> receivingRings_;
+   PacketArrayType received_;
+   std::ostringstream formatStream_;
 
    // threadMutex_ protects the start/stop of loopThread_; it must be acquired
    // before mutex_.
@@ -51,15 +107,23 @@ private:
 
 public:
    GenericPacketQueue() :
-      shutdownRequested_(false)
+      queueId_(NextQueueId()),
+      nextSequence_(0),
+      shutdownRequested_(false),
+      drainRequested_(false),
+      receiverSleeping_(false)
    {}
 
-   template <typename TPacketIter>
-   void SendPackets(TPacketIter first, TPacketIter last)
+   void SendEntry(const TMetadata& metadata, const char* entryText)
    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      queue_.Append(first, last);
-      condVar_.notify_one();
+      Send([&](RecordType& record, std::uint64_t sequence)
+            { record.SetText(sequence, metadata, entryText); });
+   }
+
+   void SendDeferred(const TMetadata& metadata, const DeferredArgs& args)
+   {
+      Send([&](RecordType& record, std::uint64_t sequence)
+            { record.SetArgs(sequence, metadata, args); });
    }
 
    void RunReceiveLoop(std::function<void (PacketArrayType&)>
@@ -104,16 +168,112 @@ public:
    }
 
 private:
+   static std::uint64_t NextQueueId()
+   {
+      static std::atomic<std::uint64_t> nextId(1);
+      return nextId.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   template <typename TFill>
+   void Send(TFill fill)
+   {
+      RingType* ring = RingForThisThread();
+      RecordType* record = ring->BeginPush();
+      if (record)
+      {
+         fill(*record, nextSequence_.fetch_add(1, std::memory_order_relaxed));
+         ring->CommitPush();
+      }
+      else
+      {
+         // The receive loop is behind (or being restarted). Rather than wait
+         // for it, allocate.
+         std::unique_ptr<RecordType> overflow(new RecordType);
+         fill(*overflow, nextSequence_.fetch_add(1, std::memory_order_relaxed));
+         ring->PushOverflow(std::move(overflow));
+      }
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (receiverSleeping_.load(std::memory_order_relaxed))
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         condVar_.notify_one();
+      }
+      else if (ring->Size() == RingType::DefaultCapacity / 2)
+      {
+         // Don't wait for the batching interval when entries arrive fast
+         RequestDrain();
+      }
+   }
+
+   void RequestDrain()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      drainRequested_ = true;
+      condVar_.notify_one();
+   }
+
+   RingType* RingForThisThread()
+   {
+      // The rings are shared with the queue. When the thread exits, the
+      // queue drains and drops its ring; when the queue is destroyed, the
+      // thread drops the ring the next time it looks up a new queue.
+      struct ThreadRings
+      {
+         std::vector< std::pair<std::uint64_t, std::shared_ptr<RingType>> >
+            rings;
+         std::uint64_t lastQueueId = 0;
+         RingType* lastRing = nullptr;
+
+         ~ThreadRings()
+         {
+            for (auto& entry : rings)
+               entry.second->MarkProducerExited();
+         }
+      };
+      thread_local ThreadRings threadRings;
+
+      if (threadRings.lastQueueId == queueId_)
+         return threadRings.lastRing;
+
+      std::shared_ptr<RingType> ring;
+      for (auto it = threadRings.rings.begin();
+            it != threadRings.rings.end(); )
+      {
+         if (it->first == queueId_)
+         {
+            ring = it->second;
+            ++it;
+         }
+         else if (it->second.use_count() == 1) // Queue is gone
+            it = threadRings.rings.erase(it);
+         else
+            ++it;
+      }
+      if (!ring)
+      {
+         ring = std::make_shared<RingType>();
+         {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            rings_.push_back(ring);
+         }
+         threadRings.rings.emplace_back(queueId_, ring);
+      }
+      threadRings.lastQueueId = queueId_;
+      threadRings.lastRing = ring.get();
+      return ring.get();
+   }
+
    void ReceiveLoop(std::function<void (PacketArrayType&)> consume)
    {
       using namespace std::chrono_literals;
 
       // The loop operates in one of two modes: timed wait and untimed wait.
       //
-      // When in timed wait mode, the loop unconditionally waits for a fixed
-      // interval before checking for data. If data is available, it is
-      // processed and the loop repeats an unconditional wait. If no data is
-      // available, the loop switches to untimed wait mode.
+      // When in timed wait mode, the loop waits for a fixed interval before
+      // checking for data, unless a sender finds its ring filling up. If data
+      // is available, it is processed and the loop repeats the wait. If no
+      // data is available, the loop switches to untimed wait mode.
       //
       // In untimed wait mode, the loop waits on a condition variable until
       // notification from the frontend. Once data is available, the loop
@@ -124,59 +284,170 @@ private:
       // threads and limiting the frequency of stream flushing.
 
       bool timedWaitMode = true;
-      bool shuttingDown = false;
 
       for (;;)
       {
-         if (timedWaitMode)
+         bool shuttingDown = false;
          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (timedWaitMode)
             {
-               std::unique_lock<std::mutex> lock(mutex_);
                condVar_.wait_for(lock, 10ms,
-                  [&] { return shutdownRequested_; });
-               if (shutdownRequested_)
-               {
-                  shutdownRequested_ = false; // Allow for restarting
-                  shuttingDown = true;
-               }
-               if (!shuttingDown && queue_.IsEmpty())
+                  [&] { return shutdownRequested_ || drainRequested_; });
+            }
+            else
+            {
+               receiverSleeping_.store(true, std::memory_order_relaxed);
+               std::atomic_thread_fence(std::memory_order_seq_cst);
+               while (!shutdownRequested_ && !drainRequested_ &&
+                     !HasReceivableEntries())
                {
-                  timedWaitMode = false;
-                  continue;
+                  condVar_.wait(lock);
                }
-               queue_.Swap(received_);
+               receiverSleeping_.store(false, std::memory_order_relaxed);
+            }
+            drainRequested_ = false;
+            if (shutdownRequested_)
+            {
+               shutdownRequested_ = false; // Allow for restarting
+               shuttingDown = true;
             }
-            consume(received_);
-            received_.Clear();
-
-            if (shuttingDown)
-               return;
          }
-         else // untimed wait mode
+
+         bool received = Receive(consume);
+
+         if (shuttingDown)
+            return;
+
+         timedWaitMode = received;
+      }
+   }
+
+   // Called with mutex_ held. A ring added since the last Receive() counts
+   // as receivable: its thread may have pushed its first entry before this
+   // loop announced that it was sleeping, in which case no notification
+   // comes.
+   bool HasReceivableEntries()
+   {
+      {
+         std::lock_guard<std::mutex> lock(ringsMutex_);
+         if (rings_.size() != receivingRings_.size())
+            return true;
+      }
+      for (const auto& r : receivingRings_)
+      {
+         if (!r.ring->IsEmpty() || r.OverflowFront())
+            return true;
+      }
+      return false;
+   }
+
+   // Format and consume all entries sent so far; return whether there were
+   // any.
+   bool Receive(const std::function<void (PacketArrayType&)>& consume)
+   {
+      UpdateReceivingRings();
+
+      // Entries sent after this point wait for the next round, so that a
+      // busy sender cannot keep us here.
+      const std::uint64_t endSequence =
+         nextSequence_.load(std::memory_order_relaxed);
+
+      for (auto& r : receivingRings_)
+         r.ring->TakeOverflow(r.overflow);
+
+      bool receivedAny = false;
+      std::size_t batchCount = 0;
+      for (;;)
+      {
+         // Merge the rings and overflow lists by sequence number. There are
+         // only as many rings as threads that have logged, so a linear scan
+         // is good enough.
+         ReceivingRing* next = nullptr;
+         const RecordType* nextRecord = nullptr;
+         for (auto& r : receivingRings_)
          {
+            const RecordType* candidates[] = {
+               r.ring->Front(),
+               r.OverflowFront(),
+            };
+            for (const RecordType* record : candidates)
             {
-               std::unique_lock<std::mutex> lock(mutex_);
-               while (queue_.IsEmpty())
+               if (record && (!nextRecord ||
+                        record->GetSequence() < nextRecord->GetSequence()))
                {
-                  condVar_.wait(lock);
-                  if (shutdownRequested_)
-                  {
-                     shutdownRequested_ = false; // Allow for restarting
-                     shuttingDown = true;
-                     break;
-                  }
+                  next = &r;
+                  nextRecord = record;
                }
-               queue_.Swap(received_);
             }
+         }
+         if (!nextRecord || nextRecord->GetSequence() >= endSequence)
+            break;
+
+         AppendRecord(*nextRecord);
+         if (nextRecord == next->OverflowFront())
+            next->OverflowPopFront();
+         else
+            next->ring->PopFront();
+         receivedAny = true;
+
+         if (++batchCount == MaxEntriesPerBatch)
+         {
             consume(received_);
             received_.Clear();
+            batchCount = 0;
+         }
+      }
 
-            if (shuttingDown)
-               return;
+      if (!received_.IsEmpty())
+      {
+         consume(received_);
+         received_.Clear();
+      }
+      return receivedAny;
+   }
+
+   void UpdateReceivingRings()
+   {
+      std::lock_guard<std::mutex> lock(ringsMutex_);
 
-            timedWaitMode = true;
+      // Rings whose thread has exited are dropped once empty (the order of
+      // the checks matters: an exited producer adds no more entries).
+      for (auto it = receivingRings_.begin(); it != receivingRings_.end(); )
+      {
+         if (it->ring->HasProducerExited() && it->ring->IsEmpty() &&
+               !it->OverflowFront())
+         {
+            rings_.erase(std::find(rings_.begin(), rings_.end(), it->ring));
+            it = receivingRings_.erase(it);
          }
+         else
+            ++it;
+      }
+
+      // Rings are only ever appended to rings_, except above
+      for (std::size_t i = receivingRings_.size(); i < rings_.size(); ++i)
+         receivingRings_.push_back(ReceivingRing{rings_[i], {}, 0});
+   }
+
+   void AppendRecord(const RecordType& record)
+   {
+      const TMetadata& metadata = record.GetMetadata();
+      const char* text;
+      std::string formatted;
+      if (record.GetLongText())
+      {
+         text = record.GetLongText()->c_str();
+      }
+      else
+      {
+         formatStream_.str(std::string());
+         record.GetArgs().FormatTo(formatStream_);
+         formatted = formatStream_.str();
+         text = formatted.c_str();
       }
+      received_.AppendEntry(metadata.GetLoggerData(),
+            metadata.GetEntryData(), metadata.GetStampData(), text);
    }
 };
 
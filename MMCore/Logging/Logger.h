@@ -60,3 +60,31 @@ typedef internal::GenericLogStream<Logger> LogStream;
 #define LOG_WARNING(logger) LOG_WITH_LEVEL((logger), ::mmcore::LogLevelWarning)
 #define LOG_ERROR(logger) LOG_WITH_LEVEL((logger), ::mmcore::LogLevelError)
 #define LOG_CRITICAL(logger) LOG_WITH_LEVEL((logger), ::mmcore::LogLevelCritical)
+
+
+// Deferred-formatting shorthands, for hot paths
+//
+// Usage:
+//
+//     LOG_DEFERRED_DEBUG(myLogger, "Inserted image ", n, " from ", label);
+//
+// The arguments are copied into a preallocated buffer and formatted on the
+// logging backend thread (when no synchronous sink is attached). Arguments
+// must be strings, chars, bools, arithmetic types, or pointers; use LOG_DEBUG
+// etc. for anything else.
+
+#define LOG_DEFERRED(logger, level, ...) \
+   (logger).Deferred((level), __VA_ARGS__)
+
+#define LOG_DEFERRED_TRACE(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelTrace, __VA_ARGS__)
+#define LOG_DEFERRED_DEBUG(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelDebug, __VA_ARGS__)
+#define LOG_DEFERRED_INFO(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelInfo, __VA_ARGS__)
+#define LOG_DEFERRED_WARNING(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelWarning, __VA_ARGS__)
+#define LOG_DEFERRED_ERROR(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelError, __VA_ARGS__)
+#define LOG_DEFERRED_CRITICAL(logger, ...) \
+   LOG_DEFERRED((logger), ::mmcore::LogLevelCritical, __VA_ARGS__)
@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
@@ -93,12 +94,23 @@ public:
    // Format the line prefix for the first line of an entry
    void FormatLinePrefix(std::ostream& stream, const Metadata& metadata);
 
+   // Same, from metadata fields (as read back from a binary log)
+   void FormatLinePrefix(std::ostream& stream,
+         std::chrono::time_point<std::chrono::system_clock> timestamp,
+         std::uint64_t threadId, LogLevel level, const char* label);
+
    // Format the line prefix for subsequent lines of an entry
    void FormatContinuationPrefix(std::ostream& stream);
 
 protected:
    explicit MetadataFormatter(bool useColor) :
       openBracketCol_(0), closeBracketCol_(0), useColor_(useColor) {}
+
+private:
+   template <typename TThreadId>
+   void FormatPrefix(std::ostream& stream,
+         std::chrono::time_point<std::chrono::system_clock> timestamp,
+         TThreadId threadId, LogLevel level, const char* label);
 };
 
 
@@ -135,20 +147,41 @@ FormatLocalTime(std::chrono::time_point<std::chrono::system_clock> tp)
 inline void
 MetadataFormatter::FormatLinePrefix(std::ostream& stream,
       const Metadata& metadata)
+{
+   FormatPrefix(stream, metadata.GetStampData().GetTimestamp(),
+         metadata.GetStampData().GetThreadId(),
+         metadata.GetEntryData().GetLevel(),
+         metadata.GetLoggerData().GetComponentLabel());
+}
+
+
+inline void
+MetadataFormatter::FormatLinePrefix(std::ostream& stream,
+      std::chrono::time_point<std::chrono::system_clock> timestamp,
+      std::uint64_t threadId, LogLevel level, const char* label)
+{
+   FormatPrefix(stream, timestamp, threadId, level, label);
+}
+
+
+template <typename TThreadId>
+inline void
+MetadataFormatter::FormatPrefix(std::ostream& stream,
+      std::chrono::time_point<std::chrono::system_clock> timestamp,
+      TThreadId threadId, LogLevel level, const char* label)
 {
    // Pre-forming string is more efficient than writing bit by bit to stream.
 
-   buf_ = FormatLocalTime(metadata.GetStampData().GetTimestamp());
+   buf_ = FormatLocalTime(timestamp);
    buf_ += " tid";
    sstrm_.str(std::string());
-   sstrm_ << metadata.GetStampData().GetThreadId();
+   sstrm_ << threadId;
    buf_ += sstrm_.str();
    buf_ += ' ';
 
    openBracketCol_ = buf_.size();
    buf_ += '[';
 
-   const auto level = metadata.GetEntryData().GetLevel();
    const char* levelStr = LevelString(level);
    if (useColor_)
       buf_ += LevelColorCode(level);
@@ -157,7 +190,6 @@ MetadataFormatter::FormatLinePrefix(std::ostream& stream,
       buf_ += LevelColorReset(level);
    buf_ += ',';
 
-   const char* label = metadata.GetLoggerData().GetComponentLabel();
    buf_ += label;
 
    closeBracketCol_ = openBracketCol_ + 1 +
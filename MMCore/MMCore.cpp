@@ -46,12 +46,14 @@
 #include "CoreUtils.h"
 #include "DeviceManager.h"
 #include "Devices/DeviceInstances.h"
+#include "FrameStreamWriter.h"
 #include "LogManager.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
 #include "NotificationQueue.h"
 #include "PluginManager.h"
 #include "SynchronizedConfiguration.h"
+#include "ThreadPool.h"
 
 #include "DeviceUtils.h"
 #include "ImageMetadata.h"
@@ -63,8 +65,11 @@
 #include <cstring>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <future>
+#include <iomanip>
 #include <map>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <thread>
@@ -105,10 +110,14 @@ namespace notif = mmcore::internal::notification;
  * provided that the resulting MMCoreJ.jar can be dropped in without
  * recompilation of client Java code.
  *
+ * Update the MMCoreJ version in MMCoreJ_wrap/pom.xml in the same change.
+ * VersionConsistencyIT checks that they match when MMCoreJ is built, and
+ * tools/check-mmcore-version.sh checks the sources without a build.
+ *
  * (Keep the 3 numbers on one line to make it easier to look at diffs when
  * merging/rebasing.)
  */
-const int MMCore_versionMajor = 12, MMCore_versionMinor = 5, MMCore_versionPatch = 0;
+const int MMCore_versionMajor = 12, MMCore_versionMinor = 10, MMCore_versionPatch = 0;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -131,8 +140,9 @@ CMMCore::CMMCore() :
    nullAffine_(6, 0.0),
    configGroups_(std::make_unique<mmi::ConfigGroupCollection>()),
    pixelSizeGroup_(std::make_unique<PixelSizeConfigGroup>()),
+   threadPool_(std::make_shared<mmi::ThreadPool>()),
    cbuf_(std::make_unique<mmi::CircularBuffer>(
-      (sizeof(void*) > 4) ? 250u : 25u)),
+      (sizeof(void*) > 4) ? 250u : 25u, threadPool_)),
    callback_(std::make_unique<mmi::CoreCallback>(this)),
    pluginManager_(std::make_shared<mmi::CPluginManager>()),
    deviceManager_(std::make_shared<mmi::DeviceManager>()),
@@ -189,7 +199,13 @@ CMMCore::~CMMCore()
  *   are initialized in serial order, and all other devices are in parallel, using 
  *   multiple threads, one per device module.  Early testing shows this to be 
  *   reliable, but switch this off when issues are encountered during 
- *   device initialization.
+ *   device initialization. Peripherals are initialized after their hub,
+ *   even when it belongs to another module.
+ * - "ParallelConfigurationLoading" (default: disabled) When enabled,
+ *   loadSystemConfiguration() loads the device adapter modules named in the
+ *   file in parallel before creating any devices, and applies runs of
+ *   Property lines that follow device initialization concurrently across
+ *   device modules (in file order within each module).
  *
  * Permanently enabled features:
  * - None so far.
@@ -267,6 +283,32 @@ void CMMCore::setPrimaryLogFileRotation(long long maxFileSize, int maxBackupCoun
          maxBackupCount);
 }
 
+/**
+ * Write the primary Core log file in a compact binary format.
+ *
+ * Binary logging avoids formatting each entry on the logging thread and
+ * produces smaller files. Binary logs can be converted to the usual text
+ * format with the mmlogdecode tool.
+ *
+ * If a primary log file is open, logging switches to a new file of the
+ * requested format; the existing file is renamed as if it had been rotated.
+ * Rotation settings apply to binary logs in the same way as to text logs.
+ *
+ * @param enable true to write binary logs; false (the default) for text
+ */
+void CMMCore::enableBinaryPrimaryLog(bool enable) MMCORE_LEGACY_THROW(CMMError)
+{
+   logManager_->SetPrimaryLogBinary(enable);
+}
+
+/**
+ * Indicates whether the primary Core log file is written in binary format.
+ */
+bool CMMCore::binaryPrimaryLogEnabled()
+{
+   return logManager_->IsPrimaryLogBinary();
+}
+
 /**
  * Record text message in the log file.
  */
@@ -462,13 +504,19 @@ int CMMCore::getMMCoreVersionPatch() { return MMCore_versionPatch; }
 
 /**
  * Get available devices from the specified device library.
+ *
+ * If a device adapter catalog is set (see setDeviceAdapterCatalogFile()),
+ * the library need not be loaded.
  */
 std::vector<std::string>
 CMMCore::getAvailableDevices(const char* moduleName) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::shared_ptr<mmi::LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   return module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
+   std::vector<std::string> names;
+   for (const auto& device : pluginManager_->GetAvailableDevices(moduleName))
+      names.push_back(device.name);
+   return names;
 }
 
 /**
@@ -479,16 +527,11 @@ CMMCore::getAvailableDeviceDescriptions(const char* moduleName) MMCORE_LEGACY_TH
 {
    // XXX It is a little silly that we return the list of descriptions, rather
    // than provide access to the description of each device.
-   std::shared_ptr<mmi::LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   std::vector<std::string> names = module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
    std::vector<std::string> descriptions;
-   descriptions.reserve(names.size());
-   for (std::vector<std::string>::const_iterator
-         it = names.begin(), end = names.end(); it != end; ++it)
-   {
-      descriptions.push_back(module->GetDeviceDescription(*it));
-   }
+   for (const auto& device : pluginManager_->GetAvailableDevices(moduleName))
+      descriptions.push_back(device.description);
    return descriptions;
 }
 
@@ -500,17 +543,11 @@ CMMCore::getAvailableDeviceTypes(const char* moduleName) MMCORE_LEGACY_THROW(CMM
 {
    // XXX It is a little silly that we return the list of types, rather than
    // provide access to the type of each device.
-   std::shared_ptr<mmi::LoadedDeviceAdapter> module =
-      pluginManager_->GetDeviceAdapter(moduleName);
-   std::vector<std::string> names = module->GetAvailableDeviceNames();
+   if (!moduleName)
+      throw CMMError("Null device adapter module name");
    std::vector<long> types;
-   types.reserve(names.size());
-   for (std::vector<std::string>::const_iterator
-         it = names.begin(), end = names.end(); it != end; ++it)
-   {
-      MM::DeviceType devType = module->GetAdvertisedDeviceType(*it);
-      types.push_back(static_cast<long>(devType));
-   }
+   for (const auto& device : pluginManager_->GetAvailableDevices(moduleName))
+      types.push_back(static_cast<long>(device.type));
    return types;
 }
 
@@ -537,45 +574,56 @@ int CMMCore::getMMDeviceDeviceInterfaceVersion() { return DEVICE_INTERFACE_VERSI
  * error. If there is an error, properties may be missing from the return
  * value.
  *
+ * If the ParallelStateRead Core property is enabled, devices of different
+ * device adapter modules are read concurrently.
+ *
  * @return Configuration object containing a collection of device-property-value triplets
  */
 Configuration CMMCore::getSystemState()
 {
-   Configuration config;
    std::vector<std::string> devices = deviceManager_->GetDeviceList();
-   for (std::vector<std::string>::const_iterator i = devices.begin(), dend = devices.end(); i != dend; ++i)
+   std::vector<std::vector<PropertySetting>> deviceSettings(devices.size());
+
+   // Devices are grouped by module; with ParallelStateRead enabled, the
+   // modules are read concurrently, one thread per module as in
+   // initializeAllDevices()
+   std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>,
+      std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, size_t>>> moduleMap;
+   for (size_t i = 0; i < devices.size(); ++i)
    {
-      std::shared_ptr<mmi::DeviceInstance> pDev = deviceManager_->GetDevice(*i);
-      mmi::DeviceModuleLockGuard guard(pDev);
-      std::vector<std::string> propertyNames = pDev->GetPropertyNames();
-      for (std::vector<std::string>::const_iterator it = propertyNames.begin(), end = propertyNames.end();
-            it != end; ++it)
-      {
-         std::string val;
-         try
-         {
-            val = pDev->GetProperty(*it);
-         }
-         catch (const CMMError&)
-         {
-            // XXX BUG This should not be ignored, but the interface does not
-            // allow throwing from this function. Keeping old behavior for now.
-         }
+      std::shared_ptr<mmi::DeviceInstance> pDev = deviceManager_->GetDevice(devices[i]);
+      moduleMap[parallelStateRead_ ? pDev->GetAdapterModule() : nullptr]
+         .emplace_back(pDev, i);
+   }
 
-         bool readOnly = false;
-         try
-         {
-            readOnly = pDev->GetPropertyReadOnly(it->c_str());
-         }
-         catch (const CMMError&)
-         {
-            // XXX BUG This should not be ignored, but the interface does not
-            // allow throwing from this function. Keeping old behavior for now.
-         }
-         config.addSetting(PropertySetting(i->c_str(), it->c_str(), val.c_str(), readOnly));
-      }
+   auto readModule = [this, &devices, &deviceSettings](
+         const std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, size_t>>& moduleDevices) {
+      for (const auto& dev : moduleDevices)
+         readDeviceState(dev.first, devices[dev.second], deviceSettings[dev.second]);
+   };
+   if (moduleMap.size() == 1)
+   {
+      readModule(moduleMap.begin()->second);
+   }
+   else if (moduleMap.size() > 1)
+   {
+      std::vector<std::future<void>> futures;
+      for (auto& moduleDevices : moduleMap)
+         futures.push_back(std::async(std::launch::async, readModule,
+               std::cref(moduleDevices.second)));
+      for (auto& fut : futures)
+         fut.wait();
+      for (auto& fut : futures)
+         fut.get();
    }
 
+   // Settings are added in device order, regardless of which module was
+   // read first
+   Configuration config;
+   for (const auto& settings : deviceSettings)
+      for (const auto& setting : settings)
+         config.addSetting(setting);
+
    // add core properties
    std::vector<std::string> coreProps = properties_->GetNames();
    for (unsigned i=0; i < coreProps.size(); i++)
@@ -588,6 +636,42 @@ Configuration CMMCore::getSystemState()
    return config;
 }
 
+/**
+ * Reads all properties of a device, holding the module lock throughout.
+ */
+void CMMCore::readDeviceState(std::shared_ptr<mmcore::internal::DeviceInstance> pDev,
+      const std::string& label, std::vector<PropertySetting>& settings)
+{
+   mmi::DeviceModuleLockGuard guard(pDev);
+   std::vector<std::string> propertyNames = pDev->GetPropertyNames();
+   for (std::vector<std::string>::const_iterator it = propertyNames.begin(), end = propertyNames.end();
+         it != end; ++it)
+   {
+      std::string val;
+      try
+      {
+         val = pDev->GetProperty(*it);
+      }
+      catch (const CMMError&)
+      {
+         // XXX BUG This should not be ignored, but the interface does not
+         // allow throwing from this function. Keeping old behavior for now.
+      }
+
+      bool readOnly = false;
+      try
+      {
+         readOnly = pDev->GetPropertyReadOnly(it->c_str());
+      }
+      catch (const CMMError&)
+      {
+         // XXX BUG This should not be ignored, but the interface does not
+         // allow throwing from this function. Keeping old behavior for now.
+      }
+      settings.push_back(PropertySetting(label.c_str(), it->c_str(), val.c_str(), readOnly));
+   }
+}
+
 /**
  * Returns the entire system state, i.e. the collection of all property values from all devices.
  * This method will return cached values instead of querying each device
@@ -595,7 +679,8 @@ Configuration CMMCore::getSystemState()
  */
 Configuration CMMCore::getSystemStateCache() const
 {
-   return stateCache_->get();
+   // Copied from a snapshot, without blocking cache updates
+   return *stateCache_->snapshot();
 }
 
 /**
@@ -644,49 +729,51 @@ Configuration CMMCore::getConfigGroupState(const char* group, bool fromCache) MM
 {
    CheckConfigGroupName(group);
 
-   std::vector<std::string> allPresets =
-      configGroups_->GetAvailableConfigs(group);
-
    Configuration state;
+   const ConfigGroup* presets = configGroups_->FindGroup(group);
+   if (!presets)
+      return state;
+   stateCache_->compilePresets(SynchronizedConfiguration::Presets::ConfigGroup,
+         group, *presets, MM::g_Keyword_CoreDevice);
 
-   // Loop over every property that appears in every preset, and collect the
+   // Loop over every property that appears in any preset, and collect the
    // value (from cache or from devices).
-   for (std::vector<std::string>::const_iterator
-         it = allPresets.begin(), end = allPresets.end(); it != end; ++it)
+   const std::vector<PropertyKey> props = stateCache_->getPresetProperties(
+         SynchronizedConfiguration::Presets::ConfigGroup, group);
+   for (const PropertyKey& prop : props)
    {
-      Configuration preset = getConfigData(group, it->c_str());
-
-      for (size_t i = 0; i < preset.size(); i++)
+      std::string value;
+      if (fromCache)
       {
-         PropertySetting cs = preset.getSetting(i);
-         std::string deviceLabel = cs.getDeviceLabel();
-         std::string propertyName = cs.getPropertyName();
-
-         // Skip properties that we have already added.
-         if (!state.isPropertyIncluded(deviceLabel.c_str(),
-                  propertyName.c_str()))
-         {
-            std::string value;
-            if (fromCache)
-            {
-               value = getPropertyFromCache(deviceLabel.c_str(),
-                     propertyName.c_str());
-            }
-            else
-            {
-               value = getProperty(deviceLabel.c_str(),
-                     propertyName.c_str());
-            }
-
-            PropertySetting ss(deviceLabel.c_str(), propertyName.c_str(),
-                  value.c_str());
-            state.addSetting(ss);
-         }
+         value = getPropertyFromCache(prop.first.c_str(), prop.second.c_str());
+      }
+      else
+      {
+         value = getProperty(prop.first.c_str(), prop.second.c_str());
       }
+
+      PropertySetting ss(prop.first.c_str(), prop.second.c_str(),
+            value.c_str());
+      state.addSetting(ss);
    }
    return state;
 }
 
+/**
+ * Returns the first preset of the group that matches the group's state (see
+ * getConfigGroupState()), or an empty string.
+ */
+std::string CMMCore::matchConfigGroupState(const char* group, bool fromCache) MMCORE_LEGACY_THROW(CMMError)
+{
+   Configuration state = getConfigGroupState(group, fromCache);
+   std::vector<std::optional<std::string>> values;
+   values.reserve(state.size());
+   for (size_t i = 0; i < state.size(); ++i)
+      values.push_back(state.getSetting(i).getPropertyValue());
+   return stateCache_->matchPresets(
+         SynchronizedConfiguration::Presets::ConfigGroup, group, values);
+}
+
 /**
  * Sets all properties contained in the Configuration object.
  * The procedure will attempt to set each property it encounters, but won't stop
@@ -742,6 +829,37 @@ void CMMCore::setDeviceAdapterSearchPaths(const std::vector<std::string>& paths)
    pluginManager_->SetSearchPaths(paths.begin(), paths.end());
 }
 
+/**
+ * Set the file in which to cache the devices provided by device adapters.
+ *
+ * With a catalog file set, getAvailableDevices(),
+ * getAvailableDeviceDescriptions() and getAvailableDeviceTypes() answer
+ * from the catalog without loading the device adapter, as long as the
+ * library file has not changed (by modification time and size) since it was
+ * cataloged and was built for the same module and device interface versions
+ * as this MMCore. When a device adapter is not in the catalog or its entry
+ * is stale, all such device adapters in the search paths are loaded in
+ * parallel and the catalog file is updated.
+ *
+ * The file need not exist. Pass an empty string to stop using a catalog.
+ *
+ * @param filename   path of the catalog file
+ */
+void CMMCore::setDeviceAdapterCatalogFile(const char* filename) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (!filename)
+      throw CMMError("Null device adapter catalog filename");
+   pluginManager_->SetCatalogFile(filename);
+}
+
+/**
+ * Return the device adapter catalog file, or an empty string if none is set.
+ */
+std::string CMMCore::getDeviceAdapterCatalogFile()
+{
+   return pluginManager_->GetCatalogFile();
+}
+
 /**
  * Return the names of discoverable device adapters.
  *
@@ -894,6 +1012,7 @@ void CMMCore::unloadDevice(const char* label///< the name of the device to unloa
       LOG_DEBUG(coreLogger_) << "Will unload device " << label;
       deviceManager_->UnloadDevice(pDevice);
       LOG_DEBUG(coreLogger_) << "Did unload device " << label;
+      forgetApplyRetries();
    }
    catch (CMMError& err) {
       logError("MMCore::unloadDevice", err.getMsg().c_str());
@@ -913,6 +1032,7 @@ void CMMCore::unloadAllDevices() MMCORE_LEGACY_THROW(CMMError)
       removeAllDeviceRoles();
 
       configGroups_->Clear();
+      stateCache_->forgetAllPresets();
       if (!channelGroup_.empty())
          setChannelGroup("");
 
@@ -930,6 +1050,7 @@ void CMMCore::unloadAllDevices() MMCORE_LEGACY_THROW(CMMError)
       LOG_DEBUG(coreLogger_) << "Will unload all devices";
       deviceManager_->UnloadAllDevices();
       LOG_INFO(coreLogger_) << "Did unload all devices";
+      forgetApplyRetries();
 
       // The system config has "changed" (to "(none)").
       // But don't notify if we will proceed to load a new config.
@@ -1016,10 +1137,7 @@ void CMMCore::initializeAllDevicesSerial() MMCORE_LEGACY_THROW(CMMError)
          logError(devices[i].c_str(), err.getMsg().c_str());
          throw;
       }
-      mmi::DeviceModuleLockGuard guard(pDevice);
-      LOG_INFO(coreLogger_) << "Will initialize device " << devices[i];
-      pDevice->Initialize();
-      LOG_INFO(coreLogger_) << "Did initialize device " << devices[i];
+      initializeDeviceTimed(pDevice, devices[i]);
 
       assignDefaultRole(pDevice);
    }
@@ -1028,11 +1146,52 @@ void CMMCore::initializeAllDevicesSerial() MMCORE_LEGACY_THROW(CMMError)
 }
 
 
+/**
+ * Initialization state of the devices being initialized by
+ * initializeAllDevicesParallel(), so that a peripheral can wait for its hub.
+ */
+struct CMMCore::DeviceInitProgress
+{
+   enum State { Pending, Done, Failed };
+
+   std::map<std::string, std::string> hubs; // Not modified during initialization
+   std::mutex mutex;
+   std::condition_variable cv;
+   std::map<std::string, State> states;
+
+   void Finish(const std::string& label, bool succeeded)
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         states[label] = succeeded ? Done : Failed;
+      }
+      cv.notify_all();
+   }
+
+   // Returns false if the device failed to initialize; devices that are not
+   // being initialized count as successful.
+   bool WaitFor(const std::string& label)
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto it = states.find(label);
+      if (it == states.end())
+         return true;
+      cv.wait(lock, [&] { return it->second != Pending; });
+      return it->second == Done;
+   }
+};
+
+
 /**
  * Calls Initialize() method for each loaded device.
  * This implementation initializes devices on separate threads, one per device module (adapter).
  * This method also initializes allowed values for core properties, based
  * on the collection of loaded devices.
+ *
+ * A peripheral is initialized only after its hub, which may belong to a
+ * different module. Within a module, devices are initialized in order of
+ * their depth below a hub, so that a module's thread never waits for a
+ * device that it has yet to initialize itself.
  */
 void CMMCore::initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError)
 {
@@ -1041,6 +1200,8 @@ void CMMCore::initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError)
    
    std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>, std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, std::string>>> moduleMap;
    std::vector<std::shared_ptr<mmi::DeviceInstance>> ports;
+   DeviceInitProgress progress;
+   std::map<std::string, std::string>& parents = progress.hubs;
 
    // first round, collect all DeviceAdapters
    for (size_t i = 0; i < devices.size(); i++)
@@ -1060,33 +1221,56 @@ void CMMCore::initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError)
       else {
          std::shared_ptr<mmi::LoadedDeviceAdapter> pAdapter;
          pAdapter = pDevice->GetAdapterModule();
+         moduleMap[pAdapter].push_back(make_pair(pDevice, devices[i]));
+         parents[devices[i]] = pDevice->GetParentID();
+      }
+   }
 
-         if (moduleMap.find(pAdapter) == moduleMap.end())
-         {
-            std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, std::string>> pDevices;
-            pDevices.push_back(make_pair(pDevice, devices[i]));
-            moduleMap.insert({ pAdapter, pDevices });
-         }
-         else
+   // Depth of each device below a hub. Parents that are not initialized here
+   // (ports, or devices that do not exist) do not count; devices whose
+   // parent chain is circular are not made to wait.
+   std::map<std::string, std::size_t> depths;
+   for (const auto& device : parents)
+   {
+      std::size_t depth = 0;
+      std::string label = device.first;
+      for (;;)
+      {
+         auto it = parents.find(label);
+         if (it == parents.end() || parents.count(it->second) == 0)
+            break;
+         label = it->second;
+         if (++depth > parents.size())
          {
-            moduleMap.find(pAdapter)->second.push_back(make_pair(pDevice, devices[i]));
+            LOG_WARNING(coreLogger_) << "Device " << device.first <<
+               " has a circular chain of parent devices";
+            parents[device.first].clear();
+            depth = 0;
+            break;
          }
       }
+      depths[device.first] = depth;
+      progress.states[device.first] = DeviceInitProgress::Pending;
+   }
+   for (auto& moduleDevices : moduleMap)
+   {
+      std::stable_sort(moduleDevices.second.begin(), moduleDevices.second.end(),
+         [&depths](const auto& a, const auto& b) {
+            return depths[a.second] < depths[b.second];
+         });
    }
 
    // Initialize ports first.  This should be fast, so no need to go parallel (also could not hurt really)
    for (std::shared_ptr<mmi::DeviceInstance> pPort : ports)
    {
-      mmi::DeviceModuleLockGuard guard(pPort);
-      LOG_INFO(coreLogger_) << "Will initialize device " << pPort->GetLabel();
-      pPort->Initialize();
-      LOG_INFO(coreLogger_) << "Did initialize device " << pPort->GetLabel();
+      initializeDeviceTimed(pPort, pPort->GetLabel());
    }
 
    // second round, spin up threads to initialize non-port devices, one thread per module
    std::vector<std::future<int>> futures;
    for (auto& moduleDevices : moduleMap) {
-      auto f = std::async(std::launch::async, &CMMCore::initializeVectorOfDevices, this, moduleDevices.second);
+      auto f = std::async(std::launch::async, &CMMCore::initializeVectorOfDevices, this,
+         moduleDevices.second, std::ref(progress));
       futures.push_back(std::move(f));
    }
 
@@ -1127,16 +1311,48 @@ void CMMCore::initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError)
  * This helper function is executed by a single thread, allowing initializeAllDevices to operate multi-threaded.
  * All devices are supposed to originate from the same device adapter
  */
-int CMMCore::initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, std::string>> devicesLabels) {
-   for (auto& deviceLabel : devicesLabels) {
-      mmi::DeviceModuleLockGuard guard(deviceLabel.first);
-      LOG_INFO(coreLogger_) << "Will initialize device " << deviceLabel.second;
-      deviceLabel.first->Initialize();
-      LOG_INFO(coreLogger_) << "Did initialize device " << deviceLabel.second;
+int CMMCore::initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<mmi::DeviceInstance>, std::string>> devicesLabels,
+      DeviceInitProgress& progress) {
+   std::size_t i = 0;
+   try {
+      for (; i < devicesLabels.size(); ++i) {
+         auto& deviceLabel = devicesLabels[i];
+         const std::string& parent = progress.hubs.at(deviceLabel.second);
+         if (!parent.empty() && !progress.WaitFor(parent))
+            throw CMMError("Cannot initialize device " + ToQuotedString(deviceLabel.second) +
+               " because its hub " + ToQuotedString(parent) + " failed to initialize");
+         initializeDeviceTimed(deviceLabel.first, deviceLabel.second);
+         progress.Finish(deviceLabel.second, true);
+      }
+   }
+   catch (...) {
+      // Release the peripherals (in other modules) waiting for our devices
+      for (; i < devicesLabels.size(); ++i)
+         progress.Finish(devicesLabels[i].second, false);
+      throw;
    }
    return DEVICE_OK;
 }
 
+
+/**
+ * Initializes a device, recording the time taken for the report logged by
+ * loadSystemConfiguration().
+ */
+void CMMCore::initializeDeviceTimed(std::shared_ptr<mmi::DeviceInstance> pDevice,
+      const std::string& label)
+{
+   mmi::DeviceModuleLockGuard guard(pDevice);
+   LOG_INFO(coreLogger_) << "Will initialize device " << label;
+   const auto start = std::chrono::steady_clock::now();
+   pDevice->Initialize();
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   LOG_INFO(coreLogger_) << "Did initialize device " << label;
+
+   std::lock_guard<std::mutex> lock(deviceInitTimesMutex_);
+   deviceInitTimes_[label] = elapsed;
+}
+
 /**
  * Update the allowed values for the Core device role properties.
  * 
@@ -1195,8 +1411,7 @@ CMMCore::getDeviceInitializationState(const char* label) const MMCORE_LEGACY_THR
 void CMMCore::updateSystemStateCache()
 {
    LOG_DEBUG(coreLogger_) << "Will update system state cache";
-   Configuration wk = getSystemState();
-   stateCache_->set(wk);
+   stateCache_->set(getSystemState());
    LOG_INFO(coreLogger_) << "Did update system state cache";
 }
 
@@ -1391,6 +1606,9 @@ bool CMMCore::deviceBusy(const char* label) MMCORE_LEGACY_THROW(CMMError)
       return false;
    std::shared_ptr<mmi::DeviceInstance> pDevice = deviceManager_->GetDevice(label);
 
+   const std::optional<bool> reported = pDevice->GetReportedBusy();
+   if (reported.has_value())
+      return *reported;
    mmi::DeviceModuleLockGuard guard(pDevice);
    return pDevice->Busy();
 }
@@ -1526,6 +1744,28 @@ void CMMCore::waitForDevice(std::shared_ptr<mmcore::internal::DeviceInstance> pD
    auto timeout = std::chrono::duration<long long, std::milli>(effectiveTimeoutMs);
    auto deadline = now + timeout;
 
+   auto timedOut = [&]() {
+      std::string label = pDev->GetLabel();
+      std::ostringstream mez;
+      mez << "wait timed out after " << effectiveTimeoutMs << " ms. ";
+      logError(label.c_str(), mez.str().c_str());
+      return CMMError("Wait for device " + ToQuotedString(label) + " timed out after " +
+            ToString(effectiveTimeoutMs) + "ms",
+            MMERR_DevicePollingTimeout);
+   };
+
+   if (pDev->GetReportedBusy().has_value())
+   {
+      // The device reports its busy state (see onDeviceBusyReported()), so
+      // there is no need to poll it
+      std::unique_lock<std::mutex> lock(busyReportMutex_);
+      if (!busyReportCv_.wait_until(lock, deadline,
+            [&] { return !pDev->GetReportedBusy().value_or(false); }))
+         throw timedOut();
+      LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel();
+      return;
+   }
+
    while (true)
    {
       {
@@ -1537,21 +1777,26 @@ void CMMCore::waitForDevice(std::shared_ptr<mmcore::internal::DeviceInstance> pD
       }
 
       if (std::chrono::steady_clock::now() > deadline)
-      {
-         std::string label = pDev->GetLabel();
-         std::ostringstream mez;
-         mez << "wait timed out after " << effectiveTimeoutMs << " ms. ";
-         logError(label.c_str(), mez.str().c_str());
-         throw CMMError("Wait for device " + ToQuotedString(label) + " timed out after " +
-               ToString(effectiveTimeoutMs) + "ms",
-               MMERR_DevicePollingTimeout);
-      }
+         throw timedOut();
 
      sleep(pollingIntervalMs_);
    }
    LOG_DEBUG(coreLogger_) << "Finished waiting for device " << pDev->GetLabel();
 }
 
+/**
+ * Records a busy state reported by a device, and wakes up threads waiting
+ * for the device.
+ */
+void CMMCore::onDeviceBusyReported(std::shared_ptr<mmcore::internal::DeviceInstance> pDev, bool busy)
+{
+   {
+      std::lock_guard<std::mutex> lock(busyReportMutex_);
+      pDev->SetReportedBusy(busy);
+   }
+   busyReportCv_.notify_all();
+}
+
 /**
  * Checks the busy status of the entire system. The system will report busy if any
  * of the devices is busy.
@@ -1576,24 +1821,85 @@ void CMMCore::waitForSystem() MMCORE_LEGACY_THROW(CMMError)
  * Checks the busy status for all devices of the specific type.
  * The system will report busy if any of the devices of the specified type are busy.
  *
+ * Devices that report their busy state to the Core (see
+ * CDeviceBase::OnBusyChanged()) are not polled. If the ParallelBusyPolling
+ * Core property is enabled, devices of different device adapter modules are
+ * polled concurrently.
+ *
  * @return true on busy
  * @param devType   a constant specifying the device type
  */
 bool CMMCore::deviceTypeBusy(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMError)
 {
+   // Devices that report their busy state need not be polled; the others are
+   // polled one module at a time, or all modules concurrently if
+   // ParallelBusyPolling is enabled
+   const bool parallel = parallelBusyPolling_;
+   std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>,
+      std::vector<std::shared_ptr<mmi::DeviceInstance>>> moduleMap;
    std::vector<std::string> devices = deviceManager_->GetDeviceList(devType);
    for (size_t i=0; i<devices.size(); i++)
    {
+      std::shared_ptr<mmi::DeviceInstance> pDevice;
+      try {
+         pDevice = deviceManager_->GetDevice(devices[i]);
+      }
+      catch (...) {
+         // trap all exceptions
+         assert(!"Plugin manager can't access device it reported as available.");
+         continue;
+      }
+      const std::optional<bool> reported = pDevice->GetReportedBusy();
+      if (reported.has_value())
+      {
+         if (*reported)
+            return true;
+         continue;
+      }
+      moduleMap[parallel ? pDevice->GetAdapterModule() : nullptr].push_back(pDevice);
+   }
+
+   if (moduleMap.empty())
+      return false;
+   if (moduleMap.size() == 1)
+   {
+      const std::atomic<bool> stop{false};
+      return moduleDevicesBusy(moduleMap.begin()->second, stop);
+   }
+
+   // One thread per module, as in initializeAllDevices(); the first module
+   // found busy stops the others
+   std::atomic<bool> busy{false};
+   std::vector<std::future<void>> futures;
+   for (auto& moduleDevices : moduleMap)
+   {
+      futures.push_back(std::async(std::launch::async,
+            [this, &moduleDevices, &busy] {
+               if (moduleDevicesBusy(moduleDevices.second, busy))
+                  busy = true;
+            }));
+   }
+   for (auto& fut : futures)
+      fut.wait();
+   return busy;
+}
+
+bool CMMCore::moduleDevicesBusy(
+      const std::vector<std::shared_ptr<mmi::DeviceInstance>>& devices,
+      const std::atomic<bool>& stop)
+{
+   for (const auto& pDevice : devices)
+   {
+      if (stop)
+         return false;
       try {
-         std::shared_ptr<mmi::DeviceInstance> pDevice =
-            deviceManager_->GetDevice(devices[i]);
          mmi::DeviceModuleLockGuard guard(pDevice);
          if (pDevice->Busy())
             return true;
       }
       catch (...) {
          // trap all exceptions
-         assert(!"Plugin manager can't access device it reported as available.");
+         assert(!"Failed to query busy state of device.");
       }
    }
    return false;
@@ -1602,13 +1908,56 @@ bool CMMCore::deviceTypeBusy(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMErro
 
 /**
  * Blocks until all devices of the specific type become ready (not-busy).
+ *
+ * If the ParallelBusyPolling Core property is enabled, devices of different
+ * device adapter modules are waited for concurrently.
+ *
  * @param devType    a constant specifying the device type
  */
 void CMMCore::waitForDeviceType(MM::DeviceType devType) MMCORE_LEGACY_THROW(CMMError)
 {
    std::vector<std::string> devices = deviceManager_->GetDeviceList(devType);
+   if (!parallelBusyPolling_)
+   {
+      for (size_t i=0; i<devices.size(); i++)
+         waitForDevice(devices[i].c_str());
+      return;
+   }
+
+   std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>,
+      std::vector<std::shared_ptr<mmi::DeviceInstance>>> moduleMap;
    for (size_t i=0; i<devices.size(); i++)
-      waitForDevice(devices[i].c_str());
+   {
+      if (IsCoreDeviceLabel(devices[i].c_str()))
+         continue;
+      std::shared_ptr<mmi::DeviceInstance> pDevice =
+         deviceManager_->GetDevice(devices[i]);
+      moduleMap[pDevice->GetAdapterModule()].push_back(pDevice);
+   }
+
+   std::vector<std::future<void>> futures;
+   for (auto& moduleDevices : moduleMap)
+   {
+      futures.push_back(std::async(std::launch::async,
+            [this, &moduleDevices] {
+               for (const auto& pDevice : moduleDevices.second)
+                  waitForDevice(pDevice);
+            }));
+   }
+
+   // Wait for all modules even if one times out (see initializeAllDevices())
+   std::exception_ptr pex;
+   for (auto& fut : futures) {
+      try {
+         fut.get();
+      } catch (const std::exception&) {
+         if (!pex)
+            pex = std::current_exception();
+      }
+   }
+   if (pex) {
+      std::rethrow_exception(pex);
+   }
 }
 
 /**
@@ -2749,11 +3098,11 @@ void CMMCore::snapImage() MMCORE_LEGACY_THROW(CMMError)
             waitForDevice(shutter);
          }
 
-         LOG_DEBUG(coreLogger_) << "Will snap image from current camera";
+         LOG_DEFERRED_DEBUG(coreLogger_, "Will snap image from current camera");
          ret = camera->SnapImage();
          if (ret == DEVICE_OK)
          {
-            LOG_DEBUG(coreLogger_) << "Did snap image from current camera";
+            LOG_DEFERRED_DEBUG(coreLogger_, "Did snap image from current camera");
          }
          else
          {
@@ -3168,8 +3517,12 @@ void CMMCore::initializeCircularBuffer() MMCORE_LEGACY_THROW(CMMError)
             camera->GetImageHeight() *
             camera->GetImageBytesPerPixel()))
       {
-         logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
-         throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
+         std::string msg = getCoreErrorText(MMERR_CircularBufferFailedToInitialize);
+         const std::string reason = cbuf_->GetAllocationStats().error;
+         if (!reason.empty())
+            msg += " (" + reason + ")";
+         logError(getDeviceName(camera).c_str(), msg.c_str());
+         throw CMMError(msg, MMERR_CircularBufferFailedToInitialize);
       }
       cbuf_->Clear();
       callback_->ResetImageInsertionState();
@@ -3178,7 +3531,13 @@ void CMMCore::initializeCircularBuffer() MMCORE_LEGACY_THROW(CMMError)
    {
       throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(), MMERR_CameraNotAvailable);
    }
-   LOG_DEBUG(coreLogger_) << "Circular buffer initialized based on current camera";
+   const auto stats = cbuf_->GetAllocationStats();
+   LOG_DEBUG(coreLogger_) << "Circular buffer initialized based on current camera "
+      "(last allocation took " << stats.milliseconds << " ms, " <<
+      stats.pageFaults << " page faults; huge pages " <<
+      (stats.hugePages ? "on" : "off") << ", NUMA binding " <<
+      (stats.numaBound ? "on" : "off") << ", " << stats.spillFrames <<
+      " frames in spill file)";
 }
 
 /**
@@ -3341,7 +3700,7 @@ void* CMMCore::getLastImageMD(unsigned channel, unsigned slice, Metadata& md) co
    const mmi::FrameBuffer* pBuf = cbuf_->GetTopImageBuffer();
    if (pBuf != 0)
    {
-      md.Restore(pBuf->GetSerializedMetadata().c_str());
+      pBuf->GetMetadata().ToMetadata(md);
       return const_cast<unsigned char*>(pBuf->GetPixels());
    }
    else
@@ -3382,7 +3741,7 @@ void* CMMCore::getNBeforeLastImageMD(unsigned long n, Metadata& md) const MMCORE
    const mmi::FrameBuffer* pBuf = cbuf_->GetNthFromTopImageBuffer(n);
    if (pBuf != 0)
    {
-      md.Restore(pBuf->GetSerializedMetadata().c_str());
+      pBuf->GetMetadata().ToMetadata(md);
       return const_cast<unsigned char*>(pBuf->GetPixels());
    }
    else
@@ -3427,7 +3786,7 @@ void* CMMCore::popNextImageMD(unsigned channel, unsigned slice, Metadata& md) MM
    const mmi::FrameBuffer* pBuf = cbuf_->GetNextImageBuffer();
    if (pBuf != 0)
    {
-      md.Restore(pBuf->GetSerializedMetadata().c_str());
+      pBuf->GetMetadata().ToMetadata(md);
       return const_cast<unsigned char*>(pBuf->GetPixels());
    }
    else
@@ -3443,36 +3802,271 @@ void* CMMCore::popNextImageMD(Metadata& md) MMCORE_LEGACY_THROW(CMMError)
 }
 
 /**
- * Removes all images from the circular buffer.
+ * Gets and removes up to maxCount images (and their metadata) from the
+ * circular buffer.
  *
- * It is rarely necessary to call this directly since starting a sequence
- * acquisition or changing the ROI will always clear the buffer.
+ * Returns handles to the images, oldest first, as popNextFrames() does; the
+ * metadata of image i is md[i]. This amortizes the per-image overhead of
+ * popNextImageMD() (and, in wrapped languages, of crossing into native code)
+ * over the batch. The pixels are not copied: wrappers convert each frame
+ * directly to an array of their own (in MMCoreJ, this function returns one
+ * pixel array per image).
+ *
+ * Throws if the buffer is empty.
  */
-void CMMCore::clearCircularBuffer() MMCORE_LEGACY_THROW(CMMError)
+std::vector<FrameHandle> CMMCore::popNextImagesMD(unsigned maxCount, std::vector<Metadata>& md) MMCORE_LEGACY_THROW(CMMError)
 {
-   cbuf_->Clear();
-   callback_->ResetImageInsertionState();
+   std::vector<FrameHandle> frames = popNextFrames(maxCount);
+   if (frames.empty())
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+
+   md.resize(frames.size());
+   for (std::size_t i = 0; i < frames.size(); ++i)
+      frames[i].getMetadata(md[i]);
+   return frames;
 }
 
 /**
- * Reserve memory for the circular buffer.
+ * Returns a handle to the image that was last inserted into the circular
+ * buffer, without removing it.
+ *
+ * The image's pixels will not be overwritten while the handle (or a copy of
+ * it) exists, so they can be used without copying. See FrameHandle.
  */
-void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
-                                               ) MMCORE_LEGACY_THROW(CMMError)
+FrameHandle CMMCore::getLastFrame() const MMCORE_LEGACY_THROW(CMMError)
 {
-   LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
-      sizeMB << " MB";
-	try
-	{
-		cbuf_ = std::make_unique<mmi::CircularBuffer>(sizeMB);
-	}
-	catch (std::bad_alloc& ex)
-	{
-      // This is an out-of-memory error before even allocating the buffers.
-		std::ostringstream messs;
-		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << '\n';
-		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
-	}
+   return getNBeforeLastFrame(0);
+}
+
+/**
+ * Returns a handle to the image that was inserted n images ago, without
+ * removing it.
+ *
+ * The image's pixels will not be overwritten while the handle (or a copy of
+ * it) exists, so they can be used without copying. See FrameHandle.
+ */
+FrameHandle CMMCore::getNBeforeLastFrame(unsigned long n) const MMCORE_LEGACY_THROW(CMMError)
+{
+   auto lease = cbuf_->LeaseNthFromTopImageBuffer(n);
+   if (!lease)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return FrameHandle(std::move(lease));
+}
+
+/**
+ * Removes the next image from the circular buffer and returns a handle to it.
+ *
+ * This is the counterpart of popNextImageMD() for consumers that process
+ * images in place: the returned pixels will not be overwritten by
+ * subsequently inserted images while the handle (or a copy of it) exists.
+ * See FrameHandle.
+ */
+FrameHandle CMMCore::popNextFrame() MMCORE_LEGACY_THROW(CMMError)
+{
+   auto lease = cbuf_->LeaseNextImageBuffer();
+   if (!lease)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   return FrameHandle(std::move(lease));
+}
+
+/**
+ * Removes up to maxCount images from the circular buffer and returns handles
+ * to them, oldest first.
+ *
+ * This is equivalent to calling popNextFrame() until the buffer is empty or
+ * maxCount images have been retrieved, but the buffer is locked only once.
+ * Returns an empty vector (rather than throwing) if the buffer is empty.
+ */
+std::vector<FrameHandle> CMMCore::popNextFrames(unsigned maxCount)
+{
+   std::vector<std::shared_ptr<mmi::FrameLease>> leases;
+   cbuf_->LeaseNextImageBuffers(maxCount, leases);
+   std::vector<FrameHandle> frames;
+   frames.reserve(leases.size());
+   for (auto& lease : leases)
+      frames.push_back(FrameHandle(std::move(lease)));
+   return frames;
+}
+
+/**
+ * Waits until an image is available in the circular buffer.
+ *
+ * Returns true as soon as popNextImage() (or popNextFrame(), etc.) can
+ * retrieve an image, or false if none became available within timeoutMs
+ * milliseconds. Unlike polling getRemainingImageCount(), this wakes up as
+ * soon as the camera inserts an image and uses no CPU while waiting.
+ *
+ * @param timeoutMs the maximum time to wait, in milliseconds
+ */
+bool CMMCore::waitForNextImage(long timeoutMs) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (timeoutMs < 0)
+      throw CMMError("Timeout must not be negative");
+   return cbuf_->WaitForImage(std::chrono::milliseconds(timeoutMs));
+}
+
+/**
+ * Removes all images from the circular buffer.
+ *
+ * It is rarely necessary to call this directly since starting a sequence
+ * acquisition or changing the ROI will always clear the buffer.
+ */
+void CMMCore::clearCircularBuffer() MMCORE_LEGACY_THROW(CMMError)
+{
+   cbuf_->Clear();
+   callback_->ResetImageInsertionState();
+}
+
+/**
+ * Starts writing the images in the circular buffer to a file.
+ *
+ * Images are removed from the circular buffer as they arrive and written,
+ * on dedicated threads, to a raw stack file at path: the pixels of each
+ * image, in order, with no header or padding. An index file (path + ".idx")
+ * records the offset, size and metadata of each image. Where the file system
+ * supports it, the file is written unbuffered, in large aligned chunks, so
+ * that sustained camera rates can be recorded without the images passing
+ * through the application.
+ *
+ * While streaming, the stream is the consumer of the circular buffer: do not
+ * also retrieve images with popNextImage() and similar functions.
+ * getLastImage() and getLastFrame() can still be used to display images.
+ * Streaming continues across sequence acquisitions until
+ * stopStreamToDisk() is called.
+ *
+ * Existing files at path and path + ".idx" are overwritten.
+ *
+ * @param path the stack file to write
+ */
+void CMMCore::startStreamToDisk(const char* path) MMCORE_LEGACY_THROW(CMMError)
+{
+   if (!path || !*path)
+      throw CMMError("Stream file path must not be empty");
+
+   std::lock_guard<std::mutex> lock(streamWriterMutex_);
+   if (streamWriter_ && !streamWriter_->IsStopped())
+      throw CMMError("Already streaming to " +
+         ToQuotedString(streamWriter_->GetPath()) +
+         "; call stopStreamToDisk() first");
+
+   streamWriter_.reset();
+   try
+   {
+      streamWriter_ = std::make_unique<mmi::FrameStreamWriter>(*cbuf_, path);
+   }
+   catch (const std::bad_alloc&)
+   {
+      throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(),
+         MMERR_OutOfMemory);
+   }
+   LOG_INFO(coreLogger_) << "Started streaming images to " << path <<
+      (streamWriter_->IsUnbuffered() ? " (unbuffered)" : "");
+}
+
+/**
+ * Stops writing images to the file started by startStreamToDisk().
+ *
+ * Images remaining in the circular buffer are written before the files are
+ * closed, so this should normally be called after the sequence acquisition
+ * has stopped. Throws if writing failed (for example, because the disk is
+ * full); the files then contain the images written before the failure.
+ * Does nothing if not streaming.
+ */
+void CMMCore::stopStreamToDisk() MMCORE_LEGACY_THROW(CMMError)
+{
+   std::lock_guard<std::mutex> lock(streamWriterMutex_);
+   if (!streamWriter_ || streamWriter_->IsStopped())
+      return;
+
+   LOG_DEBUG(coreLogger_) << "Will stop streaming images to " <<
+      streamWriter_->GetPath();
+   try
+   {
+      streamWriter_->Stop();
+   }
+   catch (const CMMError& e)
+   {
+      LOG_ERROR(coreLogger_) << e.getMsg();
+      throw;
+   }
+   LOG_INFO(coreLogger_) << "Stopped streaming images to " <<
+      streamWriter_->GetPath() << " (" << streamWriter_->GetFramesWritten() <<
+      " images, " << streamWriter_->GetThroughputMBps() << " MB/s)";
+}
+
+/**
+ * Returns whether images are being written to disk.
+ *
+ * Returns false if writing failed; stopStreamToDisk() then reports the
+ * error.
+ */
+bool CMMCore::isStreamingToDisk()
+{
+   std::lock_guard<std::mutex> lock(streamWriterMutex_);
+   return streamWriter_ && streamWriter_->IsActive();
+}
+
+/**
+ * Returns the number of images written to disk by the current (or last)
+ * stream.
+ */
+long long CMMCore::getStreamToDiskImageCount()
+{
+   std::lock_guard<std::mutex> lock(streamWriterMutex_);
+   if (!streamWriter_)
+      return 0;
+   return static_cast<long long>(streamWriter_->GetFramesWritten());
+}
+
+/**
+ * Returns the sustained rate, in MB/s, at which the current (or last) stream
+ * has written images to disk.
+ *
+ * This is the average since the first image arrived. If it stays below the
+ * camera's data rate, the circular buffer fills up and images will be lost
+ * (or the acquisition will stop on overflow).
+ */
+double CMMCore::getStreamToDiskThroughput()
+{
+   std::lock_guard<std::mutex> lock(streamWriterMutex_);
+   if (!streamWriter_)
+      return 0.0;
+   return streamWriter_->GetThroughputMBps();
+}
+
+/**
+ * Reserve memory for the circular buffer.
+ */
+void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
+                                               ) MMCORE_LEGACY_THROW(CMMError)
+{
+   // Held until the new buffer is initialized, so that streaming cannot
+   // start on the buffer being replaced
+   std::lock_guard<std::mutex> streamLock(streamWriterMutex_);
+   if (streamWriter_ && !streamWriter_->IsStopped())
+      throw CMMError("Cannot change the circular buffer size while "
+         "streaming to disk");
+   if (cbuf_->HasOpenWriteSlots())
+      throw CMMError("Cannot change the circular buffer size while a camera "
+         "is writing an image into it");
+
+   LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
+      sizeMB << " MB";
+	try
+	{
+		const auto engine = cbuf_->GetEngine();
+		const auto storageOptions = cbuf_->GetStorageOptions();
+		cbuf_ = std::make_unique<mmi::CircularBuffer>(sizeMB, threadPool_);
+		cbuf_->SetEngine(engine);
+		cbuf_->SetStorageOptions(storageOptions);
+	}
+	catch (std::bad_alloc& ex)
+	{
+      // This is an out-of-memory error before even allocating the buffers.
+		std::ostringstream messs;
+		messs << getCoreErrorText(MMERR_OutOfMemory).c_str() << " " << ex.what() << '\n';
+		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
+	}
 
 
 	try
@@ -3504,6 +4098,114 @@ void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
       throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
 }
 
+namespace {
+
+const char* const g_CircularBufferEngine_Mutex = "Mutex";
+const char* const g_CircularBufferEngine_LockFree = "LockFree";
+const char* const g_CircularBufferStorage_Heap = "Heap";
+const char* const g_CircularBufferStorage_Arena = "Arena";
+
+} // anonymous namespace
+
+void CMMCore::setCircularBufferEngineInternal(const std::string& engine)
+{
+   if (isSequenceRunning())
+      throw CMMError("Cannot switch circular buffer engine while sequence "
+            "acquisition is running");
+
+   const auto newEngine = (engine == g_CircularBufferEngine_LockFree) ?
+      mmi::CircularBuffer::Engine::LockFree :
+      mmi::CircularBuffer::Engine::Mutex;
+   if (newEngine == cbuf_->GetEngine())
+      return;
+   if (cbuf_->HasOpenWriteSlots())
+      throw CMMError("Cannot switch circular buffer engine while a camera "
+            "is writing an image into the buffer");
+
+   // Switching discards any images in the buffer
+   cbuf_->SetEngine(newEngine);
+   callback_->ResetImageInsertionState();
+   LOG_INFO(coreLogger_) << "Circular buffer engine set to " << engine;
+}
+
+// Storage options take effect when the circular buffer is next initialized
+// (explicitly, or by starting a sequence acquisition), at which point the
+// frames are reallocated.
+void CMMCore::setCircularBufferStorageInternal(const char* propName,
+      const std::string& value)
+{
+   if (isSequenceRunning())
+      throw CMMError("Cannot change circular buffer storage while sequence "
+            "acquisition is running");
+
+   auto options = cbuf_->GetStorageOptions();
+   const std::string name = propName;
+   if (name == MM::g_Keyword_CoreCircularBufferStorage)
+   {
+      options.storage = (value == g_CircularBufferStorage_Arena) ?
+         mmi::CircularBuffer::Storage::Arena :
+         mmi::CircularBuffer::Storage::Heap;
+   }
+   else if (name == MM::g_Keyword_CoreCircularBufferHugePages)
+   {
+      options.arena.hugePages = (value == "1");
+   }
+   else if (name == MM::g_Keyword_CoreCircularBufferPrefault)
+   {
+      options.arena.prefault = (value == "1");
+   }
+   else if (name == MM::g_Keyword_CoreCircularBufferNumaNode)
+   {
+      int node;
+      try {
+         node = std::stoi(value);
+      } catch (const std::exception&) {
+         node = -2;
+      }
+      if (node < -1)
+         throw CMMError("CircularBufferNumaNode must be a node number, or -1 "
+               "for default placement", MMERR_InvalidCoreValue);
+      options.arena.numaNode = node;
+   }
+   else if (name == MM::g_Keyword_CoreCircularBufferSpillDirectory)
+   {
+      options.spillDirectory = value;
+   }
+   else if (name == MM::g_Keyword_CoreCircularBufferSpillSizeMB)
+   {
+      long long sizeMB;
+      try {
+         sizeMB = std::stoll(value);
+      } catch (const std::exception&) {
+         sizeMB = -1;
+      }
+      if (sizeMB < 0)
+         throw CMMError("CircularBufferSpillSizeMB must be a non-negative "
+               "integer", MMERR_InvalidCoreValue);
+      options.spillSizeMB = static_cast<std::size_t>(sizeMB);
+   }
+   cbuf_->SetStorageOptions(options);
+   LOG_INFO(coreLogger_) << "Circular buffer " << name << " set to " <<
+      value << "; will take effect when the buffer is next initialized";
+}
+
+void CMMCore::setThreadPoolInternal(unsigned threadCount, bool pinned)
+{
+   if (threadCount == threadPoolSize_ && pinned == threadPoolPinned_)
+      return;
+
+   // Users of the old pool finish their current work on it and then switch;
+   // the old pool is destroyed when the last of them lets go of it.
+   auto pool = std::make_shared<mmi::ThreadPool>(threadCount, pinned);
+   threadPool_ = pool;
+   threadPoolSize_ = threadCount;
+   threadPoolPinned_ = pinned;
+   cbuf_->SetThreadPool(pool);
+   LOG_INFO(coreLogger_) << "Thread pool recreated with " << pool->GetSize() <<
+      " threads" << (pinned ? (pool->IsPinned() ? ", pinned to CPUs" :
+         " (could not pin to CPUs)") : "");
+}
+
 /**
  * Returns the size of the Circular Buffer in MB
  */
@@ -5022,7 +5724,7 @@ void CMMCore::setState(const char* deviceLabel, long state) MMCORE_LEGACY_THROW(
       deviceManager_->GetDeviceOfType<mmi::StateInstance>(deviceLabel);
    mmi::DeviceModuleLockGuard guard(pStateDev);
 
-   LOG_DEBUG(coreLogger_) << "Will set " << deviceLabel << " to state " << state;
+   LOG_DEFERRED_DEBUG(coreLogger_, "Will set ", deviceLabel, " to state ", state);
    int nRet = pStateDev->SetPosition(state);
    if (nRet != DEVICE_OK)
       throw CMMError(getDeviceErrorText(nRet, pStateDev));
@@ -5037,7 +5739,7 @@ void CMMCore::setState(const char* deviceLabel, long state) MMCORE_LEGACY_THROW(
       stateCache_->addSetting(PropertySetting(deviceLabel, MM::g_Keyword_Label, posLbl.c_str()));
    }
 
-   LOG_DEBUG(coreLogger_) << "Did set " << deviceLabel << " to state " << state;
+   LOG_DEFERRED_DEBUG(coreLogger_, "Did set ", deviceLabel, " to state ", state);
 }
 
 /**
@@ -5095,11 +5797,11 @@ void CMMCore::setStateLabel(const char* deviceLabel, const char* stateLabel) MMC
    CheckStateLabel(stateLabel);
 
    mmi::DeviceModuleLockGuard guard(pStateDev);
-   LOG_DEBUG(coreLogger_) << "Will set " << deviceLabel << " to label " << stateLabel;
+   LOG_DEFERRED_DEBUG(coreLogger_, "Will set ", deviceLabel, " to label ", stateLabel);
    int nRet = pStateDev->SetPosition(stateLabel);
    if (nRet != DEVICE_OK)
       throw CMMError(getDeviceErrorText(nRet, pStateDev));
-   LOG_DEBUG(coreLogger_) << "Did set " << deviceLabel << " to label " << stateLabel;
+   LOG_DEFERRED_DEBUG(coreLogger_, "Did set ", deviceLabel, " to label ", stateLabel);
 
    if (pStateDev->HasProperty(MM::g_Keyword_Label))
    {
@@ -5256,6 +5958,8 @@ void CMMCore::deleteConfigGroup(const char* groupName) MMCORE_LEGACY_THROW(CMMEr
    if (!configGroups_->Delete(groupName))
       throw CMMError(ToQuotedString(groupName) + ": " + getCoreErrorText(MMERR_NoConfigGroup),
             MMERR_NoConfigGroup);
+   stateCache_->forgetPresets(SynchronizedConfiguration::Presets::ConfigGroup,
+         groupName);
 
    if (!isGroupDefined(getChannelGroup().c_str()))
       setChannelGroup("");
@@ -5274,6 +5978,8 @@ void CMMCore::renameConfigGroup(const char* oldGroupName, const char* newGroupNa
    if (!configGroups_->RenameGroup(oldGroupName, newGroupName))
       throw CMMError(ToQuotedString(oldGroupName) + ": " + getCoreErrorText(MMERR_NoConfigGroup),
             MMERR_NoConfigGroup);
+   stateCache_->forgetPresets(SynchronizedConfiguration::Presets::ConfigGroup,
+         oldGroupName);
 
    LOG_DEBUG(coreLogger_) << "Renamed config group " << oldGroupName <<
       " to " << newGroupName;
@@ -5545,6 +6251,14 @@ void CMMCore::setPixelSizeConfig(const char* resolutionID) MMCORE_LEGACY_THROW(C
  * Applies a configuration to a group. The command will fail if the
  * configuration was not previously defined.
  *
+ * Properties that fail to be set are retried after the others.
+ *
+ * If the Core property ParallelConfigApply is "1", the properties of devices
+ * in different device adapters are set concurrently, and this waits for the
+ * devices to become non-busy (as waitForConfig() does) before returning.
+ * In this mode, properties that needed a retry are also set after the others
+ * from then on, until devices are unloaded or a configuration is loaded.
+ *
  * @param groupName   the configuration group name
  * @param configName  the configuration preset name
  */
@@ -5707,21 +6421,7 @@ std::string CMMCore::getCurrentConfig(const char* groupName) MMCORE_LEGACY_THROW
 {
    CheckConfigGroupName(groupName);
 
-   std::vector<std::string> cfgs = configGroups_->GetAvailableConfigs(groupName);
-   if (cfgs.empty())
-      return "";
-
-   Configuration curState = getConfigGroupState(groupName, false);
-
-   for (size_t i=0; i<cfgs.size(); i++)
-   {
-      Configuration* pCfg = configGroups_->Find(groupName, cfgs[i].c_str());
-      if (pCfg && curState.isConfigurationIncluded(*pCfg))
-         return cfgs[i];
-   }
-
-   // no match
-   return "";
+   return matchConfigGroupState(groupName, false);
 }
 
 /**
@@ -5731,27 +6431,35 @@ std::string CMMCore::getCurrentConfig(const char* groupName) MMCORE_LEGACY_THROW
  * Also, in general it is possible that the system state fits multiple configurations.
  * This method will return only the first matching configuration, if any.
  *
+ * The match is kept up to date as the cache changes, so this does not
+ * compare each preset to the cache.
+ *
  * @return The cache's current configuration preset name
  */
 std::string CMMCore::getCurrentConfigFromCache(const char* groupName) MMCORE_LEGACY_THROW(CMMError)
 {
    CheckConfigGroupName(groupName);
 
-   std::vector<std::string> cfgs = configGroups_->GetAvailableConfigs(groupName);
-   if (cfgs.empty())
+   const ConfigGroup* presets = configGroups_->FindGroup(groupName);
+   if (!presets || presets->IsEmpty())
       return "";
 
-   Configuration curState = getConfigGroupState(groupName, true);
+   // Core properties are not cached; they are read each time
+   const std::vector<PropertyKey> coreProps = stateCache_->compilePresets(
+         SynchronizedConfiguration::Presets::ConfigGroup, groupName,
+         *presets, MM::g_Keyword_CoreDevice);
+   std::vector<std::string> coreValues;
+   for (const PropertyKey& prop : coreProps)
+      coreValues.push_back(properties_->Get(prop.second.c_str()));
 
-   for (size_t i=0; i<cfgs.size(); i++)
-   {
-      Configuration* pCfg = configGroups_->Find(groupName, cfgs[i].c_str());
-      if (pCfg && curState.isConfigurationIncluded(*pCfg))
-         return cfgs[i];
-   }
+   std::optional<std::string> match = stateCache_->matchPresets(
+         SynchronizedConfiguration::Presets::ConfigGroup, groupName,
+         coreValues, true);
+   if (match)
+      return *match;
 
-   // no match
-   return "";
+   // Some properties are missing from the cache (normally throws)
+   return matchConfigGroupState(groupName, true);
 }
 
 /**
@@ -5855,61 +6563,37 @@ std::string CMMCore::getCurrentPixelSizeConfig() MMCORE_LEGACY_THROW(CMMError)
  **/
 std::string CMMCore::getCurrentPixelSizeConfig(bool cached) MMCORE_LEGACY_THROW(CMMError)
 {
-   // get a list of configuration names
-   std::vector<std::string> cfgs = pixelSizeGroup_->GetAvailable();
-   if (cfgs.empty())
+   if (pixelSizeGroup_->IsEmpty())
       return "";
 
-   // create a union of configuration settings used in this group
-   // and obtain the current state of the system
-   Configuration curState;
-   for (size_t i=0; i<cfgs.size(); i++) {
-      PixelSizeConfiguration* cfgData = pixelSizeGroup_->Find(cfgs[i].c_str());
-      assert(cfgData);
-      for (size_t j=0; j < cfgData->size(); j++)
-      {
-         PropertySetting cs = cfgData->getSetting(j); // config setting
-         const auto deviceLabel = cs.getDeviceLabel();
-         const auto propName = cs.getPropertyName();
-         if (!curState.isPropertyIncluded(deviceLabel.c_str(), propName.c_str()))
-         {
-            std::string value;
-            if (!cached)
-            {
-               try
-               {
-                  value = getProperty(deviceLabel.c_str(), propName.c_str());
-               }
-               catch (CMMError& err)
-               {
-                  logError(deviceLabel.c_str(), err.getMsg().c_str());
-                  continue;
-               }
-            }
-            else
-            {
-               auto s = stateCache_->getSetting(deviceLabel.c_str(), propName.c_str());
-               if (!s)
-                  continue;
-               value = s->getPropertyValue();
-            }
-            PropertySetting ss(deviceLabel.c_str(), propName.c_str(), value.c_str()); // state setting
-            curState.addSetting(ss);
-         }
-      }
+   const auto kind = SynchronizedConfiguration::Presets::PixelSize;
+   stateCache_->compilePresets(kind, "", *pixelSizeGroup_);
+
+   if (cached)
+   {
+      // Properties missing from the cache match no preset
+      return stateCache_->matchPresets(kind, "", {}, false).value_or("");
    }
 
-   // check which one matches the current state
-   for (size_t i=0; i<cfgs.size(); i++)
+   // obtain the current state of the properties used in any preset
+   const std::vector<PropertyKey> props = stateCache_->getPresetProperties(kind, "");
+   std::vector<std::optional<std::string>> values;
+   values.reserve(props.size());
+   for (const PropertyKey& prop : props)
    {
-      PixelSizeConfiguration* pCfg = pixelSizeGroup_->Find(cfgs[i].c_str());
-      if (pCfg && curState.isConfigurationIncluded(*pCfg))
+      try
       {
-		 return cfgs[i];
+         values.push_back(getProperty(prop.first.c_str(), prop.second.c_str()));
+      }
+      catch (CMMError& err)
+      {
+         logError(prop.first.c_str(), err.getMsg().c_str());
+         values.push_back(std::nullopt);
       }
    }
 
-   return "";
+   // check which one matches the current state
+   return stateCache_->matchPresets(kind, "", values);
 }
 
 /**
@@ -7621,8 +8305,8 @@ void CMMCore::saveSystemConfiguration(const char* fileName) MMCORE_LEGACY_THROW(
  * Format specification:
  * Each line consists of a number of string fields separated by "," (comma) characters.
  * Lines beginning with "#" are ignored (can be used for comments).
- * Each line in the file will be parsed by the system and as a result a corresponding command
- * will be immediately executed.
+ * The whole file is parsed (and the number of fields of each line checked) before
+ * the commands are executed, in order.
  * The first field in the line always specifies the command from the following set of values:
  *    Device - executes loadDevice()
  *    Label - executes defineStateLabel() command
@@ -7632,6 +8316,10 @@ void CMMCore::saveSystemConfiguration(const char* fileName) MMCORE_LEGACY_THROW(
  * The remaining fields in the line will be used for corresponding command parameters.
  * The number of parameters depends on the actual command used.
  *
+ * When done, the time spent loading, initializing, and setting properties of
+ * each device is logged. See also the "ParallelConfigurationLoading" feature
+ * (enableFeature()).
+ *
  * This function is not thread-safe.
  */
 void CMMCore::loadSystemConfiguration(const char* fileName) MMCORE_LEGACY_THROW(CMMError)
@@ -7672,12 +8360,80 @@ void CMMCore::loadSystemConfiguration(const char* fileName) MMCORE_LEGACY_THROW(
 }
 
 
+namespace {
+
+// A (non-comment) line of a system configuration file
+struct ConfigCommand
+{
+   int lineNumber = 0;
+   std::string line;
+   std::vector<std::string> tokens;
+};
+
+// Whether the line has the right number of fields for its command. Lines
+// with unknown commands are valid (and ignored).
+bool IsValidConfigCommand(const std::vector<std::string>& tokens)
+{
+   // Allowed numbers of fields, including the command
+   static const std::map<std::string, std::vector<std::size_t>> fieldCounts = {
+      {MM::g_CFGCommand_Device, {4}},
+      {MM::g_CFGCommand_Property, {3, 4}}, // Missing value means empty
+      {MM::g_CFGCommand_Delay, {3}},
+      {MM::g_CFGCommand_FocusDirection, {3}},
+      {MM::g_CFGCommand_Label, {4}},
+      {MM::g_CFGCommand_Configuration, {5}},
+      {MM::g_CFGCommand_ConfigGroup, {2, 5, 6}},
+      {MM::g_CFGCommand_ConfigPixelSize, {5}},
+      {MM::g_CFGCommand_PixelSize_um, {3}},
+      {MM::g_CFGCommand_PixelSizeAffine, {8}},
+      {MM::g_CFGCommand_PixelSizedxdz, {3}},
+      {MM::g_CFGCommand_PixelSizedydz, {3}},
+      {MM::g_CFGCommand_PixelSizeOptimalZUm, {3}},
+      {MM::g_CFGCommand_Equipment, {}}, // Property blocks have been removed
+      {MM::g_CFGCommand_ImageSynchro, {}}, // ImageSynchro has been removed
+      {MM::g_CFGCommand_ParentID, {3}},
+   };
+
+   if (tokens.empty())
+      return false;
+   auto it = fieldCounts.find(tokens[0]);
+   if (it == fieldCounts.end())
+      return true;
+   return std::find(it->second.begin(), it->second.end(), tokens.size()) !=
+      it->second.end();
+}
+
+bool IsDevicePropertyCommand(const ConfigCommand& cmd)
+{
+   return cmd.tokens[0] == MM::g_CFGCommand_Property &&
+      cmd.tokens[1] != MM::g_Keyword_CoreDevice;
+}
+
+CMMError ConfigLineError(const ConfigCommand& cmd, const CMMError& err)
+{
+   std::ostringstream errorText;
+   errorText << "Line " << cmd.lineNumber << ": " << cmd.line << '\n';
+   errorText << err.getFullMsg() << "\n\n";
+   return CMMError(errorText.str().c_str(), MMERR_InvalidConfigurationFile);
+}
+
+double ToMs(std::chrono::steady_clock::duration d)
+{
+   return std::chrono::duration<double, std::milli>(d).count();
+}
+
+} // anonymous namespace
+
 void CMMCore::loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_THROW(CMMError)
 {
+   using Clock = std::chrono::steady_clock;
+
    if (!fileName)
       throw CMMError("Null filename");
 
    LOG_INFO(coreLogger_) << "Loading system configuration from:" << ToQuotedString(fileName);
+   const auto loadStart = Clock::now();
+   forgetApplyRetries();
 
    std::ifstream is;
    is.open(fileName, std::ios_base::in);
@@ -7688,10 +8444,11 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_TH
             MMERR_FileOpenFailed);
    }
 
-   // Process commands
+   // Parse the whole file first, so that malformed lines are reported before
+   // any device is loaded
    const int maxLineLength = 4 * MM::MaxStrLength + 4; // accommodate up to 4 strings and delimiters
    char line[maxLineLength+1];
-   std::vector<std::string> tokens;
+   std::vector<ConfigCommand> plan;
 
    int lineCount = 0;
 
@@ -7702,213 +8459,131 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_TH
       il.getline(line, maxLineLength, '\r');
 
       lineCount++;
-      if (strlen(line) > 0)
-      {
-         if (line[0] == '#')
-         {
-            // comment, so skip processing
-            continue;
-         }
+      if (strlen(line) == 0 || line[0] == '#') // comment, so skip processing
+         continue;
 
-         // parse tokens
-         tokens.clear();
-         CDeviceUtils::Tokenize(line, tokens, MM::g_FieldDelimiters);
+      ConfigCommand cmd;
+      cmd.lineNumber = lineCount;
+      cmd.line = line;
+      CDeviceUtils::Tokenize(line, cmd.tokens, MM::g_FieldDelimiters);
+      if (!IsValidConfigCommand(cmd.tokens))
+         throw ConfigLineError(cmd, CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) +
+               " (" + ToQuotedString(line) + ")", MMERR_InvalidCFGEntry));
+      plan.push_back(std::move(cmd));
+   }
 
-         try
-         {
+   const bool parallel = mmi::features::flags().ParallelConfigurationLoading;
+   {
+      std::lock_guard<std::mutex> lock(deviceInitTimesMutex_);
+      deviceInitTimes_.clear();
+   }
 
-            // non-empty and non-comment lines mush have at least one token
-            if (tokens.size() < 1)
-               throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                     ToQuotedString(line) + ")",
-                     MMERR_InvalidCFGEntry);
+   // Loading the modules is typically a good part of the loading time
+   std::map<std::string, Clock::duration> moduleLoadTimes;
+   if (parallel)
+   {
+      std::vector<std::string> modules;
+      for (const auto& cmd : plan)
+      {
+         if (cmd.tokens[0] == MM::g_CFGCommand_Device)
+            modules.push_back(cmd.tokens[2]);
+      }
+      moduleLoadTimes = pluginManager_->LoadDeviceAdapters(modules);
+   }
 
-            if(tokens[0].compare(MM::g_CFGCommand_Device) == 0)
-            {
-               // load device command
-               // -------------------
-               if (tokens.size() != 4)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-               loadDevice(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str());
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_Property) == 0)
-            {
-               // set property command
-               // --------------------
-               if (tokens.size() == 4)
-                  setProperty(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str());
-               else if (tokens.size() == 3)
-                  // ...assuming here that the last missing toke represents an empty string
-                  setProperty(tokens[1].c_str(), tokens[2].c_str(), "");
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_Delay) == 0)
-            {
-               // set delay command
-               // -----------------
-               if (tokens.size() != 3)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-               setDeviceDelayMs(tokens[1].c_str(), atof(tokens[2].c_str()));
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_FocusDirection) == 0)
-            {
-               // set focus direction command
-               // ---------------------------
-               if (tokens.size() != 3)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-               setFocusDirection(tokens[1].c_str(), atol(tokens[2].c_str()));
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_Label) == 0)
-            {
-               // define label command
-               // --------------------
-               if (tokens.size() != 4)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-               defineStateLabel(tokens[1].c_str(), atol(tokens[2].c_str()), tokens[3].c_str());
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_Configuration) == 0)
-            {
-               // define configuration command
-               // ----------------------------
-               if (tokens.size() != 5)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-               LOG_WARNING(coreLogger_) << "Obsolete command " << tokens[0] <<
-                  " ignored in configuration file";
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_ConfigGroup) == 0)
+   // Time spent in the Device and Property lines of each device
+   std::map<std::string, Clock::duration> deviceLoadTimes;
+   std::map<std::string, Clock::duration> propertyTimes;
+   std::map<std::string, std::string> deviceModules;
+   std::mutex propertyTimesMutex;
+
+   for (std::size_t i = 0; i < plan.size(); )
+   {
+      const ConfigCommand& cmd = plan[i];
+
+      // Property lines following device initialization are usually sent to
+      // the hardware; those of different modules are applied concurrently,
+      // keeping file order within each module.
+      if (parallel && initialized_ && IsDevicePropertyCommand(cmd))
+      {
+         std::size_t end = i + 1;
+         while (end < plan.size() && IsDevicePropertyCommand(plan[end]))
+            ++end;
+         if (end - i > 1)
+         {
+            std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>,
+               std::vector<const ConfigCommand*>> moduleCommands;
+            for (std::size_t j = i; j < end; ++j)
             {
-               // define grouped configuration command
-               // ------------------------------------
-               if (tokens.size() == 6)
-                  defineConfig(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str(), tokens[4].c_str(), tokens[5].c_str());
-               else if (tokens.size() == 5)
-               {
-                  // we will assume here that the last (missing) token is representing an empty string
-                  defineConfig(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str(), tokens[4].c_str(), "");
+               std::shared_ptr<mmi::DeviceInstance> pDevice;
+               try {
+                  pDevice = deviceManager_->GetDevice(plan[j].tokens[1]);
                }
-               else if (tokens.size() == 2)
-                  defineConfigGroup(tokens[1].c_str());
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_ConfigPixelSize) == 0)
-            {
-               // define pixel size configuration command
-               // ---------------------------------------
-               if (tokens.size() == 5)
-                  definePixelSizeConfig(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str(), tokens[4].c_str());
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_PixelSize_um) == 0)
-            {
-               // set pixel size
-               // --------------
-               if (tokens.size() == 3)
-                  setPixelSizeUm(tokens[1].c_str(), atof(tokens[2].c_str()));
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_PixelSizeAffine) == 0)
-            {
-               // set affine transform
-               // --------------
-               //
-               if (tokens.size() == 8)
-               {
-                  std::vector<double> affineT(6);
-                  for (int i = 0; i < 6; i++)
-                  {
-                     affineT[i] = std::atof(tokens[i + 2].c_str());
-                  }
-                  setPixelSizeAffine(tokens[1].c_str(), affineT);
+               catch (const CMMError& err) {
+                  throw ConfigLineError(plan[j], err);
                }
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if (tokens[0].compare(MM::g_CFGCommand_PixelSizedxdz) == 0)
-            {
-               if (tokens.size() == 3)
-                  setPixelSizedxdz(tokens[1].c_str(), atof(tokens[2].c_str()));
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if (tokens[0].compare(MM::g_CFGCommand_PixelSizedydz) == 0)
-            {
-               if (tokens.size() == 3)
-                  setPixelSizedydz(tokens[1].c_str(), atof(tokens[2].c_str()));
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if (tokens[0].compare(MM::g_CFGCommand_PixelSizeOptimalZUm) == 0)
-            {
-               if (tokens.size() == 3)
-                  setPixelSizeOptimalZUm(tokens[1].c_str(), atof(tokens[2].c_str()));
-               else
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_Equipment) == 0)
-            {
-              // Property blocks have been removed
-              throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                    ToQuotedString(line) + ")",
-                    MMERR_InvalidCFGEntry);
+               moduleCommands[pDevice->GetAdapterModule()].push_back(&plan[j]);
             }
-            else if(tokens[0].compare(MM::g_CFGCommand_ImageSynchro) == 0)
+
+            // Report the error of the earliest failing line
+            const ConfigCommand* failedCmd = nullptr;
+            std::unique_ptr<CMMError> failure;
+            std::vector<std::future<void>> futures;
+            for (const auto& commands : moduleCommands)
             {
-               // ImageSynchro has been removed
-               throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                     ToQuotedString(line) + ")",
-                     MMERR_InvalidCFGEntry);
-            }
-            else if(tokens[0].compare(MM::g_CFGCommand_ParentID) == 0)
-            {
-               // set parent ID
-               // -------------
-               if (tokens.size() != 3)
-                  throw CMMError(getCoreErrorText(MMERR_InvalidCFGEntry) + " (" +
-                        ToQuotedString(line) + ")",
-                        MMERR_InvalidCFGEntry);
-
-               setParentLabel(tokens[1].c_str(), tokens[2].c_str());
+               futures.push_back(std::async(std::launch::async,
+                  [&, commands = commands.second] {
+                     for (const ConfigCommand* c : commands)
+                     {
+                        const auto start = Clock::now();
+                        try {
+                           setProperty(c->tokens[1].c_str(), c->tokens[2].c_str(),
+                              c->tokens.size() == 4 ? c->tokens[3].c_str() : "");
+                        }
+                        catch (const CMMError& err) {
+                           std::lock_guard<std::mutex> lock(propertyTimesMutex);
+                           if (!failedCmd || c->lineNumber < failedCmd->lineNumber)
+                           {
+                              failedCmd = c;
+                              failure = std::make_unique<CMMError>(err);
+                           }
+                           return;
+                        }
+                        std::lock_guard<std::mutex> lock(propertyTimesMutex);
+                        propertyTimes[c->tokens[1]] += Clock::now() - start;
+                     }
+                  }));
             }
+            for (auto& fut : futures)
+               fut.get();
+            if (failedCmd)
+               throw ConfigLineError(*failedCmd, *failure);
 
-         }
-         catch (CMMError& err)
-         {
-            std::ostringstream errorText;
-            errorText << "Line " << lineCount << ": " << line << '\n';
-            errorText << err.getFullMsg() << "\n\n";
-            throw CMMError(errorText.str().c_str(), MMERR_InvalidConfigurationFile);
+            i = end;
+            continue;
          }
       }
+
+      const auto start = Clock::now();
+      try
+      {
+         executeConfigCommand(cmd.tokens);
+      }
+      catch (const CMMError& err)
+      {
+         throw ConfigLineError(cmd, err);
+      }
+      const auto elapsed = Clock::now() - start;
+      if (cmd.tokens[0] == MM::g_CFGCommand_Device)
+      {
+         deviceLoadTimes[cmd.tokens[1]] += elapsed;
+         deviceModules[cmd.tokens[1]] = cmd.tokens[2];
+      }
+      else if (IsDevicePropertyCommand(cmd))
+      {
+         propertyTimes[cmd.tokens[1]] += elapsed;
+      }
+      ++i;
    }
 
    // file parsing finished, try to set startup configuration
@@ -7924,6 +8599,131 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_TH
 
    waitForSystem();
    updateSystemStateCache();
+
+   // Startup timing report, longest first
+   struct DeviceTimes {
+      std::string label;
+      Clock::duration load{}, init{}, properties{}, total{};
+   };
+   std::map<std::string, DeviceTimes> byLabel;
+   for (const auto& t : deviceLoadTimes)
+      byLabel[t.first].load = t.second;
+   {
+      std::lock_guard<std::mutex> lock(deviceInitTimesMutex_);
+      for (const auto& t : deviceInitTimes_)
+         byLabel[t.first].init = t.second;
+   }
+   for (const auto& t : propertyTimes)
+      byLabel[t.first].properties = t.second;
+   std::vector<DeviceTimes> rows;
+   for (auto& entry : byLabel)
+   {
+      DeviceTimes& row = entry.second;
+      row.label = entry.first;
+      row.total = row.load + row.init + row.properties;
+      rows.push_back(row);
+   }
+   std::stable_sort(rows.begin(), rows.end(),
+      [](const DeviceTimes& a, const DeviceTimes& b) { return a.total > b.total; });
+
+   std::ostringstream report;
+   report << std::fixed << std::setprecision(1);
+   report << "System configuration loaded in " << ToMs(Clock::now() - loadStart) <<
+      " ms; time per device (ms):";
+   for (const auto& row : rows)
+   {
+      report << "\n  " << row.label;
+      auto module = deviceModules.find(row.label);
+      if (module != deviceModules.end())
+         report << " (" << module->second << ")";
+      report << ": total " << ToMs(row.total) << ", load " << ToMs(row.load) <<
+         ", initialize " << ToMs(row.init) << ", properties " <<
+         ToMs(row.properties);
+   }
+   if (!moduleLoadTimes.empty())
+   {
+      report << "\nDevice adapter modules loaded in parallel (ms):";
+      for (const auto& t : moduleLoadTimes)
+         report << "\n  " << t.first << ": " << ToMs(t.second);
+   }
+   LOG_INFO(coreLogger_) << report.str();
+}
+
+
+/**
+ * Executes a (validated) command line of the system configuration file.
+ */
+void CMMCore::executeConfigCommand(const std::vector<std::string>& tokens) MMCORE_LEGACY_THROW(CMMError)
+{
+   const std::string& command = tokens[0];
+   if (command == MM::g_CFGCommand_Device)
+   {
+      loadDevice(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str());
+   }
+   else if (command == MM::g_CFGCommand_Property)
+   {
+      // A missing last token represents an empty string
+      setProperty(tokens[1].c_str(), tokens[2].c_str(),
+            tokens.size() == 4 ? tokens[3].c_str() : "");
+   }
+   else if (command == MM::g_CFGCommand_Delay)
+   {
+      setDeviceDelayMs(tokens[1].c_str(), atof(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_FocusDirection)
+   {
+      setFocusDirection(tokens[1].c_str(), atol(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_Label)
+   {
+      defineStateLabel(tokens[1].c_str(), atol(tokens[2].c_str()), tokens[3].c_str());
+   }
+   else if (command == MM::g_CFGCommand_Configuration)
+   {
+      LOG_WARNING(coreLogger_) << "Obsolete command " << command <<
+         " ignored in configuration file";
+   }
+   else if (command == MM::g_CFGCommand_ConfigGroup)
+   {
+      if (tokens.size() == 2)
+         defineConfigGroup(tokens[1].c_str());
+      else // A missing last token represents an empty string
+         defineConfig(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str(),
+               tokens[4].c_str(), tokens.size() == 6 ? tokens[5].c_str() : "");
+   }
+   else if (command == MM::g_CFGCommand_ConfigPixelSize)
+   {
+      definePixelSizeConfig(tokens[1].c_str(), tokens[2].c_str(), tokens[3].c_str(), tokens[4].c_str());
+   }
+   else if (command == MM::g_CFGCommand_PixelSize_um)
+   {
+      setPixelSizeUm(tokens[1].c_str(), atof(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_PixelSizeAffine)
+   {
+      std::vector<double> affineT(6);
+      for (int i = 0; i < 6; i++)
+      {
+         affineT[i] = std::atof(tokens[i + 2].c_str());
+      }
+      setPixelSizeAffine(tokens[1].c_str(), affineT);
+   }
+   else if (command == MM::g_CFGCommand_PixelSizedxdz)
+   {
+      setPixelSizedxdz(tokens[1].c_str(), atof(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_PixelSizedydz)
+   {
+      setPixelSizedydz(tokens[1].c_str(), atof(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_PixelSizeOptimalZUm)
+   {
+      setPixelSizeOptimalZUm(tokens[1].c_str(), atof(tokens[2].c_str()));
+   }
+   else if (command == MM::g_CFGCommand_ParentID)
+   {
+      setParentLabel(tokens[1].c_str(), tokens[2].c_str());
+   }
 }
 
 
@@ -7934,6 +8734,15 @@ void CMMCore::loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_TH
  *
  * Pass nullptr to unregister.
  *
+ * Notifications are delivered in order on a dedicated thread. Property
+ * value and stage position notifications that are still pending when a
+ * newer one arrives for the same property or stage are replaced by it, so a
+ * slow handler sees only the latest values. If more notifications are
+ * pending than the NotificationQueueCapacity Core property allows, further
+ * property value and stage position notifications are dropped (other
+ * notifications are always delivered); see the NotificationQueueStatistics
+ * Core property.
+ *
  * The caller is responsible for ensuring that the object pointed to by \p cb
  * remains valid until it is unregistered.
  *
@@ -7956,20 +8765,25 @@ void CMMCore::registerCallback(MMEventCallback* cb) MMCORE_LEGACY_THROW(CMMError
 
    if (cb) {
       if (!notificationQueue_) {
-         auto queue = std::make_shared<mmi::NotificationQueue>();
+         auto queue = std::make_shared<mmi::NotificationQueue>(
+            notificationQueueCapacity_);
          std::lock_guard<std::mutex> lock(notificationQueueMutex_);
          notificationQueue_ = queue;
       }
 
       auto queue = notificationQueue_;
       notificationDeliveryThread_ = std::thread([queue, cb, this] {
-         while (auto n = queue->WaitAndPop()) {
-            try {
-               mmi::DispatchNotification(*n, *cb);
-            }
-            catch (...) {
-               LOG_ERROR(coreLogger_)
-                  << "Exception in MMEventCallback delivery";
+         // Take notifications in batches, to lock the queue less often
+         constexpr std::size_t batchSize = 64;
+         while (auto batch = queue->WaitAndPopBatch(batchSize)) {
+            for (const auto& n : *batch) {
+               try {
+                  mmi::DispatchNotification(n, *cb);
+               }
+               catch (...) {
+                  LOG_ERROR(coreLogger_)
+                     << "Exception in MMEventCallback delivery";
+               }
             }
          }
       });
@@ -8538,6 +9352,253 @@ void CMMCore::CreateCoreProperties()
       },
       nullptr,
    });
+
+   // CircularBufferEngine
+   properties_->Add(MM::g_Keyword_CoreCircularBufferEngine, {
+      MM::String, false,
+      [this]() {
+         return cbuf_->GetEngine() == mmi::CircularBuffer::Engine::LockFree ?
+            g_CircularBufferEngine_LockFree : g_CircularBufferEngine_Mutex;
+      },
+      [this](const std::string& val) { setCircularBufferEngineInternal(val); },
+      []() {
+         return std::vector<std::string>{
+            g_CircularBufferEngine_Mutex, g_CircularBufferEngine_LockFree};
+      },
+   });
+
+   // CircularBufferStorage
+   properties_->Add(MM::g_Keyword_CoreCircularBufferStorage, {
+      MM::String, false,
+      [this]() {
+         return cbuf_->GetStorageOptions().storage ==
+            mmi::CircularBuffer::Storage::Arena ?
+            g_CircularBufferStorage_Arena : g_CircularBufferStorage_Heap;
+      },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferStorage, val);
+      },
+      []() {
+         return std::vector<std::string>{
+            g_CircularBufferStorage_Heap, g_CircularBufferStorage_Arena};
+      },
+   });
+
+   // CircularBufferHugePages (Arena storage only)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferHugePages, {
+      MM::Integer, false,
+      [this]() {
+         return cbuf_->GetStorageOptions().arena.hugePages ? "1" : "0";
+      },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferHugePages, val);
+      },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // CircularBufferPrefault (Arena storage only)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferPrefault, {
+      MM::Integer, false,
+      [this]() {
+         return cbuf_->GetStorageOptions().arena.prefault ? "1" : "0";
+      },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferPrefault, val);
+      },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // CircularBufferNumaNode (Arena storage only)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferNumaNode, {
+      MM::Integer, false,
+      [this]() {
+         return std::to_string(cbuf_->GetStorageOptions().arena.numaNode);
+      },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferNumaNode, val);
+      },
+      nullptr,
+   });
+
+   // CircularBufferSpillDirectory (empty to disable spilling)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferSpillDirectory, {
+      MM::String, false,
+      [this]() { return cbuf_->GetStorageOptions().spillDirectory; },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferSpillDirectory, val);
+      },
+      nullptr,
+   });
+
+   // CircularBufferSpillSizeMB (0 to disable spilling)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferSpillSizeMB, {
+      MM::Integer, false,
+      [this]() {
+         return std::to_string(cbuf_->GetStorageOptions().spillSizeMB);
+      },
+      [this](const std::string& val) {
+         setCircularBufferStorageInternal(
+               MM::g_Keyword_CoreCircularBufferSpillSizeMB, val);
+      },
+      nullptr,
+   });
+
+   // ThreadPoolSize (0 for one thread per hardware thread)
+   properties_->Add(MM::g_Keyword_CoreThreadPoolSize, {
+      MM::Integer, false,
+      [this]() { return std::to_string(threadPoolSize_); },
+      [this](const std::string& val) {
+         long v;
+         try {
+            v = std::stol(val);
+         } catch (const std::exception&) {
+            v = -1;
+         }
+         if (v < 0 || v > 1024)
+            throw CMMError("ThreadPoolSize must be an integer between 0 "
+                  "(one thread per hardware thread) and 1024",
+                  MMERR_InvalidCoreValue);
+         setThreadPoolInternal(static_cast<unsigned>(v), threadPoolPinned_);
+      },
+      nullptr,
+   });
+
+   // ThreadPoolPinThreads
+   properties_->Add(MM::g_Keyword_CoreThreadPoolPinThreads, {
+      MM::Integer, false,
+      [this]() { return threadPoolPinned_ ? "1" : "0"; },
+      [this](const std::string& val) {
+         setThreadPoolInternal(threadPoolSize_, val == "1");
+      },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // ThreadPoolUtilization (read-only): percentage of time each worker has
+   // spent executing tasks since the pool was created
+   properties_->Add(MM::g_Keyword_CoreThreadPoolUtilization, {
+      MM::String, true,
+      [this]() {
+         const auto stats = threadPool_->GetWorkerStats();
+         const double uptimeNs = static_cast<double>(
+               threadPool_->GetUptime().count());
+         std::ostringstream oss;
+         oss << std::fixed << std::setprecision(1);
+         for (std::size_t i = 0; i < stats.size(); ++i) {
+            if (i > 0)
+               oss << ',';
+            oss << (uptimeNs > 0.0 ?
+                  100.0 * stats[i].busyTime.count() / uptimeNs : 0.0);
+         }
+         return oss.str();
+      },
+      nullptr,
+      nullptr,
+   });
+
+   // ParallelConfigApply: set the properties of different device adapter
+   // modules concurrently when applying presets
+   properties_->Add(MM::g_Keyword_CoreParallelConfigApply, {
+      MM::Integer, false,
+      [this]() { return parallelConfigApply_ ? "1" : "0"; },
+      [this](const std::string& val) { parallelConfigApply_ = val == "1"; },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // ParallelBusyPolling: poll the busy state of different device adapter
+   // modules concurrently in deviceTypeBusy() and waitForDeviceType()
+   properties_->Add(MM::g_Keyword_CoreParallelBusyPolling, {
+      MM::Integer, false,
+      [this]() { return parallelBusyPolling_ ? "1" : "0"; },
+      [this](const std::string& val) { parallelBusyPolling_ = val == "1"; },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // ParallelStateRead: read the properties of different device adapter
+   // modules concurrently in getSystemState() and updateSystemStateCache()
+   properties_->Add(MM::g_Keyword_CoreParallelStateRead, {
+      MM::Integer, false,
+      [this]() { return parallelStateRead_ ? "1" : "0"; },
+      [this](const std::string& val) { parallelStateRead_ = val == "1"; },
+      []() { return std::vector<std::string>{"0", "1"}; },
+   });
+
+   // NotificationQueueCapacity: maximum number of undelivered notifications
+   // (after coalescing); further value notifications are dropped
+   properties_->Add(MM::g_Keyword_CoreNotificationQueueCapacity, {
+      MM::Integer, false,
+      [this]() { return std::to_string(notificationQueueCapacity_); },
+      [this](const std::string& val) {
+         long v;
+         try {
+            v = std::stol(val);
+         } catch (const std::exception&) {
+            v = -1;
+         }
+         if (v <= 0)
+            throw CMMError("NotificationQueueCapacity must be a positive integer",
+                  MMERR_InvalidCoreValue);
+         notificationQueueCapacity_ = static_cast<std::size_t>(v);
+         std::lock_guard<std::mutex> lock(notificationQueueMutex_);
+         if (notificationQueue_)
+            notificationQueue_->SetCapacity(notificationQueueCapacity_);
+      },
+      nullptr,
+   });
+
+   // NotificationQueueStatistics (read-only): counters of the notification
+   // queue, as comma-separated name=value pairs
+   properties_->Add(MM::g_Keyword_CoreNotificationQueueStatistics, {
+      MM::String, true,
+      [this]() {
+         mmi::NotificationQueue::Stats stats;
+         {
+            std::lock_guard<std::mutex> lock(notificationQueueMutex_);
+            if (notificationQueue_)
+               stats = notificationQueue_->GetStats();
+         }
+         using Ms = std::chrono::duration<double, std::milli>;
+         const double meanLatencyMs = stats.popped > 0 ?
+            Ms(stats.totalLatency).count() / stats.popped : 0.0;
+         std::ostringstream oss;
+         oss << "Depth=" << stats.depth
+            << ",MaxDepth=" << stats.maxDepth
+            << ",Pushed=" << stats.pushed
+            << ",Coalesced=" << stats.coalesced
+            << ",Dropped=" << stats.dropped
+            << ",Delivered=" << stats.popped
+            << std::fixed << std::setprecision(3)
+            << ",MeanLatencyMs=" << meanLatencyMs
+            << ",MaxLatencyMs=" << Ms(stats.maxLatency).count();
+         return oss.str();
+      },
+      nullptr,
+      nullptr,
+   });
+
+   // CircularBufferAllocationTimeMs (read-only)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferAllocationTimeMs, {
+      MM::Float, true,
+      [this]() {
+         return std::to_string(cbuf_->GetAllocationStats().milliseconds);
+      },
+      nullptr,
+      nullptr,
+   });
+
+   // CircularBufferAllocationPageFaults (read-only)
+   properties_->Add(MM::g_Keyword_CoreCircularBufferAllocationPageFaults, {
+      MM::Integer, true,
+      [this]() {
+         return std::to_string(cbuf_->GetAllocationStats().pageFaults);
+      },
+      nullptr,
+      nullptr,
+   });
 }
 
 static bool ContainsForbiddenCharacters(const std::string& str)
@@ -8620,25 +9681,182 @@ bool CMMCore::IsCoreDeviceLabel(const char* label) const MMCORE_LEGACY_THROW(CMM
  */
 void CMMCore::applyConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError)
 {
-   std::ostringstream sall;
-   bool error = false;
-   std::vector<PropertySetting> failedProps;
-   for (size_t i=0; i<config.size(); i++)
-   {
-      PropertySetting setting = config.getSetting(i);
+   const auto start = std::chrono::steady_clock::now();
 
-      // perform special processing for core commands
-      if (setting.getDeviceLabel().compare(MM::g_Keyword_CoreDevice) == 0)
+   const bool parallel = parallelConfigApply_;
+
+   // In parallel mode, settings that needed retrying in the past are applied
+   // after the others, in the order in which they eventually succeeded
+   std::vector<PropertySetting> settings;
+   std::vector<unsigned> ranks;
+   if (!parallel)
+   {
+      for (size_t i = 0; i < config.size(); i++)
+         settings.push_back(config.getSetting(i));
+   }
+   else
+   {
+      std::lock_guard<std::mutex> lock(applyRetryRanksMutex_);
+      std::vector<std::pair<unsigned, PropertySetting>> ranked;
+      for (size_t i = 0; i < config.size(); i++)
       {
-         properties_->Set(setting.getPropertyName().c_str(), setting.getPropertyValue());
-         std::string actual = properties_->Get(setting.getPropertyName().c_str());
-         stateCache_->addSetting(PropertySetting(MM::g_Keyword_CoreDevice, setting.getPropertyName().c_str(), actual.c_str()));
+         PropertySetting setting = config.getSetting(i);
+         auto it = applyRetryRanks_.find(setting.getKey());
+         ranked.emplace_back(it == applyRetryRanks_.end() ? 0 : it->second,
+               setting);
       }
-      else
+      std::stable_sort(ranked.begin(), ranked.end(),
+            [](const std::pair<unsigned, PropertySetting>& a,
+               const std::pair<unsigned, PropertySetting>& b) {
+               return a.first < b.first;
+            });
+      for (auto& r : ranked)
       {
-         // normal processing
+         ranks.push_back(r.first);
+         settings.push_back(r.second);
+      }
+   }
+
+   std::vector<PropertySetting> failedProps;
+   std::map<std::string, ApplyTiming> timings;
+   std::set<std::shared_ptr<mmi::LoadedDeviceAdapter>> modules;
+   std::vector<std::shared_ptr<mmi::DeviceInstance>> devices;
+
+   // Settings of equal rank form a wave; in parallel mode, the modules of a
+   // wave are handled concurrently
+   for (size_t first = 0; first < settings.size(); )
+   {
+      size_t last = first;
+      while (last < settings.size() && (!parallel || ranks[last] == ranks[first]))
+         ++last;
+
+      std::map<std::shared_ptr<mmi::LoadedDeviceAdapter>, ModuleSettings> moduleMap;
+      for (size_t i = first; i < last; i++)
+      {
+         const PropertySetting& setting = settings[i];
+
+         // perform special processing for core commands
+         if (setting.getDeviceLabel().compare(MM::g_Keyword_CoreDevice) == 0)
+         {
+            properties_->Set(setting.getPropertyName().c_str(), setting.getPropertyValue());
+            std::string actual = properties_->Get(setting.getPropertyName().c_str());
+            stateCache_->addSetting(PropertySetting(MM::g_Keyword_CoreDevice, setting.getPropertyName().c_str(), actual.c_str()));
+            continue;
+         }
+
          std::shared_ptr<mmi::DeviceInstance> pDevice =
             deviceManager_->GetDevice(setting.getDeviceLabel());
+         if (std::find(devices.begin(), devices.end(), pDevice) == devices.end())
+            devices.push_back(pDevice);
+         if (!parallel)
+         {
+            // normal processing
+            applyModuleSettings({{pDevice, setting}}, failedProps, timings);
+            continue;
+         }
+         moduleMap[pDevice->GetAdapterModule()].emplace_back(pDevice, setting);
+         modules.insert(pDevice->GetAdapterModule());
+      }
+
+      if (moduleMap.size() == 1)
+      {
+         applyModuleSettings(moduleMap.begin()->second, failedProps, timings);
+      }
+      else if (moduleMap.size() > 1)
+      {
+         // One thread per module, as in initializeAllDevices()
+         std::vector<std::vector<PropertySetting>> moduleFailures(moduleMap.size());
+         std::vector<std::map<std::string, ApplyTiming>> moduleTimings(moduleMap.size());
+         std::vector<std::future<void>> futures;
+         size_t m = 0;
+         for (auto& moduleSettings : moduleMap)
+         {
+            futures.push_back(std::async(std::launch::async,
+                  [this, &moduleSettings, &moduleFailures, &moduleTimings, m] {
+                     applyModuleSettings(moduleSettings.second,
+                           moduleFailures[m], moduleTimings[m]);
+                  }));
+            ++m;
+         }
+         for (auto& fut : futures)
+            fut.wait();
+         for (m = 0; m < moduleMap.size(); ++m)
+         {
+            failedProps.insert(failedProps.end(), moduleFailures[m].begin(),
+                  moduleFailures[m].end());
+            for (const auto& t : moduleTimings[m])
+            {
+               timings[t.first].settings += t.second.settings;
+               timings[t.first].elapsed += t.second.elapsed;
+            }
+         }
+      }
+      first = last;
+   }
+
+   if (!failedProps.empty())
+   {
+      std::string errorString;
+      for (unsigned pass = 1; ; ++pass)
+      {
+         const std::vector<PropertySetting> retried = failedProps;
+         applyProperties(failedProps, errorString);
+         if (parallel)
+            recordApplyRetries(retried, failedProps, pass);
+         if (failedProps.empty())
+            break;
+         if (failedProps.size() == retried.size())
+            throw CMMError(errorString.c_str(), MMERR_DEVICE_GENERIC);
+      }
+   }
+
+   if (parallel)
+   {
+      // Devices in different modules may be busy at the same time, so
+      // waiting for each in turn takes about as long as the slowest one
+      const auto waitStart = std::chrono::steady_clock::now();
+      try {
+         for (const auto& pDevice : devices)
+            waitForDevice(pDevice);
+      } catch (const CMMError& err) {
+         logError("applyConfiguration", err.getMsg().c_str());
+      }
+      LOG_DEBUG(coreLogger_) << "Config apply: waited " <<
+         std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - waitStart).count() <<
+         " ms for " << devices.size() << " devices";
+   }
+
+   for (const auto& t : timings)
+   {
+      LOG_DEBUG(coreLogger_) << "Config apply: device " << t.first << ": " <<
+         t.second.settings << " settings in " << std::fixed <<
+         std::setprecision(1) << std::chrono::duration<double, std::milli>(
+               t.second.elapsed).count() << " ms";
+   }
+   LOG_DEBUG(coreLogger_) << "Config apply: " << config.size() <<
+      " settings" << (parallel ? " (parallel across " +
+            ToString(modules.size()) + " modules)" : std::string()) <<
+      " in " << std::fixed << std::setprecision(1) <<
+      std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count() << " ms";
+}
+
+/*
+ * Helper function for applyConfiguration, run on a separate thread per
+ * module in parallel mode. Sets the properties (normally all of the same
+ * module) in order, collecting those that failed.
+ */
+void CMMCore::applyModuleSettings(const ModuleSettings& settings,
+      std::vector<PropertySetting>& failedProps,
+      std::map<std::string, ApplyTiming>& timings)
+{
+   for (const auto& deviceSetting : settings)
+   {
+      const std::shared_ptr<mmi::DeviceInstance>& pDevice = deviceSetting.first;
+      const PropertySetting& setting = deviceSetting.second;
+      const auto start = std::chrono::steady_clock::now();
+      {
          mmi::DeviceModuleLockGuard guard(pDevice);
          try
          {
@@ -8650,23 +9868,52 @@ void CMMCore::applyConfiguration(const Configuration& config) MMCORE_LEGACY_THRO
          catch (const CMMError&)
          {
             failedProps.push_back(setting);
-            error = true;
          }
       }
+      ApplyTiming& timing = timings[setting.getDeviceLabel()];
+      ++timing.settings;
+      timing.elapsed += std::chrono::steady_clock::now() - start;
    }
-   if (error)
+}
+
+/*
+ * Helper function for applyConfiguration
+ * Remembers the retry pass in which settings that had failed succeeded, so
+ * that they can be applied in that order the next time.
+ */
+void CMMCore::recordApplyRetries(const std::vector<PropertySetting>& retried,
+      const std::vector<PropertySetting>& stillFailed, unsigned pass)
+{
+   std::set<std::string> failedKeys;
+   for (const auto& setting : stillFailed)
+      failedKeys.insert(setting.getKey());
+
+   std::lock_guard<std::mutex> lock(applyRetryRanksMutex_);
+   for (const auto& setting : retried)
    {
-      std::string errorString;
-      while (failedProps.size() > (unsigned) applyProperties(failedProps, errorString) )
+      if (failedKeys.count(setting.getKey()))
+         continue;
+      unsigned& rank = applyRetryRanks_[setting.getKey()];
+      if (pass > rank)
       {
-         if (failedProps.size() == 0)
-            return;
+         rank = pass;
+         LOG_DEBUG(coreLogger_) << "Config apply: " << setting.getDeviceLabel() <<
+            "-" << setting.getPropertyName() << " succeeded on retry " <<
+            pass << "; will be applied later from now on";
       }
-
-      throw CMMError(errorString.c_str(), MMERR_DEVICE_GENERIC);
    }
 }
 
+/*
+ * Called when devices are unloaded: their learned order may not apply to
+ * the devices loaded next.
+ */
+void CMMCore::forgetApplyRetries()
+{
+   std::lock_guard<std::mutex> lock(applyRetryRanksMutex_);
+   applyRetryRanks_.clear();
+}
+
 /*
  * Helper function for applyConfiguration
  * It is possible that setting certain properties failed because they are dependent
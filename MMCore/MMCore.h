@@ -49,6 +49,7 @@
 #include "Configuration.h"
 #include "Error.h"
 #include "ErrorCodes.h"
+#include "FrameHandle.h"
 #include "LogLevel.h"
 #include "Logging/Logger.h"
 #include "MockDeviceAdapter.h"
@@ -57,6 +58,9 @@
 #include "MMDevice.h"
 #include "MMDeviceConstants.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <deque>
 #include <map>
@@ -93,8 +97,10 @@ namespace internal {
    class CorePropertyCollection;
    class CPluginManager;
    class DeviceManager;
+   class FrameStreamWriter;
    class LogManager;
    class NotificationQueue;
+   class ThreadPool;
 } // namespace internal
 } // namespace mmcore
 
@@ -187,6 +193,8 @@ public:
    void setPrimaryLogFile(const char* filename, bool truncate = false) MMCORE_LEGACY_THROW(CMMError);
    std::string getPrimaryLogFile() const;
    void setPrimaryLogFileRotation(long long maxFileSize, int maxBackupCount);
+   void enableBinaryPrimaryLog(bool enable) MMCORE_LEGACY_THROW(CMMError);
+   bool binaryPrimaryLogEnabled();
 
    void logMessage(const char* msg);
    void logMessage(const char* msg, bool debugOnly);
@@ -212,6 +220,8 @@ public:
    ///@{
    std::vector<std::string> getDeviceAdapterSearchPaths();
    void setDeviceAdapterSearchPaths(const std::vector<std::string>& paths);
+   void setDeviceAdapterCatalogFile(const char* filename) MMCORE_LEGACY_THROW(CMMError);
+   std::string getDeviceAdapterCatalogFile();
 
    std::vector<std::string> getDeviceAdapterNames() MMCORE_LEGACY_THROW(CMMError);
 
@@ -446,6 +456,14 @@ public:
    void* getNBeforeLastImageMD(unsigned long n, Metadata& md)
       const MMCORE_LEGACY_THROW(CMMError);
    void* popNextImageMD(Metadata& md) MMCORE_LEGACY_THROW(CMMError);
+   std::vector<FrameHandle> popNextImagesMD(unsigned maxCount,
+         std::vector<Metadata>& md) MMCORE_LEGACY_THROW(CMMError);
+   FrameHandle getLastFrame() const MMCORE_LEGACY_THROW(CMMError);
+   FrameHandle getNBeforeLastFrame(unsigned long n)
+      const MMCORE_LEGACY_THROW(CMMError);
+   FrameHandle popNextFrame() MMCORE_LEGACY_THROW(CMMError);
+   std::vector<FrameHandle> popNextFrames(unsigned maxCount);
+   bool waitForNextImage(long timeoutMs) MMCORE_LEGACY_THROW(CMMError);
 
    long getRemainingImageCount();
    long getBufferTotalCapacity();
@@ -456,6 +474,12 @@ public:
    void initializeCircularBuffer() MMCORE_LEGACY_THROW(CMMError);
    void clearCircularBuffer() MMCORE_LEGACY_THROW(CMMError);
 
+   void startStreamToDisk(const char* path) MMCORE_LEGACY_THROW(CMMError);
+   void stopStreamToDisk() MMCORE_LEGACY_THROW(CMMError);
+   bool isStreamingToDisk();
+   long long getStreamToDiskImageCount();
+   double getStreamToDiskThroughput();
+
    bool isExposureSequenceable(const char* cameraLabel) MMCORE_LEGACY_THROW(CMMError);
    void startExposureSequence(const char* cameraLabel) MMCORE_LEGACY_THROW(CMMError);
    void stopExposureSequence(const char* cameraLabel) MMCORE_LEGACY_THROW(CMMError);
@@ -729,7 +753,32 @@ private:
    std::unique_ptr<mmcore::internal::ConfigGroupCollection> configGroups_;
    std::unique_ptr<PixelSizeConfigGroup> pixelSizeGroup_;
    std::unique_ptr<mmcore::internal::CorePropertyCollection> properties_;
+   // Worker threads shared by MMCore subsystems (currently the circular
+   // buffer). Must be declared before its users.
+   std::shared_ptr<mmcore::internal::ThreadPool> threadPool_;
+   unsigned threadPoolSize_ = 0; // 0 for one thread per hardware thread
+   bool threadPoolPinned_ = false;
+   // Set properties of different device adapter modules concurrently in
+   // applyConfiguration()
+   bool parallelConfigApply_ = false;
+   // Retry pass in which settings previously succeeded, by setting key
+   // (parallel mode only; forgotten when devices are unloaded)
+   std::map<std::string, unsigned> applyRetryRanks_;
+   std::mutex applyRetryRanksMutex_;
+   // Poll the busy state of different device adapter modules concurrently
+   // in deviceTypeBusy() and waitForDeviceType()
+   bool parallelBusyPolling_ = false;
+   // Signaled when a device reports a change of its busy state
+   std::mutex busyReportMutex_;
+   std::condition_variable busyReportCv_;
+   // Read the properties of different device adapter modules concurrently in
+   // getSystemState()
+   bool parallelStateRead_ = false;
    std::unique_ptr<mmcore::internal::CircularBuffer> cbuf_;
+   // Consumer of cbuf_ while streaming to disk; kept after stopping so that
+   // its counters can be read. Declared after cbuf_, which it references.
+   std::unique_ptr<mmcore::internal::FrameStreamWriter> streamWriter_;
+   std::mutex streamWriterMutex_;
    std::unique_ptr<mmcore::internal::CoreCallback> callback_;
 
    std::shared_ptr<mmcore::internal::CPluginManager> pluginManager_;
@@ -741,11 +790,17 @@ private:
    // True while interpreting the config file (but not while rolling back on
    // failure):
    bool isLoadingSystemConfiguration_ = false;
+   // Time taken by Initialize() of each device, for the report logged at the
+   // end of loading the system configuration
+   std::map<std::string, std::chrono::steady_clock::duration> deviceInitTimes_;
+   std::mutex deviceInitTimesMutex_;
 
    std::mutex callbackMutex_; // Serializes registerCallback() calls
    std::mutex notificationQueueMutex_; // Protects notificationQueue_
    std::shared_ptr<mmcore::internal::NotificationQueue>
       notificationQueue_;
+   // Notifications arriving while this many are pending are dropped
+   std::size_t notificationQueueCapacity_ = 10000;
    std::thread notificationDeliveryThread_;
 
 private:
@@ -761,10 +816,28 @@ private:
    static void CheckConfigPresetName(const char* presetName) MMCORE_LEGACY_THROW(CMMError);
    bool IsCoreDeviceLabel(const char* label) const MMCORE_LEGACY_THROW(CMMError);
 
+   struct ApplyTiming {
+      unsigned settings = 0;
+      std::chrono::steady_clock::duration elapsed{};
+   };
+   typedef std::vector<std::pair<std::shared_ptr<mmcore::internal::DeviceInstance>,
+      PropertySetting>> ModuleSettings;
    void applyConfiguration(const Configuration& config) MMCORE_LEGACY_THROW(CMMError);
+   void applyModuleSettings(const ModuleSettings& settings,
+         std::vector<PropertySetting>& failedProps,
+         std::map<std::string, ApplyTiming>& timings);
+   void recordApplyRetries(const std::vector<PropertySetting>& retried,
+         const std::vector<PropertySetting>& stillFailed, unsigned pass);
+   void forgetApplyRetries();
    int applyProperties(std::vector<PropertySetting>& props, std::string& lastError);
    void waitForDevice(std::shared_ptr<mmcore::internal::DeviceInstance> pDev) MMCORE_LEGACY_THROW(CMMError);
+   bool moduleDevicesBusy(const std::vector<std::shared_ptr<mmcore::internal::DeviceInstance>>& devices,
+         const std::atomic<bool>& stop);
+   void onDeviceBusyReported(std::shared_ptr<mmcore::internal::DeviceInstance> pDev, bool busy);
+   void readDeviceState(std::shared_ptr<mmcore::internal::DeviceInstance> pDev,
+         const std::string& label, std::vector<PropertySetting>& settings);
    Configuration getConfigGroupState(const char* group, bool fromCache) MMCORE_LEGACY_THROW(CMMError);
+   std::string matchConfigGroupState(const char* group, bool fromCache) MMCORE_LEGACY_THROW(CMMError);
    std::string getDeviceErrorText(int deviceCode, std::shared_ptr<mmcore::internal::DeviceInstance> pDevice);
    std::string getDeviceName(std::shared_ptr<mmcore::internal::DeviceInstance> pDev);
    void logError(const char* device, const char* msg);
@@ -772,6 +845,7 @@ private:
    void removeDeviceRole(std::shared_ptr<mmcore::internal::DeviceInstance> pDev);
    void removeAllDeviceRoles();
    void loadSystemConfigurationImpl(const char* fileName) MMCORE_LEGACY_THROW(CMMError);
+   void executeConfigCommand(const std::vector<std::string>& tokens) MMCORE_LEGACY_THROW(CMMError);
 
    void setCameraInternal(const std::string& label);
    void setShutterInternal(const std::string& label);
@@ -783,12 +857,20 @@ private:
    void setGalvoInternal(const std::string& label);
    void setAutoShutterInternal(bool state);
    void setTimeoutMsInternal(long timeoutMs);
+   void setCircularBufferEngineInternal(const std::string& engine);
+   void setCircularBufferStorageInternal(const char* propName,
+         const std::string& value);
+   void setThreadPoolInternal(unsigned threadCount, bool pinned);
    void setChannelGroupInternal(const std::string& group);
    void initializeInternal(bool init);
 
    void initializeAllDevicesSerial() MMCORE_LEGACY_THROW(CMMError);
    void initializeAllDevicesParallel() MMCORE_LEGACY_THROW(CMMError);
-   int initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<mmcore::internal::DeviceInstance>, std::string> > pDevices);
+   struct DeviceInitProgress;
+   int initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<mmcore::internal::DeviceInstance>, std::string> > pDevices,
+         DeviceInitProgress& progress);
+   void initializeDeviceTimed(std::shared_ptr<mmcore::internal::DeviceInstance> pDevice,
+         const std::string& label);
 
    void postNotification(
       mmcore::internal::Notification notification);
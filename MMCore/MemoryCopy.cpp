@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MemoryCopy.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Frame copy kernels with runtime CPU dispatch
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "MemoryCopy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || \
+   (defined(_M_X64) && !defined(_M_ARM64EC))
+#define MMCORE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#else
+#include <unistd.h>
+#endif
+
+// GCC and Clang only emit vector instructions in functions marked with
+// the target feature; MSVC always does.
+#if defined(__GNUC__) || defined(__clang__)
+#define MMCORE_TARGET(features) __attribute__((target(features)))
+#else
+#define MMCORE_TARGET(features)
+#endif
+
+namespace mmcore {
+namespace internal {
+
+namespace {
+
+void CopyStd(void* dst, const void* src, std::size_t bytes)
+{
+   std::memcpy(dst, src, bytes);
+}
+
+#ifdef MMCORE_X86
+
+// Each streaming kernel copies an unaligned head with memcpy, streams
+// aligned blocks of 4 vectors, and copies the remaining tail with memcpy.
+// The stores are weakly ordered, hence the final sfence.
+
+std::size_t HeadBytes(const void* dst, std::size_t alignment, std::size_t bytes)
+{
+   const std::size_t misalign =
+      reinterpret_cast<std::uintptr_t>(dst) & (alignment - 1);
+   return std::min(bytes, misalign ? alignment - misalign : 0);
+}
+
+MMCORE_TARGET("sse2")
+void CopyStreamSSE2(void* dst, const void* src, std::size_t bytes)
+{
+   auto* d = static_cast<unsigned char*>(dst);
+   auto* s = static_cast<const unsigned char*>(src);
+   const std::size_t head = HeadBytes(d, 16, bytes);
+   std::memcpy(d, s, head);
+   d += head;
+   s += head;
+   bytes -= head;
+   for (; bytes >= 64; bytes -= 64, d += 64, s += 64)
+   {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+      const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+   }
+   _mm_sfence();
+   std::memcpy(d, s, bytes);
+}
+
+MMCORE_TARGET("avx2")
+void CopyStreamAVX2(void* dst, const void* src, std::size_t bytes)
+{
+   auto* d = static_cast<unsigned char*>(dst);
+   auto* s = static_cast<const unsigned char*>(src);
+   const std::size_t head = HeadBytes(d, 32, bytes);
+   std::memcpy(d, s, head);
+   d += head;
+   s += head;
+   bytes -= head;
+   for (; bytes >= 128; bytes -= 128, d += 128, s += 128)
+   {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 32));
+      const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 64));
+      const __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + 96));
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(d), a);
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 32), b);
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 64), c);
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(d + 96), e);
+   }
+   _mm_sfence();
+   std::memcpy(d, s, bytes);
+}
+
+MMCORE_TARGET("avx512f")
+void CopyStreamAVX512(void* dst, const void* src, std::size_t bytes)
+{
+   auto* d = static_cast<unsigned char*>(dst);
+   auto* s = static_cast<const unsigned char*>(src);
+   const std::size_t head = HeadBytes(d, 64, bytes);
+   std::memcpy(d, s, head);
+   d += head;
+   s += head;
+   bytes -= head;
+   for (; bytes >= 256; bytes -= 256, d += 256, s += 256)
+   {
+      const __m512i a = _mm512_loadu_si512(s);
+      const __m512i b = _mm512_loadu_si512(s + 64);
+      const __m512i c = _mm512_loadu_si512(s + 128);
+      const __m512i e = _mm512_loadu_si512(s + 192);
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(d), a);
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(d + 64), b);
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(d + 128), c);
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(d + 192), e);
+   }
+   _mm_sfence();
+   std::memcpy(d, s, bytes);
+}
+
+struct CpuFeatures {
+   bool sse2 = false;
+   bool avx2 = false;
+   bool avx512f = false;
+};
+
+CpuFeatures DetectCpuFeatures()
+{
+   CpuFeatures f;
+#ifdef _MSC_VER
+   int regs[4];
+   __cpuid(regs, 0);
+   const int maxLeaf = regs[0];
+   __cpuid(regs, 1);
+   f.sse2 = (regs[3] & (1 << 26)) != 0;
+   const bool osxsave = (regs[2] & (1 << 27)) != 0;
+   if (!osxsave || maxLeaf < 7)
+      return f;
+   // The OS must save the vector registers on context switches
+   const unsigned long long xcr0 = _xgetbv(0);
+   const bool ymm = (xcr0 & 0x6) == 0x6;
+   const bool zmm = (xcr0 & 0xe6) == 0xe6;
+   __cpuidex(regs, 7, 0);
+   f.avx2 = ymm && (regs[1] & (1 << 5)) != 0;
+   f.avx512f = zmm && (regs[1] & (1 << 16)) != 0;
+#else
+   // Also checks for OS support of the vector registers
+   __builtin_cpu_init();
+   f.sse2 = __builtin_cpu_supports("sse2");
+   f.avx2 = __builtin_cpu_supports("avx2");
+   f.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+   return f;
+}
+
+#endif // MMCORE_X86
+
+std::vector<CopyKernel> DetectCopyKernels()
+{
+   std::vector<CopyKernel> kernels{{"memcpy", CopyStd, false}};
+#ifdef MMCORE_X86
+   const CpuFeatures f = DetectCpuFeatures();
+   if (f.sse2)
+      kernels.push_back({"SSE2-stream", CopyStreamSSE2, true});
+   if (f.avx2)
+      kernels.push_back({"AVX2-stream", CopyStreamAVX2, true});
+   if (f.avx512f)
+      kernels.push_back({"AVX512-stream", CopyStreamAVX512, true});
+#endif
+   return kernels;
+}
+
+std::size_t LastLevelCacheSize()
+{
+#ifdef _WIN32
+   DWORD len = 0;
+   GetLogicalProcessorInformation(nullptr, &len);
+   std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(
+      len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+   if (info.empty() || !GetLogicalProcessorInformation(info.data(), &len))
+      return 0;
+   std::size_t size = 0;
+   BYTE level = 0;
+   for (const auto& i : info)
+   {
+      if (i.Relationship != RelationCache || i.Cache.Level < level)
+         continue;
+      if (i.Cache.Level > level)
+         size = 0;
+      level = i.Cache.Level;
+      size = std::max<std::size_t>(size, i.Cache.Size);
+   }
+   return size;
+#elif defined(__APPLE__)
+   const char* names[] = {"hw.l3cachesize", "hw.l2cachesize"};
+   for (const char* name : names)
+   {
+      std::int64_t size = 0;
+      std::size_t len = sizeof(size);
+      if (sysctlbyname(name, &size, &len, nullptr, 0) == 0 && size > 0)
+         return static_cast<std::size_t>(size);
+   }
+   return 0;
+#else
+#ifdef _SC_LEVEL3_CACHE_SIZE
+   const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+   if (l3 > 0)
+      return static_cast<std::size_t>(l3);
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+   const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+   if (l2 > 0)
+      return static_cast<std::size_t>(l2);
+#endif
+   return 0;
+#endif
+}
+
+} // anonymous namespace
+
+const std::vector<CopyKernel>& AvailableCopyKernels()
+{
+   static const std::vector<CopyKernel> kernels = DetectCopyKernels();
+   return kernels;
+}
+
+const CopyKernel& StreamingCopyKernel()
+{
+   return AvailableCopyKernels().back();
+}
+
+std::size_t StreamingCopyThreshold()
+{
+   // A frame larger than a quarter of the last-level cache cannot stay in
+   // it for long alongside the consumer's working set. If the cache size is
+   // unknown, assume a typical desktop L3 of 16 MB. The limits come from the
+   // "[MemCopyBenchmark]" test case (one thread, 512 MB ring) on a server
+   // part with a 105 MB L3: the AVX-512 streaming kernel ran at 9-11 GB/s
+   // for frames of 256 KB to 4 MB, against 6-7 GB/s for memcpy. A large,
+   // shared L3 therefore does not justify copying larger frames through the
+   // cache.
+   static const std::size_t threshold = [] {
+      constexpr std::size_t KB = 1 << 10;
+      constexpr std::size_t MB = 1 << 20;
+      std::size_t llc = LastLevelCacheSize();
+      if (llc == 0)
+         llc = 16 * MB;
+      return std::min(std::max(llc / 4, 256 * KB), 1 * MB);
+   }();
+   return threshold;
+}
+
+void CopyFrameMemory(void* dst, const void* src, std::size_t bytes,
+   std::size_t frameBytes)
+{
+   if (frameBytes >= StreamingCopyThreshold())
+      StreamingCopyKernel().copy(dst, src, bytes);
+   else
+      std::memcpy(dst, src, bytes);
+}
+
+} // namespace internal
+} // namespace mmcore
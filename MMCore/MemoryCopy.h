@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          MemoryCopy.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Frame copy kernels with runtime CPU dispatch
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mmcore {
+namespace internal {
+
+struct CopyKernel {
+   const char* name;
+   void (*copy)(void* dst, const void* src, std::size_t bytes);
+   bool streaming; // Uses non-temporal (cache-bypassing) stores
+};
+
+// The kernels supported by this CPU: first std::memcpy, then any streaming
+// kernels (SSE2, AVX2, AVX-512) in order of increasing vector width.
+const std::vector<CopyKernel>& AvailableCopyKernels();
+
+// The widest available streaming kernel, or std::memcpy if there is none.
+const CopyKernel& StreamingCopyKernel();
+
+// Frames at least this large are copied with StreamingCopyKernel(): they are
+// unlikely to be read from cache by the consumer, and copying them through
+// the cache would evict data the consumer does need. Derived from the size
+// of the last-level cache, where known.
+std::size_t StreamingCopyThreshold();
+
+// Copy part of a frame of frameBytes bytes, using a streaming kernel if the
+// frame is at least StreamingCopyThreshold() bytes.
+void CopyFrameMemory(void* dst, const void* src, std::size_t bytes,
+   std::size_t frameBytes);
+
+} // namespace internal
+} // namespace mmcore
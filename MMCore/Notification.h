@@ -8,6 +8,7 @@
 
 #include "MMEventCallback.h"
 
+#include <optional>
 #include <string>
 #include <variant>
 
@@ -146,5 +147,27 @@ inline void DispatchNotification(const Notification& notification,
    }, notification);
 }
 
+// Notifications that only report the latest value of a property or a stage
+// position have a key, and a pending notification can be replaced by a later
+// one with the same key.
+inline std::optional<std::string> CoalescingKey(
+      const Notification& notification) {
+   return std::visit(detail::overloaded{
+      [](const notification::PropertyChanged& n) -> std::optional<std::string> {
+         return "P" + std::string(1, '\0') + n.deviceLabel + '\0' +
+            n.propertyName;
+      },
+      [](const notification::StagePositionChanged& n) -> std::optional<std::string> {
+         return "S" + std::string(1, '\0') + n.deviceLabel;
+      },
+      [](const notification::XYStagePositionChanged& n) -> std::optional<std::string> {
+         return "X" + std::string(1, '\0') + n.deviceLabel;
+      },
+      [](const auto&) -> std::optional<std::string> {
+         return std::nullopt;
+      },
+   }, notification);
+}
+
 } // namespace internal
 } // namespace mmcore
@@ -8,35 +8,102 @@
 
 #include "Notification.h"
 
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace mmcore {
 namespace internal {
 
+// Notifications that carry the latest value of something (see
+// CoalescingKey()) replace a pending notification with the same key instead
+// of being queued behind it, so that a device reporting at a high rate
+// cannot flood the queue. The queue can also be bounded, in which case
+// value notifications for a new key that arrive while it is full are dropped
+// (and counted). Other notifications report events, such as a loaded
+// configuration, that cannot be recovered from a later value, so they are
+// always queued.
 class NotificationQueue {
 public:
+   using Clock = std::chrono::steady_clock;
+
+   struct Stats {
+      std::size_t depth = 0;
+      std::size_t maxDepth = 0;
+      std::uint64_t pushed = 0;
+      std::uint64_t coalesced = 0;
+      std::uint64_t dropped = 0;
+      std::uint64_t popped = 0;
+      // Time from queueing to popping, over the popped notifications
+      Clock::duration totalLatency{};
+      Clock::duration maxLatency{};
+   };
+
+   // capacity 0 means unbounded
+   explicit NotificationQueue(std::size_t capacity = 0) :
+      capacity_(capacity) {}
+
+   void SetCapacity(std::size_t capacity) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      capacity_ = capacity;
+   }
+
    void Push(Notification notification) {
+      std::optional<std::string> key = CoalescingKey(notification);
       {
          std::lock_guard<std::mutex> lock(mutex_);
-         queue_.push_back(std::move(notification));
+         ++stats_.pushed;
+         if (key) {
+            auto it = pending_.find(*key);
+            if (it != pending_.end()) {
+               // Latest value wins; the pending entry keeps its place
+               queue_[it->second - frontSeq_].notification =
+                  std::move(notification);
+               ++stats_.coalesced;
+               return;
+            }
+         }
+         if (key && capacity_ > 0 && queue_.size() >= capacity_) {
+            ++stats_.dropped;
+            return;
+         }
+         if (key)
+            pending_.emplace(*key, frontSeq_ + queue_.size());
+         queue_.push_back(
+            Entry{std::move(notification), std::move(key), Clock::now()});
+         stats_.maxDepth = std::max(stats_.maxDepth, queue_.size());
       }
       cv_.notify_one();
    }
 
    std::optional<Notification> WaitAndPop() {
       std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock,
-         [this] { return interrupted_ || !queue_.empty(); });
-      if (interrupted_) {
-         interrupted_ = false;
+      if (!Wait(lock))
          return std::nullopt;
-      }
-      Notification n = std::move(queue_.front());
-      queue_.pop_front();
-      return n;
+      return PopLocked(Clock::now());
+   }
+
+   // Like WaitAndPop(), but takes up to maxCount notifications at once.
+   std::optional<std::vector<Notification>> WaitAndPopBatch(
+         std::size_t maxCount) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!Wait(lock))
+         return std::nullopt;
+      const auto now = Clock::now();
+      std::vector<Notification> batch;
+      batch.reserve(std::min(maxCount, queue_.size()));
+      while (!queue_.empty() && batch.size() < maxCount)
+         batch.push_back(PopLocked(now));
+      return batch;
    }
 
    // Wake WaitAndPop (returns nullopt) without discarding pending items.
@@ -49,10 +116,52 @@ public:
       cv_.notify_one();
    }
 
+   Stats GetStats() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Stats stats = stats_;
+      stats.depth = queue_.size();
+      return stats;
+   }
+
 private:
-   std::mutex mutex_;
+   struct Entry {
+      Notification notification;
+      std::optional<std::string> key;
+      Clock::time_point queued;
+   };
+
+   // Returns false if interrupted
+   bool Wait(std::unique_lock<std::mutex>& lock) {
+      cv_.wait(lock,
+         [this] { return interrupted_ || !queue_.empty(); });
+      if (interrupted_) {
+         interrupted_ = false;
+         return false;
+      }
+      return true;
+   }
+
+   Notification PopLocked(Clock::time_point now) {
+      Entry entry = std::move(queue_.front());
+      queue_.pop_front();
+      ++frontSeq_;
+      if (entry.key)
+         pending_.erase(*entry.key);
+      const auto latency = now - entry.queued;
+      ++stats_.popped;
+      stats_.totalLatency += latency;
+      stats_.maxLatency = std::max(stats_.maxLatency, latency);
+      return std::move(entry.notification);
+   }
+
+   mutable std::mutex mutex_;
    std::condition_variable cv_;
-   std::deque<Notification> queue_;
+   std::deque<Entry> queue_;
+   std::uint64_t frontSeq_ = 0; // Sequence number of queue_.front()
+   // Coalescing key -> sequence number of the pending entry
+   std::unordered_map<std::string, std::uint64_t> pending_;
+   std::size_t capacity_;
+   Stats stats_;
    bool interrupted_ = false;
 };
 
@@ -33,11 +33,17 @@
 #include "ModuleInterface.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -139,10 +145,7 @@ CPluginManager::GetDeviceAdapter(const std::string& moduleName)
       return it->second;
    }
 
-   std::string filename(LIB_NAME_PREFIX);
-   filename += moduleName;
-   filename += LIB_NAME_SUFFIX;
-   filename = FindInSearchPath(filename);
+   std::string filename = FindInSearchPath(GetLibraryFilename(moduleName));
 
    auto module = [&] {
       try {
@@ -159,6 +162,15 @@ CPluginManager::GetDeviceAdapter(const std::string& moduleName)
    return module;
 }
 
+std::string
+CPluginManager::GetLibraryFilename(const std::string& moduleName)
+{
+   std::string filename(LIB_NAME_PREFIX);
+   filename += moduleName;
+   filename += LIB_NAME_SUFFIX;
+   return filename;
+}
+
 std::shared_ptr<LoadedDeviceAdapter>
 CPluginManager::GetDeviceAdapter(const char* moduleName)
 {
@@ -188,6 +200,244 @@ CPluginManager::LoadMockAdapter(const std::string& name, MockDeviceAdapter* impl
 }
 
 
+/**
+ * Set the file in which the devices of device adapter modules are cached.
+ *
+ * Existing entries are read from the file, which need not exist yet.
+ */
+void
+CPluginManager::SetCatalogFile(const std::string& filename)
+{
+   catalogFile_ = filename;
+   if (filename.empty())
+      catalog_.Clear();
+   else
+      catalog_.Load(filename);
+}
+
+std::vector<DeviceAdapterCatalog::Device>
+CPluginManager::GetAvailableDevices(const std::string& moduleName)
+{
+   if (moduleName.empty())
+   {
+      throw CMMError("Empty device adapter module name");
+   }
+
+   // Loaded modules (including mock adapters) can be asked directly
+   auto it = moduleMap_.find(moduleName);
+   if (it != moduleMap_.end())
+      return DeviceAdapterCatalog::DescribeDevices(*it->second);
+   if (catalogFile_.empty())
+      return DeviceAdapterCatalog::DescribeDevices(*GetDeviceAdapter(moduleName));
+
+   const std::string path = FindInSearchPath(GetLibraryFilename(moduleName));
+   if (auto devices = catalog_.Find(path))
+      return *devices;
+
+   // If one module is missing or stale, the others may be too (e.g. after an
+   // update), and are likely to be asked for next
+   RefreshCatalog();
+   if (auto devices = catalog_.Find(path))
+      return *devices;
+
+   // Not in the search paths, or failed to load: load it by itself (throwing
+   // if it fails)
+   const auto stamp = DeviceAdapterCatalog::GetFileStamp(path);
+   std::vector<DeviceAdapterCatalog::Device> devices =
+      DeviceAdapterCatalog::DescribeDevices(*GetDeviceAdapter(moduleName));
+   if (stamp)
+   {
+      catalog_.Put(path, *stamp, devices);
+      SaveCatalog();
+   }
+   return devices;
+}
+
+/**
+ * Probe, in parallel, the modules in the search paths that are not loaded and
+ * whose catalog entry is missing or stale, and enter them into the catalog.
+ *
+ * The probed modules are unloaded again; they are loaded for real only when
+ * a device is created from them. Modules that fail to load are skipped, and
+ * not probed again unless their file changes.
+ */
+void
+CPluginManager::RefreshCatalog()
+{
+   std::vector<std::string> names;
+   try
+   {
+      names = GetAvailableDeviceAdapters();
+   }
+   catch (const CMMError&)
+   {
+      return; // Duplicate libraries; leave it to GetDeviceAdapter()
+   }
+
+   struct Job {
+      std::string name;
+      std::string path;
+      std::optional<DeviceAdapterCatalog::FileStamp> stamp;
+      bool described = false;
+      std::vector<DeviceAdapterCatalog::Device> devices;
+   };
+   std::vector<Job> jobs;
+   for (const auto& name : names)
+   {
+      if (moduleMap_.count(name))
+         continue;
+      Job job;
+      job.name = name;
+      job.path = FindInSearchPath(GetLibraryFilename(name));
+      if (catalog_.Find(job.path))
+         continue;
+      // Stamp before loading, so that a file replaced meanwhile is stale
+      job.stamp = DeviceAdapterCatalog::GetFileStamp(job.path);
+      if (!job.stamp)
+         continue;
+      auto failed = failedProbes_.find(job.path);
+      if (failed != failedProbes_.end() &&
+            failed->second.mtime == job.stamp->mtime &&
+            failed->second.size == job.stamp->size)
+         continue;
+      jobs.push_back(std::move(job));
+   }
+   if (jobs.empty())
+      return;
+
+   RunInParallel(jobs.size(), [&jobs](std::size_t i) {
+      Job& job = jobs[i];
+      std::shared_ptr<LoadedDeviceAdapter> module;
+      try
+      {
+         auto impl = std::make_unique<LoadedDeviceAdapterImplRegular>(job.path);
+         module = std::make_shared<LoadedDeviceAdapter>(job.name, std::move(impl));
+         job.devices = DeviceAdapterCatalog::DescribeDevices(*module);
+         job.described = true;
+      }
+      catch (const CMMError&)
+      {
+         // Not a usable device adapter
+      }
+      if (module)
+      {
+         try
+         {
+            module->Unload();
+         }
+         catch (const CMMError&)
+         {
+            // Stays loaded; harmless
+         }
+      }
+   });
+
+   for (auto& job : jobs)
+   {
+      if (!job.described)
+      {
+         failedProbes_[job.path] = *job.stamp;
+         continue;
+      }
+      failedProbes_.erase(job.path);
+      catalog_.Put(job.path, *job.stamp, std::move(job.devices));
+   }
+   SaveCatalog();
+}
+
+/**
+ * Load, in parallel, those of the given modules that are not yet loaded.
+ *
+ * Modules that fail to load are skipped; GetDeviceAdapter() reports the
+ * error when they are next asked for. Returns the time taken to load each
+ * module that was loaded.
+ */
+std::map<std::string, std::chrono::steady_clock::duration>
+CPluginManager::LoadDeviceAdapters(const std::vector<std::string>& moduleNames)
+{
+   struct Job {
+      std::string name;
+      std::string path;
+      std::shared_ptr<LoadedDeviceAdapter> module;
+      std::chrono::steady_clock::duration elapsed{};
+   };
+   std::vector<Job> jobs;
+   std::set<std::string> seen;
+   for (const auto& name : moduleNames)
+   {
+      if (name.empty() || moduleMap_.count(name) || !seen.insert(name).second)
+         continue;
+      Job job;
+      job.name = name;
+      job.path = FindInSearchPath(GetLibraryFilename(name));
+      jobs.push_back(std::move(job));
+   }
+
+   RunInParallel(jobs.size(), [&jobs](std::size_t i) {
+      Job& job = jobs[i];
+      const auto start = std::chrono::steady_clock::now();
+      try
+      {
+         auto impl = std::make_unique<LoadedDeviceAdapterImplRegular>(job.path);
+         job.module = std::make_shared<LoadedDeviceAdapter>(job.name, std::move(impl));
+      }
+      catch (const CMMError&)
+      {
+         // Reported by GetDeviceAdapter()
+      }
+      job.elapsed = std::chrono::steady_clock::now() - start;
+   });
+
+   std::map<std::string, std::chrono::steady_clock::duration> loadTimes;
+   for (auto& job : jobs)
+   {
+      if (!job.module)
+         continue;
+      moduleMap_.emplace(job.name, std::move(job.module));
+      loadTimes[job.name] = job.elapsed;
+   }
+   return loadTimes;
+}
+
+/**
+ * Call func(0) ... func(count - 1) on up to as many threads as there are
+ * hardware threads.
+ */
+void
+CPluginManager::RunInParallel(std::size_t count,
+      const std::function<void(std::size_t)>& func)
+{
+   if (count == 0)
+      return;
+   std::atomic<std::size_t> next{0};
+   auto worker = [count, &func, &next] {
+      for (std::size_t i = next++; i < count; i = next++)
+         func(i);
+   };
+   const std::size_t threadCount = std::min<std::size_t>(count,
+         std::max(1u, std::thread::hardware_concurrency()));
+   std::vector<std::thread> threads;
+   for (std::size_t t = 1; t < threadCount; ++t)
+      threads.emplace_back(worker);
+   worker();
+   for (auto& thread : threads)
+      thread.join();
+}
+
+void
+CPluginManager::SaveCatalog()
+{
+   try
+   {
+      catalog_.Save(catalogFile_);
+   }
+   catch (const CMMError&)
+   {
+      // The catalog is only a cache; it will be rebuilt next time
+   }
+}
+
+
 /** 
  * Unload a module.
  */
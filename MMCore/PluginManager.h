@@ -22,8 +22,11 @@
 
 #pragma once
 
+#include "DeviceAdapterCatalog.h"
 #include "MockDeviceAdapter.h"
 
+#include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -60,14 +63,39 @@ public:
 
    void LoadMockAdapter(const std::string& name, MockDeviceAdapter* impl);
 
+   // Device adapter catalog; an empty filename disables it
+   void SetCatalogFile(const std::string& filename);
+   std::string GetCatalogFile() const { return catalogFile_; }
+
+   /**
+    * Return the devices of a device adapter module, from the catalog if
+    * possible and loading the module otherwise
+    */
+   std::vector<DeviceAdapterCatalog::Device>
+   GetAvailableDevices(const std::string& moduleName);
+
+   std::map<std::string, std::chrono::steady_clock::duration>
+   LoadDeviceAdapters(const std::vector<std::string>& moduleNames);
+
 private:
    static std::vector<std::string> GetDefaultSearchPaths();
    static void GetModules(std::vector<std::string> &modules, const char *path);
    std::string FindInSearchPath(std::string filename);
+   static std::string GetLibraryFilename(const std::string& moduleName);
+   void RefreshCatalog();
+   static void RunInParallel(std::size_t count,
+         const std::function<void(std::size_t)>& func);
+   void SaveCatalog();
 
    std::vector<std::string> searchPaths_;
 
    std::map< std::string, std::shared_ptr<LoadedDeviceAdapter> > moduleMap_;
+
+   std::string catalogFile_;
+   DeviceAdapterCatalog catalog_;
+   // Libraries that failed to load when probed for the catalog, so that they
+   // are not probed again unless they change
+   std::map<std::string, DeviceAdapterCatalog::FileStamp> failedProbes_;
 };
 
 } // namespace internal
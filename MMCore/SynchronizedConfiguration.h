@@ -6,37 +6,153 @@
 
 #pragma once
 
+#include "ConfigGroup.h"
+#include "ConfigMatcher.h"
 #include "Configuration.h"
 
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
+// The settings are held in an immutable snapshot that is shared with
+// readers (copy-on-write): readers take a reference under the mutex instead
+// of copying, and a change copies the settings only if a reader still holds
+// the current snapshot.
+//
+// Also keeps track of which config group and pixel size presets match the
+// settings, so that the current presets can be looked up without comparing
+// every preset to the settings.
 class SynchronizedConfiguration {
 public:
+   enum class Presets { ConfigGroup, PixelSize };
+
    void addSetting(const PropertySetting& setting) {
       std::lock_guard<std::mutex> lock(mutex_);
-      config_.addSetting(setting);
+      writable().addSetting(setting);
+      const PropertyKey key(setting.getDeviceLabel(), setting.getPropertyName());
+      const std::string value = setting.getPropertyValue();
+      groupMatcher_.SetValue(key, value);
+      pixelSizeMatcher_.SetValue(key, value);
    }
 
    std::optional<PropertySetting> getSetting(const char* device,
          const char* prop) {
       std::lock_guard<std::mutex> lock(mutex_);
-      if (!config_.isPropertyIncluded(device, prop))
+      if (!config_->isPropertyIncluded(device, prop))
          return std::nullopt;
-      return config_.getSetting(device, prop);
+      return config_->getSetting(device, prop);
    }
 
-   Configuration get() const {
+   // The current settings, unaffected by later changes.
+   std::shared_ptr<const Configuration> snapshot() const {
       std::lock_guard<std::mutex> lock(mutex_);
       return config_;
    }
 
+   Configuration get() const { return *snapshot(); }
+
    void set(Configuration config) {
+      auto fresh = std::make_shared<Configuration>(std::move(config));
+      std::lock_guard<std::mutex> lock(mutex_);
+      config_ = std::move(fresh);
+      const auto lookup = lookupFunction();
+      groupMatcher_.ResetValues(lookup);
+      pixelSizeMatcher_.ResetValues(lookup);
+   }
+
+   // Compiles the presets of a group for matching, unless they have not
+   // changed since last compiled. Properties of liveDevice are not matched
+   // against the cache; their labels are returned, and their values must be
+   // passed to matchPresets().
+   template <class T>
+   std::vector<PropertyKey> compilePresets(Presets kind,
+         const std::string& group, const ConfigGroupBase<T>& presets,
+         const std::string& liveDevice = std::string()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      mmcore::internal::ConfigMatcher& matcher = getMatcher(kind);
+      if (!matcher.IsCompiled(group, presets.GetGeneration())) {
+         const std::vector<std::string> names = presets.GetAvailable();
+         std::vector<std::pair<std::string, const Configuration*>> configs;
+         configs.reserve(names.size());
+         for (const auto& name : names)
+            configs.emplace_back(name, presets.Find(name.c_str()));
+         matcher.Compile(group, presets.GetGeneration(), configs, liveDevice,
+            lookupFunction());
+      }
+      return matcher.GetLiveProperties(group);
+   }
+
+   // The first preset of a compiled group that matches the cached settings
+   // (or "" if none match), or nullopt if requireAll and the cache is
+   // missing any property included in the presets.
+   std::optional<std::string> matchPresets(Presets kind,
+         const std::string& group, const std::vector<std::string>& liveValues,
+         bool requireAll) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return getMatcher(kind).MatchCurrent(group, liveValues, requireAll);
+   }
+
+   // The first preset of a compiled group that matches values, given in the
+   // order of getPresetProperties().
+   std::string matchPresets(Presets kind, const std::string& group,
+         const std::vector<std::optional<std::string>>& values) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return getMatcher(kind).Match(group, values);
+   }
+
+   // The union of the properties included in the presets of a compiled
+   // group, in order of first appearance.
+   std::vector<PropertyKey> getPresetProperties(Presets kind,
+         const std::string& group) const {
       std::lock_guard<std::mutex> lock(mutex_);
-      config_ = std::move(config);
+      return getMatcher(kind).GetProperties(group);
+   }
+
+   void forgetPresets(Presets kind, const std::string& group) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      getMatcher(kind).Remove(group);
+   }
+
+   void forgetAllPresets() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      groupMatcher_.Clear();
+      pixelSizeMatcher_.Clear();
    }
 
 private:
+   // Must be called with mutex_ held. Snapshots can only be taken under the
+   // mutex, so a use count of 1 means no reader holds the current one (a
+   // reader dropping its snapshot concurrently at worst causes a needless
+   // copy).
+   Configuration& writable() {
+      if (config_.use_count() > 1)
+         config_ = std::make_shared<Configuration>(*config_);
+      return *config_;
+   }
+
+   mmcore::internal::ConfigMatcher& getMatcher(Presets kind) {
+      return kind == Presets::PixelSize ? pixelSizeMatcher_ : groupMatcher_;
+   }
+
+   const mmcore::internal::ConfigMatcher& getMatcher(Presets kind) const {
+      return kind == Presets::PixelSize ? pixelSizeMatcher_ : groupMatcher_;
+   }
+
+   // Must be called with mutex_ held, and the result used before releasing it
+   mmcore::internal::ConfigMatcher::ValueLookup lookupFunction() {
+      return [this](const PropertyKey& key) -> std::optional<std::string> {
+         if (!config_->isPropertyIncluded(key.first.c_str(), key.second.c_str()))
+            return std::nullopt;
+         return config_->getSetting(key.first.c_str(), key.second.c_str())
+            .getPropertyValue();
+      };
+   }
+
    mutable std::mutex mutex_;
-   Configuration config_;
+   std::shared_ptr<Configuration> config_ = std::make_shared<Configuration>();
+   mmcore::internal::ConfigMatcher groupMatcher_;
+   mmcore::internal::ConfigMatcher pixelSizeMatcher_;
 };
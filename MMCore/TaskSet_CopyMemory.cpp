@@ -23,13 +23,19 @@
 
 #include "TaskSet_CopyMemory.h"
 
+#include "MemoryCopy.h"
+
 #include <algorithm>
 #include <cassert>
-#include <cstring>
 
 namespace mmcore {
 namespace internal {
 
+// Frames are copied on the calling thread up to this size, and otherwise
+// split so that each task copies at least this many bytes. Measure with the
+// MMCoreTests "[MemCopyBenchmark]" test case.
+constexpr size_t minBytesPerCopyTask = 1000000;
+
 TaskSet_CopyMemory::ATask::ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount)
     : Task(semDone, taskIndex, totalTaskCount)
 {
@@ -56,7 +62,7 @@ void TaskSet_CopyMemory::ATask::Execute()
     void* dst = static_cast<char*>(dst_) + chunkOffset;
     const void* src = static_cast<const char*>(src_) + chunkOffset;
 
-    std::memcpy(dst, src, chunkBytes);
+    CopyFrameMemory(dst, src, chunkBytes, bytes_);
 }
 
 TaskSet_CopyMemory::TaskSet_CopyMemory(std::shared_ptr<ThreadPool> pool)
@@ -71,13 +77,12 @@ void TaskSet_CopyMemory::SetUp(void* dst, const void* src, size_t bytes)
     assert(src);
     assert(bytes > 0);
 
-    // Call memcpy directly without threading for small frames up to 1MB
-    // Otherwise do parallel copy and add one thread for each 1MB
-    // The limits were found experimentally
-    usedTaskCount_ = std::min<size_t>(1 + bytes / 1000000, tasks_.size());
+    // Copy directly without threading for small frames; otherwise do
+    // parallel copy and add one thread for each minBytesPerCopyTask
+    usedTaskCount_ = std::min<size_t>(1 + bytes / minBytesPerCopyTask, tasks_.size());
     if (usedTaskCount_ == 1)
     {
-        std::memcpy(dst, src, bytes);
+        CopyFrameMemory(dst, src, bytes, bytes);
         return;
     }
 
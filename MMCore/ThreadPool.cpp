@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
 //                and scaling number of threads based on hardware.
+//                Each thread has its own queue; idle threads steal
+//                tasks queued on busy ones.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -31,16 +33,56 @@
 #include <mutex>
 #include <thread>
 
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace mmcore {
 namespace internal {
 
-ThreadPool::ThreadPool()
+namespace {
+
+bool PinThread(std::thread& thread, size_t cpu)
+{
+#ifdef _WIN32
+    const size_t bits = 8 * sizeof(DWORD_PTR);
+    const DWORD_PTR mask = DWORD_PTR(1) << (cpu % bits);
+    return SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)cpu;
+    return false; // macOS only supports affinity hints
+#endif
+}
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(size_t threadCount, bool pinThreads)
+    : startTime_(std::chrono::steady_clock::now())
 {
     const size_t hwThreadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
-    for (size_t n = 0; n < hwThreadCount; ++n)
+    if (threadCount == 0)
+        threadCount = hwThreadCount;
+
+    // Create all workers before starting any thread, since threads steal
+    // from each other's queues.
+    for (size_t n = 0; n < threadCount; ++n)
+        workers_.push_back(std::make_unique<Worker>());
+
+    pinned_ = pinThreads;
+    for (size_t n = 0; n < threadCount; ++n)
     {
-        auto thread = std::make_unique<std::thread>(&ThreadPool::ThreadFunc, this);
-        threads_.push_back(std::move(thread));
+        workers_[n]->thread = std::thread(&ThreadPool::ThreadFunc, this, n);
+        if (pinThreads && !PinThread(workers_[n]->thread, n % hwThreadCount))
+            pinned_ = false;
     }
 }
 
@@ -49,28 +91,35 @@ ThreadPool::~ThreadPool()
     {
         std::lock_guard<std::mutex> lock(mx_);
         abortFlag_ = true;
+        aborting_ = true;
     }
     cv_.notify_all();
 
-    for (const auto& thread : threads_)
-        thread->join();
+    for (const auto& worker : workers_)
+        worker->thread.join();
 }
 
 size_t ThreadPool::GetSize() const
 {
-    return threads_.size();
+    return workers_.size();
 }
 
 void ThreadPool::Execute(Task* task)
+{
+    Execute(task, nextWorker_.fetch_add(1, std::memory_order_relaxed));
+}
+
+void ThreadPool::Execute(Task* task, size_t preferredWorker)
 {
     assert(task);
     {
         std::lock_guard<std::mutex> lock(mx_);
         if (abortFlag_)
             return;
-        queue_.push_back(task);
+        ++pending_;
     }
-    cv_.notify_one();
+    Enqueue(task, preferredWorker % workers_.size());
+    NotifyQueued(1);
 }
 
 void ThreadPool::Execute(const std::vector<Task*>& tasks)
@@ -81,29 +130,111 @@ void ThreadPool::Execute(const std::vector<Task*>& tasks)
         std::lock_guard<std::mutex> lock(mx_);
         if (abortFlag_)
             return;
-        for (Task* task : tasks)
+        pending_ += tasks.size();
+    }
+    for (size_t n = 0; n < tasks.size(); ++n)
+    {
+        assert(tasks[n]);
+        Enqueue(tasks[n], n % workers_.size());
+    }
+    NotifyQueued(tasks.size());
+}
+
+void ThreadPool::Enqueue(Task* task, size_t worker)
+{
+    std::lock_guard<std::mutex> lock(workers_[worker]->mx);
+    workers_[worker]->queue.push_back(task);
+}
+
+void ThreadPool::NotifyQueued(size_t count)
+{
+    // Synchronize with workers that are about to wait, so that the wakeup is
+    // not lost.
+    {
+        std::lock_guard<std::mutex> lock(mx_);
+    }
+    if (count == 1)
+        cv_.notify_one();
+    else
+        cv_.notify_all();
+}
+
+std::vector<ThreadPool::WorkerStats> ThreadPool::GetWorkerStats() const
+{
+    std::vector<WorkerStats> stats(workers_.size());
+    for (size_t n = 0; n < workers_.size(); ++n)
+    {
+        stats[n].tasksExecuted = workers_[n]->tasksExecuted.load();
+        stats[n].tasksStolen = workers_[n]->tasksStolen.load();
+        stats[n].busyTime = std::chrono::nanoseconds(workers_[n]->busyNs.load());
+    }
+    return stats;
+}
+
+std::chrono::nanoseconds ThreadPool::GetUptime() const
+{
+    return std::chrono::steady_clock::now() - startTime_;
+}
+
+// Take the oldest task from the worker's own queue or, failing that, the
+// newest task from another worker's queue (the one its owner would get to
+// last).
+Task* ThreadPool::TakeTask(size_t index, bool& stolen)
+{
+    {
+        Worker& self = *workers_[index];
+        std::lock_guard<std::mutex> lock(self.mx);
+        if (!self.queue.empty())
         {
-            assert(task);
-            queue_.push_back(task);
+            Task* task = self.queue.front();
+            self.queue.pop_front();
+            stolen = false;
+            return task;
         }
     }
-    cv_.notify_all();
+    for (size_t i = 1; i < workers_.size(); ++i)
+    {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mx);
+        if (!victim.queue.empty())
+        {
+            Task* task = victim.queue.back();
+            victim.queue.pop_back();
+            stolen = true;
+            return task;
+        }
+    }
+    return nullptr;
 }
 
-void ThreadPool::ThreadFunc()
+void ThreadPool::ThreadFunc(size_t index)
 {
+    Worker& self = *workers_[index];
     for (;;)
     {
-        Task* task = nullptr;
+        if (aborting_)
+            break;
+
+        bool stolen = false;
+        Task* task = TakeTask(index, stolen);
+        if (!task)
         {
             std::unique_lock<std::mutex> lock(mx_);
-            cv_.wait(lock, [&]() { return abortFlag_ || !queue_.empty(); });
+            cv_.wait(lock, [&]() { return abortFlag_ || pending_ > 0; });
             if (abortFlag_)
                 break;
-            task = queue_.front();
-            queue_.pop_front();
+            // A pending task may not be in a queue yet; retry taking one.
+            continue;
         }
+        --pending_;
+
+        const auto start = std::chrono::steady_clock::now();
         task->Execute();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        self.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        ++self.tasksExecuted;
+        if (stolen)
+            ++self.tasksStolen;
         task->Done();
     }
 }
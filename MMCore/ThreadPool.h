@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
 //                and scaling number of threads based on hardware.
+//                Each thread has its own queue; idle threads steal
+//                tasks queued on busy ones.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -24,7 +26,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -39,23 +44,64 @@ class Task;
 class ThreadPool final
 {
 public:
-    explicit ThreadPool();
+    struct WorkerStats
+    {
+        std::uint64_t tasksExecuted{ 0 };
+        std::uint64_t tasksStolen{ 0 }; // Executed tasks queued on another worker
+        std::chrono::nanoseconds busyTime{ 0 };
+    };
+
+    // threadCount 0 means one thread per hardware thread. If pinThreads is
+    // set, worker n is pinned to CPU n (modulo the CPU count) where the OS
+    // supports it.
+    explicit ThreadPool(size_t threadCount = 0, bool pinThreads = false);
     ~ThreadPool();
 
     size_t GetSize() const;
+    bool IsPinned() const { return pinned_; }
 
+    // Queue a task on the next worker in turn, or on a preferred worker
+    // (modulo the pool size). Queued tasks may be stolen by idle workers, so
+    // the preference is a hint for cache (and, if pinned, CPU) locality.
     void Execute(Task* task);
+    void Execute(Task* task, size_t preferredWorker);
+    // Task n is queued on worker n (modulo the pool size).
     void Execute(const std::vector<Task*>& tasks);
 
+    std::vector<WorkerStats> GetWorkerStats() const;
+    // Time since the pool was created, for computing utilization.
+    std::chrono::nanoseconds GetUptime() const;
+
 private:
-    void ThreadFunc();
+    struct Worker
+    {
+        std::mutex mx{};
+        std::deque<Task*> queue{};
+        std::atomic<std::uint64_t> tasksExecuted{ 0 };
+        std::atomic<std::uint64_t> tasksStolen{ 0 };
+        std::atomic<std::int64_t> busyNs{ 0 };
+        std::thread thread{};
+    };
+
+    void ThreadFunc(size_t index);
+    Task* TakeTask(size_t index, bool& stolen);
+    void Enqueue(Task* task, size_t worker);
+    void NotifyQueued(size_t count);
 
 private:
-    std::vector<std::unique_ptr<std::thread>> threads_{};
-    bool abortFlag_{ false };
+    std::vector<std::unique_ptr<Worker>> workers_{};
+    const std::chrono::steady_clock::time_point startTime_;
+    bool pinned_{ false };
+    std::atomic<size_t> nextWorker_{ 0 };
+
+    // Number of tasks queued but not yet taken by a worker; idle workers
+    // sleep on cv_ while it is zero. Incremented under mx_ (before the
+    // tasks are queued) so that wakeups are not lost.
+    std::atomic<size_t> pending_{ 0 };
+    bool abortFlag_{ false }; // Guarded by mx_
+    std::atomic<bool> aborting_{ false };
     std::mutex mx_{};
     std::condition_variable cv_{};
-    std::deque<Task*> queue_{};
 };
 
 } // namespace internal
@@ -0,0 +1,79 @@
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+// mmlogdecode: write binary MMCore log files to stdout in the text format.
+//
+// Usage: mmlogdecode [FILE...]
+//
+// Files are decoded in the order given (pass rotated files oldest first);
+// with no arguments, stdin is decoded.
+
+#include "Logging/BinaryLogFormat.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int Decode(std::istream& in, const std::string& name)
+{
+   using namespace mmcore::internal::logging;
+   switch (DecodeBinaryLog(in, std::cout))
+   {
+      case BinaryLogDecodeOK:
+         return 0;
+      case BinaryLogDecodeTruncated:
+         std::cerr << "mmlogdecode: warning: " << name <<
+            " ends with an incomplete record\n";
+         return 0;
+      case BinaryLogDecodeNotBinaryLog:
+      default:
+         std::cerr << "mmlogdecode: " << name << " is not a binary log\n";
+         return 1;
+   }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+   std::ios_base::sync_with_stdio(false);
+
+   if (argc < 2)
+      return Decode(std::cin, "(stdin)");
+
+   int result = 0;
+   for (int i = 1; i < argc; ++i)
+   {
+      if (std::strcmp(argv[i], "-h") == 0 ||
+            std::strcmp(argv[i], "--help") == 0)
+      {
+         std::cout << "Usage: mmlogdecode [FILE...]\n"
+            "Write binary MMCore log files to stdout in the text format.\n";
+         return 0;
+      }
+   }
+   for (int i = 1; i < argc; ++i)
+   {
+      std::ifstream file(argv[i], std::ios_base::binary);
+      if (!file)
+      {
+         std::cerr << "mmlogdecode: cannot open " << argv[i] << '\n';
+         result = 1;
+         continue;
+      }
+      if (Decode(file, argv[i]) != 0)
+         result = 1;
+   }
+   return result;
+}
@@ -0,0 +1,133 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+
+#include <string>
+
+namespace {
+
+// "Mode" can only be set to "fast" while "Enabled" is "1".
+struct DependentDevice : CGenericBase<DependentDevice> {
+   std::string name = "DependentDevice";
+   bool enabled = false;
+   int modeFailures = 0;
+
+   int Initialize() override {
+      CreateStringProperty("Enabled", "0", false, new MM::ActionLambda(
+         [this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::AfterSet) {
+               std::string v;
+               pProp->Get(v);
+               enabled = v == "1";
+            }
+            return DEVICE_OK;
+         }));
+      CreateStringProperty("Mode", "slow", false, new MM::ActionLambda(
+         [this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::AfterSet) {
+               std::string v;
+               pProp->Get(v);
+               if (v == "fast" && !enabled) {
+                  ++modeFailures;
+                  return DEVICE_ERR;
+               }
+            }
+            return DEVICE_OK;
+         }));
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+};
+
+} // namespace
+
+TEST_CASE("Parallel config apply sets different modules concurrently") {
+   RendezvousDevice dev1{RendezvousDevice::MeetIn::SetValue};
+   RendezvousDevice dev2{RendezvousDevice::MeetIn::SetValue};
+   MockAdapterWithDevices adapter1{"adapter1", {{"dev1", &dev1}}};
+   MockAdapterWithDevices adapter2{"adapter2", {{"dev2", &dev2}}};
+   CMMCore c;
+   adapter1.LoadIntoCore(c);
+   adapter2.LoadIntoCore(c);
+
+   c.defineConfig("G", "P", "dev1", "Value", "1");
+   c.defineConfig("G", "P", "dev2", "Value", "1");
+
+   c.setProperty("Core", "ParallelConfigApply", "1");
+   c.setConfig("G", "P");
+   CHECK(dev1.overlapped);
+   CHECK(dev2.overlapped);
+   CHECK(c.getProperty("dev1", "Value") == "1");
+   CHECK(c.getPropertyFromCache("dev2", "Value") == "1");
+   CHECK(c.getCurrentConfigFromCache("G") == "P");
+}
+
+TEST_CASE("Config apply retries failed settings and learns their order") {
+   DependentDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   // Mode is applied first, in order of definition
+   c.defineConfig("G", "Fast", "dev", "Mode", "fast");
+   c.defineConfig("G", "Fast", "dev", "Enabled", "1");
+   c.defineConfig("G", "Off", "dev", "Enabled", "0");
+
+   const auto reapplyFast = [&] {
+      c.setConfig("G", "Off");
+      c.setProperty("dev", "Mode", "slow");
+      c.setConfig("G", "Fast");
+      CHECK(c.getProperty("dev", "Mode") == "fast");
+   };
+
+   SECTION("Sequential apply keeps the order of definition") {
+      c.setConfig("G", "Fast");
+      CHECK(dev.modeFailures == 1);
+      CHECK(c.getProperty("dev", "Mode") == "fast");
+      reapplyFast();
+      CHECK(dev.modeFailures == 2);
+   }
+
+   SECTION("Parallel apply learns the order") {
+      c.setProperty("Core", "ParallelConfigApply", "1");
+      c.setConfig("G", "Fast");
+      CHECK(dev.modeFailures == 1);
+      CHECK(c.getProperty("dev", "Mode") == "fast");
+      reapplyFast();
+      CHECK(dev.modeFailures == 1);
+
+      // Switching to sequential apply returns to the order of definition
+      c.setProperty("Core", "ParallelConfigApply", "0");
+      reapplyFast();
+      CHECK(dev.modeFailures == 2);
+   }
+
+   SECTION("Unloading devices forgets the learned order") {
+      c.setProperty("Core", "ParallelConfigApply", "1");
+      c.setConfig("G", "Fast");
+      CHECK(dev.modeFailures == 1);
+      c.unloadAllDevices();
+      c.loadDevice("dev", "mock_adapter", "dev");
+      c.initializeDevice("dev");
+      c.setProperty("Core", "ParallelConfigApply", "1");
+      c.defineConfig("G", "Fast", "dev", "Mode", "fast");
+      c.defineConfig("G", "Fast", "dev", "Enabled", "1");
+      c.defineConfig("G", "Off", "dev", "Enabled", "0");
+      reapplyFast();
+      CHECK(dev.modeFailures == 2);
+   }
+
+   SECTION("Settings that never succeed are still an error") {
+      const char* parallel = GENERATE("0", "1");
+      c.setProperty("Core", "ParallelConfigApply", parallel);
+      c.defineConfig("G", "Broken", "dev", "Mode", "fast");
+      CHECK_THROWS_AS(c.setConfig("G", "Broken"), CMMError);
+   }
+}
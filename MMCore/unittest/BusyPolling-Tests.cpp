@@ -0,0 +1,102 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Reports its busy state to the core; Busy() should never be called.
+struct ReportingDevice : CGenericBase<ReportingDevice> {
+   std::string name = "ReportingDevice";
+   std::atomic<int> busyCalls{0};
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override {
+      ++busyCalls;
+      return false;
+   }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+
+   using CGenericBase<ReportingDevice>::OnBusyChanged;
+   using CGenericBase<ReportingDevice>::OnPropertyChanged;
+};
+
+} // namespace
+
+TEST_CASE("Parallel busy polling polls different modules concurrently") {
+   RendezvousDevice dev1{RendezvousDevice::MeetIn::Busy};
+   RendezvousDevice dev2{RendezvousDevice::MeetIn::Busy};
+   MockAdapterWithDevices adapter1{"adapter1", {{"dev1", &dev1}}};
+   MockAdapterWithDevices adapter2{"adapter2", {{"dev2", &dev2}}};
+   CMMCore c;
+   adapter1.LoadIntoCore(c);
+   adapter2.LoadIntoCore(c);
+
+   c.setProperty("Core", "ParallelBusyPolling", "1");
+   CHECK_FALSE(c.systemBusy());
+   CHECK(dev1.overlapped);
+   CHECK(dev2.overlapped);
+
+   dev1.overlapped = dev2.overlapped = false;
+   c.waitForSystem();
+   CHECK(dev1.overlapped);
+   CHECK(dev2.overlapped);
+
+   dev2.busy = true;
+   CHECK(c.systemBusy());
+   c.setDeviceTimeoutMs("dev2", 50);
+   CHECK_THROWS_AS(c.waitForSystem(), CMMError);
+}
+
+TEST_CASE("Devices that report their busy state are not polled") {
+   ReportingDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   const char* parallel = GENERATE("0", "1");
+   c.setProperty("Core", "ParallelBusyPolling", parallel);
+
+   REQUIRE(dev.OnBusyChanged(true) == DEVICE_OK);
+   CHECK(c.deviceBusy("dev"));
+   CHECK(c.systemBusy());
+
+   std::thread reporter([&dev] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      dev.OnBusyChanged(false);
+   });
+   c.waitForDevice("dev");
+   reporter.join();
+   CHECK_FALSE(c.deviceBusy("dev"));
+   CHECK_FALSE(c.systemBusy());
+   c.waitForSystem();
+
+   dev.OnBusyChanged(true);
+   c.setDeviceTimeoutMs("dev", 20);
+   CHECK_THROWS_AS(c.waitForDevice("dev"), CMMError);
+   dev.OnBusyChanged(false);
+
+   CHECK(dev.busyCalls == 0);
+}
+
+TEST_CASE("A property named Busy does not report the busy state") {
+   ReportingDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   // Some adapters have a real property of this name
+   REQUIRE(dev.OnPropertyChanged("Busy", "1") == DEVICE_OK);
+   CHECK_FALSE(c.deviceBusy("dev"));
+   CHECK(dev.busyCalls > 0);
+}
@@ -6,7 +6,15 @@
 #include "MockDeviceUtils.h"
 #include "StubDevices.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
 #include <vector>
 
 // Initialization
@@ -460,3 +468,774 @@ TEST_CASE("clearCircularBuffer resets overflow flag", "[CircularBuffer]") {
    c.clearCircularBuffer();
    CHECK(c.isBufferOverflowed() == false);
 }
+
+// Lock-free engine
+
+TEST_CASE("Lock-free engine preserves buffer semantics", "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", "LockFree");
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   const long total = c.getBufferTotalCapacity();
+   REQUIRE(total == 4);
+
+   const std::size_t frameBytes =
+      static_cast<std::size_t>(cam.width) * cam.height;
+   auto insertNumbered = [&](unsigned char n) {
+      std::vector<unsigned char> pixels(frameBytes, n);
+      return cam.InsertTestImage(MM::CameraImageMetadata{}, pixels.data());
+   };
+
+   SECTION("FIFO order and counts") {
+      REQUIRE(insertNumbered(1) == DEVICE_OK);
+      REQUIRE(insertNumbered(2) == DEVICE_OK);
+      REQUIRE(insertNumbered(3) == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 3);
+      CHECK(c.getBufferFreeCapacity() == 1);
+      CHECK(*static_cast<unsigned char*>(c.getLastImage()) == 3);
+      Metadata md;
+      CHECK(*static_cast<unsigned char*>(c.getNBeforeLastImageMD(2, md)) == 1);
+      CHECK_THROWS(c.getNBeforeLastImageMD(3, md));
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 1);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 2);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 3);
+      CHECK_THROWS(c.popNextImage());
+      CHECK(c.getBufferFreeCapacity() == total);
+   }
+
+   SECTION("Mismatched image is rejected") {
+      cam.width = 256;
+      CHECK(cam.InsertTestImage() == DEVICE_INCOMPATIBLE_IMAGE);
+      CHECK(c.getRemainingImageCount() == 0);
+   }
+
+   SECTION("Overflow with overwrite disabled is sticky until clear") {
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      CHECK(insertNumbered(99) == DEVICE_BUFFER_OVERFLOW);
+      CHECK(c.isBufferOverflowed());
+      CHECK(c.getRemainingImageCount() == total);
+      REQUIRE(c.popNextImage() != nullptr);
+      CHECK(insertNumbered(99) == DEVICE_BUFFER_OVERFLOW);
+      c.clearCircularBuffer();
+      CHECK_FALSE(c.isBufferOverflowed());
+      CHECK(c.getRemainingImageCount() == 0);
+      CHECK(insertNumbered(99) == DEVICE_OK);
+   }
+
+   SECTION("Overflow with overwrite enabled discards old images") {
+      c.startSequenceAcquisition(100, 0.0, false);
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      CHECK(insertNumbered(99) == DEVICE_OK);
+      CHECK_FALSE(c.isBufferOverflowed());
+      CHECK(c.getRemainingImageCount() == 1);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 99);
+   }
+}
+
+TEST_CASE("Lock-free engine delivers frames in order to a concurrent reader",
+          "[CircularBuffer]") {
+   StubCamera cam;
+   cam.width = 16;
+   cam.height = 16;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", "LockFree");
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   const long total = c.getBufferTotalCapacity();
+   REQUIRE(total >= 1000);
+   const unsigned nFrames = static_cast<unsigned>(total);
+
+   std::thread producer([&] {
+      std::vector<unsigned char> pixels(16 * 16);
+      for (unsigned i = 0; i < nFrames; ++i) {
+         std::memcpy(pixels.data(), &i, sizeof(i));
+         cam.InsertTestImage(MM::CameraImageMetadata{}, pixels.data());
+      }
+   });
+
+   unsigned expected = 0;
+   bool inOrder = true;
+   while (expected < nFrames) {
+      if (c.getRemainingImageCount() == 0) {
+         std::this_thread::yield();
+         continue;
+      }
+      unsigned n;
+      std::memcpy(&n, c.popNextImage(), sizeof(n));
+      inOrder = inOrder && (n == expected);
+      ++expected;
+   }
+   producer.join();
+
+   CHECK(inOrder);
+   CHECK_FALSE(c.isBufferOverflowed());
+   CHECK(c.getRemainingImageCount() == 0);
+}
+
+// Two-phase (zero-copy) insertion
+
+TEST_CASE("Write slot commit publishes the image in place",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   const std::size_t frameBytes =
+      static_cast<std::size_t>(cam.width) * cam.height;
+
+   SECTION("Commit") {
+      unsigned char* pixels = nullptr;
+      REQUIRE(cam.AcquireTestWriteSlot(&pixels) == DEVICE_OK);
+      REQUIRE(pixels != nullptr);
+      CHECK(c.getRemainingImageCount() == 0);
+      std::memset(pixels, 42, frameBytes);
+      MM::CameraImageMetadata md;
+      md.AddTag("TestTag", "TestValue");
+      REQUIRE(cam.CommitTestWriteSlot(pixels, md) == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 1);
+      Metadata outMd;
+      auto* img = static_cast<unsigned char*>(c.popNextImageMD(outMd));
+      CHECK(img == pixels);
+      CHECK(img[0] == 42);
+      CHECK(img[frameBytes - 1] == 42);
+      CHECK(outMd.GetSingleTag("TestTag").GetValue() == "TestValue");
+   }
+
+   SECTION("Abort publishes nothing and frees the slot") {
+      unsigned char* pixels = nullptr;
+      REQUIRE(cam.AcquireTestWriteSlot(&pixels) == DEVICE_OK);
+      REQUIRE(cam.AbortTestWriteSlot(pixels) == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 0);
+      CHECK(c.getBufferFreeCapacity() == c.getBufferTotalCapacity());
+      CHECK(cam.InsertTestImage() == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 1);
+   }
+
+   SECTION("Unknown pointer is rejected") {
+      unsigned char bogus[4] = {};
+      CHECK(cam.CommitTestWriteSlot(bogus) == DEVICE_INVALID_INPUT_PARAM);
+      CHECK(cam.AbortTestWriteSlot(bogus) == DEVICE_INVALID_INPUT_PARAM);
+      CHECK(cam.AcquireTestWriteSlot(nullptr) == DEVICE_INVALID_INPUT_PARAM);
+   }
+
+   SECTION("Mismatched image is rejected at acquire") {
+      const unsigned width = cam.width;
+      cam.width = width * 2;
+      unsigned char* pixels = nullptr;
+      CHECK(cam.AcquireTestWriteSlot(&pixels) == DEVICE_INCOMPATIBLE_IMAGE);
+      cam.width = width;
+      CHECK(cam.InsertTestImage() == DEVICE_OK);
+   }
+
+   SECTION("Overflow with overwrite disabled") {
+      const long total = c.getBufferTotalCapacity();
+      for (long i = 0; i < total; ++i) {
+         unsigned char* pixels = nullptr;
+         REQUIRE(cam.AcquireTestWriteSlot(&pixels) == DEVICE_OK);
+         REQUIRE(cam.CommitTestWriteSlot(pixels) == DEVICE_OK);
+      }
+      unsigned char* pixels = nullptr;
+      CHECK(cam.AcquireTestWriteSlot(&pixels) == DEVICE_BUFFER_OVERFLOW);
+      CHECK(c.isBufferOverflowed());
+   }
+
+   SECTION("Buffer is not resized or reinitialized while a slot is open") {
+      unsigned char* pixels = nullptr;
+      REQUIRE(cam.AcquireTestWriteSlot(&pixels) == DEVICE_OK);
+      CHECK_THROWS(c.setCircularBufferMemoryFootprint(2));
+      CHECK_THROWS(c.initializeCircularBuffer());
+      REQUIRE(cam.CommitTestWriteSlot(pixels) == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 1);
+      c.setCircularBufferMemoryFootprint(2);
+      c.initializeCircularBuffer();
+      CHECK(cam.InsertTestImage() == DEVICE_OK);
+   }
+}
+
+TEST_CASE("Write slot is aborted when processing the image throws",
+          "[CircularBuffer]") {
+   struct ThrowingImageProcessor : StubImageProcessor {
+      int Process(unsigned char*, unsigned, unsigned, unsigned) override {
+         throw std::bad_alloc();
+      }
+   };
+
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   ThrowingImageProcessor ip;
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"ip", &ip}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("ip");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   unsigned char* pixels = nullptr;
+   REQUIRE(cam.AcquireTestWriteSlot(&pixels) == DEVICE_OK);
+   CHECK(cam.CommitTestWriteSlot(pixels) == DEVICE_ERR);
+   CHECK(c.getRemainingImageCount() == 0);
+
+   // With the Mutex engine, these would block if the slot were left open
+   c.setImageProcessorDevice("");
+   CHECK(cam.InsertTestImage() == DEVICE_OK);
+   CHECK(c.getRemainingImageCount() == 1);
+   c.setCircularBufferMemoryFootprint(2);
+}
+
+TEST_CASE("Lock-free engine skips aborted slots committed out of order",
+          "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", "LockFree");
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   unsigned char* first = nullptr;
+   unsigned char* second = nullptr;
+   REQUIRE(cam.AcquireTestWriteSlot(&first) == DEVICE_OK);
+   REQUIRE(cam.AcquireTestWriteSlot(&second) == DEVICE_OK);
+   REQUIRE(first != second);
+   second[0] = 7;
+
+   // The first slot cannot be rolled back once the second is reserved, so it
+   // is published as a discarded frame that readers never see.
+   REQUIRE(cam.AbortTestWriteSlot(first) == DEVICE_OK);
+   REQUIRE(cam.CommitTestWriteSlot(second) == DEVICE_OK);
+
+   CHECK(c.getRemainingImageCount() == 1);
+   CHECK(static_cast<unsigned char*>(c.getLastImage())[0] == 7);
+   Metadata md;
+   CHECK_THROWS(c.getNBeforeLastImageMD(1, md));
+   auto* img = static_cast<unsigned char*>(c.popNextImage());
+   CHECK(img[0] == 7);
+   CHECK(c.getRemainingImageCount() == 0);
+   CHECK_THROWS(c.popNextImage());
+}
+
+TEST_CASE("Lock-free engine peeks skip aborted slots", "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", "LockFree");
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   unsigned char* first = nullptr;
+   unsigned char* second = nullptr;
+   unsigned char* third = nullptr;
+   REQUIRE(cam.AcquireTestWriteSlot(&first) == DEVICE_OK);
+   REQUIRE(cam.AcquireTestWriteSlot(&second) == DEVICE_OK);
+   REQUIRE(cam.AcquireTestWriteSlot(&third) == DEVICE_OK);
+   first[0] = 5;
+   third[0] = 9;
+   REQUIRE(cam.CommitTestWriteSlot(first) == DEVICE_OK);
+   // Published as discarded, as the third slot is reserved
+   REQUIRE(cam.AbortTestWriteSlot(second) == DEVICE_OK);
+
+   // The newest published frame is the discarded one
+   CHECK(c.getRemainingImageCount() == 1);
+   CHECK(static_cast<unsigned char*>(c.getLastImage())[0] == 5);
+   CHECK(*static_cast<unsigned char*>(c.getLastFrame().getPixels()) == 5);
+   CHECK_THROWS(c.getNBeforeLastFrame(1));
+   Metadata md;
+   CHECK_THROWS(c.getNBeforeLastImageMD(1, md));
+
+   REQUIRE(cam.CommitTestWriteSlot(third) == DEVICE_OK);
+   CHECK(c.getRemainingImageCount() == 2);
+   CHECK(static_cast<unsigned char*>(c.getLastImage())[0] == 9);
+   CHECK(static_cast<unsigned char*>(c.getNBeforeLastImageMD(1, md))[0] == 5);
+   CHECK(*static_cast<unsigned char*>(c.getNBeforeLastFrame(1).getPixels()) == 5);
+
+   CHECK(static_cast<unsigned char*>(c.popNextImage())[0] == 5);
+   CHECK(static_cast<unsigned char*>(c.popNextImage())[0] == 9);
+   CHECK(c.getRemainingImageCount() == 0);
+}
+
+// Frame handles
+
+TEST_CASE("Frame handles are not overwritten when the buffer wraps",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   const std::string storage = GENERATE("Heap", "Arena");
+   CAPTURE(engine, storage);
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.setProperty("Core", "CircularBufferStorage", storage.c_str());
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+
+   const long total = c.getBufferTotalCapacity();
+   REQUIRE(total == 4);
+
+   const std::size_t frameBytes =
+      static_cast<std::size_t>(cam.width) * cam.height;
+   auto insertNumbered = [&](unsigned char n) {
+      std::vector<unsigned char> pixels(frameBytes, n);
+      MM::CameraImageMetadata md;
+      md.AddTag("Number", std::to_string(n).c_str());
+      return cam.InsertTestImage(md, pixels.data());
+   };
+   auto firstByte = [](const FrameHandle& h) {
+      return *static_cast<unsigned char*>(h.getPixels());
+   };
+   auto lastByte = [&](const FrameHandle& h) {
+      return static_cast<unsigned char*>(h.getPixels())[frameBytes - 1];
+   };
+
+   SECTION("Empty buffer throws") {
+      CHECK_THROWS(c.popNextFrame());
+      CHECK_THROWS(c.getLastFrame());
+      CHECK_THROWS(c.getNBeforeLastFrame(0));
+   }
+
+   SECTION("Popped frame survives reuse of its slot") {
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      FrameHandle h = c.popNextFrame();
+      REQUIRE(h.isValid());
+      CHECK(h.getSizeBytes() == frameBytes);
+      CHECK(c.getRemainingImageCount() == total - 1);
+
+      REQUIRE(insertNumbered(99) == DEVICE_OK);
+      CHECK(firstByte(h) == 0);
+      CHECK(lastByte(h) == 0);
+      Metadata md;
+      h.getMetadata(md);
+      CHECK(md.GetSingleTag("Number").GetValue() == "0");
+
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 1);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 2);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 3);
+      CHECK(*static_cast<unsigned char*>(c.popNextImage()) == 99);
+      CHECK(firstByte(h) == 0);
+   }
+
+   SECTION("Peeked frame survives overwrite") {
+      c.startSequenceAcquisition(100, 0.0, false);
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      FrameHandle last = c.getLastFrame();
+      FrameHandle first = c.getNBeforeLastFrame(total - 1);
+      CHECK(firstByte(last) == total - 1);
+      CHECK(firstByte(first) == 0);
+
+      for (long i = 0; i < 2 * total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(50 + i)) == DEVICE_OK);
+      CHECK(firstByte(last) == total - 1);
+      CHECK(lastByte(last) == total - 1);
+      CHECK(firstByte(first) == 0);
+      c.stopSequenceAcquisition();
+   }
+
+   SECTION("Released slots are reused") {
+      for (long round = 0; round < 3; ++round) {
+         for (long i = 0; i < total; ++i)
+            REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+         for (long i = 0; i < total; ++i) {
+            FrameHandle h = c.popNextFrame();
+            CHECK(firstByte(h) == i);
+         }
+      }
+   }
+
+   SECTION("Handle outlives the buffer") {
+      REQUIRE(insertNumbered(7) == DEVICE_OK);
+      FrameHandle h = c.popNextFrame();
+      FrameHandle copy = h;
+      c.setCircularBufferMemoryFootprint(2);
+      c.initializeCircularBuffer();
+      CHECK(firstByte(copy) == 7);
+      h.release();
+      CHECK_FALSE(h.isValid());
+      CHECK(h.getPixels() == nullptr);
+      CHECK(h.getSizeBytes() == 0);
+      CHECK(lastByte(copy) == 7);
+   }
+}
+
+TEST_CASE("Lock-free engine hands out intact frames to a concurrent reader",
+          "[CircularBuffer]") {
+   StubCamera cam;
+   cam.width = 16;
+   cam.height = 16;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", "LockFree");
+   c.setCircularBufferMemoryFootprint(1);
+   // Overwrite mode, so that the producer keeps reusing slots
+   c.startSequenceAcquisition(0, 0.0, false);
+
+   const unsigned nFrames = 20000;
+   std::atomic<bool> done{false};
+   std::thread producer([&] {
+      std::vector<unsigned char> pixels(16 * 16);
+      for (unsigned i = 0; i < nFrames; ++i) {
+         std::fill(pixels.begin(), pixels.end(),
+            static_cast<unsigned char>(i));
+         cam.InsertTestImage(MM::CameraImageMetadata{}, pixels.data());
+      }
+      done = true;
+   });
+
+   bool intact = true;
+   std::vector<FrameHandle> held;
+   while (!done) {
+      try {
+         held.push_back(c.getLastFrame());
+      } catch (const CMMError&) {
+         continue;
+      }
+      if (held.size() == 8) {
+         for (const auto& h : held) {
+            const auto* p = static_cast<const unsigned char*>(h.getPixels());
+            intact = intact && std::all_of(p, p + 16 * 16,
+               [&](unsigned char v) { return v == p[0]; });
+         }
+         held.clear();
+      }
+   }
+   producer.join();
+   c.stopSequenceAcquisition();
+
+   CHECK(intact);
+}
+
+TEST_CASE("Arena storage is used after reinitialization", "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setCircularBufferMemoryFootprint(4);
+   c.initializeCircularBuffer();
+   const long heapCapacity = c.getBufferTotalCapacity();
+
+   c.setProperty("Core", "CircularBufferStorage", "Arena");
+   // Huge pages and NUMA binding are requests; allocation must succeed
+   // (falling back to regular pages and default placement) regardless of
+   // system configuration.
+   c.setProperty("Core", "CircularBufferHugePages", "1");
+   c.setProperty("Core", "CircularBufferNumaNode", "0");
+   c.setProperty("Core", "CircularBufferPrefault", "1");
+   c.initializeCircularBuffer();
+   CHECK(c.getBufferTotalCapacity() == heapCapacity);
+   CHECK(std::stod(c.getProperty("Core",
+      "CircularBufferAllocationTimeMs")) >= 0.0);
+   CHECK(std::stol(c.getProperty("Core",
+      "CircularBufferAllocationPageFaults")) >= -1);
+
+   std::vector<unsigned char> pixels(
+      static_cast<std::size_t>(cam.width) * cam.height);
+   for (long i = 0; i < 2 * heapCapacity; ++i) {
+      std::fill(pixels.begin(), pixels.end(), static_cast<unsigned char>(i));
+      REQUIRE(cam.InsertTestImage(MM::CameraImageMetadata{},
+         pixels.data()) == DEVICE_OK);
+      const auto* img = static_cast<const unsigned char*>(c.popNextImage());
+      CHECK(img[0] == static_cast<unsigned char>(i));
+      CHECK(img[pixels.size() - 1] == static_cast<unsigned char>(i));
+   }
+
+   c.setProperty("Core", "CircularBufferStorage", "Heap");
+   c.initializeCircularBuffer();
+   CHECK(c.getBufferTotalCapacity() == heapCapacity);
+}
+
+TEST_CASE("Frames beyond memory capacity spill to file in order",
+          "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setCircularBufferMemoryFootprint(1);
+   c.setProperty("Core", "CircularBufferSpillDirectory",
+      std::filesystem::temp_directory_path().string().c_str());
+   c.setProperty("Core", "CircularBufferSpillSizeMB", "2");
+   c.initializeCircularBuffer();
+
+   // 4 frames in memory plus 8 in the spill file
+   const long total = c.getBufferTotalCapacity();
+   REQUIRE(total == 12);
+
+   const std::size_t frameBytes =
+      static_cast<std::size_t>(cam.width) * cam.height;
+   auto insertNumbered = [&](unsigned char n) {
+      std::vector<unsigned char> pixels(frameBytes, n);
+      pixels.back() = static_cast<unsigned char>(n + 1);
+      return cam.InsertTestImage(MM::CameraImageMetadata{}, pixels.data());
+   };
+   auto checkNumber = [&](const void* img, unsigned char n) {
+      const auto* p = static_cast<const unsigned char*>(img);
+      CHECK(p[0] == n);
+      CHECK(p[frameBytes - 1] == static_cast<unsigned char>(n + 1));
+   };
+
+   SECTION("Fill memory and file, then drain") {
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      CHECK(c.getBufferFreeCapacity() == 0);
+      CHECK(insertNumbered(99) == DEVICE_BUFFER_OVERFLOW);
+      CHECK(c.getRemainingImageCount() == total);
+
+      checkNumber(c.getLastImage(), static_cast<unsigned char>(total - 1));
+      Metadata md;
+      checkNumber(c.getNBeforeLastImageMD(total - 1, md), 0);
+      checkNumber(c.getNBeforeLastImageMD(8, md), 3);
+
+      for (long i = 0; i < total; ++i)
+         checkNumber(c.popNextImage(), static_cast<unsigned char>(i));
+      CHECK(c.getRemainingImageCount() == 0);
+   }
+
+   SECTION("Frames inserted while spilled frames remain are spilled too") {
+      for (unsigned char i = 0; i < 6; ++i)
+         REQUIRE(insertNumbered(i) == DEVICE_OK);
+      checkNumber(c.popNextImage(), 0);
+      // Memory has room again, but frames 4 and 5 are still in the file
+      CHECK(c.getBufferFreeCapacity() == 6);
+      REQUIRE(insertNumbered(6) == DEVICE_OK);
+      checkNumber(c.getLastImage(), 6);
+      for (unsigned char i = 1; i <= 6; ++i)
+         checkNumber(c.popNextImage(), i);
+      CHECK_THROWS(c.popNextImage());
+
+      // With the file drained, memory is used first again
+      CHECK(c.getBufferFreeCapacity() == total);
+      for (unsigned char i = 10; i < 10 + total; ++i)
+         REQUIRE(insertNumbered(i) == DEVICE_OK);
+      for (unsigned char i = 10; i < 10 + total; ++i)
+         checkNumber(c.popNextImage(), i);
+   }
+
+   SECTION("Spilled frame handles survive reuse of their slots") {
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      FrameHandle spilled = c.getLastFrame();
+      for (long i = 0; i < total; ++i)
+         c.popNextImage();
+      for (long i = 0; i < total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(50 + i)) == DEVICE_OK);
+      checkNumber(spilled.getPixels(), static_cast<unsigned char>(total - 1));
+   }
+
+   SECTION("Overwrite discards spilled frames too") {
+      c.startSequenceAcquisition(100, 0.0, false);
+      for (long i = 0; i <= total; ++i)
+         REQUIRE(insertNumbered(static_cast<unsigned char>(i)) == DEVICE_OK);
+      CHECK(c.getRemainingImageCount() == 1);
+      checkNumber(c.popNextImage(), static_cast<unsigned char>(total));
+      c.stopSequenceAcquisition();
+   }
+}
+
+TEST_CASE("Spill frame count fits page-aligned slots in the spill size",
+          "[CircularBuffer]") {
+   StubCamera cam;
+   // Not a multiple of any page size
+   cam.width = 100;
+   cam.height = 100;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setCircularBufferMemoryFootprint(1);
+   c.initializeCircularBuffer();
+   const long memoryCapacity = c.getBufferTotalCapacity();
+
+   c.setProperty("Core", "CircularBufferSpillDirectory",
+      std::filesystem::temp_directory_path().string().c_str());
+   c.setProperty("Core", "CircularBufferSpillSizeMB", "1");
+   c.initializeCircularBuffer();
+   const long spillFrames = c.getBufferTotalCapacity() - memoryCapacity;
+
+   // Pages are at least 4 KiB, so each spilled frame occupies 12 KiB
+   CHECK(spillFrames > 0);
+   CHECK(spillFrames * 12288 <= 1024 * 1024);
+}
+
+TEST_CASE("Unusable spill directory fails initialization", "[CircularBuffer]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferSpillDirectory",
+      (std::filesystem::temp_directory_path() / "mmcore-no-such-dir").string().c_str());
+   c.setProperty("Core", "CircularBufferSpillSizeMB", "1");
+   CHECK_THROWS_WITH(c.initializeCircularBuffer(),
+      Catch::Matchers::ContainsSubstring("spill file"));
+
+   c.setProperty("Core", "CircularBufferSpillSizeMB", "0");
+   c.initializeCircularBuffer();
+   CHECK(c.getBufferTotalCapacity() > 0);
+}
+
+// Blocking and batch retrieval
+
+TEST_CASE("waitForNextImage times out on an empty buffer",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.initializeCircularBuffer();
+
+   CHECK_FALSE(c.waitForNextImage(0));
+   const auto start = std::chrono::steady_clock::now();
+   CHECK_FALSE(c.waitForNextImage(20));
+   CHECK(std::chrono::steady_clock::now() - start >=
+         std::chrono::milliseconds(20));
+   CHECK_THROWS_AS(c.waitForNextImage(-1), CMMError);
+
+   REQUIRE(cam.InsertTestImage() == DEVICE_OK);
+   CHECK(c.waitForNextImage(0));
+}
+
+TEST_CASE("waitForNextImage wakes a consumer for each inserted frame",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   cam.width = 16;
+   cam.height = 16;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.initializeCircularBuffer();
+
+   constexpr unsigned nFrames = 200;
+   std::thread producer([&] {
+      std::vector<unsigned char> pixels(16 * 16);
+      for (unsigned i = 0; i < nFrames; ++i) {
+         if (i % 16 == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         std::memcpy(pixels.data(), &i, sizeof(i));
+         cam.InsertTestImage(MM::CameraImageMetadata{}, pixels.data());
+      }
+   });
+
+   unsigned expected = 0;
+   bool inOrder = true;
+   while (expected < nFrames && c.waitForNextImage(10000)) {
+      for (const FrameHandle& frame : c.popNextFrames(7)) {
+         unsigned n;
+         std::memcpy(&n, frame.getPixels(), sizeof(n));
+         inOrder = inOrder && (n == expected);
+         ++expected;
+      }
+   }
+   producer.join();
+
+   CHECK(expected == nFrames);
+   CHECK(inOrder);
+   CHECK(c.getRemainingImageCount() == 0);
+}
+
+TEST_CASE("popNextFrames returns at most the requested count",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.initializeCircularBuffer();
+
+   CHECK(c.popNextFrames(10).empty());
+   for (int i = 0; i < 5; ++i)
+      REQUIRE(cam.InsertTestImage() == DEVICE_OK);
+
+   CHECK(c.popNextFrames(0).empty());
+   auto frames = c.popNextFrames(3);
+   CHECK(frames.size() == 3);
+   CHECK(c.getRemainingImageCount() == 2);
+   frames = c.popNextFrames(10);
+   CHECK(frames.size() == 2);
+   CHECK(std::all_of(frames.begin(), frames.end(),
+         [](const FrameHandle& f) { return f.isValid(); }));
+   CHECK(c.getRemainingImageCount() == 0);
+}
+
+TEST_CASE("popNextImagesMD returns a batch of images with their metadata",
+          "[CircularBuffer]") {
+   const std::string engine = GENERATE("Mutex", "LockFree");
+   CAPTURE(engine);
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setProperty("Core", "CircularBufferEngine", engine.c_str());
+   c.initializeCircularBuffer();
+
+   std::vector<Metadata> mds;
+   CHECK_THROWS_AS(c.popNextImagesMD(10, mds), CMMError);
+
+   const std::size_t frameBytes = c.getImageBufferSize();
+   for (unsigned char i = 0; i < 5; ++i) {
+      std::vector<unsigned char> pixels(frameBytes, i);
+      MM::CameraImageMetadata md;
+      md.AddTag("Number", std::to_string(i).c_str());
+      REQUIRE(cam.InsertTestImage(md, pixels.data()) == DEVICE_OK);
+   }
+
+   auto frames = c.popNextImagesMD(3, mds);
+   REQUIRE(frames.size() == 3);
+   REQUIRE(mds.size() == 3);
+   for (std::size_t i = 0; i < 3; ++i) {
+      const auto* pixels = static_cast<unsigned char*>(frames[i].getPixels());
+      CHECK(frames[i].getSizeBytes() == frameBytes);
+      CHECK(pixels[0] == i);
+      CHECK(pixels[frameBytes - 1] == i);
+      CHECK(mds[i].GetSingleTag("Number").GetValue() == std::to_string(i));
+   }
+   CHECK(c.getRemainingImageCount() == 2);
+
+   frames = c.popNextImagesMD(10, mds);
+   REQUIRE(frames.size() == 2);
+   REQUIRE(mds.size() == 2);
+   CHECK(*static_cast<unsigned char*>(frames[0].getPixels()) == 3);
+   CHECK(*static_cast<unsigned char*>(frames[1].getPixels()) == 4);
+   CHECK(mds[1].GetSingleTag("Number").GetValue() == "4");
+   CHECK(c.getRemainingImageCount() == 0);
+}
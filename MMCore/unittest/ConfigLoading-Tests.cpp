@@ -0,0 +1,165 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+#include "TempFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Initialization takes a while (or fails), and is recorded
+struct SlowInitDevice : CGenericBase<SlowInitDevice> {
+   std::string name = "SlowInitDevice";
+   std::atomic<bool> initialized{false};
+   bool fail = false;
+   // Whether the hub was initialized by the time we were
+   const SlowInitDevice* hub = nullptr;
+   bool hubWasInitialized = false;
+
+   int Initialize() override {
+      if (hub)
+         hubWasInitialized = hub->initialized;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      if (fail)
+         return DEVICE_ERR;
+      initialized = true;
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+};
+
+std::string ReadFile(const std::string& path) {
+   std::ifstream file(path);
+   std::ostringstream contents;
+   contents << file.rdbuf();
+   return contents.str();
+}
+
+} // namespace
+
+TEST_CASE("Config loading initializes peripherals after their hub") {
+   SlowInitDevice hub;
+   SlowInitDevice other;
+   SlowInitDevice periph;
+   periph.hub = &hub;
+   MockAdapterWithDevices adapter1{"adapter1", {{"hub", &hub}}};
+   // The peripheral comes first in its module
+   MockAdapterWithDevices adapter2{"adapter2",
+      {{"periph", &periph}, {"other", &other}}};
+   CMMCore c;
+   c.loadMockDeviceAdapter("adapter1", &adapter1);
+   c.loadMockDeviceAdapter("adapter2", &adapter2);
+
+   TempFile cfg(
+      "Device,periph,adapter2,periph\n"
+      "Device,other,adapter2,other\n"
+      "Device,hub,adapter1,hub\n"
+      "Parent,periph,hub\n"
+      "Property,Core,Initialize,1\n");
+
+   SECTION("hub succeeds") {
+      c.loadSystemConfiguration(cfg.getPath().c_str());
+      CHECK(periph.hubWasInitialized);
+      CHECK(periph.initialized);
+      CHECK(other.initialized);
+   }
+
+   SECTION("hub fails") {
+      hub.fail = true;
+      CHECK_THROWS_AS(c.loadSystemConfiguration(cfg.getPath().c_str()),
+         CMMError);
+      CHECK_FALSE(periph.initialized);
+      CHECK(other.initialized);
+   }
+}
+
+TEST_CASE("Malformed config lines are reported before loading devices") {
+   SlowInitDevice dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   c.loadMockDeviceAdapter("mock_adapter", &adapter);
+
+   TempFile cfg(
+      "# comment\n"
+      "Device,dev,mock_adapter,dev\n"
+      "Property,Core,Initialize,1\n"
+      "Label,dev,1\n");
+   try {
+      c.loadSystemConfiguration(cfg.getPath().c_str());
+      FAIL("No exception");
+   }
+   catch (const CMMError& e) {
+      CHECK(e.getMsg().rfind("Line 4: Label,dev,1", 0) == 0);
+   }
+   CHECK_FALSE(dev.initialized);
+}
+
+TEST_CASE("Parallel config loading sets properties of modules concurrently") {
+   RendezvousDevice dev1{RendezvousDevice::MeetIn::SetValue};
+   RendezvousDevice dev2{RendezvousDevice::MeetIn::SetValue};
+   for (RendezvousDevice* dev : {&dev1, &dev2}) {
+      dev->meetValue = "wait";
+      dev->failValue = "bad";
+   }
+   MockAdapterWithDevices adapter1{"adapter1", {{"dev1", &dev1}}};
+   MockAdapterWithDevices adapter2{"adapter2", {{"dev2", &dev2}}};
+   CMMCore c;
+   c.loadMockDeviceAdapter("adapter1", &adapter1);
+   c.loadMockDeviceAdapter("adapter2", &adapter2);
+   c.enableFeature("ParallelConfigurationLoading", true);
+
+   SECTION("success") {
+      TempFile cfg(
+         "Device,dev1,adapter1,dev1\n"
+         "Device,dev2,adapter2,dev2\n"
+         "Property,Core,Initialize,1\n"
+         "Property,dev1,Value,wait\n"
+         "Property,dev2,Value,wait\n"
+         "Property,dev1,Value,1\n");
+      TempFile log("");
+      const int logHandle =
+         c.startSecondaryLogFile(log.getPath().c_str(), false, true);
+      c.loadSystemConfiguration(cfg.getPath().c_str());
+      c.stopSecondaryLogFile(logHandle);
+
+      CHECK(dev1.overlapped);
+      CHECK(dev2.overlapped);
+      // File order is kept within a module
+      CHECK(c.getProperty("dev1", "Value") == "1");
+      CHECK(c.getPropertyFromCache("dev2", "Value") == "wait");
+
+      const std::string report = ReadFile(log.getPath());
+      CHECK(report.find("System configuration loaded in") != std::string::npos);
+      CHECK(report.find("dev1 (adapter1): total") != std::string::npos);
+   }
+
+   SECTION("failure names the line") {
+      TempFile cfg(
+         "Device,dev1,adapter1,dev1\n"
+         "Device,dev2,adapter2,dev2\n"
+         "Property,Core,Initialize,1\n"
+         "Property,dev1,Value,1\n"
+         "Property,dev2,Value,bad\n");
+      try {
+         c.loadSystemConfiguration(cfg.getPath().c_str());
+         FAIL("No exception");
+      }
+      catch (const CMMError& e) {
+         CHECK(e.getMsg().rfind("Line 5: Property,dev2,Value,bad", 0) == 0);
+      }
+   }
+
+   c.enableFeature("ParallelConfigurationLoading", false);
+}
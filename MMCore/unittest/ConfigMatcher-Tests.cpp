@@ -0,0 +1,304 @@
+#include <catch2/catch_all.hpp>
+
+#include "ConfigMatcher.h"
+#include "Configuration.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+#include "SynchronizedConfiguration.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using mmcore::internal::ConfigMatcher;
+
+namespace {
+
+struct Presets {
+   std::map<std::string, Configuration> configs;
+
+   void Define(const std::string& preset, const std::string& device,
+         const std::string& prop, const std::string& value) {
+      configs[preset].addSetting(PropertySetting(device.c_str(),
+         prop.c_str(), value.c_str()));
+   }
+
+   std::vector<std::pair<std::string, const Configuration*>> Get() const {
+      std::vector<std::pair<std::string, const Configuration*>> ret;
+      for (const auto& config : configs)
+         ret.emplace_back(config.first, &config.second);
+      return ret;
+   }
+};
+
+ConfigMatcher::ValueLookup LookupIn(
+      const std::map<PropertyKey, std::string>& values) {
+   return [&values](const PropertyKey& key) -> std::optional<std::string> {
+      auto it = values.find(key);
+      if (it == values.end())
+         return std::nullopt;
+      return it->second;
+   };
+}
+
+struct StubWithTwoProperties : CGenericBase<StubWithTwoProperties> {
+   std::string name = "StubWithTwoProperties";
+
+   int Initialize() override {
+      CreateStringProperty("A", "a0", false);
+      CreateStringProperty("B", "b0", false);
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override { return false; }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+};
+
+} // namespace
+
+TEST_CASE("ConfigMatcher follows value changes") {
+   Presets presets;
+   presets.Define("p1", "dev", "A", "1");
+   presets.Define("p1", "dev", "B", "1");
+   presets.Define("p2", "dev", "A", "2");
+   presets.Define("p3", "dev", "A", "1");
+
+   std::map<PropertyKey, std::string> values{{{"dev", "A"}, "1"}};
+   ConfigMatcher m;
+   m.Compile("g", 1, presets.Get(), "Core", LookupIn(values));
+   CHECK(m.IsCompiled("g", 1));
+   CHECK_FALSE(m.IsCompiled("g", 2));
+   CHECK(m.GetProperties("g") ==
+      std::vector<PropertyKey>{{"dev", "A"}, {"dev", "B"}});
+
+   // dev-B is unknown: p1 cannot match, and requireAll fails
+   CHECK(m.MatchCurrent("g", {}, false) == std::optional<std::string>("p3"));
+   CHECK_FALSE(m.MatchCurrent("g", {}, true).has_value());
+
+   m.SetValue({"dev", "B"}, "1");
+   CHECK(m.MatchCurrent("g", {}, true) == std::optional<std::string>("p1"));
+   m.SetValue({"dev", "B"}, "other");
+   CHECK(m.MatchCurrent("g", {}, true) == std::optional<std::string>("p3"));
+   m.SetValue({"dev", "A"}, "2");
+   CHECK(m.MatchCurrent("g", {}, true) == std::optional<std::string>("p2"));
+   m.SetValue({"dev", "A"}, "3");
+   CHECK(m.MatchCurrent("g", {}, true) == std::optional<std::string>(""));
+   m.SetValue({"dev", "C"}, "1"); // Not tracked
+   CHECK(m.MatchCurrent("g", {}, true) == std::optional<std::string>(""));
+
+   CHECK(m.Match("g", {std::string("1"), std::string("1")}) == "p1");
+   CHECK(m.Match("g", {std::string("1"), std::nullopt}) == "p3");
+   CHECK(m.Match("g", {std::string("0"), std::nullopt}).empty());
+}
+
+TEST_CASE("ConfigMatcher shares properties between groups") {
+   Presets g1;
+   g1.Define("x", "dev", "A", "1");
+   Presets g2;
+   g2.Define("y", "dev", "A", "2");
+
+   std::map<PropertyKey, std::string> values{{{"dev", "A"}, "2"}};
+   ConfigMatcher m;
+   m.Compile("g1", 1, g1.Get(), "", LookupIn(values));
+   // "2" was not a value of any preset when it was set
+   m.SetValue({"dev", "A"}, "2");
+   m.Compile("g2", 2, g2.Get(), "", LookupIn(values));
+   CHECK(m.MatchCurrent("g1", {}, true) == std::optional<std::string>(""));
+   CHECK(m.MatchCurrent("g2", {}, true) == std::optional<std::string>("y"));
+
+   m.SetValue({"dev", "A"}, "1");
+   CHECK(m.MatchCurrent("g1", {}, true) == std::optional<std::string>("x"));
+   CHECK(m.MatchCurrent("g2", {}, true) == std::optional<std::string>(""));
+
+   m.Remove("g1");
+   CHECK_FALSE(m.IsCompiled("g1", 1));
+   values[{"dev", "A"}] = "2";
+   m.ResetValues(LookupIn(values));
+   CHECK(m.MatchCurrent("g2", {}, true) == std::optional<std::string>("y"));
+}
+
+TEST_CASE("ConfigMatcher takes values of live properties with each query") {
+   Presets presets;
+   presets.Define("p1", "Core", "Camera", "cam1");
+   presets.Define("p1", "dev", "A", "1");
+   presets.Define("p2", "Core", "Camera", "cam2");
+   presets.Define("p2", "dev", "A", "1");
+
+   std::map<PropertyKey, std::string> values{{{"dev", "A"}, "1"}};
+   ConfigMatcher m;
+   m.Compile("g", 1, presets.Get(), "Core", LookupIn(values));
+   REQUIRE(m.GetLiveProperties("g") ==
+      std::vector<PropertyKey>{{"Core", "Camera"}});
+   CHECK(m.MatchCurrent("g", {"cam2"}, true) ==
+      std::optional<std::string>("p2"));
+   CHECK(m.MatchCurrent("g", {"cam1"}, true) ==
+      std::optional<std::string>("p1"));
+   CHECK(m.MatchCurrent("g", {"cam3"}, true) ==
+      std::optional<std::string>(""));
+}
+
+TEST_CASE("Current config follows property changes and preset edits") {
+   StubWithTwoProperties dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.defineConfig("G", "P1", "dev", "A", "a1");
+   c.defineConfig("G", "P2", "dev", "A", "a2");
+   c.defineConfig("G", "P2", "dev", "B", "b2");
+   // Nothing has been read from the device yet
+   CHECK_THROWS_AS(c.getCurrentConfigFromCache("G"), CMMError);
+   CHECK(c.getCurrentConfig("G").empty());
+   c.updateSystemStateCache();
+   CHECK(c.getCurrentConfigFromCache("G").empty());
+
+   c.setProperty("dev", "A", "a2");
+   CHECK(c.getCurrentConfigFromCache("G").empty());
+   c.setProperty("dev", "B", "b2");
+   CHECK(c.getCurrentConfigFromCache("G") == "P2");
+   CHECK(c.getCurrentConfig("G") == "P2");
+
+   // Changing a preset takes effect immediately
+   c.deleteConfig("G", "P2", "dev", "A");
+   c.defineConfig("G", "P0", "dev", "B", "b2");
+   CHECK(c.getCurrentConfigFromCache("G") == "P0");
+   c.renameConfig("G", "P0", "P3");
+   CHECK(c.getCurrentConfigFromCache("G") == "P2");
+   c.renameConfigGroup("G", "H");
+   CHECK(c.getCurrentConfigFromCache("H") == "P2");
+   c.deleteConfigGroup("H");
+   c.defineConfig("H", "Q", "dev", "A", "a2");
+   CHECK(c.getCurrentConfigFromCache("H") == "Q");
+
+   Configuration state = c.getConfigGroupState("H");
+   REQUIRE(state.size() == 1);
+   CHECK(state.getSetting(0).getPropertyValue() == "a2");
+}
+
+TEST_CASE("Current config reads Core properties rather than the cache") {
+   CMMCore c;
+   c.defineConfig("G", "On", "Core", "AutoShutter", "1");
+   c.defineConfig("G", "Off", "Core", "AutoShutter", "0");
+
+   c.setAutoShutter(false);
+   CHECK(c.getCurrentConfigFromCache("G") == "Off");
+   c.setAutoShutter(true);
+   CHECK(c.getCurrentConfigFromCache("G") == "On");
+   CHECK(c.getCurrentConfig("G") == "On");
+}
+
+TEST_CASE("Current pixel size config follows property changes") {
+   StubWithTwoProperties dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.definePixelSizeConfig("R1", "dev", "A", "a1");
+   c.setPixelSizeUm("R1", 1.0);
+   c.definePixelSizeConfig("R2", "dev", "A", "a2");
+   c.setPixelSizeUm("R2", 2.0);
+
+   c.setProperty("dev", "A", "a2");
+   CHECK(c.getCurrentPixelSizeConfig(true) == "R2");
+   CHECK(c.getCurrentPixelSizeConfig(false) == "R2");
+   CHECK(c.getPixelSizeUm(true) == 2.0);
+   c.setProperty("dev", "A", "a1");
+   CHECK(c.getCurrentPixelSizeConfig(true) == "R1");
+
+   c.deletePixelSizeConfig("R1");
+   CHECK(c.getCurrentPixelSizeConfig(true).empty());
+   CHECK(c.getCurrentPixelSizeConfig(false).empty());
+}
+
+// Current preset lookup over 50 groups of 10 presets each, compared to the
+// union-and-compare approach previously used by getCurrentConfigFromCache().
+// Run with: MMCoreTests "[ConfigMatchBenchmark]"
+TEST_CASE("Config match throughput", "[.][ConfigMatchBenchmark]") {
+   using Clock = std::chrono::steady_clock;
+   constexpr int groupCount = 50;
+   constexpr int presetsPerGroup = 10;
+   constexpr int propsPerGroup = 4;
+   constexpr int queries = 20000;
+
+   std::vector<Presets> groups(groupCount);
+   std::vector<std::string> names;
+   for (int g = 0; g < groupCount; ++g) {
+      names.push_back("Group" + std::to_string(g));
+      for (int p = 0; p < presetsPerGroup; ++p) {
+         for (int i = 0; i < propsPerGroup; ++i) {
+            // Neighboring groups share devices
+            const std::string dev = "Dev" + std::to_string((g + i) % 60);
+            groups[g].Define("Preset" + std::to_string(p), dev,
+               "Prop" + std::to_string(i), std::to_string((p + i) % 7));
+         }
+      }
+   }
+
+   SynchronizedConfiguration cache;
+   for (int d = 0; d < 60; ++d)
+      for (int i = 0; i < propsPerGroup; ++i)
+         cache.addSetting(PropertySetting(("Dev" + std::to_string(d)).c_str(),
+            ("Prop" + std::to_string(i)).c_str(), "3"));
+
+   ConfigMatcher matcher;
+   std::map<PropertyKey, std::string> values;
+   for (int d = 0; d < 60; ++d)
+      for (int i = 0; i < propsPerGroup; ++i)
+         values[{"Dev" + std::to_string(d), "Prop" + std::to_string(i)}] = "3";
+   for (int g = 0; g < groupCount; ++g)
+      matcher.Compile(names[g], 1, groups[g].Get(), "Core", LookupIn(values));
+
+   // Legacy: build the union state, then compare each preset in turn
+   auto start = Clock::now();
+   std::size_t matches = 0;
+   for (int q = 0; q < queries; ++q) {
+      Presets& group = groups[q % groupCount];
+      Configuration state;
+      for (auto& preset : group.configs) {
+         for (std::size_t i = 0; i < preset.second.size(); ++i) {
+            PropertySetting s = preset.second.getSetting(i);
+            if (!state.isPropertyIncluded(s.getDeviceLabel().c_str(),
+                  s.getPropertyName().c_str()))
+               state.addSetting(*cache.getSetting(
+                  s.getDeviceLabel().c_str(), s.getPropertyName().c_str()));
+         }
+      }
+      for (auto& preset : group.configs) {
+         if (state.isConfigurationIncluded(preset.second)) {
+            ++matches;
+            break;
+         }
+      }
+   }
+   const double legacyUs = std::chrono::duration<double, std::micro>(
+      Clock::now() - start).count() / queries;
+
+   start = Clock::now();
+   std::size_t compiledMatches = 0;
+   for (int q = 0; q < queries; ++q) {
+      if (!matcher.MatchCurrent(names[q % groupCount], {}, true)->empty())
+         ++compiledMatches;
+   }
+   const double compiledUs = std::chrono::duration<double, std::micro>(
+      Clock::now() - start).count() / queries;
+
+   start = Clock::now();
+   for (int q = 0; q < queries; ++q) {
+      matcher.SetValue({"Dev" + std::to_string(q % 60), "Prop" +
+         std::to_string(q % propsPerGroup)}, std::to_string(q % 7));
+   }
+   const double updateUs = std::chrono::duration<double, std::micro>(
+      Clock::now() - start).count() / queries;
+
+   CHECK(matches == compiledMatches);
+   std::printf("Union-and-compare query: %8.3f us\n", legacyUs);
+   std::printf("Compiled query:          %8.3f us\n", compiledUs);
+   std::printf("Compiled value update:   %8.3f us\n", updateUs);
+}
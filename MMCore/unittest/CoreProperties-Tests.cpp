@@ -4,6 +4,7 @@
 #include "MockDeviceUtils.h"
 #include "StubDevices.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -15,13 +16,21 @@ using Catch::Matchers::VectorContains;
 TEST_CASE("Core has expected properties") {
    CMMCore c;
 
-   SECTION("getDevicePropertyNames returns all 12 properties") {
+   SECTION("getDevicePropertyNames returns all 29 properties") {
       auto names = c.getDevicePropertyNames("Core");
-      CHECK(names.size() == 12);
+      CHECK(names.size() == 29);
       CHECK_THAT(names, UnorderedEquals(std::vector<std::string>{
          "Initialize", "Camera", "Shutter", "Focus", "XYStage",
          "AutoFocus", "AutoShutter", "ChannelGroup",
          "ImageProcessor", "SLM", "Galvo", "TimeoutMs",
+         "CircularBufferEngine", "CircularBufferStorage",
+         "CircularBufferHugePages", "CircularBufferPrefault",
+         "CircularBufferNumaNode", "CircularBufferSpillDirectory",
+         "CircularBufferSpillSizeMB", "CircularBufferAllocationTimeMs",
+         "CircularBufferAllocationPageFaults", "ThreadPoolSize",
+         "ThreadPoolPinThreads", "ThreadPoolUtilization",
+         "ParallelConfigApply", "ParallelBusyPolling", "ParallelStateRead",
+         "NotificationQueueCapacity", "NotificationQueueStatistics",
       }));
    }
 
@@ -128,6 +137,135 @@ TEST_CASE("Core TimeoutMs property") {
    }
 }
 
+// --- CircularBufferEngine property ---
+
+TEST_CASE("Core CircularBufferEngine property") {
+   CMMCore c;
+
+   SECTION("default value is Mutex") {
+      CHECK(c.getProperty("Core", "CircularBufferEngine") == "Mutex");
+   }
+
+   SECTION("allowed values") {
+      CHECK_THAT(c.getAllowedPropertyValues("Core", "CircularBufferEngine"),
+         UnorderedEquals(std::vector<std::string>{"Mutex", "LockFree"}));
+   }
+
+   SECTION("set via property") {
+      c.setProperty("Core", "CircularBufferEngine", "LockFree");
+      CHECK(c.getProperty("Core", "CircularBufferEngine") == "LockFree");
+      c.setProperty("Core", "CircularBufferEngine", "Mutex");
+      CHECK(c.getProperty("Core", "CircularBufferEngine") == "Mutex");
+   }
+
+   SECTION("invalid value is rejected") {
+      CHECK_THROWS(c.setProperty("Core", "CircularBufferEngine", "Spin"));
+      CHECK(c.getProperty("Core", "CircularBufferEngine") == "Mutex");
+   }
+
+   SECTION("survives change of memory footprint") {
+      c.setProperty("Core", "CircularBufferEngine", "LockFree");
+      c.setCircularBufferMemoryFootprint(1);
+      CHECK(c.getProperty("Core", "CircularBufferEngine") == "LockFree");
+   }
+}
+
+TEST_CASE("Cannot switch circular buffer engine while sequence is running") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.setCameraDevice("cam");
+   cam.capturing = true;
+   CHECK_THROWS(c.setProperty("Core", "CircularBufferEngine", "LockFree"));
+   cam.capturing = false;
+   CHECK(c.getProperty("Core", "CircularBufferEngine") == "Mutex");
+}
+
+// --- CircularBuffer storage properties ---
+
+TEST_CASE("Core CircularBuffer storage properties") {
+   CMMCore c;
+
+   SECTION("default values") {
+      CHECK(c.getProperty("Core", "CircularBufferStorage") == "Heap");
+      CHECK(c.getProperty("Core", "CircularBufferHugePages") == "0");
+      CHECK(c.getProperty("Core", "CircularBufferPrefault") == "1");
+      CHECK(c.getProperty("Core", "CircularBufferNumaNode") == "-1");
+      CHECK(c.getProperty("Core", "CircularBufferSpillDirectory").empty());
+      CHECK(c.getProperty("Core", "CircularBufferSpillSizeMB") == "0");
+   }
+
+   SECTION("set via property") {
+      c.setProperty("Core", "CircularBufferStorage", "Arena");
+      c.setProperty("Core", "CircularBufferHugePages", "1");
+      c.setProperty("Core", "CircularBufferPrefault", "0");
+      c.setProperty("Core", "CircularBufferNumaNode", "1");
+      CHECK(c.getProperty("Core", "CircularBufferStorage") == "Arena");
+      CHECK(c.getProperty("Core", "CircularBufferHugePages") == "1");
+      CHECK(c.getProperty("Core", "CircularBufferPrefault") == "0");
+      CHECK(c.getProperty("Core", "CircularBufferNumaNode") == "1");
+   }
+
+   SECTION("invalid values are rejected") {
+      CHECK_THROWS(c.setProperty("Core", "CircularBufferStorage", "Disk"));
+      CHECK_THROWS(c.setProperty("Core", "CircularBufferNumaNode", "-2"));
+      CHECK_THROWS(c.setProperty("Core", "CircularBufferNumaNode", "abc"));
+      CHECK_THROWS(c.setProperty("Core", "CircularBufferSpillSizeMB", "-1"));
+      CHECK(c.getProperty("Core", "CircularBufferNumaNode") == "-1");
+   }
+
+   SECTION("allocation statistics are read-only") {
+      CHECK(c.isPropertyReadOnly("Core", "CircularBufferAllocationTimeMs"));
+      CHECK(c.isPropertyReadOnly("Core",
+         "CircularBufferAllocationPageFaults"));
+      CHECK_THROWS(c.setProperty("Core",
+         "CircularBufferAllocationTimeMs", "0"));
+   }
+
+   SECTION("survive change of memory footprint") {
+      c.setProperty("Core", "CircularBufferStorage", "Arena");
+      c.setProperty("Core", "CircularBufferHugePages", "1");
+      c.setCircularBufferMemoryFootprint(1);
+      CHECK(c.getProperty("Core", "CircularBufferStorage") == "Arena");
+      CHECK(c.getProperty("Core", "CircularBufferHugePages") == "1");
+   }
+}
+
+// --- ThreadPool properties ---
+
+TEST_CASE("Core ThreadPool properties") {
+   CMMCore c;
+
+   SECTION("default values") {
+      CHECK(c.getProperty("Core", "ThreadPoolSize") == "0");
+      CHECK(c.getProperty("Core", "ThreadPoolPinThreads") == "0");
+   }
+
+   SECTION("utilization has one entry per worker") {
+      c.setProperty("Core", "ThreadPoolSize", "3");
+      CHECK(c.getProperty("Core", "ThreadPoolSize") == "3");
+      const std::string util = c.getProperty("Core", "ThreadPoolUtilization");
+      CHECK(std::count(util.begin(), util.end(), ',') == 2);
+      CHECK(c.isPropertyReadOnly("Core", "ThreadPoolUtilization"));
+   }
+
+   SECTION("pinning can be toggled") {
+      c.setProperty("Core", "ThreadPoolPinThreads", "1");
+      CHECK(c.getProperty("Core", "ThreadPoolPinThreads") == "1");
+      c.setProperty("Core", "ThreadPoolPinThreads", "0");
+      CHECK(c.getProperty("Core", "ThreadPoolPinThreads") == "0");
+   }
+
+   SECTION("invalid values are rejected") {
+      CHECK_THROWS(c.setProperty("Core", "ThreadPoolSize", "-1"));
+      CHECK_THROWS(c.setProperty("Core", "ThreadPoolSize", "abc"));
+      CHECK_THROWS(c.setProperty("Core", "ThreadPoolPinThreads", "2"));
+      CHECK(c.getProperty("Core", "ThreadPoolSize") == "0");
+   }
+}
+
 // --- Device role properties ---
 
 TEST_CASE("Core Camera property") {
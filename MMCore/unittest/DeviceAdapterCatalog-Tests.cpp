@@ -0,0 +1,145 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceAdapterCatalog.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using mmcore::internal::DeviceAdapterCatalog;
+
+namespace {
+
+class TempDir {
+public:
+   TempDir() {
+      auto dir = std::filesystem::temp_directory_path();
+      for (int i = 0; ; ++i) {
+         auto p = dir / ("mmcore-catalog-test-" + std::to_string(i));
+         if (std::filesystem::create_directory(p)) {
+            path_ = p;
+            break;
+         }
+      }
+   }
+   ~TempDir() { std::filesystem::remove_all(path_); }
+
+   std::string File(const std::string& name) const {
+      return (path_ / name).string();
+   }
+   std::string Path() const { return path_.string(); }
+
+private:
+   std::filesystem::path path_;
+};
+
+void WriteFile(const std::string& path, const std::string& contents) {
+   std::ofstream(path, std::ios::binary) << contents;
+}
+
+// Filename of a device adapter library, as looked up by the core
+std::string LibraryName(const std::string& moduleName) {
+#ifdef _WIN32
+   return "mmgr_dal_" + moduleName + ".dll";
+#elif defined(__linux__)
+   return "libmmgr_dal_" + moduleName + ".so.0";
+#else
+   return "libmmgr_dal_" + moduleName;
+#endif
+}
+
+std::vector<DeviceAdapterCatalog::Device> SomeDevices() {
+   DeviceAdapterCatalog::Device cam;
+   cam.name = "Cam";
+   cam.description = "A camera\twith\\odd\ncharacters";
+   cam.type = MM::CameraDevice;
+   DeviceAdapterCatalog::Device stage;
+   stage.name = "Z";
+   stage.type = MM::StageDevice;
+   return {cam, stage};
+}
+
+} // namespace
+
+TEST_CASE("Device adapter catalog round trip and staleness") {
+   TempDir dir;
+   const std::string lib = dir.File("lib");
+   WriteFile(lib, "library contents");
+   const auto stamp = DeviceAdapterCatalog::GetFileStamp(lib);
+   REQUIRE(stamp.has_value());
+   CHECK(stamp->size == 16);
+   CHECK_FALSE(DeviceAdapterCatalog::GetFileStamp(dir.File("none")));
+
+   DeviceAdapterCatalog catalog;
+   catalog.Put(lib, *stamp, SomeDevices());
+   catalog.Put(dir.File("gone"), *stamp, {});
+   catalog.Save(dir.File("catalog"));
+
+   DeviceAdapterCatalog loaded;
+   REQUIRE(loaded.Load(dir.File("catalog")));
+   CHECK(loaded.Size() == 2);
+   auto devices = loaded.Find(lib);
+   REQUIRE(devices.has_value());
+   REQUIRE(devices->size() == 2);
+   CHECK((*devices)[0].name == "Cam");
+   CHECK((*devices)[0].description == "A camera\twith\\odd\ncharacters");
+   CHECK((*devices)[0].type == MM::CameraDevice);
+   CHECK((*devices)[1].type == MM::StageDevice);
+   CHECK_FALSE(loaded.Find(dir.File("gone")));
+
+   // A changed library invalidates its entry
+   WriteFile(lib, "new library contents");
+   CHECK_FALSE(loaded.Find(lib));
+
+   WriteFile(dir.File("bad"), "SomethingElse\t1\n");
+   CHECK_FALSE(loaded.Load(dir.File("bad")));
+   CHECK(loaded.Size() == 0);
+   CHECK_FALSE(loaded.Load(dir.File("none")));
+}
+
+TEST_CASE("Available devices are listed from the catalog without loading") {
+   TempDir dir;
+   // Not a loadable library: any attempt to load it fails
+   const std::string lib = dir.File(LibraryName("Fake"));
+   WriteFile(lib, "not a library");
+   DeviceAdapterCatalog catalog;
+   catalog.Put(lib, *DeviceAdapterCatalog::GetFileStamp(lib), SomeDevices());
+   catalog.Save(dir.File("catalog"));
+
+   CMMCore c;
+   c.setDeviceAdapterSearchPaths({dir.Path()});
+   CHECK_THROWS_AS(c.getAvailableDevices("Fake"), CMMError);
+
+   c.setDeviceAdapterCatalogFile(dir.File("catalog").c_str());
+   CHECK(c.getDeviceAdapterCatalogFile() == dir.File("catalog"));
+   CHECK(c.getAvailableDevices("Fake") ==
+      std::vector<std::string>{"Cam", "Z"});
+   CHECK(c.getAvailableDeviceTypes("Fake") ==
+      std::vector<long>{MM::CameraDevice, MM::StageDevice});
+   CHECK(c.getAvailableDeviceDescriptions("Fake")[1].empty());
+
+   WriteFile(lib, "still not a library");
+   CHECK_THROWS_AS(c.getAvailableDevices("Fake"), CMMError);
+
+   c.setDeviceAdapterCatalogFile("");
+   CHECK(c.getDeviceAdapterCatalogFile().empty());
+}
+
+TEST_CASE("Loaded adapters are listed directly when a catalog is set") {
+   TempDir dir;
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   c.setDeviceAdapterSearchPaths({dir.Path()});
+   c.setDeviceAdapterCatalogFile(dir.File("catalog").c_str());
+   adapter.LoadIntoCore(c);
+   CHECK(c.getAvailableDevices("mock_adapter") ==
+      std::vector<std::string>{"cam"});
+   CHECK(c.getAvailableDeviceTypes("mock_adapter") ==
+      std::vector<long>{MM::CameraDevice});
+}
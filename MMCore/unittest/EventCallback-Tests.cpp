@@ -220,6 +220,7 @@ private:
 struct StubWithProperty : CGenericBase<StubWithProperty> {
    std::string name = "StubWithProperty";
    using CGenericBase::OnPropertyChanged;
+   using CGenericBase::OnPropertiesChanged;
 
    int Initialize() override {
       CreateStringProperty("TestProp", "initial", false);
@@ -411,6 +412,39 @@ TEST_CASE("onConfigGroupChanged from device property change",
    CHECK(recs[0].s1 == "Group1");
 }
 
+TEST_CASE("onConfigGroupChanged follows edits to presets",
+          "[EventCallback]") {
+   StubWithProperty dev;
+   MockAdapterWithDevices adapter{{"dev", &dev}};
+   RecordingCallback cb;
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+
+   c.defineConfig("Group1", "Config1", "dev", "TestProp", "val1");
+   c.defineConfig("Group2", "ConfigA", "dev", "TestProp", "val1");
+   c.defineConfig("Group2", "ConfigB", "dev", "TestProp", "val2");
+   c.defineConfig("Group4", "Config1", "dev", "TestProp", "val1");
+   c.deleteConfig("Group2", "ConfigA");
+   c.deleteConfig("Group2", "ConfigB", "dev", "TestProp");
+   c.renameConfigGroup("Group1", "Group3");
+   c.deleteConfigGroup("Group4");
+   c.definePixelSizeConfig("Res1", "dev", "TestProp", "val1");
+   c.deletePixelSizeConfig("Res1");
+   c.registerCallback(&cb);
+
+   // Notifications are delivered in order, so all those caused by the
+   // change have arrived once the following PropertiesChanged is seen.
+   dev.OnPropertyChanged("TestProp", "val1");
+   dev.OnPropertiesChanged();
+   REQUIRE(cb.waitForCount(CBType::PropertiesChanged, 1));
+
+   auto recs = cb.records(CBType::ConfigGroupChanged);
+   REQUIRE(recs.size() == 1);
+   CHECK(recs[0].s1 == "Group3");
+   CHECK(recs[0].s2 == "Config1");
+   CHECK(cb.records(CBType::PixelSizeChanged).empty());
+}
+
 TEST_CASE("onPixelSizeChanged from device property change",
           "[EventCallback]") {
    StubWithProperty dev;
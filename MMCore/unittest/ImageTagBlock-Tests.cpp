@@ -0,0 +1,221 @@
+#include <catch2/catch_all.hpp>
+
+#include "CameraImageMetadata.h"
+#include "DeviceUtils.h"
+#include "ImageMetadata.h"
+#include "ImageTagBlock.h"
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "SerializedMetadata.h"
+#include "StubDevices.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using mmcore::internal::ImageTagBlock;
+using mmcore::internal::SerializedMetadata;
+using mmcore::internal::TagKey;
+
+TEST_CASE("TagKey interning is idempotent") {
+   TagKey a = TagKey::Intern("ImageTagBlockTestKey");
+   TagKey b = TagKey::Intern(std::string("ImageTagBlockTestKey"));
+   TagKey c = TagKey::Intern("ImageTagBlockTestOtherKey");
+   CHECK(a.Id() == b.Id());
+   CHECK(a.Id() != c.Id());
+   CHECK(a.Name() == "ImageTagBlockTestKey");
+   CHECK(c.Name() == "ImageTagBlockTestOtherKey");
+}
+
+TEST_CASE("Empty ImageTagBlock converts to empty Metadata") {
+   ImageTagBlock block;
+   Metadata md;
+   md.PutImageTag("Stale", 1);
+   block.ToMetadata(md);
+   CHECK(md.GetKeys().empty());
+}
+
+TEST_CASE("Typed tags are formatted like the text format") {
+   ImageTagBlock block;
+   block.AddTag(TagKey::Intern("Int"), static_cast<std::int64_t>(-42));
+   block.AddTag(TagKey::Intern("Double"), 3.5);
+   block.AddTag(TagKey::Intern("String"), std::string_view("hello"));
+   block.AddTag(TagKey::Intern("EmptyString"), std::string_view(""));
+
+   SerializedMetadata text;
+   text.AddTag("Int", static_cast<std::int64_t>(-42));
+   text.AddTag("Double", 3.5);
+   Metadata expected;
+   expected.Restore(std::string(text.View()).c_str());
+
+   Metadata md;
+   block.ToMetadata(md);
+   CHECK(md.GetKeys().size() == 4);
+   CHECK(md.GetSingleTag("Int").GetValue() ==
+         expected.GetSingleTag("Int").GetValue());
+   CHECK(md.GetSingleTag("Double").GetValue() ==
+         expected.GetSingleTag("Double").GetValue());
+   CHECK(md.GetSingleTag("String").GetValue() == "hello");
+   CHECK(md.GetSingleTag("EmptyString").GetValue().empty());
+   CHECK(md.GetSingleTag("Int").IsReadOnly());
+}
+
+TEST_CASE("Timestamp tags are formatted as local time") {
+   ImageTagBlock block;
+   const std::int64_t us = 1700000000123456;
+   block.AddTimestampTag(TagKey::Intern("Time"), us);
+   Metadata md;
+   block.ToMetadata(md);
+   const std::string value = md.GetSingleTag("Time").GetValue();
+   CHECK(value == mmcore::internal::FormatLocalTime(us));
+   CHECK(value.size() == 26);
+   CHECK(value.substr(19) == ".123456");
+}
+
+TEST_CASE("Core tags take precedence over device tags") {
+   MM::CameraImageMetadata cim;
+   cim.AddTag("Width", "1");
+   cim.AddTag("Custom", "x");
+
+   ImageTagBlock block;
+   block.DeviceTags().AppendSerialized(cim.Serialize());
+   block.AddTag(TagKey::Intern("Width"), static_cast<std::int64_t>(512));
+
+   Metadata md;
+   block.ToMetadata(md);
+   CHECK(md.GetSingleTag("Width").GetValue() == "512");
+   CHECK(md.GetSingleTag("Custom").GetValue() == "x");
+   CHECK(md.GetKeys().size() == 2);
+}
+
+TEST_CASE("ImageTagBlock can be cleared and copied") {
+   ImageTagBlock block;
+   block.DeviceTags().AddTag("Device", "d");
+   block.AddTag(TagKey::Intern("Core"), std::string_view("c"));
+
+   ImageTagBlock copy;
+   copy.AddTag(TagKey::Intern("Old"), 1.0);
+   copy = block;
+   block.Clear();
+
+   Metadata md;
+   block.ToMetadata(md);
+   CHECK(md.GetKeys().empty());
+   copy.ToMetadata(md);
+   CHECK(md.GetKeys().size() == 2);
+   CHECK(md.GetSingleTag("Device").GetValue() == "d");
+   CHECK(md.GetSingleTag("Core").GetValue() == "c");
+}
+
+// Per-frame metadata cost. Run with: MMCoreTests "[ImageTagBlockBenchmark]"
+// At 10k frames/s, the budget for everything done per frame is 100 us.
+TEST_CASE("Per-frame image metadata cost", "[.][ImageTagBlockBenchmark]") {
+   MM::CameraImageMetadata cim;
+   cim.AddTag("Camera-Binning", "1");
+   cim.AddTag("ROI-X-start", "0");
+   cim.AddTag("ROI-Y-start", "0");
+   const std::string cameraTags = cim.Serialize();
+   long imageNumber = 0;
+
+   // The text format as stored with each frame before ImageTagBlock
+   std::string storedText;
+   BENCHMARK("text: build and store") {
+      SerializedMetadata md(cameraTags.c_str());
+      md.AddTag(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+      md.AddTag(MM::g_Keyword_Metadata_Width, 2048u);
+      md.AddTag(MM::g_Keyword_Metadata_Height, 2048u);
+      md.AddTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_GRAY16);
+      using namespace std::chrono;
+      md.AddTag(MM::g_Keyword_Metadata_TimeInCore,
+         mmcore::internal::FormatLocalTime(duration_cast<microseconds>(
+            system_clock::now().time_since_epoch()).count()));
+      md.AddTag(MM::g_Keyword_Elapsed_Time_ms, std::to_string(imageNumber));
+      md.AddTag(MM::g_Keyword_Metadata_ImageNumber,
+         CDeviceUtils::ConvertToString(imageNumber++));
+      storedText.assign(md.View());
+      return storedText.size();
+   };
+
+   BENCHMARK("text: convert to Metadata") {
+      Metadata md;
+      md.Restore(storedText.c_str());
+      return md.GetKeys().size();
+   };
+
+   ImageTagBlock scratch;
+   ImageTagBlock stored;
+   BENCHMARK("binary: build and store") {
+      static const TagKey widthKey =
+         TagKey::Intern(MM::g_Keyword_Metadata_Width);
+      static const TagKey heightKey =
+         TagKey::Intern(MM::g_Keyword_Metadata_Height);
+      static const TagKey pixelTypeKey =
+         TagKey::Intern(MM::g_Keyword_PixelType);
+      static const TagKey timeKey =
+         TagKey::Intern(MM::g_Keyword_Metadata_TimeInCore);
+      static const TagKey elapsedKey =
+         TagKey::Intern(MM::g_Keyword_Elapsed_Time_ms);
+      static const TagKey numberKey =
+         TagKey::Intern(MM::g_Keyword_Metadata_ImageNumber);
+      scratch.Clear();
+      scratch.DeviceTags().AppendSerialized(cameraTags.c_str());
+      scratch.DeviceTags().AddTag(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+      scratch.AddTag(widthKey, static_cast<std::int64_t>(2048));
+      scratch.AddTag(heightKey, static_cast<std::int64_t>(2048));
+      scratch.AddTag(pixelTypeKey,
+         std::string_view(MM::g_Keyword_PixelType_GRAY16));
+      using namespace std::chrono;
+      scratch.AddTimestampTag(timeKey, duration_cast<microseconds>(
+         system_clock::now().time_since_epoch()).count());
+      scratch.AddTag(elapsedKey, static_cast<std::int64_t>(imageNumber));
+      scratch.AddTag(numberKey, static_cast<std::int64_t>(imageNumber++));
+      stored = scratch;
+      return stored.DeviceTags().View().size();
+   };
+
+   BENCHMARK("binary: convert to Metadata") {
+      Metadata md;
+      stored.ToMetadata(md);
+      return md.GetKeys().size();
+   };
+
+   StubCamera cam;
+   cam.width = 16;
+   cam.height = 16;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setCircularBufferMemoryFootprint(4);
+   c.initializeCircularBuffer();
+   REQUIRE(c.getBufferTotalCapacity() >= 10000);
+
+   BENCHMARK("core: insert 10000 frames") {
+      c.clearCircularBuffer();
+      for (int i = 0; i < 10000; ++i)
+         cam.InsertTestImage(cim);
+      return c.getRemainingImageCount();
+   };
+
+   BENCHMARK("core: insert and popNextImageMD 10000 frames") {
+      c.clearCircularBuffer();
+      Metadata md;
+      for (int i = 0; i < 10000; ++i) {
+         cam.InsertTestImage(cim);
+         c.popNextImageMD(md);
+      }
+      return md.GetKeys().size();
+   };
+
+   BENCHMARK("core: insert and popNextImagesMD 10000 frames in batches of 100") {
+      c.clearCircularBuffer();
+      std::vector<Metadata> mds;
+      for (int i = 0; i < 10000; i += 100) {
+         for (int j = 0; j < 100; ++j)
+            cam.InsertTestImage(cim);
+         c.popNextImagesMD(100, mds);
+      }
+      return mds.size();
+   };
+}
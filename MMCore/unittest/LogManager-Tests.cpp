@@ -2,10 +2,14 @@
 
 #include "LogManager.h"
 
+#include "Logging/BinaryLogFormat.h"
+
 #include <filesystem>
 #include <fstream>
 #include <random>
+#include <sstream>
 #include <string>
+#include <vector>
 
 namespace mmcore {
 namespace internal {
@@ -124,5 +128,47 @@ TEST_CASE("stderr level persists across disable/enable", "[LogManager]")
    }
 }
 
+TEST_CASE("switching primary log format moves the old file aside",
+      "[LogManager]")
+{
+   TempFile tmp;
+   auto path = std::filesystem::path(tmp.Path());
+   std::vector<std::filesystem::path> movedFiles;
+
+   {
+      LogManager mgr;
+      mgr.SetPrimaryLogFilename(tmp.Path(), true);
+      logging::Logger lgr = mgr.NewLogger("test");
+      lgr(LogLevelInfo, "msg-text");
+
+      mgr.SetPrimaryLogBinary(true);
+      REQUIRE(mgr.IsPrimaryLogBinary());
+      lgr(LogLevelInfo, "msg-binary");
+   }
+
+   for (const auto& entry :
+         std::filesystem::directory_iterator(path.parent_path()))
+   {
+      auto name = entry.path().filename().string();
+      if (name != path.filename().string() &&
+            name.rfind(path.filename().string() + "_", 0) == 0)
+         movedFiles.push_back(entry.path());
+   }
+   REQUIRE(movedFiles.size() == 1);
+   std::string oldContents = ReadFileContents(movedFiles[0].string());
+   std::filesystem::remove(movedFiles[0]);
+
+   CHECK(oldContents.find("msg-text") != std::string::npos);
+   CHECK(oldContents.find("msg-binary") == std::string::npos);
+
+   REQUIRE(logging::IsBinaryLogFile(tmp.Path()));
+   std::ifstream in(tmp.Path(), std::ios_base::binary);
+   std::ostringstream decoded;
+   REQUIRE(logging::DecodeBinaryLog(in, decoded) ==
+         logging::BinaryLogDecodeOK);
+   CHECK(decoded.str().find("msg-binary") != std::string::npos);
+   CHECK(decoded.str().find("msg-text") == std::string::npos);
+}
+
 } // namespace internal
 } // namespace mmcore
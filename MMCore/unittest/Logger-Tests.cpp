@@ -2,8 +2,13 @@
 
 #include "Logging/Logging.h"
 
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -120,6 +125,246 @@ TEST_CASE("async logger on thread", "[Logger]")
       threads[i]->join();
 }
 
+// Collects the text of each entry (lines joined with '\n')
+class CollectingSink : public LogSink
+{
+   mutable std::mutex mutex_;
+   std::vector<std::string> entries_;
+
+public:
+   void Consume(const PacketArrayType& packets) override
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto it = packets.Begin(); it != packets.End(); ++it)
+      {
+         switch (it->GetPacketState())
+         {
+            case internal::PacketStateEntryFirstLine:
+               entries_.emplace_back(it->GetText());
+               break;
+            case internal::PacketStateNewLine:
+               entries_.back() += '\n';
+               entries_.back() += it->GetText();
+               break;
+            case internal::PacketStateLineContinuation:
+               entries_.back() += it->GetText();
+               break;
+         }
+      }
+   }
+
+   std::vector<std::string> Entries() const
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return entries_;
+   }
+};
+
+
+TEST_CASE("deferred entries are formatted like log streams", "[Logger]")
+{
+   auto c = std::make_shared<LoggingCore>();
+   auto sink = std::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   Logger lgr = c->NewLogger("mylabel");
+   const char* label = "Camera";
+   std::string name = "DCam";
+   LOG_DEFERRED_DEBUG(lgr, "Image ", 42u, " from ", label, '/', name,
+         ": ", -7, ' ', 2.5, ' ', 1e-9f, ' ', true, ' ', 123456789012LL);
+   LOG_DEBUG(lgr) << "Image " << 42u << " from " << label << '/' << name <<
+      ": " << -7 << ' ' << 2.5 << ' ' << 1e-9f << ' ' << true << ' ' <<
+      123456789012LL;
+
+   c->RemoveSink(sink, SinkModeAsynchronous); // Drains the queue
+   auto entries = sink->Entries();
+   REQUIRE(entries.size() == 2);
+   CHECK(entries[0] == entries[1]);
+   CHECK(entries[0] == "Image 42 from Camera/DCam: -7 2.5 1e-09 1 123456789012");
+}
+
+
+TEST_CASE("deferred entries too large for the buffer are not lost", "[Logger]")
+{
+   auto c = std::make_shared<LoggingCore>();
+   auto sink = std::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   Logger lgr = c->NewLogger("mylabel");
+   std::string longText(3000, 'x');
+   LOG_DEFERRED_INFO(lgr, "a", longText, "b");
+   lgr(LogLevelInfo, longText);
+
+   c->RemoveSink(sink, SinkModeAsynchronous);
+   auto entries = sink->Entries();
+   REQUIRE(entries.size() == 2);
+   CHECK(entries[0] == "a" + longText + "b");
+   CHECK(entries[1] == longText);
+}
+
+
+TEST_CASE("deferred entries reach synchronous sinks", "[Logger]")
+{
+   auto c = std::make_shared<LoggingCore>();
+   auto syncSink = std::make_shared<CollectingSink>();
+   auto asyncSink = std::make_shared<CollectingSink>();
+   c->AddSink(syncSink, SinkModeSynchronous);
+   c->AddSink(asyncSink, SinkModeAsynchronous);
+
+   Logger lgr = c->NewLogger("mylabel");
+   LOG_DEFERRED_INFO(lgr, "value = ", 3);
+   REQUIRE(syncSink->Entries().size() == 1);
+   CHECK(syncSink->Entries()[0] == "value = 3");
+
+   c->RemoveSink(asyncSink, SinkModeAsynchronous);
+   REQUIRE(asyncSink->Entries().size() == 1);
+   CHECK(asyncSink->Entries()[0] == "value = 3");
+}
+
+
+TEST_CASE("async entries keep order from many threads", "[Logger]")
+{
+   auto c = std::make_shared<LoggingCore>();
+   auto sink = std::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   // Many more entries than a thread's ring holds, so that senders also wait
+   // for the receive loop.
+   const unsigned nThreads = 4;
+   const unsigned nEntries = 5000;
+   std::vector<std::thread> threads;
+   for (unsigned t = 0; t < nThreads; ++t)
+   {
+      threads.emplace_back([&, t] {
+         Logger lgr = c->NewLogger("thread" + std::to_string(t));
+         for (unsigned i = 0; i < nEntries; ++i)
+         {
+            if (i % 2)
+               LOG_DEFERRED_DEBUG(lgr, t, ' ', i);
+            else
+               lgr(LogLevelDebug, std::to_string(t) + ' ' + std::to_string(i));
+         }
+      });
+   }
+   for (auto& th : threads)
+      th.join();
+
+   c->RemoveSink(sink, SinkModeAsynchronous);
+   auto entries = sink->Entries();
+   REQUIRE(entries.size() == nThreads * nEntries);
+   std::vector<unsigned> next(nThreads, 0);
+   for (const auto& entry : entries)
+   {
+      unsigned t, i;
+      std::istringstream(entry) >> t >> i;
+      REQUIRE(t < nThreads);
+      REQUIRE(i == next[t]);
+      ++next[t];
+   }
+}
+
+
+TEST_CASE("async entries from a new thread reach an idle receive loop", "[Logger]")
+{
+   auto c = std::make_shared<LoggingCore>();
+   auto sink = std::make_shared<CollectingSink>();
+   c->AddSink(sink, SinkModeAsynchronous);
+
+   // Let the receive loop find nothing and wait without a timeout
+   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+   std::thread([&] {
+      Logger lgr = c->NewLogger("fresh");
+      lgr(LogLevelInfo, "from a new thread");
+   }).join();
+
+   // Not flushed by removing the sink: the entry must be delivered on its own
+   const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+   while (sink->Entries().empty() &&
+         std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   auto entries = sink->Entries();
+   REQUIRE(entries.size() == 1);
+   CHECK(entries[0] == "from a new thread");
+
+   c->RemoveSink(sink, SinkModeAsynchronous);
+}
+
+
+// Logging calls per second per thread, by front end, with and without an
+// asynchronous file sink.
+// Run with: MMCoreTests "[LoggingBenchmark]"
+TEST_CASE("Logging call rate", "[.][LoggingBenchmark]")
+{
+   using Clock = std::chrono::steady_clock;
+   const unsigned threadCounts[] = {1, 2, 4, 8};
+   const unsigned callsPerThread = 200000;
+   const char* const frontEnds[] = {"stream", "text", "deferred"};
+   const std::string path = (std::filesystem::temp_directory_path() /
+         "mmcore-logging-benchmark.log").string();
+
+   std::printf("%-9s %-5s %8s %14s\n", "front end", "sink", "threads",
+         "calls/s/thread");
+   for (bool withFile : {false, true})
+   {
+      for (unsigned frontEnd = 0; frontEnd < 3; ++frontEnd)
+      {
+         for (unsigned nThreads : threadCounts)
+         {
+            auto c = std::make_shared<LoggingCore>();
+            std::shared_ptr<LogSink> sink;
+            if (withFile)
+            {
+               sink = std::make_shared<FileLogSink>(path);
+               c->AddSink(sink, SinkModeAsynchronous);
+            }
+
+            std::vector<double> seconds(nThreads);
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < nThreads; ++t)
+            {
+               threads.emplace_back([&, t] {
+                  Logger lgr = c->NewLogger("bench");
+                  std::string label = "Camera" + std::to_string(t);
+                  auto start = Clock::now();
+                  for (unsigned i = 0; i < callsPerThread; ++i)
+                  {
+                     switch (frontEnd)
+                     {
+                        case 0:
+                           LOG_DEBUG(lgr) << "Inserted image " << i <<
+                              " from " << label;
+                           break;
+                        case 1:
+                           lgr(LogLevelDebug, "Inserted image from camera");
+                           break;
+                        case 2:
+                           LOG_DEFERRED_DEBUG(lgr, "Inserted image ", i,
+                                 " from ", label);
+                           break;
+                     }
+                  }
+                  seconds[t] = std::chrono::duration<double>(
+                        Clock::now() - start).count();
+               });
+            }
+            for (auto& th : threads)
+               th.join();
+            if (sink)
+               c->RemoveSink(sink, SinkModeAsynchronous);
+
+            double rate = 0.0;
+            for (double s : seconds)
+               rate += callsPerThread / s;
+            std::printf("%-9s %-5s %8u %14.0f\n", frontEnds[frontEnd],
+                  withFile ? "file" : "none", nThreads, rate / nThreads);
+         }
+      }
+   }
+   std::filesystem::remove(path);
+}
+
 } // namespace logging
 } // namespace internal
 } // namespace mmcore
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include <catch2/catch_all.hpp>
+
+#include "Logging/Logging.h"
+
+#include "Logging/BinaryLogFormat.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace mmcore {
+namespace internal {
+namespace logging {
+
+
+static std::string ReadFileContents(const std::string& path)
+{
+   std::ifstream in(path, std::ios_base::binary);
+   return std::string(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+}
+
+
+static std::string DecodeFile(const std::string& path,
+      BinaryLogDecodeResult expected = BinaryLogDecodeOK)
+{
+   std::ifstream in(path, std::ios_base::binary);
+   std::ostringstream out;
+   REQUIRE(DecodeBinaryLog(in, out) == expected);
+   return out.str();
+}
+
+
+class TempDir
+{
+   std::filesystem::path path_;
+
+public:
+   TempDir()
+   {
+      std::random_device rd;
+      auto dir = std::filesystem::temp_directory_path();
+      for (;;)
+      {
+         auto p = dir / ("mmcore-test-" + std::to_string(rd()));
+         if (!std::filesystem::exists(p))
+         {
+            std::filesystem::create_directory(p);
+            path_ = p;
+            break;
+         }
+      }
+   }
+
+   ~TempDir() { std::filesystem::remove_all(path_); }
+
+   std::string FilePath(const std::string& name) const
+   {
+      return (path_ / name).string();
+   }
+
+   std::vector<std::string> ListFiles() const
+   {
+      std::vector<std::string> result;
+      for (const auto& entry : std::filesystem::directory_iterator(path_))
+         result.push_back(entry.path().filename().string());
+      std::sort(result.begin(), result.end());
+      return result;
+   }
+};
+
+
+TEST_CASE("binary log decodes to the same text as the text log",
+      "[LoggingBinarySink]")
+{
+   TempDir dir;
+   std::string textPath = dir.FilePath("test.log");
+   std::string binaryPath = dir.FilePath("test.bin");
+
+   auto core = std::make_shared<LoggingCore>();
+   auto textSink = std::make_shared<FileLogSink>(textPath);
+   auto binarySink = std::make_shared<BinaryFileLogSink>(binaryPath);
+   textSink->SetFilter(std::make_shared<LevelFilter>(LogLevelDebug));
+   binarySink->SetFilter(std::make_shared<LevelFilter>(LogLevelDebug));
+   core->AddSink(textSink, SinkModeAsynchronous);
+   core->AddSink(binarySink, SinkModeAsynchronous);
+
+   {
+      Logger lgr1 = core->NewLogger("first");
+      Logger lgr2 = core->NewLogger("second logger");
+
+      lgr1(LogLevelInfo, "single line");
+      lgr2(LogLevelTrace, "filtered out");
+      lgr2(LogLevelWarning, "two\nlines");
+      lgr1(LogLevelError, "trailing newline\n");
+      lgr2(LogLevelDebug, std::string(300, 'x').c_str());
+      lgr1(LogLevelCritical, (std::string(200, 'y') + "\n" +
+               std::string(150, 'z')).c_str());
+      LOG_DEFERRED_INFO(lgr2, "deferred ", 42, ' ', 2.5);
+      lgr1(LogLevelInfo, "");
+   }
+   core.reset(); // Flush and close both sinks
+   textSink.reset();
+   binarySink.reset();
+
+   std::string text = ReadFileContents(textPath);
+   REQUIRE_FALSE(text.empty());
+   CHECK(DecodeFile(binaryPath) == text);
+   CHECK(text.find("filtered out") == std::string::npos);
+}
+
+
+TEST_CASE("binary log sink appends to an existing binary log",
+      "[LoggingBinarySink]")
+{
+   TempDir dir;
+   std::string path = dir.FilePath("test.bin");
+
+   for (const char* message : {"before", "after"})
+   {
+      auto core = std::make_shared<LoggingCore>();
+      core->AddSink(std::make_shared<BinaryFileLogSink>(path, true),
+            SinkModeSynchronous);
+      Logger lgr = core->NewLogger("test");
+      lgr(LogLevelInfo, message);
+   }
+
+   std::string decoded = DecodeFile(path);
+   auto before = decoded.find("test] before\n");
+   auto after = decoded.find("test] after\n");
+   REQUIRE(before != std::string::npos);
+   REQUIRE(after != std::string::npos);
+   CHECK(before < after);
+}
+
+
+TEST_CASE("binary log sink refuses to append to a text file",
+      "[LoggingBinarySink]")
+{
+   TempDir dir;
+   std::string path = dir.FilePath("test.log");
+   std::ofstream(path) << "some text log\n";
+
+   REQUIRE_THROWS_AS(BinaryFileLogSink(path, true), CannotOpenFileException);
+   CHECK(ReadFileContents(path) == "some text log\n");
+}
+
+
+TEST_CASE("binary log rotation writes standalone files",
+      "[LoggingBinarySink][rotation]")
+{
+   TempDir dir;
+   std::string path = dir.FilePath("test.bin");
+
+   {
+      auto core = std::make_shared<LoggingCore>();
+      core->AddSink(std::make_shared<BinaryFileLogSink>(path, false, 200, 0),
+            SinkModeSynchronous);
+      Logger lgr = core->NewLogger("test");
+      for (int i = 0; i < 20; ++i)
+         lgr(LogLevelInfo, "This is a log entry for rotation testing");
+   }
+
+   auto files = dir.ListFiles();
+   REQUIRE(files.size() >= 2);
+   for (const auto& f : files)
+   {
+      INFO(f);
+      std::string decoded = DecodeFile(dir.FilePath(f));
+      // The label is written again after each rotation
+      if (!decoded.empty())
+         CHECK(decoded.find("test] This is a log entry") !=
+               std::string::npos);
+   }
+}
+
+
+TEST_CASE("truncated binary log decodes complete entries",
+      "[LoggingBinarySink]")
+{
+   TempDir dir;
+   std::string path = dir.FilePath("test.bin");
+
+   {
+      auto core = std::make_shared<LoggingCore>();
+      core->AddSink(std::make_shared<BinaryFileLogSink>(path),
+            SinkModeSynchronous);
+      Logger lgr = core->NewLogger("test");
+      lgr(LogLevelInfo, "complete");
+      lgr(LogLevelInfo, "cut off");
+   }
+
+   std::string contents = ReadFileContents(path);
+   contents.resize(contents.size() - 3);
+   std::istringstream in(contents);
+   std::ostringstream out;
+   REQUIRE(DecodeBinaryLog(in, out) == BinaryLogDecodeTruncated);
+   CHECK(out.str().find("complete") != std::string::npos);
+   CHECK(out.str().find("cut off") == std::string::npos);
+}
+
+
+TEST_CASE("decoding rejects non-binary input", "[LoggingBinarySink]")
+{
+   std::istringstream in("2024-01-01T00:00:00.000000 tid1 [IFO,test] x\n");
+   std::ostringstream out;
+   CHECK(DecodeBinaryLog(in, out) == BinaryLogDecodeNotBinaryLog);
+   CHECK(out.str().empty());
+
+   TempDir dir;
+   std::string path = dir.FilePath("missing.bin");
+   CHECK_FALSE(IsBinaryLogFile(path));
+}
+
+
+// Run with: MMCoreTests "[LoggingBinarySinkBenchmark]"
+TEST_CASE("binary vs text log sink throughput",
+      "[.][LoggingBinarySinkBenchmark]")
+{
+   TempDir dir;
+   const int count = 200000;
+
+   auto run = [&](std::shared_ptr<LogSink> sink, const char* name,
+         const std::string& path) {
+      auto core = std::make_shared<LoggingCore>();
+      core->AddSink(sink, SinkModeAsynchronous);
+      sink.reset();
+      auto start = std::chrono::steady_clock::now();
+      {
+         Logger lgr = core->NewLogger("benchmark");
+         for (int i = 0; i < count; ++i)
+            LOG_DEFERRED_DEBUG(lgr, "Will set camera property Exposure to ",
+                  i);
+      }
+      core.reset(); // Wait for the sink to finish
+      double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+      auto size = std::filesystem::file_size(path);
+      printf("%s: %.0f entries/s, %.1f bytes/entry\n", name, count / secs,
+            static_cast<double>(size) / count);
+   };
+
+   std::string textPath = dir.FilePath("bench.log");
+   std::string binaryPath = dir.FilePath("bench.bin");
+   run(std::make_shared<FileLogSink>(textPath), "text", textPath);
+   run(std::make_shared<BinaryFileLogSink>(binaryPath), "binary", binaryPath);
+}
+
+
+} // namespace logging
+} // namespace internal
+} // namespace mmcore
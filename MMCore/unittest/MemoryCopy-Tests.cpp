@@ -0,0 +1,159 @@
+#include <catch2/catch_all.hpp>
+
+#include "MemoryCopy.h"
+#include "Semaphore.h"
+#include "Task.h"
+#include "TaskSet_CopyMemory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+using mmcore::internal::AvailableCopyKernels;
+using mmcore::internal::CopyFrameMemory;
+using mmcore::internal::CopyKernel;
+using mmcore::internal::Semaphore;
+using mmcore::internal::StreamingCopyKernel;
+using mmcore::internal::StreamingCopyThreshold;
+using mmcore::internal::Task;
+using mmcore::internal::TaskSet_CopyMemory;
+using mmcore::internal::ThreadPool;
+
+namespace {
+
+std::vector<unsigned char> Pattern(std::size_t size) {
+   std::vector<unsigned char> v(size);
+   for (std::size_t i = 0; i < size; ++i)
+      v[i] = static_cast<unsigned char>(i * 7 + 3);
+   return v;
+}
+
+// One chunk of a frame copy with a given kernel
+class KernelCopyTask : public Task {
+   const CopyKernel& kernel_;
+
+public:
+   unsigned char* dst = nullptr;
+   const unsigned char* src = nullptr;
+   std::size_t bytes = 0;
+
+   KernelCopyTask(std::shared_ptr<Semaphore> sem, const CopyKernel& kernel) :
+      Task(sem, 0, 1), kernel_(kernel) {}
+
+   void Execute() override { kernel_.copy(dst, src, bytes); }
+};
+
+} // namespace
+
+TEST_CASE("Copy kernels start with memcpy") {
+   const auto& kernels = AvailableCopyKernels();
+   REQUIRE(!kernels.empty());
+   CHECK(std::string(kernels.front().name) == "memcpy");
+   CHECK_FALSE(kernels.front().streaming);
+   CHECK(&StreamingCopyKernel() == &kernels.back());
+}
+
+TEST_CASE("Copy kernels copy exactly the requested bytes") {
+   const std::size_t size = GENERATE(0, 1, 63, 64, 65, 255, 256, 1000, 4099);
+   const std::size_t srcOffset = GENERATE(0, 1, 17);
+   const std::size_t dstOffset = GENERATE(0, 3, 32);
+   const auto src = Pattern(size + srcOffset);
+
+   for (const CopyKernel& kernel : AvailableCopyKernels()) {
+      INFO(kernel.name);
+      std::vector<unsigned char> dst(size + dstOffset + 1, 0xee);
+      kernel.copy(dst.data() + dstOffset, src.data() + srcOffset, size);
+
+      CHECK(std::all_of(dst.begin(), dst.begin() + dstOffset,
+         [](unsigned char c) { return c == 0xee; }));
+      CHECK(std::equal(src.begin() + srcOffset, src.end(),
+         dst.begin() + dstOffset));
+      CHECK(dst.back() == 0xee);
+   }
+}
+
+TEST_CASE("Streaming copy threshold is within bounds") {
+   CHECK(StreamingCopyThreshold() >= (256u << 10));
+   CHECK(StreamingCopyThreshold() <= (1u << 20));
+}
+
+TEST_CASE("Large frames are copied correctly") {
+   const std::size_t size = StreamingCopyThreshold() + 12345;
+   const auto src = Pattern(size);
+   std::vector<unsigned char> dst(size);
+   CopyFrameMemory(dst.data(), src.data() + 1, size - 1, size);
+   CHECK(std::equal(dst.begin(), dst.end() - 1, src.begin() + 1));
+
+   auto pool = std::make_shared<ThreadPool>(3);
+   TaskSet_CopyMemory copier(pool);
+   std::vector<unsigned char> dst2(size);
+   copier.MemCopy(dst2.data(), src.data(), size);
+   CHECK(dst2 == src);
+}
+
+// Copy throughput by kernel, frame size, and thread count, for calibrating
+// the streaming threshold and the split into tasks in TaskSet_CopyMemory.
+// Run with: MMCoreTests "[MemCopyBenchmark]"
+TEST_CASE("Frame copy throughput", "[.][MemCopyBenchmark]") {
+   using Clock = std::chrono::steady_clock;
+   const std::size_t frameSizes[] = {
+      256u << 10, 1u << 20, 4u << 20, 8u << 20, 32u << 20, 128u << 20};
+   const std::size_t threadCounts[] = {1, 2, 4, 8};
+   // Cycle through more memory than any cache, as an acquisition would
+   constexpr std::size_t totalBytes = std::size_t(512) << 20;
+
+   std::printf("Streaming threshold: %zu bytes\n", StreamingCopyThreshold());
+   std::printf("%-14s %10s %8s %8s\n", "kernel", "frame KiB", "threads",
+      "GB/s");
+   for (const auto& kernel : AvailableCopyKernels()) {
+      for (std::size_t frameSize : frameSizes) {
+         const std::size_t frameCount = std::max<std::size_t>(2,
+            totalBytes / frameSize);
+         std::vector<unsigned char> src(frameSize, 1);
+         std::vector<unsigned char> ring(frameCount * frameSize);
+         for (std::size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            auto sem = std::make_shared<Semaphore>();
+            std::vector<std::unique_ptr<KernelCopyTask>> tasks;
+            std::vector<Task*> raw;
+            for (std::size_t t = 0; t < threads; ++t) {
+               tasks.push_back(std::make_unique<KernelCopyTask>(sem, kernel));
+               raw.push_back(tasks.back().get());
+            }
+            const std::size_t chunk = frameSize / threads;
+            auto copyFrame = [&](unsigned char* dst) {
+               for (std::size_t t = 0; t < threads; ++t) {
+                  tasks[t]->dst = dst + t * chunk;
+                  tasks[t]->src = src.data() + t * chunk;
+                  tasks[t]->bytes = t + 1 < threads ? chunk :
+                     frameSize - t * chunk;
+               }
+               if (threads == 1) {
+                  tasks.front()->Execute();
+                  return;
+               }
+               pool.Execute(raw);
+               sem->Wait(threads);
+            };
+            // Warm up (also faults in the ring)
+            for (std::size_t i = 0; i < frameCount; ++i)
+               copyFrame(ring.data() + i * frameSize);
+            const std::size_t reps = 3;
+            const auto start = Clock::now();
+            for (std::size_t r = 0; r < reps; ++r)
+               for (std::size_t i = 0; i < frameCount; ++i)
+                  copyFrame(ring.data() + i * frameSize);
+            const double s = std::chrono::duration<double>(
+               Clock::now() - start).count();
+            std::printf("%-14s %10zu %8zu %8.2f\n", kernel.name,
+               frameSize >> 10, threads,
+               reps * frameCount * frameSize / s / 1e9);
+         }
+      }
+   }
+}
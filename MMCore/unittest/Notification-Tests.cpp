@@ -124,6 +124,91 @@ TEST_CASE("NotificationQueue: RequestInterrupt preserves pending items",
    CHECK(std::holds_alternative<notif::PropertyChanged>(*n));
 }
 
+TEST_CASE("NotificationQueue: coalesces property and position updates",
+   "[NotificationQueue]")
+{
+   mmi::NotificationQueue queue;
+   queue.Push(notif::StagePositionChanged{"Z", 1.0});
+   queue.Push(notif::PropertyChanged{"dev", "prop", "a"});
+   queue.Push(notif::StagePositionChanged{"Z", 2.0});
+   queue.Push(notif::StagePositionChanged{"Z2", 5.0});
+   queue.Push(notif::PropertyChanged{"dev", "prop", "b"});
+   queue.Push(notif::PropertyChanged{"dev", "other", "c"});
+   queue.Push(notif::XYStagePositionChanged{"XY", 1.0, 2.0});
+   queue.Push(notif::XYStagePositionChanged{"XY", 3.0, 4.0});
+   queue.Push(notif::PropertiesChanged{});
+   queue.Push(notif::PropertiesChanged{});
+
+   auto batch = queue.WaitAndPopBatch(100);
+   REQUIRE(batch.has_value());
+   REQUIRE(batch->size() == 7);
+   // The latest value is delivered in place of the first
+   CHECK(std::get<notif::StagePositionChanged>((*batch)[0]).position == 2.0);
+   CHECK(std::get<notif::PropertyChanged>((*batch)[1]).propertyValue == "b");
+   CHECK(std::get<notif::StagePositionChanged>((*batch)[2]).deviceLabel == "Z2");
+   CHECK(std::get<notif::PropertyChanged>((*batch)[3]).propertyName == "other");
+   CHECK(std::get<notif::XYStagePositionChanged>((*batch)[4]).x == 3.0);
+   CHECK(std::holds_alternative<notif::PropertiesChanged>((*batch)[5]));
+   CHECK(std::holds_alternative<notif::PropertiesChanged>((*batch)[6]));
+
+   // Once delivered, a key is queued again
+   queue.Push(notif::StagePositionChanged{"Z", 3.0});
+   queue.Push(notif::StagePositionChanged{"Z", 4.0});
+   auto n = queue.WaitAndPop();
+   REQUIRE(n.has_value());
+   CHECK(std::get<notif::StagePositionChanged>(*n).position == 4.0);
+
+   const auto stats = queue.GetStats();
+   CHECK(stats.pushed == 12);
+   CHECK(stats.coalesced == 4);
+   CHECK(stats.popped == 8);
+   CHECK(stats.depth == 0);
+   CHECK(stats.maxDepth == 7);
+}
+
+TEST_CASE("NotificationQueue: drops value notifications when full",
+   "[NotificationQueue]")
+{
+   mmi::NotificationQueue queue(2);
+   queue.Push(notif::StagePositionChanged{"Z", 1.0});
+   queue.Push(notif::PropertyChanged{"dev", "prop", "a"});
+   queue.Push(notif::PropertyChanged{"dev", "other", "b"});
+   queue.Push(notif::XYStagePositionChanged{"XY", 1.0, 2.0});
+   // Coalescing still works when full
+   queue.Push(notif::StagePositionChanged{"Z", 2.0});
+   // Events are never dropped
+   queue.Push(notif::SystemConfigurationLoaded{});
+
+   auto stats = queue.GetStats();
+   CHECK(stats.depth == 3);
+   CHECK(stats.dropped == 2);
+   CHECK(stats.coalesced == 1);
+
+   auto batch = queue.WaitAndPopBatch(1);
+   REQUIRE(batch.has_value());
+   REQUIRE(batch->size() == 1);
+   CHECK(std::get<notif::StagePositionChanged>((*batch)[0]).position == 2.0);
+
+   queue.SetCapacity(0);
+   for (int i = 0; i < 10; ++i)
+      queue.Push(notif::ImageSnapped{"cam"});
+   stats = queue.GetStats();
+   CHECK(stats.depth == 12);
+   CHECK(stats.dropped == 2);
+}
+
+TEST_CASE("NotificationQueue: RequestInterrupt unblocks WaitAndPopBatch",
+   "[NotificationQueue]")
+{
+   mmi::NotificationQueue queue;
+   std::thread consumer([&] {
+      CHECK_FALSE(queue.WaitAndPopBatch(10).has_value());
+   });
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   queue.RequestInterrupt();
+   consumer.join();
+}
+
 // --- Notification Dispatch tests ---
 
 namespace {
@@ -389,6 +474,28 @@ TEST_CASE("registerCallback delivers notifications asynchronously",
    core.registerCallback(nullptr);
 }
 
+TEST_CASE("Notification queue counters are available as a Core property",
+   "[Notification][Integration]")
+{
+   WaitableCallback cb;
+   CMMCore core;
+   CHECK(core.getProperty("Core", "NotificationQueueCapacity") == "10000");
+   CHECK_THROWS_AS(core.setProperty("Core", "NotificationQueueCapacity", "0"),
+      CMMError);
+   core.setProperty("Core", "NotificationQueueCapacity", "100");
+   CHECK(core.getProperty("Core", "NotificationQueueCapacity") == "100");
+
+   core.registerCallback(&cb);
+   core.unloadAllDevices();
+   REQUIRE(cb.waitForSystemConfigLoaded(std::chrono::milliseconds(1000)));
+   const std::string stats =
+      core.getProperty("Core", "NotificationQueueStatistics");
+   CHECK_THAT(stats, Catch::Matchers::StartsWith("Depth="));
+   CHECK_THAT(stats, Catch::Matchers::ContainsSubstring("Dropped=0"));
+   CHECK_THAT(stats, Catch::Matchers::ContainsSubstring("MaxLatencyMs="));
+   core.registerCallback(nullptr);
+}
+
 TEST_CASE("registerCallback(nullptr) stops delivery",
    "[Notification][Integration]")
 {
@@ -1,10 +1,12 @@
 #include <catch2/catch_all.hpp>
 
 #include "MMCore.h"
+#include "ImageMetadata.h"
 #include "MMDeviceConstants.h"
 #include "MockDeviceUtils.h"
 #include "StubDevices.h"
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <mutex>
@@ -151,6 +153,62 @@ private:
    std::vector<unsigned char> imgBuf_;
 };
 
+struct LegacyCamera : CLegacyCameraBase<LegacyCamera> {
+   std::string name = "LegacyCamera";
+   unsigned width = 64;
+   unsigned height = 64;
+   unsigned bytesPerPixel = 1;
+   int binning = 1;
+   double exposure = 0.0;
+   std::atomic<bool> threadExited{false};
+
+   int Initialize() override { return DEVICE_OK; }
+   int Shutdown() override { return DEVICE_OK; }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+
+   int SnapImage() override {
+      imgBuf_.assign(
+         static_cast<size_t>(width) * height * bytesPerPixel, 0);
+      return DEVICE_OK;
+   }
+   const unsigned char* GetImageBuffer() override {
+      return imgBuf_.data();
+   }
+   long GetImageBufferSize() const override {
+      return static_cast<long>(width) * height * bytesPerPixel;
+   }
+   unsigned GetImageWidth() const override { return width; }
+   unsigned GetImageHeight() const override { return height; }
+   unsigned GetImageBytesPerPixel() const override { return bytesPerPixel; }
+   unsigned GetBitDepth() const override { return 8; }
+   int GetBinning() const override { return binning; }
+   int SetBinning(int b) override { binning = b; return DEVICE_OK; }
+   void SetExposure(double e) override { exposure = e; }
+   double GetExposure() const override { return exposure; }
+   int SetROI(unsigned, unsigned, unsigned, unsigned) override {
+      return DEVICE_OK;
+   }
+   int GetROI(unsigned& x, unsigned& y, unsigned& w, unsigned& h) override {
+      x = 0; y = 0; w = width; h = height;
+      return DEVICE_OK;
+   }
+   int ClearROI() override { return DEVICE_OK; }
+   int IsExposureSequenceable(bool& seq) const override {
+      seq = false;
+      return DEVICE_OK;
+   }
+
+   void OnThreadExiting() override {
+      CLegacyCameraBase::OnThreadExiting();
+      threadExited = true;
+   }
+
+private:
+   std::vector<unsigned char> imgBuf_;
+};
+
 // --- Lifecycle error handling ---
 
 TEST_CASE("startSequenceAcquisition throws when no camera set",
@@ -551,3 +609,47 @@ TEST_CASE("startSequenceAcquisition after camera self-finish without "
    CHECK(c.popNextImage() != nullptr);
    c.stopSequenceAcquisition();
 }
+
+TEST_CASE("Buffered legacy sequence stamps the elapsed time at snap",
+          "[SequenceAcquisition]") {
+   // Each insertion into the Core takes longer than the whole burst of
+   // snaps, so a Core-side stamp of the later frames would be late
+   struct SlowImageProcessor : StubImageProcessor {
+      int Process(unsigned char*, unsigned, unsigned, unsigned) override {
+         std::this_thread::sleep_for(std::chrono::milliseconds(50));
+         return DEVICE_OK;
+      }
+   };
+
+   LegacyCamera cam;
+   SlowImageProcessor ip;
+   MockAdapterWithDevices adapter{{"cam", &cam}, {"ip", &ip}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setImageProcessorDevice("ip");
+   c.setProperty("cam", MM::g_Keyword_SequenceBufferCount, "3");
+
+   const long numImages = 3;
+   c.startSequenceAcquisition(numImages, 0.0, true);
+
+   // The thread reports itself stopped before it notifies the Core
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+   while (!cam.threadExited &&
+          std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   REQUIRE(cam.threadExited);
+   REQUIRE(c.getRemainingImageCount() == numImages);
+
+   for (long i = 0; i < numImages; ++i) {
+      Metadata md;
+      REQUIRE(c.popNextImageMD(md) != nullptr);
+      CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_ImageNumber).GetValue() ==
+            std::to_string(i));
+      CHECK(std::stod(md.GetSingleTag(MM::g_Keyword_Elapsed_Time_ms)
+                         .GetValue()) < 40.0);
+   }
+   c.setImageProcessorDevice("");
+   c.stopSequenceAcquisition();
+}
@@ -0,0 +1,276 @@
+#include <catch2/catch_all.hpp>
+
+#include "MMCore.h"
+#include "CircularBuffer.h"
+#include "FrameStreamWriter.h"
+#include "ImageMetadata.h"
+#include "ImageTagBlock.h"
+#include "MMDeviceConstants.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class TempStreamPath {
+   std::filesystem::path dir_;
+
+public:
+   TempStreamPath() {
+      std::random_device rd;
+      auto tmp = std::filesystem::temp_directory_path();
+      do {
+         dir_ = tmp / ("mmcore-stream-test-" + std::to_string(rd()));
+      } while (std::filesystem::exists(dir_));
+      std::filesystem::create_directory(dir_);
+   }
+
+   ~TempStreamPath() { std::filesystem::remove_all(dir_); }
+
+   std::string Stack() const { return (dir_ / "stack.raw").string(); }
+   std::string Index() const {
+      return Stack() + mmcore::internal::StreamIndexSuffix;
+   }
+};
+
+std::string ReadFileContents(const std::string& path) {
+   std::ifstream in(path, std::ios_base::binary);
+   return std::string(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+}
+
+template <typename T>
+T ReadLE(const std::string& buf, std::size_t& pos) {
+   REQUIRE(pos + sizeof(T) <= buf.size());
+   T value = 0;
+   for (std::size_t i = 0; i < sizeof(T); ++i)
+      value |= static_cast<T>(static_cast<unsigned char>(buf[pos + i])) <<
+         (8 * i);
+   pos += sizeof(T);
+   return value;
+}
+
+struct IndexRecord {
+   std::uint64_t offset;
+   std::uint64_t size;
+   std::string metadata;
+};
+
+std::vector<IndexRecord> ReadIndex(const std::string& path) {
+   std::string idx = ReadFileContents(path);
+   REQUIRE(idx.size() >= 16);
+   REQUIRE(std::memcmp(idx.data(), mmcore::internal::StreamIndexMagic, 8) ==
+           0);
+   std::size_t pos = 8;
+   CHECK(ReadLE<std::uint32_t>(idx, pos) ==
+         mmcore::internal::StreamIndexFormatVersion);
+   CHECK(ReadLE<std::uint32_t>(idx, pos) == 0);
+
+   std::vector<IndexRecord> records;
+   while (pos < idx.size()) {
+      IndexRecord rec;
+      rec.offset = ReadLE<std::uint64_t>(idx, pos);
+      rec.size = ReadLE<std::uint64_t>(idx, pos);
+      auto mdLen = ReadLE<std::uint32_t>(idx, pos);
+      REQUIRE(pos + mdLen <= idx.size());
+      rec.metadata = idx.substr(pos, mdLen);
+      pos += mdLen;
+      records.push_back(std::move(rec));
+   }
+   return records;
+}
+
+} // namespace
+
+TEST_CASE("stream to disk writes raw frames and an index",
+          "[StreamToDisk]") {
+   StubCamera cam;
+   // Frames that do not divide the chunk size, so that some span chunks
+   cam.width = 500;
+   cam.height = 499;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.initializeCircularBuffer();
+
+   TempStreamPath tmp;
+   c.startStreamToDisk(tmp.Stack().c_str());
+   CHECK(c.isStreamingToDisk());
+
+   const std::size_t frameSize = std::size_t(cam.width) * cam.height;
+   const int nFrames = 100;
+   std::vector<unsigned char> pixels(frameSize);
+   for (int i = 0; i < nFrames; ++i) {
+      std::fill(pixels.begin(), pixels.end(),
+                static_cast<unsigned char>(i));
+      pixels[0] = 0xa5; // Distinguish the frame boundaries
+      REQUIRE(cam.InsertTestImage(MM::CameraImageMetadata{},
+                                  pixels.data()) == DEVICE_OK);
+   }
+
+   c.stopStreamToDisk();
+   CHECK_FALSE(c.isStreamingToDisk());
+   CHECK(c.getStreamToDiskImageCount() == nFrames);
+   CHECK(c.getRemainingImageCount() == 0);
+   CHECK_NOTHROW(c.stopStreamToDisk());
+
+   std::string stack = ReadFileContents(tmp.Stack());
+   REQUIRE(stack.size() == nFrames * frameSize);
+   for (int i = 0; i < nFrames; ++i) {
+      INFO("frame " << i);
+      const char* frame = stack.data() + i * frameSize;
+      CHECK(static_cast<unsigned char>(frame[0]) == 0xa5);
+      CHECK(static_cast<unsigned char>(frame[1]) == i);
+      CHECK(static_cast<unsigned char>(frame[frameSize - 1]) == i);
+   }
+
+   auto records = ReadIndex(tmp.Index());
+   REQUIRE(records.size() == nFrames);
+   for (int i = 0; i < nFrames; ++i) {
+      INFO("frame " << i);
+      CHECK(records[i].offset == i * frameSize);
+      CHECK(records[i].size == frameSize);
+      Metadata md;
+      REQUIRE(md.Restore(records[i].metadata.c_str()));
+      CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_Width).GetValue() ==
+            std::to_string(cam.width));
+      CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_Height).GetValue() ==
+            std::to_string(cam.height));
+      CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_ImageNumber).GetValue() ==
+            std::to_string(i));
+   }
+}
+
+TEST_CASE("stream to disk with no frames leaves empty stack",
+          "[StreamToDisk]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.initializeCircularBuffer();
+
+   CHECK(c.getStreamToDiskImageCount() == 0);
+   CHECK(c.getStreamToDiskThroughput() == 0.0);
+
+   TempStreamPath tmp;
+   c.startStreamToDisk(tmp.Stack().c_str());
+   c.stopStreamToDisk();
+   CHECK(std::filesystem::file_size(tmp.Stack()) == 0);
+   CHECK(ReadIndex(tmp.Index()).empty());
+}
+
+TEST_CASE("stream to disk rejects a second stream and buffer resize",
+          "[StreamToDisk]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.initializeCircularBuffer();
+
+   TempStreamPath tmp;
+   c.startStreamToDisk(tmp.Stack().c_str());
+   CHECK_THROWS_AS(c.startStreamToDisk(tmp.Stack().c_str()), CMMError);
+   CHECK_THROWS_AS(c.setCircularBufferMemoryFootprint(100), CMMError);
+   c.stopStreamToDisk();
+   CHECK_NOTHROW(c.setCircularBufferMemoryFootprint(100));
+
+   // A new stream can be started after stopping
+   c.startStreamToDisk(tmp.Stack().c_str());
+   CHECK(c.isStreamingToDisk());
+}
+
+TEST_CASE("stream to disk fails for an unwritable path", "[StreamToDisk]") {
+   StubCamera cam;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.initializeCircularBuffer();
+
+   TempStreamPath tmp;
+   std::string bad = tmp.Stack() + "/no/such/dir/stack.raw";
+   CHECK_THROWS_AS(c.startStreamToDisk(bad.c_str()), CMMError);
+   CHECK_THROWS_AS(c.startStreamToDisk(""), CMMError);
+   CHECK_FALSE(c.isStreamingToDisk());
+}
+
+TEST_CASE("stream writer splits frames across small chunks",
+          "[StreamToDisk]") {
+   using namespace mmcore::internal;
+   const std::size_t frameSize = 100 * 100;
+   const int nFrames = 20;
+   CircularBuffer cbuf(10, std::make_shared<ThreadPool>());
+   REQUIRE(cbuf.Initialize(frameSize));
+   std::vector<unsigned char> pixels(frameSize);
+   for (int i = 0; i < nFrames; ++i) {
+      std::fill(pixels.begin(), pixels.end(),
+                static_cast<unsigned char>(i + 1));
+      REQUIRE(cbuf.InsertImage(pixels.data(), frameSize, ImageTagBlock{}));
+   }
+
+   // Chunks smaller than a frame
+   FrameStreamWriter::Options options;
+   options.chunkSize = 4096;
+   options.chunkCount = 2;
+   TempStreamPath tmp;
+   FrameStreamWriter writer(cbuf, tmp.Stack(), options);
+   writer.Stop();
+   CHECK(writer.GetFramesWritten() == nFrames);
+   CHECK(writer.GetBytesWritten() == nFrames * frameSize);
+   CHECK(cbuf.GetRemainingImageCount() == 0);
+
+   std::string stack = ReadFileContents(tmp.Stack());
+   REQUIRE(stack.size() == nFrames * frameSize);
+   for (int i = 0; i < nFrames; ++i) {
+      CHECK(static_cast<unsigned char>(stack[i * frameSize]) == i + 1);
+      CHECK(static_cast<unsigned char>(stack[(i + 1) * frameSize - 1]) ==
+            i + 1);
+   }
+   auto records = ReadIndex(tmp.Index());
+   REQUIRE(records.size() == nFrames);
+   CHECK(records.back().offset == (nFrames - 1) * frameSize);
+}
+
+// Run with: MMCoreTests "[StreamToDiskBenchmark]"
+TEST_CASE("stream to disk throughput", "[.][StreamToDiskBenchmark]") {
+   StubCamera cam;
+   cam.width = 2048;
+   cam.height = 2048;
+   cam.bytesPerPixel = 2;
+   MockAdapterWithDevices adapter{{"cam", &cam}};
+   CMMCore c;
+   adapter.LoadIntoCore(c);
+   c.setCameraDevice("cam");
+   c.setCircularBufferMemoryFootprint(1024);
+   c.initializeCircularBuffer();
+
+   TempStreamPath tmp;
+   c.startStreamToDisk(tmp.Stack().c_str());
+   const int nFrames = 500;
+   std::vector<unsigned char> pixels(
+      std::size_t(cam.width) * cam.height * cam.bytesPerPixel, 0x55);
+   for (int i = 0; i < nFrames; ++i) {
+      // Wait for the writer rather than overflow the buffer
+      while (c.getBufferFreeCapacity() == 0)
+         std::this_thread::sleep_for(std::chrono::microseconds(100));
+      REQUIRE(cam.InsertTestImage(MM::CameraImageMetadata{},
+                                  pixels.data()) == DEVICE_OK);
+   }
+   c.stopStreamToDisk();
+   printf("stream to disk: %lld frames, %.0f MB/s\n",
+          c.getStreamToDiskImageCount(), c.getStreamToDiskThroughput());
+}
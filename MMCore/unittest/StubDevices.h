@@ -7,7 +7,11 @@
 #include "CameraImageMetadata.h"
 #include "DeviceBase.h"
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 struct StubGeneric : CGenericBase<StubGeneric> {
@@ -22,6 +26,68 @@ struct StubGeneric : CGenericBase<StubGeneric> {
    }
 };
 
+// Lets tests check that the core calls different devices concurrently. The
+// call selected by meetIn waits (up to a timeout) for another
+// RendezvousDevice to be in such a call at the same time, and records
+// whether one was in overlapped.
+struct RendezvousDevice : CGenericBase<RendezvousDevice> {
+   enum class MeetIn { Nothing, SetValue, GetValue, Busy };
+
+   std::string name = "RendezvousDevice";
+   MeetIn meetIn;
+   std::string value; // Initial value of the "Value" property
+   std::string meetValue; // If not empty, only setting this value meets
+   std::string failValue; // If not empty, setting this value fails
+   bool busy = false;
+   std::atomic<bool> overlapped{false};
+
+   explicit RendezvousDevice(MeetIn meet, std::string initialValue = "0") :
+      meetIn(meet), value(std::move(initialValue)) {}
+
+   int Initialize() override {
+      CreateStringProperty("Value", value.c_str(), false, new MM::ActionLambda(
+         [this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::BeforeGet && meetIn == MeetIn::GetValue)
+               Meet();
+            if (eAct != MM::AfterSet)
+               return DEVICE_OK;
+            std::string v;
+            pProp->Get(v);
+            if (!failValue.empty() && v == failValue)
+               return DEVICE_ERR;
+            if (meetIn == MeetIn::SetValue &&
+                  (meetValue.empty() || v == meetValue))
+               Meet();
+            return DEVICE_OK;
+         }));
+      return DEVICE_OK;
+   }
+   int Shutdown() override { return DEVICE_OK; }
+   bool Busy() override {
+      if (meetIn == MeetIn::Busy)
+         Meet();
+      return busy;
+   }
+   void GetName(char* buf) const override {
+      CDeviceUtils::CopyLimitedString(buf, name.c_str());
+   }
+
+private:
+   void Meet() {
+      static std::atomic<int> meeting{0};
+      ++meeting;
+      const auto deadline = std::chrono::steady_clock::now() +
+         std::chrono::seconds(5);
+      while (meeting < 2 && std::chrono::steady_clock::now() < deadline)
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      if (meeting >= 2)
+         overlapped = true;
+      // Let the other device see us before leaving
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      --meeting;
+   }
+};
+
 struct StubCamera : CCameraBase<StubCamera> {
    std::string name = "StubCamera";
    using CCameraBase::OnExposureChanged;
@@ -103,6 +169,21 @@ struct StubCamera : CCameraBase<StubCamera> {
          md.Serialize());
    }
 
+   int AcquireTestWriteSlot(unsigned char** pixels) {
+      return GetCoreCallback()->AcquireImageWriteSlot(this,
+         width, height, bytesPerPixel, nComponents, pixels);
+   }
+
+   int CommitTestWriteSlot(unsigned char* pixels,
+         const MM::CameraImageMetadata& md = MM::CameraImageMetadata{}) {
+      return GetCoreCallback()->CommitImageWriteSlot(this, pixels,
+         md.Serialize());
+   }
+
+   int AbortTestWriteSlot(unsigned char* pixels) {
+      return GetCoreCallback()->AbortImageWriteSlot(this, pixels);
+   }
+
 private:
    std::vector<unsigned char> imgBuf_;
 };
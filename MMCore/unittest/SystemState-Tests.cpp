@@ -0,0 +1,70 @@
+#include <catch2/catch_all.hpp>
+
+#include "MMCore.h"
+#include "MockDeviceUtils.h"
+#include "StubDevices.h"
+#include "SynchronizedConfiguration.h"
+
+#include <string>
+
+namespace {
+
+std::vector<std::string> DeviceOrder(const Configuration& config) {
+   std::vector<std::string> labels;
+   for (size_t i = 0; i < config.size(); ++i) {
+      const std::string label = config.getSetting(i).getDeviceLabel();
+      if (labels.empty() || labels.back() != label)
+         labels.push_back(label);
+   }
+   return labels;
+}
+
+} // namespace
+
+TEST_CASE("Parallel state read reads different modules concurrently") {
+   RendezvousDevice dev1{RendezvousDevice::MeetIn::Nothing, "a"};
+   RendezvousDevice dev2{RendezvousDevice::MeetIn::Nothing, "b"};
+   MockAdapterWithDevices adapter1{"adapter1", {{"dev1", &dev1}}};
+   MockAdapterWithDevices adapter2{"adapter2", {{"dev2", &dev2}}};
+   CMMCore c;
+   adapter1.LoadIntoCore(c);
+   adapter2.LoadIntoCore(c);
+
+   const Configuration serial = c.getSystemState();
+
+   c.setProperty("Core", "ParallelStateRead", "1");
+   dev1.meetIn = dev2.meetIn = RendezvousDevice::MeetIn::GetValue;
+   Configuration parallel = c.getSystemState();
+   dev1.meetIn = dev2.meetIn = RendezvousDevice::MeetIn::Nothing;
+   CHECK(dev1.overlapped);
+   CHECK(dev2.overlapped);
+
+   // Same settings, in the same order
+   CHECK(DeviceOrder(parallel) == DeviceOrder(serial));
+   REQUIRE(parallel.size() == serial.size());
+   CHECK(parallel.getSetting("dev1", "Value").getPropertyValue() == "a");
+   CHECK(parallel.getSetting("dev2", "Value").getPropertyValue() == "b");
+
+   c.updateSystemStateCache();
+   CHECK(c.getPropertyFromCache("dev2", "Value") == "b");
+}
+
+TEST_CASE("State cache snapshots are not affected by later changes") {
+   SynchronizedConfiguration cache;
+   cache.addSetting(PropertySetting("dev", "A", "1"));
+   const auto snapshot = cache.snapshot();
+
+   cache.addSetting(PropertySetting("dev", "A", "2"));
+   cache.addSetting(PropertySetting("dev", "B", "3"));
+   CHECK(snapshot->size() == 1);
+   CHECK(snapshot->getSetting("dev", "A").getPropertyValue() == "1");
+   CHECK(cache.getSetting("dev", "A")->getPropertyValue() == "2");
+   CHECK(cache.get().size() == 2);
+
+   Configuration replacement;
+   replacement.addSetting(PropertySetting("dev", "C", "4"));
+   cache.set(replacement);
+   CHECK(snapshot->size() == 1);
+   CHECK_FALSE(cache.getSetting("dev", "A").has_value());
+   CHECK(cache.snapshot()->isPropertyIncluded("dev", "C"));
+}
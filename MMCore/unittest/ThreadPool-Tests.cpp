@@ -0,0 +1,123 @@
+#include <catch2/catch_all.hpp>
+
+#include "Semaphore.h"
+#include "Task.h"
+#include "TaskSet_CopyMemory.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using mmcore::internal::Semaphore;
+using mmcore::internal::Task;
+using mmcore::internal::TaskSet_CopyMemory;
+using mmcore::internal::ThreadPool;
+
+namespace {
+
+class CountingTask : public Task {
+   std::atomic<int>& count_;
+   std::chrono::milliseconds duration_;
+
+public:
+   CountingTask(std::shared_ptr<Semaphore> sem, std::atomic<int>& count,
+         std::chrono::milliseconds duration = {}) :
+      Task(sem, 0, 1), count_(count), duration_(duration) {}
+
+   void Execute() override {
+      if (duration_.count() > 0)
+         std::this_thread::sleep_for(duration_);
+      ++count_;
+   }
+};
+
+} // namespace
+
+TEST_CASE("ThreadPool size can be chosen") {
+   CHECK(ThreadPool(3).GetSize() == 3);
+   CHECK(ThreadPool().GetSize() ==
+      std::max(1u, std::thread::hardware_concurrency()));
+}
+
+TEST_CASE("ThreadPool executes all tasks") {
+   ThreadPool pool(4);
+   auto sem = std::make_shared<Semaphore>();
+   std::atomic<int> count{0};
+   std::vector<std::unique_ptr<Task>> tasks;
+   std::vector<Task*> raw;
+   for (int i = 0; i < 100; ++i) {
+      tasks.push_back(std::make_unique<CountingTask>(sem, count));
+      raw.push_back(tasks.back().get());
+   }
+
+   pool.Execute(raw);
+   for (int i = 0; i < 10; ++i)
+      pool.Execute(tasks[i].get(), 2);
+   for (int i = 0; i < 10; ++i)
+      pool.Execute(tasks[i].get());
+   sem->Wait(120);
+   CHECK(count == 120);
+
+   const auto stats = pool.GetWorkerStats();
+   REQUIRE(stats.size() == 4);
+   CHECK(std::accumulate(stats.begin(), stats.end(), std::uint64_t{0},
+      [](std::uint64_t sum, const ThreadPool::WorkerStats& s) {
+         return sum + s.tasksExecuted;
+      }) == 120);
+}
+
+TEST_CASE("Idle ThreadPool workers steal queued tasks") {
+   ThreadPool pool(4);
+   auto sem = std::make_shared<Semaphore>();
+   std::atomic<int> count{0};
+   std::vector<std::unique_ptr<Task>> tasks;
+   for (int i = 0; i < 8; ++i) {
+      tasks.push_back(std::make_unique<CountingTask>(sem, count,
+         std::chrono::milliseconds(20)));
+      pool.Execute(tasks.back().get(), 0);
+   }
+
+   const auto start = std::chrono::steady_clock::now();
+   sem->Wait(8);
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   CHECK(count == 8);
+
+   const auto stats = pool.GetWorkerStats();
+   std::uint64_t stolen = 0;
+   for (std::size_t i = 0; i < stats.size(); ++i) {
+      stolen += stats[i].tasksStolen;
+      if (stats[i].tasksExecuted > 0)
+         CHECK(stats[i].busyTime >= std::chrono::milliseconds(15));
+   }
+   CHECK(stats[0].tasksStolen == 0);
+   if (std::thread::hardware_concurrency() > 1) {
+      CHECK(stolen > 0);
+      CHECK(elapsed < std::chrono::milliseconds(8 * 20));
+   }
+   CHECK(pool.GetUptime() >= elapsed);
+}
+
+TEST_CASE("ThreadPool with pinned threads executes tasks") {
+   ThreadPool pool(2, true);
+   auto sem = std::make_shared<Semaphore>();
+   std::atomic<int> count{0};
+   CountingTask a(sem, count), b(sem, count);
+   pool.Execute({&a, &b});
+   sem->Wait(2);
+   CHECK(count == 2);
+}
+
+TEST_CASE("TaskSet_CopyMemory copies large buffers on the pool") {
+   auto pool = std::make_shared<ThreadPool>(4);
+   TaskSet_CopyMemory copier(pool);
+   std::vector<unsigned char> src(8 * 1000 * 1000 + 3);
+   std::iota(src.begin(), src.end(), static_cast<unsigned char>(0));
+   std::vector<unsigned char> dst(src.size());
+   copier.MemCopy(dst.data(), src.data(), src.size());
+   CHECK(dst == src);
+}
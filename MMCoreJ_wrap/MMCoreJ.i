@@ -205,110 +205,33 @@
 }
 %typemap(out) void*
 {
-   long lSize = (arg1)->getImageWidth() * (arg1)->getImageHeight();
-   
-   if ((arg1)->getBytesPerPixel() == 1)
-   {
-      // create a new byte[] object in Java
-      jbyteArray data = JCALL1(NewByteArray, jenv, lSize);
-      if (data == 0)
-      {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
-
-         $result = 0;
-         return $result;
-      }
-   
-      // copy pixels from the image buffer
-      JCALL4(SetByteArrayRegion, jenv, data, 0, lSize, (jbyte*)result);
-
-      $result = data;
-   }
-   else if ((arg1)->getBytesPerPixel() == 2)
-   {
-      // create a new short[] object in Java
-      jshortArray data = JCALL1(NewShortArray, jenv, lSize);
-      if (data == 0)
-      {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
-         $result = 0;
-         return $result;
-      }
-  
-      // copy pixels from the image buffer
-      JCALL4(SetShortArrayRegion, jenv, data, 0, lSize, (jshort*)result);
-
-      $result = data;
-   }
-   else if ((arg1)->getBytesPerPixel() == 4)
-   {
-      if ((arg1)->getNumberOfComponents() == 1)
-      {
-         // create a new float[] object in Java
-         jfloatArray data = JCALL1(NewFloatArray, jenv, lSize);
-         if (data == 0)
-         {
-            jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-            if (excep)
-               jenv->ThrowNew(excep, "The system ran out of memory!");
-
-            $result = 0;
-            return $result;
-         }
-
-         // copy pixels from the image buffer
-         JCALL4(SetFloatArrayRegion, jenv, data, 0, lSize, (jfloat*)result);
-
-         $result = data;
-      }
-      else
-      {
-         // create a new byte[] object in Java
-         jbyteArray data = JCALL1(NewByteArray, jenv, lSize * 4);
-         if (data == 0)
-         {
-            jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-            if (excep)
-               jenv->ThrowNew(excep, "The system ran out of memory!");
-
-            $result = 0;
-            return $result;
-         }
-
-         // copy pixels from the image buffer
-         JCALL4(SetByteArrayRegion, jenv, data, 0, lSize * 4, (jbyte*)result);
+   $result = NewPixelArray(jenv, arg1, result, 1);
+}
 
-         $result = data;
-      }
-   }
-   else if ((arg1)->getBytesPerPixel() == 8)
+// popNextImagesMD() returns one pixel array per image, each copied directly
+// from the frame that the Core leased from the circular buffer
+%typemap(jni) std::vector<FrameHandle> popNextImagesMD    "jobjectArray"
+%typemap(jtype) std::vector<FrameHandle> popNextImagesMD  "Object[]"
+%typemap(jstype) std::vector<FrameHandle> popNextImagesMD "Object[]"
+%typemap(javaout) std::vector<FrameHandle> popNextImagesMD {
+   return $jnicall;
+}
+%typemap(out) std::vector<FrameHandle> popNextImagesMD
+{
+   const std::vector<FrameHandle>& frames = result;
+   const jsize count = static_cast<jsize>(frames.size());
+   jclass objectClass = jenv->FindClass("java/lang/Object");
+   $result = objectClass ? jenv->NewObjectArray(count, objectClass, 0) : 0;
+   for (jsize i = 0; $result != 0 && i < count; ++i)
    {
-      // create a new short[] object in Java
-      jshortArray data = JCALL1(NewShortArray, jenv, lSize * 4);
-      if (data == 0)
+      jobject pixels = NewPixelArray(jenv, arg1, frames[i].getPixels(), 1);
+      if (pixels == 0)
       {
-         jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
-         if (excep)
-            jenv->ThrowNew(excep, "The system ran out of memory!");
          $result = 0;
-         return $result;
+         break;
       }
-  
-      // copy pixels from the image buffer
-      JCALL4(SetShortArrayRegion, jenv, data, 0, lSize * 4, (jshort*)result);
-
-      $result = data;
-   }
-
-   else
-   {
-      // don't know how to map
-      // TODO: throw exception?
-      $result = 0;
+      jenv->SetObjectArrayElement($result, i, pixels);
+      jenv->DeleteLocalRef(pixels);
    }
 }
 
@@ -434,6 +357,14 @@
 %ignore MetadataKeyError;
 %ignore MetadataIndexError;
 
+// Frame handles provide in-place access to pixels in native memory, which
+// Java code cannot use without copying them anyway; the TaggedImage and
+// pixel array functions are used instead.
+%ignore CMMCore::getLastFrame;
+%ignore CMMCore::getNBeforeLastFrame;
+%ignore CMMCore::popNextFrame;
+%ignore CMMCore::popNextFrames;
+
 
 %typemap(javaimports) CMMCore %{
    import java.awt.geom.Point2D;
@@ -488,6 +419,24 @@
       return popNextTaggedImage(0);
    }
 
+   /*
+    * Removes up to maxCount images from the circular buffer, retrieving
+    * them with a single call into native code. Throws if the buffer is
+    * empty.
+    */
+   public List<TaggedImage> popNextTaggedImages(int maxCount) throws java.lang.Exception {
+      MetadataVector mds = new MetadataVector();
+      Object[] pixels = popNextImagesMD(maxCount, mds);
+      List<TaggedImage> images = new ArrayList<TaggedImage>();
+      if (pixels == null) {
+         return images;
+      }
+      for (int i = 0; i < pixels.length; ++i) {
+         images.add(TaggedImageCreator.createTaggedImage(this, includeSystemStateCache_, pixels[i], mds.get(i), 0));
+      }
+      return images;
+   }
+
    // convenience functions follow
    
    /*
@@ -611,6 +560,75 @@
 #include "ImageMetadata.h"
 #include "MMEventCallback.h"
 #include "MMCore.h"
+
+// Copies imageCount images of the current camera's size and pixel type,
+// packed at pixels, into a new Java array of the matching element type.
+// Returns null (with an OutOfMemoryError pending if allocation failed) on
+// failure.
+static jobject NewPixelArray(JNIEnv* jenv, CMMCore* core, const void* pixels,
+      long imageCount)
+{
+   long lSize = core->getImageWidth() * core->getImageHeight() * imageCount;
+   jarray data = 0;
+
+   if (core->getBytesPerPixel() == 1)
+   {
+      // create a new byte[] object in Java
+      data = jenv->NewByteArray(lSize);
+      if (data != 0)
+         jenv->SetByteArrayRegion(static_cast<jbyteArray>(data), 0, lSize,
+               static_cast<const jbyte*>(pixels));
+   }
+   else if (core->getBytesPerPixel() == 2)
+   {
+      // create a new short[] object in Java
+      data = jenv->NewShortArray(lSize);
+      if (data != 0)
+         jenv->SetShortArrayRegion(static_cast<jshortArray>(data), 0, lSize,
+               static_cast<const jshort*>(pixels));
+   }
+   else if (core->getBytesPerPixel() == 4)
+   {
+      if (core->getNumberOfComponents() == 1)
+      {
+         // create a new float[] object in Java
+         data = jenv->NewFloatArray(lSize);
+         if (data != 0)
+            jenv->SetFloatArrayRegion(static_cast<jfloatArray>(data), 0,
+                  lSize, static_cast<const jfloat*>(pixels));
+      }
+      else
+      {
+         // create a new byte[] object in Java
+         data = jenv->NewByteArray(lSize * 4);
+         if (data != 0)
+            jenv->SetByteArrayRegion(static_cast<jbyteArray>(data), 0,
+                  lSize * 4, static_cast<const jbyte*>(pixels));
+      }
+   }
+   else if (core->getBytesPerPixel() == 8)
+   {
+      // create a new short[] object in Java
+      data = jenv->NewShortArray(lSize * 4);
+      if (data != 0)
+         jenv->SetShortArrayRegion(static_cast<jshortArray>(data), 0,
+               lSize * 4, static_cast<const jshort*>(pixels));
+   }
+   else
+   {
+      // don't know how to map
+      // TODO: throw exception?
+      return 0;
+   }
+
+   if (data == 0)
+   {
+      jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
+      if (excep)
+         jenv->ThrowNew(excep, "The system ran out of memory!");
+   }
+   return data;
+}
 %}
 
 
@@ -930,6 +948,11 @@ namespace std {
 %include "Error.h"
 %include "Configuration.h"
 %include "ImageMetadata.h"
+
+namespace std {
+    %template(MetadataVector) vector<Metadata>;
+}
+
 %include "MMEventCallback.h"
 %include "MMCore.h"
 
@@ -28,6 +28,8 @@
 #include "CameraImageMetadata.h"
 #include "DeviceThreads.h"
 #include "DeviceUtils.h"
+#include "FramePacer.h"
+#include "ImageInsertPipeline.h"
 #include "MMDeviceConstants.h"
 #include "ModuleInterface.h"
 #include "Property.h"
@@ -1138,6 +1140,23 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+    * @brief Report that the device became busy or finished being busy.
+    *
+    * Devices that receive completion notifications from the hardware/driver
+    * can call this whenever their busy state changes. Once a device has
+    * called this, the core uses the reported state instead of calling
+    * Busy(), and waits for the device without polling it. A device that
+    * calls this must therefore keep reporting every change, including
+    * becoming busy as a result of a command from the core.
+    */
+   int OnBusyChanged(bool busy)
+   {
+      if (callback_)
+         return callback_->OnBusyChanged(this, busy);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
    /**
     * @brief Report position change (for single-axis stage).
     *
@@ -1585,9 +1604,47 @@ template <class U>
 class CLegacyCameraBase : public CCameraBase<U>
 {
 public:
-   CLegacyCameraBase() : busy_(false), stopWhenCBOverflows_(false), thd_(0)
+   CLegacyCameraBase() : busy_(false), stopWhenCBOverflows_(false), sequenceBufferCount_(1), thd_(0)
    {
       thd_ = new BaseSequenceThread(this);
+
+      // Frame timing jitter of the current or last sequence acquisition
+      this->CreateFloatProperty(MM::g_Keyword_FrameTimingJitter_ms, 0.0, true,
+         new MM::ActionLambda([this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::BeforeGet)
+               pProp->Set(thd_->GetFramePacer().GetJitterMs());
+            return DEVICE_OK;
+         }));
+
+      // Images buffered between the sequence thread and a second thread
+      // that inserts them, so that the next snap overlaps the insertion of
+      // the last image; 1 inserts each image before the next snap.
+      std::vector<std::string> bufferCounts;
+      bufferCounts.push_back("1");
+      bufferCounts.push_back("2");
+      bufferCounts.push_back("3");
+      this->CreateIntegerProperty(MM::g_Keyword_SequenceBufferCount, sequenceBufferCount_, false,
+         new MM::ActionLambda([this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::BeforeGet)
+               pProp->Set(sequenceBufferCount_);
+            else if (eAct == MM::AfterSet)
+            {
+               if (IsCapturing())
+                  return DEVICE_CAMERA_BUSY_ACQUIRING;
+               pProp->Get(sequenceBufferCount_);
+            }
+            return DEVICE_OK;
+         }));
+      this->SetAllowedValues(MM::g_Keyword_SequenceBufferCount, bufferCounts);
+
+      // Share of the insertion time hidden behind snapping, in the current
+      // or last buffered sequence acquisition
+      this->CreateFloatProperty(MM::g_Keyword_SequenceInsertOverlap, 0.0, true,
+         new MM::ActionLambda([this](MM::PropertyBase* pProp, MM::ActionType eAct) {
+            if (eAct == MM::BeforeGet)
+               pProp->Set(thd_->GetInsertPipeline().GetOverlapPercent());
+            return DEVICE_OK;
+         }));
    }
 
    virtual ~CLegacyCameraBase()
@@ -1673,11 +1730,23 @@ protected:
       this->GetLabel(label);
       MM::CameraImageMetadata md;
       md.AddTag(MM::g_Keyword_Metadata_CameraLabel, label);
+      if (thd_->pipeline_.IsRunning())
+      {
+         // The Core receives the image up to a few frames later, so the
+         // elapsed time is taken now rather than left to the Core
+         md.AddTag(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString(
+            (this->GetCurrentMMTime() - thd_->GetStartTime()).getMsec()));
+         return thd_->pipeline_.Submit(this->GetImageBuffer(), this->GetImageWidth(),
+            this->GetImageHeight(), this->GetImageBytesPerPixel(), md.Serialize());
+      }
       return this->GetCoreCallback()->InsertImage(this, this->GetImageBuffer(), this->GetImageWidth(),
          this->GetImageHeight(), this->GetImageBytesPerPixel(),
          md.Serialize());
    }
 
+   // Interval between the starts of successive ThreadRun() calls; the
+   // sequence thread paces them against absolute deadlines. Zero (the
+   // default) runs them back to back.
    virtual double GetIntervalMs() {return 0.0;}
    virtual long GetImageCounter() {return thd_->GetImageCounter();}
    virtual long GetNumberOfImages() {return thd_->GetNumberOfImages();}
@@ -1744,6 +1813,7 @@ protected:
       void Stop() {
          MMThreadGuard g(this->stopLock_);
          stop_=true;
+         pacer_.Stop();
       }
 
       void Start(long numImages)
@@ -1754,10 +1824,20 @@ protected:
          imageCounter_=0;
          stop_ = false;
          suspend_=false;
-         activate();
+         pacer_.Start();
+         if (camera_->sequenceBufferCount_ > 1)
+         {
+            CLegacyCameraBase* cam = camera_;
+            pipeline_.Start(static_cast<unsigned>(cam->sequenceBufferCount_),
+               [cam](const ImgBuffer& img, const std::string& md) {
+                  return cam->GetCoreCallback()->InsertImage(cam, img.GetPixels(),
+                     img.Width(), img.Height(), img.Depth(), md.c_str());
+               });
+         }
          actualDuration_ = MM::MMTime{};
          startTime_= camera_->GetCurrentMMTime();
          lastFrameTime_ = MM::MMTime{};
+         activate();
       }
       bool IsStopped(){
          MMThreadGuard g(this->stopLock_);
@@ -1783,6 +1863,8 @@ protected:
 
       CLegacyCameraBase* GetCamera() {return camera_;}
       long GetNumberOfImages() {return numImages_;}
+      const MMFramePacer& GetFramePacer() const {return pacer_;}
+      const MMImageInsertPipeline& GetInsertPipeline() const {return pipeline_;}
 
       void UpdateActualDuration() {actualDuration_ = camera_->GetCurrentMMTime() - startTime_;}
 
@@ -1792,16 +1874,23 @@ protected:
          int ret=DEVICE_ERR;
          try
          {
+            // Each frame after the first waits for its deadline on the
+            // pacer's schedule (returning false if stopped meanwhile)
             do
             {
                ret=camera_->ThreadRun();
-            } while (DEVICE_OK == ret && !IsStopped() && imageCounter_++ < numImages_-1);
+            } while (DEVICE_OK == ret && !IsStopped() && imageCounter_++ < numImages_-1
+                  && pacer_.WaitForNextFrame(camera_->GetIntervalMs()));
             if (IsStopped())
                camera_->LogMessage("SeqAcquisition interrupted by the user\n");
 
          }catch(...){
             camera_->LogMessage(g_Msg_EXCEPTION_IN_THREAD, false);
          }
+         // All images are in the Core before the acquisition is finished
+         const int insertRet = pipeline_.Finish();
+         if (ret == DEVICE_OK)
+            ret = insertRet;
          stop_=true;
          UpdateActualDuration();
          camera_->OnThreadExiting();
@@ -1816,6 +1905,8 @@ protected:
       MM::MMTime startTime_;
       MM::MMTime actualDuration_;
       MM::MMTime lastFrameTime_;
+      MMFramePacer pacer_;
+      MMImageInsertPipeline pipeline_;
       MMThreadLock stopLock_;
       MMThreadLock suspendLock_;
    };
@@ -1826,6 +1917,7 @@ private:
 
    bool busy_;
    bool stopWhenCBOverflows_;
+   long sequenceBufferCount_;
 
    BaseSequenceThread * thd_;
    friend class BaseSequenceThread;
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FramePacer.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Absolute-deadline frame timing for sequence threads
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#include "FramePacer.h"
+
+#include <cmath>
+
+MMFramePacer::MMFramePacer() :
+   stopped_(false),
+   deadline_(Clock::now()),
+   frameCount_(0),
+   meanLatenessMs_(0.0),
+   sumSquaredDeviations_(0.0),
+   maxLatenessMs_(0.0)
+{
+}
+
+void MMFramePacer::Start()
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   stopped_ = false;
+   deadline_ = Clock::now();
+   frameCount_ = 0;
+   meanLatenessMs_ = 0.0;
+   sumSquaredDeviations_ = 0.0;
+   maxLatenessMs_ = 0.0;
+}
+
+bool MMFramePacer::WaitForNextFrame(double intervalMs)
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   if (intervalMs <= 0.0)
+   {
+      deadline_ = Clock::now();
+      return !stopped_;
+   }
+
+   const Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(intervalMs));
+   deadline_ += interval;
+
+   // With a steady clock time point, this is an absolute wait on the
+   // monotonic clock (pthread_cond_clockwait on Linux), so preemption
+   // between computing the deadline and going to sleep does not delay the
+   // wake-up.
+   if (stopCondition_.wait_until(lock, deadline_, [this] { return stopped_; }))
+      return false;
+
+   const Clock::time_point now = Clock::now();
+   const Clock::duration lateness = now - deadline_;
+   RecordLateness(std::chrono::duration<double, std::milli>(lateness).count());
+   if (lateness > interval)
+      deadline_ = now;
+   return true;
+}
+
+void MMFramePacer::Stop()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+   }
+   stopCondition_.notify_all();
+}
+
+void MMFramePacer::RecordLateness(double latenessMs)
+{
+   ++frameCount_;
+   const double delta = latenessMs - meanLatenessMs_;
+   meanLatenessMs_ += delta / frameCount_;
+   sumSquaredDeviations_ += delta * (latenessMs - meanLatenessMs_);
+   if (frameCount_ == 1 || latenessMs > maxLatenessMs_)
+      maxLatenessMs_ = latenessMs;
+}
+
+long MMFramePacer::GetFrameCount() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return frameCount_;
+}
+
+double MMFramePacer::GetJitterMs() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (frameCount_ < 2)
+      return 0.0;
+   return std::sqrt(sumSquaredDeviations_ / (frameCount_ - 1));
+}
+
+double MMFramePacer::GetMeanLatenessMs() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return meanLatenessMs_;
+}
+
+double MMFramePacer::GetMaxLatenessMs() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return maxLatenessMs_;
+}
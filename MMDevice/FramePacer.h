@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          FramePacer.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Absolute-deadline frame timing for sequence threads
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @brief Paces the frames of a sequence acquisition against a fixed schedule.
+ *
+ * Sleeping for the frame interval after each frame makes the frame period
+ * longer than the interval by the time spent on the frame plus the
+ * oversleep of each wait, and the error accumulates over the sequence.
+ * MMFramePacer instead keeps an absolute deadline on the monotonic clock,
+ * which advances by exactly one interval per frame, and waits until it, so
+ * that timing errors do not add up.
+ *
+ * The wait can be cut short from another thread with Stop(), so a sequence
+ * thread with a long interval still stops promptly.
+ *
+ * How late each wait returns relative to its deadline is recorded; the
+ * standard deviation of that lateness is the jitter of the frame timing.
+ */
+class MMFramePacer
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   MMFramePacer();
+
+   /**
+    * @brief Start a new schedule, with its first deadline at the current time.
+    *
+    * Clears a previous Stop() and the timing statistics. Call this from the
+    * thread that starts the sequence, before starting the sequence thread,
+    * so that a Stop() issued right after starting is not lost.
+    */
+   void Start();
+
+   /**
+    * @brief Advance the deadline by intervalMs and wait until it is reached.
+    *
+    * If the deadline has already passed, returns immediately. If it passed
+    * by more than an interval (the frames take longer than the interval),
+    * the schedule restarts from the current time instead of trying to catch
+    * up. An interval of zero or less restarts the schedule without waiting
+    * or recording statistics (free-running acquisition).
+    *
+    * @return false if Stop() was called, true otherwise.
+    */
+   bool WaitForNextFrame(double intervalMs);
+
+   /**
+    * @brief Interrupt the current and any further waits until Start().
+    */
+   void Stop();
+
+   /**
+    * @brief Number of paced frames since Start().
+    */
+   long GetFrameCount() const;
+
+   /**
+    * @brief Standard deviation of the lateness of the paced frames (ms).
+    */
+   double GetJitterMs() const;
+
+   /**
+    * @brief Mean lateness of the paced frames relative to their deadlines (ms).
+    */
+   double GetMeanLatenessMs() const;
+
+   /**
+    * @brief Largest lateness of the paced frames relative to their deadlines (ms).
+    */
+   double GetMaxLatenessMs() const;
+
+private:
+   void RecordLateness(double latenessMs);
+
+   mutable std::mutex mutex_;
+   std::condition_variable stopCondition_;
+   bool stopped_;
+   Clock::time_point deadline_;
+
+   // Running mean and sum of squared deviations (Welford's method)
+   long frameCount_;
+   double meanLatenessMs_;
+   double sumSquaredDeviations_;
+   double maxLatenessMs_;
+};
@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageInsertPipeline.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Inserts sequence images on a separate thread, so that
+//                capturing the next image overlaps inserting the last
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#include "ImageInsertPipeline.h"
+
+#include "MMDeviceConstants.h"
+
+MMImageInsertPipeline::MMImageInsertPipeline() :
+   running_(false),
+   finishing_(false),
+   error_(DEVICE_OK),
+   insertTime_(Clock::duration::zero()),
+   waitTime_(Clock::duration::zero())
+{
+}
+
+MMImageInsertPipeline::~MMImageInsertPipeline()
+{
+   Finish();
+}
+
+void MMImageInsertPipeline::Start(unsigned bufferCount, InsertFunction insert)
+{
+   Finish();
+
+   std::lock_guard<std::mutex> lock(mutex_);
+   // Buffers keep their allocation from run to run
+   slots_.resize(bufferCount < 2 ? 2 : bufferCount);
+   free_.clear();
+   for (Slot& slot : slots_)
+      free_.push_back(&slot);
+   queued_.clear();
+   insert_ = insert;
+   error_ = DEVICE_OK;
+   insertTime_ = Clock::duration::zero();
+   waitTime_ = Clock::duration::zero();
+   finishing_ = false;
+   running_ = true;
+   thread_ = std::thread([this] { InsertLoop(); });
+}
+
+int MMImageInsertPipeline::Submit(const unsigned char* pixels, unsigned width,
+   unsigned height, unsigned bytesPerPixel, const std::string& serializedMetadata)
+{
+   Slot* slot = nullptr;
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!running_)
+         return DEVICE_ERR;
+      if (free_.empty() && error_ == DEVICE_OK)
+      {
+         const Clock::time_point start = Clock::now();
+         slotFree_.wait(lock, [this] { return !free_.empty() || error_ != DEVICE_OK; });
+         waitTime_ += Clock::now() - start;
+      }
+      if (error_ != DEVICE_OK)
+         return error_;
+      slot = free_.back();
+      free_.pop_back();
+   }
+
+   // The slot is owned by this thread until it is queued
+   slot->image.Resize(width, height, bytesPerPixel);
+   slot->image.SetPixels(pixels);
+   slot->metadata = serializedMetadata;
+
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_.push_back(slot);
+   }
+   slotQueued_.notify_one();
+   return DEVICE_OK;
+}
+
+int MMImageInsertPipeline::Finish()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_)
+         return error_;
+      finishing_ = true;
+   }
+   slotQueued_.notify_one();
+
+   // Inserting the images still queued is not overlapped with capturing
+   const Clock::time_point start = Clock::now();
+   thread_.join();
+
+   std::lock_guard<std::mutex> lock(mutex_);
+   waitTime_ += Clock::now() - start;
+   running_ = false;
+   return error_;
+}
+
+bool MMImageInsertPipeline::IsRunning() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return running_;
+}
+
+double MMImageInsertPipeline::GetOverlapPercent() const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (insertTime_ <= Clock::duration::zero())
+      return 0.0;
+   const double waited = static_cast<double>(waitTime_.count()) /
+      static_cast<double>(insertTime_.count());
+   return waited >= 1.0 ? 0.0 : 100.0 * (1.0 - waited);
+}
+
+void MMImageInsertPipeline::InsertLoop()
+{
+   for (;;)
+   {
+      Slot* slot = nullptr;
+      bool failed = false;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         slotQueued_.wait(lock, [this] { return !queued_.empty() || finishing_; });
+         if (queued_.empty())
+            return;
+         slot = queued_.front();
+         queued_.pop_front();
+         failed = (error_ != DEVICE_OK);
+      }
+
+      int ret = DEVICE_OK;
+      const Clock::time_point start = Clock::now();
+      if (!failed)
+      {
+         try
+         {
+            ret = insert_(slot->image, slot->metadata);
+         }
+         catch (...)
+         {
+            ret = DEVICE_ERR;
+         }
+      }
+      const Clock::duration elapsed = Clock::now() - start;
+
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         insertTime_ += elapsed;
+         if (ret != DEVICE_OK && error_ == DEVICE_OK)
+            error_ = ret;
+         free_.push_back(slot);
+      }
+      slotFree_.notify_one();
+   }
+}
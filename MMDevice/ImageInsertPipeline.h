@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageInsertPipeline.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Inserts sequence images on a separate thread, so that
+//                capturing the next image overlaps inserting the last
+// COPYRIGHT:     University of California, San Francisco, 2006
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#pragma once
+
+#include "ImgBuffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Hands sequence images to a thread that inserts them into the Core.
+ *
+ * A camera that acquires a sequence as a series of snaps normally inserts
+ * each image before snapping the next, so the time the Core takes to copy
+ * the image and build its metadata adds to the frame period. With this
+ * pipeline, the sequence thread copies each image into one of a small pool
+ * of buffers and goes on to the next snap, while an insertion thread passes
+ * the buffered images to the Core in order. With two buffers, one image can
+ * be inserted while the next is captured (double buffering); a third buffer
+ * absorbs variation in the time either side takes.
+ *
+ * The pipeline reports how much of the insertion time was overlapped with
+ * capturing: the share of it during which the sequence thread did not have
+ * to wait for a free buffer.
+ */
+class MMImageInsertPipeline
+{
+public:
+   // Inserts an image with its serialized metadata; returns an MM error code
+   typedef std::function<int(const ImgBuffer&, const std::string&)> InsertFunction;
+
+   MMImageInsertPipeline();
+   ~MMImageInsertPipeline();
+
+   /**
+    * @brief Start the insertion thread with bufferCount (at least 2) buffers.
+    *
+    * Clears a previous error and the overlap statistics.
+    */
+   void Start(unsigned bufferCount, InsertFunction insert);
+
+   /**
+    * @brief Queue a copy of an image for insertion.
+    *
+    * Waits for a free buffer if all of them are queued. If a previously
+    * queued image failed to insert, the image is dropped and that error is
+    * returned; images queued after a failure are not inserted.
+    */
+   int Submit(const unsigned char* pixels, unsigned width, unsigned height,
+      unsigned bytesPerPixel, const std::string& serializedMetadata);
+
+   /**
+    * @brief Wait until all queued images are inserted and stop the thread.
+    *
+    * Returns the error of the first image that failed to insert, if any.
+    */
+   int Finish();
+
+   bool IsRunning() const;
+
+   /**
+    * @brief Percentage of insertion time overlapped with capturing.
+    *
+    * For the current or last run; 0 before the first image is inserted.
+    */
+   double GetOverlapPercent() const;
+
+private:
+   typedef std::chrono::steady_clock Clock;
+
+   struct Slot {
+      ImgBuffer image;
+      std::string metadata;
+   };
+
+   void InsertLoop();
+
+   mutable std::mutex mutex_;
+   std::condition_variable slotFree_;
+   std::condition_variable slotQueued_;
+   std::thread thread_;
+   bool running_;
+   bool finishing_;
+   int error_;
+   InsertFunction insert_;
+
+   std::vector<Slot> slots_;
+   std::vector<Slot*> free_;
+   std::deque<Slot*> queued_;
+
+   Clock::duration insertTime_;
+   Clock::duration waitTime_; // Sequence thread waiting on insertion
+};
@@ -28,6 +28,11 @@ class ImgBuffer
 {
 public:
    ImgBuffer(unsigned xSize, unsigned ySize, unsigned pixDepth);
+   // Use externally owned pixel memory (e.g., a Core write slot), which must
+   // stay valid for the lifetime of this object. Resizing to a larger size
+   // switches to an internally allocated buffer.
+   ImgBuffer(unsigned char* externalPixels, unsigned xSize, unsigned ySize,
+      unsigned pixDepth);
    ImgBuffer(const ImgBuffer& ib);
    ImgBuffer();
    ~ImgBuffer();
@@ -52,7 +57,10 @@ public:
    ImgBuffer& operator=(const ImgBuffer& rhs);
 
 private:
+   void ReleasePixels();
+
    unsigned char* pixels_;
+   bool ownsPixels_;
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
@@ -26,7 +26,7 @@
 
 // Device Interface Version — see README.md for the full versioning policy.
 // Must be incremented for any binary-incompatible change.
-#define DEVICE_INTERFACE_VERSION 75
+#define DEVICE_INTERFACE_VERSION 76
 
 // N.B. Method parameters and return values in Device and its derived
 // classes must be POD types or pointers (no std::string, etc.) to
@@ -1679,6 +1679,12 @@ namespace MM {
        * @brief Signal that the shutter opened or closed.
        */
       virtual int OnShutterOpenChanged(const Device* caller, bool open) = 0;
+      /**
+       * @brief Report that the device became busy or finished being busy.
+       *
+       * @see CDeviceBase::OnBusyChanged()
+       */
+      virtual int OnBusyChanged(const Device* caller, bool busy) = 0;
 
       // Deprecated: Return value overflows in ~72 minutes on Windows.
       // Prefer std::chrono::steady_clock for time delta measurements.
@@ -1730,6 +1736,50 @@ namespace MM {
          unsigned width, unsigned height, unsigned bytePerPixel,
          const char* serializedMetadata = nullptr) = 0;
 
+      /**
+       * @brief Obtain a Core-owned buffer to write the next sequence frame into.
+       *
+       * This is an alternative to InsertImage() that avoids copying the
+       * frame: the camera writes (e.g., DMAs or decodes) pixel data directly
+       * into the sequence buffer, then calls CommitImageWriteSlot().
+       *
+       * On success, *pixels is set to a buffer of width * height *
+       * bytesPerPixel bytes. The camera must then call exactly one of
+       * CommitImageWriteSlot() or AbortImageWriteSlot() with that pointer,
+       * from the same thread, before acquiring another slot. Other image
+       * insertions may be blocked while a slot is held, so the slot should
+       * be committed as soon as the frame is complete.
+       *
+       * The width, height, bytesPerPixel, and nComponents parameters have the
+       * same meaning as for InsertImage().
+       *
+       * Returns DEVICE_BUFFER_OVERFLOW if the sequence buffer is full,
+       * DEVICE_INCOMPATIBLE_IMAGE if the image size does not match the
+       * sequence buffer, or DEVICE_NOT_SUPPORTED if the Core cannot provide a
+       * slot (in which case the camera should use InsertImage() instead). As
+       * with InsertImage(), cameras should stop the acquisition on any other
+       * error.
+       */
+      virtual int AcquireImageWriteSlot(const Device* caller,
+         unsigned width, unsigned height, unsigned bytesPerPixel,
+         unsigned nComponents, unsigned char** pixels) = 0;
+
+      /**
+       * @brief Send a frame written into a slot obtained with
+       * AcquireImageWriteSlot() to the Core.
+       *
+       * serializedMetadata: same as for InsertImage()
+       */
+      virtual int CommitImageWriteSlot(const Device* caller,
+         unsigned char* pixels, const char* serializedMetadata = nullptr) = 0;
+
+      /**
+       * @brief Give up a slot obtained with AcquireImageWriteSlot() without
+       * sending a frame.
+       */
+      virtual int AbortImageWriteSlot(const Device* caller,
+         unsigned char* pixels) = 0;
+
       /**
        * @brief Prepare the sequence buffer for the given image size and pixel format.
        *
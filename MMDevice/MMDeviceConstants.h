@@ -107,6 +107,9 @@ namespace MM {
    const char* const g_Keyword_ActualExposure   = "ActualExposure";
    const char* const g_Keyword_ActualInterval_ms= "ActualInterval-ms";
    const char* const g_Keyword_Interval_ms      = "Interval-ms";
+   const char* const g_Keyword_FrameTimingJitter_ms = "FrameTimingJitter-ms";
+   const char* const g_Keyword_SequenceBufferCount = "SequenceBufferCount";
+   const char* const g_Keyword_SequenceInsertOverlap = "SequenceInsertOverlapPercent";
    const char* const g_Keyword_Elapsed_Time_ms  = "ElapsedTime-ms";
    const char* const g_Keyword_PixelType        = "PixelType";
    const char* const g_Keyword_ReadoutTime      = "ReadoutTime";
@@ -145,6 +148,23 @@ namespace MM {
    const char* const g_Keyword_CorePressurePump = "PressurePump";
    const char* const g_Keyword_CoreVolumetricPump = "VolumetricPump";
    const char* const g_Keyword_CoreTimeoutMs    = "TimeoutMs";
+   const char* const g_Keyword_CoreCircularBufferEngine = "CircularBufferEngine";
+   const char* const g_Keyword_CoreCircularBufferStorage = "CircularBufferStorage";
+   const char* const g_Keyword_CoreCircularBufferHugePages = "CircularBufferHugePages";
+   const char* const g_Keyword_CoreCircularBufferPrefault = "CircularBufferPrefault";
+   const char* const g_Keyword_CoreCircularBufferNumaNode = "CircularBufferNumaNode";
+   const char* const g_Keyword_CoreCircularBufferSpillDirectory = "CircularBufferSpillDirectory";
+   const char* const g_Keyword_CoreCircularBufferSpillSizeMB = "CircularBufferSpillSizeMB";
+   const char* const g_Keyword_CoreCircularBufferAllocationTimeMs = "CircularBufferAllocationTimeMs";
+   const char* const g_Keyword_CoreCircularBufferAllocationPageFaults = "CircularBufferAllocationPageFaults";
+   const char* const g_Keyword_CoreThreadPoolSize = "ThreadPoolSize";
+   const char* const g_Keyword_CoreThreadPoolPinThreads = "ThreadPoolPinThreads";
+   const char* const g_Keyword_CoreThreadPoolUtilization = "ThreadPoolUtilization";
+   const char* const g_Keyword_CoreParallelConfigApply = "ParallelConfigApply";
+   const char* const g_Keyword_CoreParallelBusyPolling = "ParallelBusyPolling";
+   const char* const g_Keyword_CoreParallelStateRead = "ParallelStateRead";
+   const char* const g_Keyword_CoreNotificationQueueCapacity = "NotificationQueueCapacity";
+   const char* const g_Keyword_CoreNotificationQueueStatistics = "NotificationQueueStatistics";
    const char* const g_Keyword_Channel          = "Channel";
    const char* const g_Keyword_Version          = "Version";
    const char* const g_Keyword_ColorMode        = "ColorMode";
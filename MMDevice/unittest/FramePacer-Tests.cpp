@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+
+#include "FramePacer.h"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+double MsSince(MMFramePacer::Clock::time_point start)
+{
+   return std::chrono::duration<double, std::milli>(
+      MMFramePacer::Clock::now() - start).count();
+}
+
+} // namespace
+
+TEST_CASE("FramePacer work does not add to the frame period", "[FramePacer]")
+{
+   MMFramePacer pacer;
+   const auto start = MMFramePacer::Clock::now();
+   pacer.Start();
+   for (int i = 0; i < 10; ++i)
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      CHECK(pacer.WaitForNextFrame(20.0));
+   }
+   const double elapsed = MsSince(start);
+   CHECK(elapsed >= 200.0);
+   // Sleeping 20 ms after each frame would take 250 ms
+   CHECK(elapsed < 240.0);
+   CHECK(pacer.GetFrameCount() == 10);
+   CHECK(pacer.GetMeanLatenessMs() >= 0.0);
+   CHECK(pacer.GetMaxLatenessMs() >= pacer.GetMeanLatenessMs());
+   CHECK(pacer.GetJitterMs() >= 0.0);
+}
+
+TEST_CASE("FramePacer restarts the schedule after an overrun", "[FramePacer]")
+{
+   MMFramePacer pacer;
+   pacer.Start();
+   std::this_thread::sleep_for(std::chrono::milliseconds(30));
+   CHECK(pacer.WaitForNextFrame(5.0));
+   CHECK(pacer.GetMaxLatenessMs() >= 20.0);
+
+   // The next frame is an interval from now, not due immediately
+   const auto start = MMFramePacer::Clock::now();
+   CHECK(pacer.WaitForNextFrame(5.0));
+   CHECK(MsSince(start) >= 4.0);
+}
+
+TEST_CASE("FramePacer zero interval does not wait", "[FramePacer]")
+{
+   MMFramePacer pacer;
+   pacer.Start();
+   CHECK(pacer.WaitForNextFrame(0.0));
+   CHECK(pacer.WaitForNextFrame(-1.0));
+   CHECK(pacer.GetFrameCount() == 0);
+   CHECK(pacer.GetJitterMs() == 0.0);
+}
+
+TEST_CASE("FramePacer stop interrupts a wait", "[FramePacer]")
+{
+   MMFramePacer pacer;
+   pacer.Start();
+   const auto start = MMFramePacer::Clock::now();
+   std::thread stopper([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      pacer.Stop();
+   });
+   CHECK_FALSE(pacer.WaitForNextFrame(60000.0));
+   stopper.join();
+   CHECK(MsSince(start) < 30000.0);
+   CHECK(pacer.GetFrameCount() == 0);
+}
+
+TEST_CASE("FramePacer stop persists until restarted", "[FramePacer]")
+{
+   MMFramePacer pacer;
+   pacer.Start();
+   pacer.Stop();
+   CHECK_FALSE(pacer.WaitForNextFrame(60000.0));
+   CHECK_FALSE(pacer.WaitForNextFrame(0.0));
+
+   pacer.Start();
+   CHECK(pacer.WaitForNextFrame(1.0));
+   CHECK(pacer.GetFrameCount() == 1);
+}
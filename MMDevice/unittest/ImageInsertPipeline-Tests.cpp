@@ -0,0 +1,107 @@
+#include <catch2/catch_all.hpp>
+
+#include "ImageInsertPipeline.h"
+#include "MMDeviceConstants.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ImageInsertPipeline inserts images in order", "[ImageInsertPipeline]")
+{
+   // Checked after Finish(), as assertions are not thread safe
+   std::vector<unsigned> sizes;
+   std::vector<unsigned char> firstPixels;
+   std::vector<std::string> metadata;
+   MMImageInsertPipeline pipeline;
+   pipeline.Start(2, [&](const ImgBuffer& img, const std::string& md) {
+      sizes.push_back(img.Width() * 100 + img.Height() * 10 + img.Depth());
+      firstPixels.push_back(img.GetPixels()[0]);
+      metadata.push_back(md);
+      return DEVICE_OK;
+   });
+   CHECK(pipeline.IsRunning());
+
+   std::vector<unsigned char> pixels(4 * 3 * 2);
+   for (unsigned char i = 0; i < 10; ++i)
+   {
+      pixels[0] = i;
+      CHECK(pipeline.Submit(pixels.data(), 4, 3, 2, std::to_string(i)) == DEVICE_OK);
+   }
+   CHECK(pipeline.Finish() == DEVICE_OK);
+   CHECK_FALSE(pipeline.IsRunning());
+
+   REQUIRE(firstPixels.size() == 10);
+   for (unsigned char i = 0; i < 10; ++i)
+   {
+      CHECK(sizes[i] == 432);
+      CHECK(firstPixels[i] == i);
+      CHECK(metadata[i] == std::to_string(i));
+   }
+}
+
+TEST_CASE("ImageInsertPipeline stops inserting after an error", "[ImageInsertPipeline]")
+{
+   int inserted = 0;
+   MMImageInsertPipeline pipeline;
+   pipeline.Start(2, [&](const ImgBuffer&, const std::string&) {
+      return ++inserted == 2 ? DEVICE_BUFFER_OVERFLOW : DEVICE_OK;
+   });
+
+   const unsigned char pixel = 0;
+   int ret = DEVICE_OK;
+   for (int i = 0; i < 100 && ret == DEVICE_OK; ++i)
+   {
+      ret = pipeline.Submit(&pixel, 1, 1, 1, "");
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   CHECK(ret == DEVICE_BUFFER_OVERFLOW);
+   CHECK(pipeline.Finish() == DEVICE_BUFFER_OVERFLOW);
+   CHECK(inserted == 2);
+
+   // Restarting clears the error
+   pipeline.Start(3, [](const ImgBuffer&, const std::string&) { return DEVICE_OK; });
+   CHECK(pipeline.Submit(&pixel, 1, 1, 1, "") == DEVICE_OK);
+   CHECK(pipeline.Finish() == DEVICE_OK);
+}
+
+TEST_CASE("ImageInsertPipeline requires Start", "[ImageInsertPipeline]")
+{
+   MMImageInsertPipeline pipeline;
+   const unsigned char pixel = 0;
+   CHECK(pipeline.Submit(&pixel, 1, 1, 1, "") == DEVICE_ERR);
+   CHECK(pipeline.Finish() == DEVICE_OK);
+   CHECK(pipeline.GetOverlapPercent() == 0.0);
+}
+
+TEST_CASE("ImageInsertPipeline overlap", "[ImageInsertPipeline]")
+{
+   const unsigned char pixel = 0;
+   MMImageInsertPipeline pipeline;
+   const auto insertSlowly = [](const ImgBuffer&, const std::string&) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      return DEVICE_OK;
+   };
+
+   SECTION("capturing slower than inserting hides the insertion")
+   {
+      pipeline.Start(2, insertSlowly);
+      for (int i = 0; i < 10; ++i)
+      {
+         std::this_thread::sleep_for(std::chrono::milliseconds(20));
+         CHECK(pipeline.Submit(&pixel, 1, 1, 1, "") == DEVICE_OK);
+      }
+      CHECK(pipeline.Finish() == DEVICE_OK);
+      CHECK(pipeline.GetOverlapPercent() > 50.0);
+   }
+
+   SECTION("instant capturing waits for the insertion")
+   {
+      pipeline.Start(2, insertSlowly);
+      for (int i = 0; i < 10; ++i)
+         CHECK(pipeline.Submit(&pixel, 1, 1, 1, "") == DEVICE_OK);
+      CHECK(pipeline.Finish() == DEVICE_OK);
+      CHECK(pipeline.GetOverlapPercent() < 50.0);
+   }
+}
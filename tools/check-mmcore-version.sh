@@ -0,0 +1,23 @@
+#!/bin/bash
+
+# The MMCoreJ artifact version must match the MMCore API version, so that the
+# version bump that comes with new API is never applied to only one of them.
+# VersionConsistencyIT checks the same against a built MMCoreJ; this check
+# only needs the sources, so it runs on every change.
+
+cd "$(git rev-parse --show-toplevel)" || exit 1
+
+core_version=$(sed -n -E 's/^const int MMCore_versionMajor = ([0-9]+), MMCore_versionMinor = ([0-9]+), MMCore_versionPatch = ([0-9]+);.*/\1.\2.\3/p' MMCore/MMCore.cpp)
+pom_version=$(sed -n -E '0,/<version>/s|^ *<version>([^<]*)</version>.*|\1|p' MMCoreJ_wrap/pom.xml)
+
+if [ -z "$core_version" ]; then
+    echo "Cannot find the MMCore version in MMCore/MMCore.cpp" >&2
+    exit 1
+fi
+
+if [ "$core_version" != "$pom_version" ]; then
+    echo "MMCore version $core_version does not match MMCoreJ_wrap/pom.xml version $pom_version" >&2
+    exit 1
+fi
+
+echo "MMCore and MMCoreJ versions match ($core_version)" >&2